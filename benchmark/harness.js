@@ -0,0 +1,141 @@
+/**
+ * Hot Updates Benchmark Harness
+ *
+ * Runs inside the test app (and, as part of the served bundle, inside every
+ * installed version). Asks benchmark/server.js for the next lifecycle step,
+ * runs it and reports wall time and getMetrics() back. State across reloads
+ * lives on the server, so the page itself keeps none.
+ *
+ * Include after cordova.js:
+ *   <script src="harness.js" data-server="http://192.168.1.10:8080"></script>
+ */
+
+(function() {
+    'use strict';
+
+    var script = document.currentScript;
+    var server = script && script.getAttribute('data-server');
+    if (!server) {
+        console.error('[HotUpdates Benchmark] data-server attribute is missing');
+        return;
+    }
+
+    function log(message) {
+        console.log('[HotUpdates Benchmark] ' + message);
+        var status = document.getElementById('benchmark-status');
+        if (status) status.textContent = message;
+    }
+
+    function request(method, path, body, callback) {
+        var xhr = new XMLHttpRequest();
+        xhr.open(method, server + path);
+        xhr.setRequestHeader('Content-Type', 'application/json');
+        xhr.onload = function() {
+            callback(null, JSON.parse(xhr.responseText));
+        };
+        xhr.onerror = function() {
+            callback(new Error('Benchmark server ' + server + ' is not reachable'));
+        };
+        xhr.send(body ? JSON.stringify(body) : null);
+    }
+
+    function report(data, callback) {
+        request('POST', '/report', data, function(error, run) {
+            if (error) {
+                log(error.message);
+                return;
+            }
+            if (callback) callback(run);
+        });
+    }
+
+    function device() {
+        var info = window.device || {};
+        return {
+            platform: info.platform || cordova.platformId,
+            model: info.model || null,
+            osVersion: info.version || null,
+            userAgent: navigator.userAgent
+        };
+    }
+
+    // ============================================================
+    // Steps
+    // ============================================================
+
+    var steps = {
+        download: function(run) {
+            hotUpdate.getMetrics({clear: true}, function(baseline) {
+                var startedAt = Date.now();
+                hotUpdate.getUpdate(run.update, function(error) {
+                    report({
+                        step: 'download',
+                        startedAt: startedAt,
+                        wallMs: Date.now() - startedAt,
+                        baseline: baseline,
+                        device: device(),
+                        error: error ? error.error : null
+                    }, next);
+                });
+            });
+        },
+
+        // Reload follows; the canary step runs in the installed version
+        install: function() {
+            report({step: 'install', startedAt: Date.now()}, function() {
+                hotUpdate.forceUpdate(function(error) {
+                    if (error) log('forceUpdate failed: ' + JSON.stringify(error.error));
+                });
+            });
+        },
+
+        canary: function(run) {
+            hotUpdate.canary(run.version, function() {
+                report({step: 'canary', at: Date.now()}, next);
+            });
+        },
+
+        // Forced rollback to the version the update replaced
+        rollback: function() {
+            hotUpdate.getVersionInfo(function(info) {
+                var target = info.previousVersion || info.appBundleVersion;
+                report({step: 'rollback', startedAt: Date.now(), target: target}, function() {
+                    hotUpdate.rollbackTo(target, function(error) {
+                        if (error) log('rollbackTo failed: ' + JSON.stringify(error.error));
+                    });
+                });
+            });
+        },
+
+        finish: function() {
+            hotUpdate.getVersionInfo(function(info) {
+                hotUpdate.canary(info.installedVersion || info.appBundleVersion, function() {
+                    var at = Date.now();
+                    hotUpdate.getMetrics(function(metrics) {
+                        report({step: 'finish', at: at, metrics: metrics}, next);
+                    });
+                });
+            });
+        }
+    };
+
+    function next(run) {
+        var step = steps[run.step];
+        if (!step) {
+            log(run.step === 'done' ? 'Benchmark finished' : 'Unknown step: ' + run.step);
+            return;
+        }
+        log('Run ' + run.run + '/' + run.runs + ': ' + run.step);
+        step(run);
+    }
+
+    document.addEventListener('deviceready', function() {
+        request('GET', '/run', null, function(error, run) {
+            if (error) {
+                log(error.message);
+                return;
+            }
+            next(run);
+        });
+    }, false);
+})();
@@ -0,0 +1,534 @@
+#!/usr/bin/env node
+
+/**
+ * Hot Updates Benchmark Server
+ *
+ * Builds a synthetic update bundle (the test app's www plus generated files),
+ * serves it over HTTP (Range, If-Range, HEAD) and drives harness.js on the
+ * device through the update lifecycle:
+ *
+ *   getUpdate -> forceUpdate -> reload -> canary -> rollbackTo(previous) -> reload
+ *
+ * The harness reports wall times and getMetrics() after each step; the server
+ * aggregates them into one JSON report per platform and bundle.
+ *
+ * Usage: node benchmark/server.js --www <platform www> [--preset 100x1MB] [--runs 3]
+ * See benchmark/README.md.
+ */
+
+'use strict';
+
+var fs = require('fs');
+var path = require('path');
+var http = require('http');
+var zlib = require('zlib');
+var crypto = require('crypto');
+
+var PRESETS = {
+    '100x1MB': {files: 100, fileSize: 1024 * 1024},
+    '1000x50KB': {files: 1000, fileSize: 50 * 1024},
+    '10000x2KB': {files: 10000, fileSize: 2 * 1024}
+};
+
+// ============================================================
+// Options
+// ============================================================
+
+function parseArgs(argv) {
+    var options = {
+        www: null,
+        preset: '100x1MB',
+        files: null,
+        fileSize: null,
+        compressible: false,
+        stored: false,
+        runs: 3,
+        port: 8080,
+        connections: 1,
+        packed: false,
+        out: path.join(__dirname, 'results')
+    };
+
+    for (var i = 2; i < argv.length; i++) {
+        var arg = argv[i];
+        var value = argv[i + 1];
+        switch (arg) {
+            case '--www': options.www = value; i++; break;
+            case '--preset': options.preset = value; i++; break;
+            case '--files': options.files = parseInt(value, 10); i++; break;
+            case '--file-size': options.fileSize = parseSize(value); i++; break;
+            case '--runs': options.runs = parseInt(value, 10); i++; break;
+            case '--port': options.port = parseInt(value, 10); i++; break;
+            case '--connections': options.connections = parseInt(value, 10); i++; break;
+            case '--out': options.out = value; i++; break;
+            case '--compressible': options.compressible = true; break;
+            case '--stored': options.stored = true; break;
+            case '--packed': options.packed = true; options.stored = true; break;
+            case '--help':
+                console.log('Usage: node benchmark/server.js --www <dir> [--preset NAME | --files N --file-size SIZE]');
+                console.log('       [--runs N] [--port 8080] [--connections N] [--packed] [--stored] [--compressible] [--out DIR]');
+                console.log('Presets: ' + Object.keys(PRESETS).join(', ') + ' (any NxSIZE works, e.g. 500x64KB)');
+                process.exit(0);
+                break;
+            default:
+                throw new Error('Unknown option: ' + arg);
+        }
+    }
+
+    if (!options.www || !fs.existsSync(path.join(options.www, 'index.html'))) {
+        throw new Error('--www must point to the built www of the test app (with index.html and harness.js)');
+    }
+
+    if (options.files === null || options.fileSize === null) {
+        var preset = PRESETS[options.preset] || parsePreset(options.preset);
+        if (!preset) throw new Error('Unknown preset: ' + options.preset);
+        if (options.files === null) options.files = preset.files;
+        if (options.fileSize === null) options.fileSize = preset.fileSize;
+    }
+    options.name = options.files + 'x' + formatSize(options.fileSize);
+    return options;
+}
+
+// "500x64KB" -> {files: 500, fileSize: 65536}
+function parsePreset(name) {
+    var match = /^(\d+)x(\d+(?:KB|MB|B)?)$/i.exec(name || '');
+    return match ? {files: parseInt(match[1], 10), fileSize: parseSize(match[2])} : null;
+}
+
+function parseSize(value) {
+    var match = /^(\d+)(KB|MB|B)?$/i.exec(value || '');
+    if (!match) throw new Error('Invalid size: ' + value);
+    var unit = (match[2] || 'B').toUpperCase();
+    return parseInt(match[1], 10) * (unit === 'MB' ? 1024 * 1024 : unit === 'KB' ? 1024 : 1);
+}
+
+function formatSize(bytes) {
+    if (bytes % (1024 * 1024) === 0) return (bytes / (1024 * 1024)) + 'MB';
+    if (bytes % 1024 === 0) return (bytes / 1024) + 'KB';
+    return bytes + 'B';
+}
+
+// ============================================================
+// Bundle
+// ============================================================
+
+var CRC_TABLE = (function() {
+    var table = new Int32Array(256);
+    for (var n = 0; n < 256; n++) {
+        var c = n;
+        for (var k = 0; k < 8; k++) {
+            c = c & 1 ? 0xEDB88320 ^ (c >>> 1) : c >>> 1;
+        }
+        table[n] = c;
+    }
+    return table;
+})();
+
+function crc32(buffer) {
+    var crc = -1;
+    for (var i = 0; i < buffer.length; i++) {
+        crc = CRC_TABLE[(crc ^ buffer[i]) & 0xFF] ^ (crc >>> 8);
+    }
+    return (crc ^ -1) >>> 0;
+}
+
+/**
+ * Content of a generated file. Random bytes by default (archive size equals bundle size);
+ * with compressible, JavaScript-like text that deflates roughly like a real bundle.
+ */
+function generateFile(index, size, compressible) {
+    var buffer = Buffer.alloc(size);
+    if (compressible) {
+        var text = Buffer.from('function module' + index + '(a, b) { return a.map(function(x) { return x + b; }); }\n');
+        for (var offset = 0; offset < size; offset += text.length) {
+            text.copy(buffer, offset, 0, Math.min(text.length, size - offset));
+        }
+        return buffer;
+    }
+
+    // xorshift32, seeded per file: same bundle on every start
+    var state = (index + 1) * 2654435761 >>> 0;
+    for (var i = 0; i < size; i++) {
+        state ^= state << 13; state >>>= 0;
+        state ^= state >>> 17;
+        state ^= state << 5; state >>>= 0;
+        buffer[i] = state & 0xFF;
+    }
+    return buffer;
+}
+
+function listFiles(root, dir, result) {
+    fs.readdirSync(path.join(root, dir)).sort().forEach(function(name) {
+        var relative = dir ? dir + '/' + name : name;
+        if (fs.statSync(path.join(root, relative)).isDirectory()) {
+            listFiles(root, relative, result);
+        } else {
+            result.push(relative);
+        }
+    });
+    return result;
+}
+
+/**
+ * ZIP with www/ layout: the app's www (so the harness runs in the installed version)
+ * plus generated files under www/bench/. No data descriptors, no ZIP64.
+ */
+function buildBundle(options) {
+    var entries = listFiles(options.www, '', []).map(function(name) {
+        return {name: 'www/' + name, data: fs.readFileSync(path.join(options.www, name))};
+    });
+    for (var i = 0; i < options.files; i++) {
+        entries.push({
+            name: 'www/bench/f' + ('0000' + i).slice(-5) + '.bin',
+            data: generateFile(i, options.fileSize, options.compressible)
+        });
+    }
+    if (entries.length > 0xFFFF) throw new Error('More than 65535 files need ZIP64, not supported');
+
+    var chunks = [];
+    var central = [];
+    var offset = 0;
+    var bundleBytes = 0;
+
+    entries.forEach(function(entry) {
+        var name = Buffer.from(entry.name);
+        var method = options.stored ? 0 : 8;
+        var body = method === 8 ? zlib.deflateRawSync(entry.data) : entry.data;
+        var crc = crc32(entry.data);
+
+        var local = Buffer.alloc(30);
+        local.writeUInt32LE(0x04034b50, 0);
+        local.writeUInt16LE(20, 4);
+        local.writeUInt16LE(0, 6);
+        local.writeUInt16LE(method, 8);
+        local.writeUInt16LE(0, 10);          // time
+        local.writeUInt16LE(0x21, 12);       // date 1980-01-01
+        local.writeUInt32LE(crc, 14);
+        local.writeUInt32LE(body.length, 18);
+        local.writeUInt32LE(entry.data.length, 22);
+        local.writeUInt16LE(name.length, 26);
+        local.writeUInt16LE(0, 28);
+
+        var header = Buffer.alloc(46);
+        header.writeUInt32LE(0x02014b50, 0);
+        header.writeUInt16LE(20, 4);
+        header.writeUInt16LE(20, 6);
+        header.writeUInt16LE(0, 8);
+        header.writeUInt16LE(method, 10);
+        header.writeUInt16LE(0, 12);
+        header.writeUInt16LE(0x21, 14);
+        header.writeUInt32LE(crc, 16);
+        header.writeUInt32LE(body.length, 20);
+        header.writeUInt32LE(entry.data.length, 24);
+        header.writeUInt16LE(name.length, 28);
+        header.writeUInt32LE(offset, 42);    // extra, comment, disk, attributes stay 0
+        central.push(header, name);
+
+        chunks.push(local, name, body);
+        offset += local.length + name.length + body.length;
+        bundleBytes += entry.data.length;
+    });
+
+    var centralBuffer = Buffer.concat(central);
+    var end = Buffer.alloc(22);
+    end.writeUInt32LE(0x06054b50, 0);
+    end.writeUInt16LE(entries.length, 8);
+    end.writeUInt16LE(entries.length, 10);
+    end.writeUInt32LE(centralBuffer.length, 12);
+    end.writeUInt32LE(offset, 16);
+
+    var archive = Buffer.concat(chunks.concat([centralBuffer, end]));
+    return {
+        archive: archive,
+        etag: '"' + crypto.createHash('sha1').update(archive).digest('hex') + '"',
+        fileCount: entries.length,
+        bundleBytes: bundleBytes
+    };
+}
+
+// ============================================================
+// Report
+// ============================================================
+
+/**
+ * One run from the harness reports: wall times of the lifecycle steps and, per native stage,
+ * summed duration, bytes and net disk change (free space before minus after the stage).
+ */
+function summarizeRun(run) {
+    var baseline = run.download.baseline;
+    var samples = run.finish.metrics.samples || [];
+    var stages = {};
+    var lastFree = baseline.freeBytes;
+    var minFree = baseline.freeBytes;
+
+    samples.forEach(function(sample) {
+        var stage = stages[sample.stage] || (stages[sample.stage] = {count: 0, durationMs: 0, bytes: 0, diskDeltaBytes: 0});
+        stage.count++;
+        stage.durationMs += sample.durationMs;
+        if (sample.bytes > 0) stage.bytes += sample.bytes;
+        if (sample.freeBytes >= 0) {
+            stage.diskDeltaBytes += lastFree - sample.freeBytes;
+            lastFree = sample.freeBytes;
+            minFree = Math.min(minFree, sample.freeBytes);
+        }
+    });
+
+    var memory = run.finish.metrics.memory || {};
+    return {
+        version: run.version,
+        wallMs: {
+            getUpdate: run.download.wallMs,
+            forceUpdateToCanary: run.canary.at - run.install.startedAt,
+            rollbackToCanary: run.finish.at - run.rollback.startedAt,
+            total: run.finish.at - run.download.startedAt
+        },
+        stages: stages,
+        disk: {
+            freeBeforeBytes: baseline.freeBytes,
+            // Sampled at stage ends: the peak inside a stage can be higher
+            peakBytes: baseline.freeBytes - minFree,
+            retainedBytes: baseline.freeBytes - run.finish.metrics.freeBytes
+        },
+        memory: {
+            beforeBytes: baseline.memory.currentBytes,
+            afterBytes: memory.currentBytes,
+            // High-water mark since process start
+            peakBytes: memory.peakBytes
+        }
+    };
+}
+
+function median(values) {
+    var sorted = values.filter(function(v) { return typeof v === 'number'; }).sort(function(a, b) { return a - b; });
+    if (sorted.length === 0) return null;
+    var middle = Math.floor(sorted.length / 2);
+    return sorted.length % 2 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+}
+
+function buildReport(options, bundle, device, runs) {
+    var stageNames = {};
+    runs.forEach(function(run) {
+        Object.keys(run.stages).forEach(function(name) { stageNames[name] = true; });
+    });
+
+    var medianStages = {};
+    Object.keys(stageNames).forEach(function(name) {
+        medianStages[name] = median(runs.map(function(run) {
+            return run.stages[name] ? run.stages[name].durationMs : null;
+        }));
+    });
+
+    return {
+        bundle: {
+            name: options.name,
+            files: bundle.fileCount,
+            generatedFiles: options.files,
+            fileSize: options.fileSize,
+            bundleBytes: bundle.bundleBytes,
+            archiveBytes: bundle.archive.length,
+            compressed: !options.stored,
+            compressible: options.compressible
+        },
+        download: {connections: options.connections, packed: options.packed},
+        device: device,
+        runs: runs,
+        median: {
+            wallMs: {
+                getUpdate: median(runs.map(function(r) { return r.wallMs.getUpdate; })),
+                forceUpdateToCanary: median(runs.map(function(r) { return r.wallMs.forceUpdateToCanary; })),
+                rollbackToCanary: median(runs.map(function(r) { return r.wallMs.rollbackToCanary; })),
+                total: median(runs.map(function(r) { return r.wallMs.total; }))
+            },
+            stageMs: medianStages,
+            peakDiskBytes: median(runs.map(function(r) { return r.disk.peakBytes; })),
+            peakMemoryBytes: median(runs.map(function(r) { return r.memory.peakBytes; }))
+        }
+    };
+}
+
+// ============================================================
+// Lifecycle (state of the device run)
+// ============================================================
+
+function Benchmark(options, bundle) {
+    this.options = options;
+    this.bundle = bundle;
+    this.session = Date.now().toString(36);
+    this.index = 0;
+    this.step = 'download';
+    this.current = null;
+    this.results = [];
+    this.device = null;
+}
+
+Benchmark.prototype.version = function() {
+    return 'bench-' + this.session + '-' + (this.index + 1);
+};
+
+Benchmark.prototype.describe = function(baseUrl) {
+    return {
+        step: this.step,
+        run: this.index + 1,
+        runs: this.options.runs,
+        version: this.version(),
+        update: {
+            url: baseUrl + '/bundle.zip',
+            version: this.version(),
+            connections: this.options.connections,
+            packed: this.options.packed
+        }
+    };
+};
+
+/**
+ * Store a step report and advance. Reports for another step are ignored (page reloaded twice).
+ */
+Benchmark.prototype.report = function(data) {
+    if (data.step !== this.step) return;
+
+    if (data.step === 'download') {
+        this.device = data.device || this.device;
+        this.current = {version: this.version()};
+        if (data.error) {
+            this.fail(data.error);
+            return;
+        }
+    }
+    this.current[data.step] = data;
+
+    var next = {download: 'install', install: 'canary', canary: 'rollback', rollback: 'finish'};
+    if (data.step !== 'finish') {
+        this.step = next[data.step];
+        return;
+    }
+
+    var summary = summarizeRun(this.current);
+    this.results.push(summary);
+    console.log('Run ' + (this.index + 1) + '/' + this.options.runs + ': getUpdate ' + summary.wallMs.getUpdate +
+        ' ms, install to canary ' + summary.wallMs.forceUpdateToCanary + ' ms, peak disk ' +
+        (summary.disk.peakBytes / 1048576).toFixed(1) + ' MB');
+
+    this.index++;
+    if (this.index < this.options.runs) {
+        this.step = 'download';
+    } else {
+        this.step = 'done';
+        this.write();
+    }
+};
+
+Benchmark.prototype.fail = function(error) {
+    console.error('Run failed: ' + JSON.stringify(error));
+    this.step = 'done';
+    this.write();
+};
+
+Benchmark.prototype.write = function() {
+    var report = buildReport(this.options, this.bundle, this.device, this.results);
+    var platform = this.device && this.device.platform ? this.device.platform.toLowerCase() : 'unknown';
+    fs.mkdirSync(this.options.out, {recursive: true});
+    var file = path.join(this.options.out, platform + '-' + this.options.name + '-' + this.session + '.json');
+    fs.writeFileSync(file, JSON.stringify(report, null, 2) + '\n');
+    console.log('Report written to ' + file);
+};
+
+// ============================================================
+// HTTP
+// ============================================================
+
+function sendJSON(res, status, body) {
+    res.writeHead(status, {'Content-Type': 'application/json', 'Access-Control-Allow-Origin': '*'});
+    res.end(JSON.stringify(body));
+}
+
+/**
+ * Archive with single-range and If-Range support, as the plugin's resume and
+ * segmented downloads expect.
+ */
+function sendArchive(req, res, bundle) {
+    var archive = bundle.archive;
+    var headers = {
+        'Content-Type': 'application/zip',
+        'Accept-Ranges': 'bytes',
+        'ETag': bundle.etag,
+        'Access-Control-Allow-Origin': '*'
+    };
+
+    var range = /^bytes=(\d*)-(\d*)$/.exec(req.headers.range || '');
+    var ifRange = req.headers['if-range'];
+    if (range && (!ifRange || ifRange === bundle.etag)) {
+        var start = range[1] === '' ? archive.length - parseInt(range[2], 10) : parseInt(range[1], 10);
+        var end = range[1] !== '' && range[2] !== '' ? Math.min(parseInt(range[2], 10), archive.length - 1) : archive.length - 1;
+        if (start >= archive.length || start > end) {
+            headers['Content-Range'] = 'bytes */' + archive.length;
+            res.writeHead(416, headers);
+            res.end();
+            return;
+        }
+        headers['Content-Range'] = 'bytes ' + start + '-' + end + '/' + archive.length;
+        headers['Content-Length'] = end - start + 1;
+        res.writeHead(206, headers);
+        res.end(req.method === 'HEAD' ? undefined : archive.subarray(start, end + 1));
+        return;
+    }
+
+    headers['Content-Length'] = archive.length;
+    res.writeHead(200, headers);
+    res.end(req.method === 'HEAD' ? undefined : archive);
+}
+
+function readBody(req, callback) {
+    var chunks = [];
+    req.on('data', function(chunk) { chunks.push(chunk); });
+    req.on('end', function() {
+        try {
+            callback(null, JSON.parse(Buffer.concat(chunks).toString('utf8') || '{}'));
+        } catch (e) {
+            callback(e);
+        }
+    });
+}
+
+function main() {
+    var options = parseArgs(process.argv);
+
+    console.log('Building bundle ' + options.name + (options.stored ? ' (stored)' : ' (deflate)') + '...');
+    var bundle = buildBundle(options);
+    console.log('Bundle: ' + bundle.fileCount + ' files, ' + (bundle.bundleBytes / 1048576).toFixed(1) +
+        ' MB, archive ' + (bundle.archive.length / 1048576).toFixed(1) + ' MB');
+
+    var benchmark = new Benchmark(options, bundle);
+
+    http.createServer(function(req, res) {
+        var baseUrl = 'http://' + req.headers.host;
+        var url = req.url.split('?')[0];
+
+        if (req.method === 'OPTIONS') {
+            res.writeHead(204, {
+                'Access-Control-Allow-Origin': '*',
+                'Access-Control-Allow-Methods': 'GET, POST, HEAD',
+                'Access-Control-Allow-Headers': 'Content-Type'
+            });
+            res.end();
+        } else if (url === '/bundle.zip') {
+            sendArchive(req, res, bundle);
+        } else if (url === '/run' && req.method === 'GET') {
+            sendJSON(res, 200, benchmark.describe(baseUrl));
+        } else if (url === '/report' && req.method === 'POST') {
+            readBody(req, function(error, data) {
+                if (error) {
+                    sendJSON(res, 400, {error: 'Invalid JSON'});
+                    return;
+                }
+                benchmark.report(data);
+                sendJSON(res, 200, benchmark.describe(baseUrl));
+            });
+        } else {
+            sendJSON(res, 404, {error: 'Not found'});
+        }
+    }).listen(options.port, function() {
+        console.log('Benchmark server on port ' + options.port + ', ' + options.runs + ' runs. Start the test app.');
+    });
+}
+
+main();
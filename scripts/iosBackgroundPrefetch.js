@@ -0,0 +1,142 @@
+#!/usr/bin/env node
+
+/**
+ * iOS Background Prefetch Hook (after_prepare)
+ * Adds the BGProcessingTask identifier and the "processing" background mode
+ * to the app's Info.plist only when the plugin was installed with
+ *   --variable IOS_BACKGROUND_PREFETCH=true
+ * and removes them again when the variable is false (default).
+ *
+ * Info.plist is edited with PlistBuddy, so this runs on macOS only.
+ */
+
+var fs = require('fs');
+var path = require('path');
+var execFileSync = require('child_process').execFileSync;
+
+var PLUGIN_ID = 'cordova-plugin-hot-updates';
+var VARIABLE = 'IOS_BACKGROUND_PREFETCH';
+var TASK_IDENTIFIER = 'com.getmeback.hotupdates.prefetch';
+var IDENTIFIERS_KEY = 'BGTaskSchedulerPermittedIdentifiers';
+var MODES_KEY = 'UIBackgroundModes';
+var PROCESSING_MODE = 'processing';
+var PLIST_BUDDY = '/usr/libexec/PlistBuddy';
+
+// ============================================================
+// Plugin variable
+// ============================================================
+
+function readJSON(file) {
+    try {
+        return JSON.parse(fs.readFileSync(file, 'utf8'));
+    } catch (e) {
+        return null;
+    }
+}
+
+// Install variables: package.json (cordova 9+), else platforms/ios/ios.json (plugman)
+function prefetchEnabled(projectRoot) {
+    var packageJson = readJSON(path.join(projectRoot, 'package.json'));
+    var plugins = packageJson && packageJson.cordova && packageJson.cordova.plugins;
+    var value = plugins && plugins[PLUGIN_ID] ? plugins[PLUGIN_ID][VARIABLE] : undefined;
+
+    if (value === undefined) {
+        var platformJson = readJSON(path.join(projectRoot, 'platforms', 'ios', 'ios.json'));
+        var installed = platformJson && platformJson.installed_plugins && platformJson.installed_plugins[PLUGIN_ID];
+        value = installed ? installed[VARIABLE] : undefined;
+    }
+    return String(value).toLowerCase() === 'true';
+}
+
+// ============================================================
+// Info.plist
+// ============================================================
+
+function findInfoPlist(projectRoot) {
+    var iosDir = path.join(projectRoot, 'platforms', 'ios');
+    var entries = fs.existsSync(iosDir) ? fs.readdirSync(iosDir) : [];
+
+    for (var i = 0; i < entries.length; i++) {
+        var plist = path.join(iosDir, entries[i], entries[i] + '-Info.plist');
+        if (entries[i] !== 'CordovaLib' && fs.existsSync(plist)) {
+            return plist;
+        }
+    }
+    return null;
+}
+
+function plistBuddy(plist, command) {
+    return execFileSync(PLIST_BUDDY, ['-c', command, plist], {encoding: 'utf8', stdio: ['ignore', 'pipe', 'ignore']});
+}
+
+// Array value as list of strings, null if the key is missing
+function readArray(plist, key) {
+    try {
+        var json = execFileSync('/usr/bin/plutil', ['-extract', key, 'json', '-o', '-', plist],
+            {encoding: 'utf8', stdio: ['ignore', 'pipe', 'ignore']});
+        return JSON.parse(json);
+    } catch (e) {
+        return null;
+    }
+}
+
+function addToArray(plist, key, value) {
+    var values = readArray(plist, key);
+    if (values && values.indexOf(value) !== -1) return false;
+
+    if (!values) {
+        plistBuddy(plist, 'Add :' + key + ' array');
+        values = [];
+    }
+    plistBuddy(plist, 'Add :' + key + ':' + values.length + ' string ' + value);
+    return true;
+}
+
+function removeFromArray(plist, key, value) {
+    var values = readArray(plist, key);
+    var index = values ? values.indexOf(value) : -1;
+    if (index === -1) return false;
+
+    plistBuddy(plist, values.length === 1 ? 'Delete :' + key : 'Delete :' + key + ':' + index);
+    return true;
+}
+
+// ============================================================
+// Hook
+// ============================================================
+
+module.exports = function(context) {
+    var platforms = context.opts.platforms || [];
+    if (platforms.length > 0 && platforms.indexOf('ios') === -1) {
+        return Promise.resolve();
+    }
+
+    var projectRoot = context.opts.projectRoot;
+    var plist = findInfoPlist(projectRoot);
+    if (!plist) {
+        return Promise.resolve();
+    }
+
+    var enabled = prefetchEnabled(projectRoot);
+    if (!fs.existsSync(PLIST_BUDDY)) {
+        if (enabled) {
+            console.warn('[HotUpdates] PlistBuddy not found: add ' + TASK_IDENTIFIER + ' to ' + IDENTIFIERS_KEY +
+                ' and ' + PROCESSING_MODE + ' to ' + MODES_KEY + ' of Info.plist manually');
+        }
+        return Promise.resolve();
+    }
+
+    if (enabled) {
+        var added = addToArray(plist, IDENTIFIERS_KEY, TASK_IDENTIFIER);
+        added = addToArray(plist, MODES_KEY, PROCESSING_MODE) || added;
+        if (added) console.log('[HotUpdates] Background prefetch enabled in ' + path.basename(plist));
+    } else if (removeFromArray(plist, IDENTIFIERS_KEY, TASK_IDENTIFIER)) {
+        // "processing" may belong to another plugin's BGProcessingTask
+        if (!readArray(plist, IDENTIFIERS_KEY)) {
+            removeFromArray(plist, MODES_KEY, PROCESSING_MODE);
+        }
+        console.log('[HotUpdates] Background prefetch removed from ' + path.basename(plist));
+    }
+
+    return Promise.resolve();
+};
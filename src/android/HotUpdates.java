@@ -13,39 +13,54 @@
 package com.getmeback.hotupdates;
 
 import android.content.Context;
-import android.content.SharedPreferences;
+import android.content.res.AssetManager;
+import android.content.pm.PackageInfo;
 import android.content.pm.PackageManager;
+import android.os.Build;
 import android.os.Handler;
 import android.os.Looper;
 import android.util.Log;
-import android.webkit.MimeTypeMap;
 import android.webkit.WebResourceResponse;
 import android.webkit.WebSettings;
 import android.webkit.WebView;
 
+import androidx.lifecycle.LiveData;
+import androidx.lifecycle.Observer;
 import androidx.webkit.WebViewAssetLoader;
+import androidx.work.Constraints;
+import androidx.work.Data;
+import androidx.work.ExistingPeriodicWorkPolicy;
+import androidx.work.ExistingWorkPolicy;
+import androidx.work.NetworkType;
+import androidx.work.OneTimeWorkRequest;
+import androidx.work.PeriodicWorkRequest;
+import androidx.work.WorkInfo;
+import androidx.work.WorkManager;
 
 import org.apache.cordova.CallbackContext;
 import org.apache.cordova.CordovaPlugin;
 import org.apache.cordova.CordovaPluginPathHandler;
+import org.apache.cordova.PluginResult;
 import org.json.JSONArray;
 import org.json.JSONException;
 import org.json.JSONObject;
 
-import java.io.BufferedInputStream;
 import java.io.File;
-import java.io.FileInputStream;
-import java.io.FileOutputStream;
 import java.io.IOException;
 import java.io.InputStream;
-import java.net.HttpURLConnection;
-import java.net.URL;
 import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.HashMap;
 import java.util.HashSet;
 import java.util.List;
+import java.util.Map;
 import java.util.Set;
+import java.util.UUID;
+import java.util.concurrent.CountDownLatch;
 import java.util.concurrent.ExecutorService;
 import java.util.concurrent.Executors;
+import java.util.concurrent.TimeUnit;
 
 import static com.getmeback.hotupdates.HotUpdatesConstants.*;
 import static com.getmeback.hotupdates.HotUpdatesHelpers.*;
@@ -58,22 +73,47 @@ public class HotUpdates extends CordovaPlugin {
 
     // Paths
     private String filesDir;
-    private String wwwPath;
-    private String previousVersionPath;
-
-    // State
-    private boolean isDownloadingUpdate = false;
-    private boolean isUpdateReadyToInstall = false;
-    private String pendingUpdateVersion;
+    private String wwwPath;              // Legacy single-directory layout (migrated to versions/)
+    private String previousVersionPath;  // Legacy backup directory (migrated to versions/)
+
+    // Content-addressed file store shared by all version directories
+    private HotUpdatesStore store;
+    // Plugin state: one file, one atomic write per transition
+    private HotUpdatesState state;
+    private HotUpdatesDownloader downloader;
+
+    // State (written on the main thread and the executor)
+    private volatile boolean isUpdateReadyToInstall = false;
+    private volatile String pendingUpdateVersion;
     private String appBundleVersion;
+    private String appBundleBuild; // "<versionName> (<versionCode>)", written into overlay markers
+    private volatile UUID backgroundWorkId; // WorkManager request of the running background download
+
+    // Download coordination: one job at a time, getUpdate calls for its version wait for it
+    private final Object downloadLock = new Object();
+    private HotUpdatesDownloadJob downloadJob; // Guarded by downloadLock, null = no download
+    private volatile HotUpdatesPathIndex pathIndex; // Files of the served version, null = serve from assets
 
-    // Lists
-    private Set<String> ignoreList = new HashSet<>();
-    private List<String> versionHistory = new ArrayList<>();
+    // Startup gate: open once the pending update is promoted and the path index is built
+    private final CountDownLatch startupLatch = new CountDownLatch(1);
+    private volatile boolean servedAssetsDuringStartup = false;
 
-    // Canary timer
+    // Lists: immutable snapshots, replaced on change, readable from any thread without locking
+    private volatile Set<String> ignoreList = Collections.emptySet();
+    private volatile List<String> versionHistory = Collections.emptyList();
+
+    // Canary timer: fields below are touched only on the main thread (posted to canaryHandler)
     private Handler canaryHandler;
     private Runnable canaryRunnable;
+    private long canaryStartTime;              // HotUpdatesMetrics.now() of the timer start
+    private long canaryTimeoutMs;              // Deadline of the running timer
+    private boolean canaryExtended;            // extendCanary() was called, load time is not measured
+
+    // Start of the WebView reload, 0 = none pending (main thread only)
+    private long reloadStartTime;
+
+    // Plugin of the running app, background prefetch hands its download over to it
+    private static volatile HotUpdates activeInstance;
 
     // Executor for background tasks
     private ExecutorService executor = Executors.newSingleThreadExecutor();
@@ -90,6 +130,9 @@ public class HotUpdates extends CordovaPlugin {
         filesDir = context.getFilesDir().getAbsolutePath();
         wwwPath = filesDir + "/" + DIR_WWW;
         previousVersionPath = filesDir + "/" + DIR_WWW_PREVIOUS;
+        store = new HotUpdatesStore(context.getFilesDir());
+        state = HotUpdatesState.get(context);
+        downloader = new HotUpdatesDownloader(context, store);
 
         canaryHandler = new Handler(Looper.getMainLooper());
 
@@ -97,45 +140,122 @@ public class HotUpdates extends CordovaPlugin {
         loadIgnoreList();
         loadVersionHistory();
 
-        // Reset download flag (in case app was killed during download)
-        isDownloadingUpdate = false;
-        getPrefs().edit().putBoolean(PREF_DOWNLOAD_IN_PROGRESS, false).apply();
+        // Reset download flag (in case app was killed during download).
+        // Resume state is kept, the next getUpdate for the same version continues the transfer
+        state.edit().putBoolean(PREF_DOWNLOAD_IN_PROGRESS, false).apply();
 
         // Load pending state
-        isUpdateReadyToInstall = getPrefs().getBoolean(PREF_PENDING_UPDATE_READY, false);
+        isUpdateReadyToInstall = state.getBoolean(PREF_PENDING_UPDATE_READY, false);
         if (isUpdateReadyToInstall) {
-            pendingUpdateVersion = getPrefs().getString(PREF_PENDING_VERSION, null);
+            pendingUpdateVersion = state.getString(PREF_PENDING_VERSION, null);
         }
 
         Log.d(TAG, "Initializing plugin...");
+        HotUpdatesBuffers.configure(preferences.getInteger(CONFIG_IO_BUFFER_SIZE, DEFAULT_IO_BUFFER_KB));
+
+        if (preferences.getBoolean(CONFIG_ASYNC_STARTUP, false)) {
+            // Serial executor: startup runs before the background download restore and any deferred command
+            executor.execute(() -> {
+                prepareInstalledContent();
+                finishStartup();
+            });
+        } else {
+            prepareInstalledContent();
+            finishStartup();
+        }
 
+        // Background download may still be queued from a previous session
+        executor.execute(this::restoreBackgroundDownload);
+
+        activeInstance = this;
+        executor.execute(this::schedulePrefetch);
+
+        // Disk pressure: drop retained versions beyond the rollback target
+        executor.execute(() -> {
+            if (isStorageLow()) pruneVersions();
+        });
+    }
+
+    /**
+     * File work of startup: migrate layout, promote the staged update, drop overlay versions
+     * made for a previous app build. Runs on the executor
+     * in async startup mode. assets/www is never copied: without an installed version, and for
+     * files a version does not contain, the PathHandler falls through to the bundled assets.
+     */
+    private void prepareInstalledContent() {
+        long startTime = System.currentTimeMillis();
+        migrateLegacyLayout();
         checkAndInstallPendingUpdate();
-        initializeWWWFolder();
+        dropStaleOverlays();
+        refreshPathIndex();
+        Log.d(TAG, "Startup file work took " + (System.currentTimeMillis() - startTime) + " ms");
+    }
+
+    /**
+     * Open the startup gate and start the canary timer of the current version.
+     */
+    private void finishStartup() {
+        startupLatch.countDown();
 
         // Start canary timer for current version
-        String currentVersion = getPrefs().getString(PREF_INSTALLED_VERSION, null);
+        String currentVersion = state.getString(PREF_INSTALLED_VERSION, null);
         if (currentVersion != null) {
-            String canaryVersion = getPrefs().getString(PREF_CANARY_VERSION, null);
+            String canaryVersion = state.getString(PREF_CANARY_VERSION, null);
             if (canaryVersion == null || !canaryVersion.equals(currentVersion)) {
                 Log.d(TAG, "Starting canary timer for version " + currentVersion);
                 startCanaryTimer();
             }
         }
 
+        // A request timed out waiting and got bundled assets - load the installed version once
+        if (servedAssetsDuringStartup && pathIndex != null) {
+            reloadWebView();
+        }
+
         Log.d(TAG, "Plugin initialized (v" + appBundleVersion + ")");
     }
 
+    /**
+     * Wait for async startup (no-op afterwards and in synchronous mode).
+     *
+     * @return false if startup did not finish within STARTUP_WAIT_TIMEOUT_MS
+     */
+    private boolean awaitStartup() {
+        try {
+            return startupLatch.await(STARTUP_WAIT_TIMEOUT_MS, TimeUnit.MILLISECONDS);
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+            return false;
+        }
+    }
+
     @Override
     public void onStart() {
         super.onStart();
-        // No redirect needed - PathHandler transparently serves from files/www
-        // when an installed version exists, or falls through to assets/www otherwise
+        // No redirect needed - PathHandler transparently serves from the current
+        // versions/<dir>/www when an installed version exists, or falls through to assets/www otherwise
+    }
+
+    @Override
+    public Object onMessage(String id, Object data) {
+        // Reload started by reloadWebView has finished loading its page
+        if ("onPageFinished".equals(id) && reloadStartTime != 0) {
+            HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_RELOAD, reloadStartTime);
+            reloadStartTime = 0;
+        }
+        if ("onPageFinished".equals(id) && data instanceof String) {
+            clearStaleServiceWorkers((String) data);
+        }
+        return null;
     }
 
     @Override
     public void onDestroy() {
-        if (canaryHandler != null && canaryRunnable != null) {
-            canaryHandler.removeCallbacks(canaryRunnable);
+        if (activeInstance == this) {
+            activeInstance = null;
+        }
+        if (canaryHandler != null) {
+            canaryHandler.removeCallbacksAndMessages(null);
         }
         executor.shutdown();
         super.onDestroy();
@@ -148,39 +268,27 @@ public class HotUpdates extends CordovaPlugin {
     @Override
     public CordovaPluginPathHandler getPathHandler() {
         WebViewAssetLoader.PathHandler handler = path -> {
-            try {
-                // Only intercept if there's an installed version
-                String installedVersion = getPrefs().getString(PREF_INSTALLED_VERSION, null);
-                if (installedVersion == null) {
-                    return null; // Let Cordova serve from assets/www
-                }
-
-                File wwwDir = new File(wwwPath);
-                if (!wwwDir.exists()) {
-                    return null;
-                }
-
-                if (path.isEmpty()) {
-                    path = INDEX_HTML;
-                }
-
-                File file = new File(wwwDir, path);
-
-                // Security: prevent path traversal
-                if (!file.getCanonicalPath().startsWith(wwwDir.getCanonicalPath())) {
-                    Log.e(TAG, "Path traversal attempt blocked: " + path);
-                    return null;
-                }
+            // Async startup: the WebView waits here (request thread, not main) until the
+            // staged update is promoted, so the first page comes from the right version
+            if (!awaitStartup()) {
+                servedAssetsDuringStartup = true;
+                return null;
+            }
 
-                if (!file.exists() || file.isDirectory()) {
-                    return null; // Fall through to Cordova default handler
-                }
+            // Resolved from memory: no prefs read, stat or canonicalisation per request
+            HotUpdatesPathIndex index = pathIndex;
+            if (index == null) {
+                return null; // No installed version - let Cordova serve from assets/www
+            }
 
-                String mimeType = getMimeType(path);
-                InputStream is = new FileInputStream(file);
-                return new WebResourceResponse(mimeType, null, is);
+            HotUpdatesPathIndex.Entry entry = index.get(path.isEmpty() ? INDEX_HTML : path);
+            if (entry == null) {
+                return null; // Fall through to Cordova default handler
+            }
 
-            } catch (Exception e) {
+            try {
+                return new WebResourceResponse(entry.mimeType, null, 200, "OK", entry.headers, entry.open());
+            } catch (IOException e) {
                 Log.e(TAG, "PathHandler error: " + e.getMessage());
                 return null;
             }
@@ -189,77 +297,154 @@ public class HotUpdates extends CordovaPlugin {
         return new CordovaPluginPathHandler(handler);
     }
 
-    private String getMimeType(String path) {
-        if (path.endsWith(".js") || path.endsWith(".mjs")) {
-            return "application/javascript";
-        } else if (path.endsWith(".wasm")) {
-            return "application/wasm";
-        } else if (path.endsWith(".html") || path.endsWith(".htm")) {
-            return "text/html";
-        } else if (path.endsWith(".css")) {
-            return "text/css";
-        } else if (path.endsWith(".json")) {
-            return "application/json";
-        } else if (path.endsWith(".svg")) {
-            return "image/svg+xml";
+    /**
+     * Rebuild the path index if the current version directory changed.
+     * Called at startup and after every switch of the current pointer, before the WebView reloads.
+     */
+    private synchronized void refreshPathIndex() {
+        HotUpdatesState.Snapshot snapshot = state.snapshot();
+        String installedVersion = snapshot.getString(PREF_INSTALLED_VERSION, null);
+        String currentDir = snapshot.getString(PREF_CURRENT_VERSION_DIR, null);
+        File wwwDir = currentDir != null ? new File(getVersionDir(currentDir), DIR_WWW) : new File(wwwPath);
+
+        if (installedVersion == null || currentDir == null || !wwwDir.exists()) {
+            pathIndex = null;
+            return;
+        }
+
+        HotUpdatesPathIndex index = pathIndex;
+        if (index != null && index.getDirName().equals(currentDir)) {
+            return;
         }
 
-        String extension = MimeTypeMap.getFileExtensionFromUrl("file:///" + path);
-        if (extension != null) {
-            String mime = MimeTypeMap.getSingleton().getMimeTypeFromExtension(extension);
-            if (mime != null) return mime;
+        // Packed version: www holds one archive, files are served from its mapping
+        File packFile = new File(wwwDir, PACKED_BUNDLE_FILE);
+        try {
+            pathIndex = packFile.isFile()
+                    ? HotUpdatesPathIndex.buildFromPack(packFile, currentDir)
+                    : HotUpdatesPathIndex.build(wwwDir, currentDir);
+        } catch (IOException e) {
+            Log.e(TAG, "Cannot open pack of version " + currentDir + ": " + e.getMessage());
+            pathIndex = null;
         }
-        return "application/octet-stream";
     }
 
     // ============================================================
     // Configuration
     // ============================================================
 
+    /**
+     * Manifest signing key from config.xml, null if not configured.
+     */
+    private String getPublicKey() {
+        String key = preferences.getString(CONFIG_PUBLIC_KEY, null);
+        return key != null && !key.trim().isEmpty() ? key : null;
+    }
+
+    @SuppressWarnings("deprecation")
     private void loadConfiguration() {
         try {
             Context context = cordova.getActivity().getApplicationContext();
-            appBundleVersion = context.getPackageManager()
-                    .getPackageInfo(context.getPackageName(), 0).versionName;
+            PackageInfo info = context.getPackageManager().getPackageInfo(context.getPackageName(), 0);
+            appBundleVersion = info.versionName;
+            long versionCode = Build.VERSION.SDK_INT >= Build.VERSION_CODES.P ? info.getLongVersionCode() : info.versionCode;
+            appBundleBuild = appBundleVersion + " (" + versionCode + ")";
         } catch (PackageManager.NameNotFoundException e) {
             appBundleVersion = "1.0.0";
+            appBundleBuild = appBundleVersion;
         }
     }
 
-    private SharedPreferences getPrefs() {
-        return cordova.getActivity().getSharedPreferences(PREFS_NAME, Context.MODE_PRIVATE);
-    }
-
     // ============================================================
     // JavaScript Interface
     // ============================================================
 
     @Override
     public boolean execute(String action, JSONArray args, CallbackContext callbackContext) throws JSONException {
+        Runnable command = getCommand(action, args, callbackContext);
+        if (command == null) {
+            return false;
+        }
+
+        if (startupLatch.getCount() > 0) {
+            // Async startup still running - queue behind it on the serial executor
+            executor.execute(command);
+        } else {
+            command.run();
+        }
+        return true;
+    }
+
+    private Runnable getCommand(String action, JSONArray args, CallbackContext callbackContext) {
         switch (action) {
+            case "checkForUpdate":
+                return () -> checkForUpdate(args, callbackContext);
             case "getUpdate":
-                getUpdate(args, callbackContext);
-                return true;
+                return () -> getUpdate(args, callbackContext);
+            case "cancelUpdate":
+                return () -> cancelUpdate(callbackContext);
             case "forceUpdate":
-                forceUpdate(callbackContext);
-                return true;
+                return () -> forceUpdate(callbackContext);
             case "canary":
-                canary(args, callbackContext);
-                return true;
+                return () -> canary(args, callbackContext);
+            case "extendCanary":
+                return () -> extendCanary(callbackContext);
             case "getIgnoreList":
-                getIgnoreList(callbackContext);
-                return true;
+                return () -> getIgnoreList(callbackContext);
             case "getVersionHistory":
-                getVersionHistory(callbackContext);
-                return true;
+                return () -> getVersionHistory(callbackContext);
             case "getVersionInfo":
-                getVersionInfo(callbackContext);
-                return true;
+                return () -> getVersionInfo(callbackContext);
+            case "getMetrics":
+                return () -> getMetrics(args, callbackContext);
+            case "rollbackTo":
+                return () -> rollbackTo(args, callbackContext);
             default:
-                return false;
+                return null;
         }
     }
 
+    // ============================================================
+    // checkForUpdate - Ask the check API for a newer version
+    // ============================================================
+
+    /**
+     * Conditional request to the check API (see HotUpdatesUpdateCheck), filtered against the
+     * ignore list and the app version. Runs on the Cordova thread pool, so a check is not
+     * queued behind a download on the plugin executor.
+     */
+    private void checkForUpdate(JSONArray args, CallbackContext callbackContext) {
+        JSONObject options = args.optJSONObject(0);
+        String checkURL = options != null ? options.optString("url", "") : "";
+        if (checkURL.isEmpty()) {
+            checkURL = preferences.getString(CONFIG_PREFETCH_URL, "");
+        }
+        if (checkURL.isEmpty()) {
+            sendError(callbackContext, ERROR_URL_REQUIRED, "URL is required");
+            return;
+        }
+
+        String url = checkURL;
+        cordova.getThreadPool().execute(() -> {
+            HotUpdatesState.Snapshot snapshot = state.snapshot();
+            String currentVersion = snapshot.getString(PREF_INSTALLED_VERSION, appBundleVersion);
+            try {
+                HotUpdatesUpdateCheck check = HotUpdatesUpdateCheck.fetch(state, url, currentVersion);
+                JSONObject result = check.evaluate(snapshot, currentVersion, appBundleVersion, ignoreList);
+                Log.d(TAG, "checkForUpdate: " + (result.optBoolean("hasUpdate")
+                        ? "v" + result.optString("version") : "no update (" + result.optString("reason") + ")")
+                        + (check.notModified ? ", not modified" : ""));
+                callbackContext.success(result);
+
+            } catch (IOException e) {
+                Log.e(TAG, "checkForUpdate failed: " + e.getMessage());
+                sendError(callbackContext, HotUpdatesDownloader.getErrorCode(e), HotUpdatesDownloader.getErrorMessage(e));
+            } catch (JSONException e) {
+                sendError(callbackContext, ERROR_MANIFEST_INVALID, "Invalid check response");
+            }
+        });
+    }
+
     // ============================================================
     // getUpdate - Download update
     // ============================================================
@@ -273,17 +458,33 @@ public class HotUpdates extends CordovaPlugin {
         }
 
         String downloadURL = updateData.optString("url", null);
-        if (downloadURL == null || downloadURL.isEmpty()) {
+        String manifestURL = updateData.optString("manifestUrl", null);
+        boolean hasDownloadURL = downloadURL != null && !downloadURL.isEmpty();
+        boolean hasManifestURL = manifestURL != null && !manifestURL.isEmpty();
+        if (!hasDownloadURL && !hasManifestURL) {
             sendError(callbackContext, ERROR_URL_REQUIRED, "URL is required");
             return;
         }
 
         String updateVersion = updateData.optString("version", "pending");
+        boolean background = updateData.optBoolean("background", false);
+        int connections = Math.max(1, Math.min(updateData.optInt("connections", 1), MAX_DOWNLOAD_CONNECTIONS));
+        boolean packed = updateData.optBoolean("packed", false);
+        boolean progress = updateData.optBoolean("progress", false);
+        boolean lowStorage = updateData.optBoolean("lowStorage", false);
+        String verifyManifestURL = updateData.optString("verifyManifestUrl", null);
+        if (verifyManifestURL != null && verifyManifestURL.isEmpty()) verifyManifestURL = null;
+        if (!hasManifestURL && verifyManifestURL == null && getPublicKey() != null) {
+            // Signing key configured: unsigned archives are refused, like unsigned delta manifests
+            sendError(callbackContext, ERROR_SIGNATURE_INVALID, MANIFEST_REQUIRED_MESSAGE);
+            return;
+        }
 
-        Log.d(TAG, "getUpdate: v" + updateVersion + " from " + downloadURL);
+        Log.d(TAG, "getUpdate: v" + updateVersion + " from " + (hasManifestURL ? manifestURL : downloadURL));
 
         // Check if already installed
-        String installedVersion = getPrefs().getString(PREF_INSTALLED_VERSION, null);
+        HotUpdatesState.Snapshot snapshot = state.snapshot();
+        String installedVersion = snapshot.getString(PREF_INSTALLED_VERSION, null);
         if (installedVersion != null && installedVersion.equals(updateVersion)) {
             Log.d(TAG, "Version " + updateVersion + " already installed, skipping download");
             callbackContext.success();
@@ -291,150 +492,613 @@ public class HotUpdates extends CordovaPlugin {
         }
 
         // Check if already downloaded
-        boolean hasPending = getPrefs().getBoolean(PREF_HAS_PENDING, false);
-        String existingPendingVersion = getPrefs().getString(PREF_PENDING_VERSION, null);
+        boolean hasPending = snapshot.getBoolean(PREF_HAS_PENDING, false);
+        String existingPendingVersion = snapshot.getString(PREF_PENDING_VERSION, null);
         if (hasPending && existingPendingVersion != null && existingPendingVersion.equals(updateVersion)) {
             Log.d(TAG, "Version " + updateVersion + " already downloaded, skipping re-download");
             callbackContext.success();
             return;
         }
 
-        // Check if download in progress
-        if (isDownloadingUpdate) {
-            sendError(callbackContext, ERROR_DOWNLOAD_IN_PROGRESS, "Download already in progress");
+        // Same version in flight: wait for that transfer. Any other version replaces it
+        HotUpdatesDownloadJob job = new HotUpdatesDownloadJob(updateVersion, callbackContext, progress);
+        HotUpdatesDownloadJob replaced;
+        synchronized (downloadLock) {
+            replaced = downloadJob;
+            if (replaced != null && replaced.version.equals(updateVersion) && replaced.attach(callbackContext, progress)) {
+                Log.d(TAG, "Download of v" + updateVersion + " already in progress, waiting for it");
+                return;
+            }
+            downloadJob = job;
+        }
+        if (replaced != null) {
+            Log.d(TAG, "Download of v" + replaced.version + " replaced by v" + updateVersion);
+            abortDownload(replaced, "Download replaced by v" + updateVersion);
+        }
+
+        if (hasManifestURL) {
+            // Delta updates are many small requests - always foreground
+            downloadDeltaUpdate(job, manifestURL);
+        } else if (background) {
+            enqueueBackgroundDownload(job, downloadURL, connections, packed, verifyManifestURL, lowStorage,
+                    updateData.optBoolean("wifiOnly", false), updateData.optBoolean("requiresCharging", false));
+        } else {
+            downloadUpdate(job, downloadURL, connections, packed, verifyManifestURL, lowStorage);
+        }
+    }
+
+    /**
+     * Download ZIP update in the plugin executor (see HotUpdatesDownloader#downloadZip).
+     * An update that does not fit is retried once in low-storage mode.
+     *
+     * @param verifyManifestURL Signed manifest every file is checked against, null to skip
+     * @param lowStorage Start in low-storage mode (see {@link #freeStorage()})
+     */
+    private void downloadUpdate(HotUpdatesDownloadJob job, String downloadURL, int connections, boolean packed,
+                                String verifyManifestURL, boolean lowStorage) {
+        executor.execute(() -> {
+            if (beginDownload(job) == null) return;
+
+            Log.d(TAG, "Starting download from: " + downloadURL
+                    + (connections > 1 && !lowStorage ? " (" + connections + " connections)" : "")
+                    + (packed ? " (packed)" : "")
+                    + (verifyManifestURL != null ? " (verified)" : "")
+                    + (lowStorage ? " (low storage)" : ""));
+
+            try {
+                HotUpdatesVerifier verifier = HotUpdatesVerifier.forArchive(verifyManifestURL, getPublicKey());
+                if (lowStorage) freeStorage();
+                try {
+                    downloader.downloadZip(downloadURL, job.version, lowStorage ? 1 : connections, packed, verifier);
+                } catch (IOException e) {
+                    if (lowStorage || job.isCancelled()
+                            || !ERROR_INSUFFICIENT_STORAGE.equals(HotUpdatesDownloader.getErrorCode(e))) {
+                        throw e;
+                    }
+                    Log.d(TAG, "Retrying download in low-storage mode: " + e.getMessage());
+                    freeStorage();
+                    downloader.downloadZip(downloadURL, job.version, 1, packed, verifier);
+                }
+                completeDownload(job);
+
+            } catch (IOException e) {
+                Log.e(TAG, "Download failed: " + e.getMessage());
+                failDownload(job, HotUpdatesDownloader.getErrorCode(e), HotUpdatesDownloader.getErrorMessage(e));
+            }
+        });
+    }
+
+    /**
+     * Low-storage mode: delete what the download replaces anyway, so that it needs about one
+     * copy of the update on top of the current and previous version. Drops stale temp files,
+     * a staged update (of another version, the same one is never downloaded again) and retained
+     * versions except the rollback target. The download then streams over one connection.
+     * Runs on the executor.
+     */
+    private void freeStorage() {
+        downloader.deleteStaleFiles();
+
+        if (isUpdateReadyToInstall || state.getBoolean(PREF_HAS_PENDING, false)) {
+            Log.d(TAG, "Low storage: dropping staged update v" + pendingUpdateVersion);
+            isUpdateReadyToInstall = false;
+            pendingUpdateVersion = null;
+            state.edit()
+                .putBoolean(PREF_PENDING_UPDATE_READY, false)
+                .putBoolean(PREF_HAS_PENDING, false)
+                .remove(PREF_PENDING_VERSION)
+                .remove(PREF_PENDING_WARMUP)
+                .commit();
+            deleteRecursive(new File(filesDir, DIR_TEMP_DOWNLOADED));
+        }
+
+        pruneVersions(true);
+    }
+
+    // ============================================================
+    // Download coordination
+    // ============================================================
+
+    /**
+     * Start the transfer of a job. Runs on the serial executor, so a replaced job's
+     * transfer has returned (and released the temp directories) before the next one starts.
+     *
+     * @return Progress reporter of the transfer (also set on the downloader),
+     *         null if the job was cancelled while it was queued
+     */
+    private HotUpdatesProgress beginDownload(HotUpdatesDownloadJob job) {
+        // Reset before the check: a cancel arriving in between still aborts the new transfer
+        downloader.resetCancel();
+        if (job.isCancelled()) return null;
+
+        HotUpdatesProgress progress = new HotUpdatesProgress(
+                (phase, bytes, totalBytes, bytesPerSecond, etaSeconds) ->
+                        sendProgress(job, phase, bytes, totalBytes, bytesPerSecond, etaSeconds));
+        downloader.setProgress(progress);
+        state.edit().putBoolean(PREF_DOWNLOAD_IN_PROGRESS, true).apply();
+        return progress;
+    }
+
+    /**
+     * Send progress event to the getUpdate calls of a job that asked for it.
+     * The callbacks are kept open; the final result closes them.
+     */
+    private void sendProgress(HotUpdatesDownloadJob job, String phase, long bytes, long totalBytes,
+                              long bytesPerSecond, long etaSeconds) {
+        List<CallbackContext> callbacks = job.getProgressCallbacks();
+        if (callbacks.isEmpty()) return;
+
+        JSONObject event = new JSONObject();
+        try {
+            event.put("type", "progress");
+            event.put("version", job.version);
+            event.put("phase", phase);
+            event.put("bytesReceived", bytes);
+            event.put("totalBytes", totalBytes);
+            event.put("bytesPerSecond", bytesPerSecond);
+            event.put("etaSeconds", etaSeconds);
+        } catch (JSONException e) {
+            return;
+        }
+
+        // Posted to the main thread like the final result, so no event arrives after it
+        cordova.getActivity().runOnUiThread(() -> {
+            for (CallbackContext callback : callbacks) {
+                PluginResult result = new PluginResult(PluginResult.Status.OK, event);
+                result.setKeepCallback(true);
+                callback.sendPluginResult(result);
+            }
+        });
+    }
+
+    /**
+     * Cancel job: report CANCELLED to its callbacks now and stop its transfer.
+     * The transfer fails shortly after; its result is dropped (see HotUpdatesDownloadJob#finish).
+     */
+    private void abortDownload(HotUpdatesDownloadJob job, String message) {
+        for (CallbackContext callback : job.cancel()) {
+            sendErrorOnMain(cordova, callback, ERROR_CANCELLED, message);
+        }
+
+        downloader.cancel();
+        UUID workId = backgroundWorkId;
+        if (workId != null) {
+            WorkManager.getInstance(cordova.getContext()).cancelWorkById(workId);
+        }
+    }
+
+    /**
+     * Detach job once its transfer ended.
+     *
+     * @return Callbacks to report to, null if the job was cancelled meanwhile
+     */
+    private List<CallbackContext> finishDownload(HotUpdatesDownloadJob job) {
+        synchronized (downloadLock) {
+            if (downloadJob == job) {
+                downloadJob = null;
+            }
+        }
+        return job.finish();
+    }
+
+    /**
+     * Update in-memory state after HotUpdatesDownloader staged an update and report success.
+     * A job cancelled too late to stop its transfer leaves the staged update in place.
+     */
+    private void completeDownload(HotUpdatesDownloadJob job) {
+        isUpdateReadyToInstall = true;
+        pendingUpdateVersion = state.getString(PREF_PENDING_VERSION, job.version);
+
+        List<CallbackContext> callbacks = finishDownload(job);
+        if (callbacks == null) return;
+        for (CallbackContext callback : callbacks) {
+            sendSuccessOnMain(cordova, callback);
+        }
+    }
+
+    /**
+     * Reset download state and report error to JavaScript.
+     */
+    private void failDownload(HotUpdatesDownloadJob job, String code, String message) {
+        List<CallbackContext> callbacks = finishDownload(job);
+        if (callbacks == null) {
+            // Already answered with CANCELLED, download state belongs to the next job
+            Log.d(TAG, "Cancelled download of v" + job.version + " stopped");
             return;
         }
 
-        pendingUpdateVersion = updateVersion;
-        downloadUpdate(downloadURL, callbackContext);
+        state.edit().putBoolean(PREF_DOWNLOAD_IN_PROGRESS, false).apply();
+        for (CallbackContext callback : callbacks) {
+            sendErrorOnMain(cordova, callback, code, message);
+        }
     }
 
-    private void downloadUpdate(String downloadURL, CallbackContext callbackContext) {
-        isDownloadingUpdate = true;
-        getPrefs().edit().putBoolean(PREF_DOWNLOAD_IN_PROGRESS, true).apply();
+    // ============================================================
+    // cancelUpdate - Abort download
+    // ============================================================
 
-        Log.d(TAG, "Starting download from: " + downloadURL);
+    /**
+     * Abort the running download (foreground or background) and delete its partial files,
+     * including resume data of an earlier interrupted transfer. Waiting getUpdate calls get
+     * CANCELLED right away; this callback fires once the temp files are gone.
+     */
+    private void cancelUpdate(CallbackContext callbackContext) {
+        HotUpdatesDownloadJob job;
+        synchronized (downloadLock) {
+            job = downloadJob;
+            downloadJob = null;
+        }
+        if (job != null) {
+            Log.d(TAG, "Cancelling download of v" + job.version);
+            abortDownload(job, "Download cancelled");
+        }
 
+        // Serial executor: runs once the aborted transfer has returned
         executor.execute(() -> {
-            HttpURLConnection connection = null;
-            InputStream input = null;
-            FileOutputStream output = null;
+            downloader.discard();
+            state.edit().putBoolean(PREF_DOWNLOAD_IN_PROGRESS, false).apply();
+            sendSuccessOnMain(cordova, callbackContext);
+        });
+    }
 
-            try {
-                URL url = new URL(downloadURL);
-                connection = (HttpURLConnection) url.openConnection();
-                connection.setConnectTimeout(HTTP_CONNECT_TIMEOUT_MS);
-                connection.setReadTimeout(HTTP_READ_TIMEOUT_MS);
-                connection.connect();
-
-                int responseCode = connection.getResponseCode();
-                if (responseCode != HttpURLConnection.HTTP_OK) {
-                    throw new IOException("HTTP error: " + responseCode);
-                }
+    // ============================================================
+    // Background download (WorkManager)
+    // ============================================================
+
+    /**
+     * Hand ZIP download to WorkManager so it survives the app being backgrounded or killed.
+     * The worker resumes from the last complete entry on every retry; the callback fires
+     * when the work finishes while the plugin is alive (otherwise the staged update is
+     * picked up from the state file on next launch).
+     */
+    private void enqueueBackgroundDownload(HotUpdatesDownloadJob job, String downloadURL, int connections,
+                                           boolean packed, String verifyManifestURL, boolean lowStorage,
+                                           boolean wifiOnly, boolean requiresCharging) {
+        // Enqueued from the executor: the worker never overlaps a foreground transfer it replaced
+        executor.execute(() -> {
+            if (beginDownload(job) == null) return;
+            if (lowStorage) freeStorage();
+            scheduleBackgroundWork(job, downloadURL, lowStorage ? 1 : connections, packed, verifyManifestURL,
+                    wifiOnly, requiresCharging);
+        });
+    }
+
+    private void scheduleBackgroundWork(HotUpdatesDownloadJob job, String downloadURL, int connections,
+                                        boolean packed, String verifyManifestURL, boolean wifiOnly,
+                                        boolean requiresCharging) {
+        state.edit().putString(PREF_BACKGROUND_VERSION, job.version).apply();
+
+        Log.d(TAG, "Scheduling background download from: " + downloadURL
+                + (wifiOnly ? " (wifi only)" : "") + (requiresCharging ? " (charging)" : ""));
 
-                // Download to temp file
-                File tempZip = new File(filesDir, "update_temp.zip");
-                input = new BufferedInputStream(connection.getInputStream());
-                output = new FileOutputStream(tempZip);
+        OneTimeWorkRequest request = HotUpdatesDownloadWorker.buildRequest(downloadURL, job.version, connections,
+                packed, verifyManifestURL, wifiOnly, requiresCharging);
 
-                byte[] buffer = new byte[8192];
-                int bytesRead;
-                while ((bytesRead = input.read(buffer)) != -1) {
-                    output.write(buffer, 0, bytesRead);
+        WorkManager.getInstance(cordova.getContext())
+            .enqueueUniqueWork(BACKGROUND_WORK_NAME, ExistingWorkPolicy.REPLACE, request);
+
+        backgroundWorkId = request.getId();
+        if (job.isCancelled()) {
+            // Cancelled before the work id was known to abortDownload
+            WorkManager.getInstance(cordova.getContext()).cancelWorkById(request.getId());
+        }
+        observeBackgroundWork(backgroundWorkId, job);
+    }
+
+    /**
+     * Report result of background work to its job once it reaches a finished state.
+     */
+    private void observeBackgroundWork(UUID workId, HotUpdatesDownloadJob job) {
+        cordova.getActivity().runOnUiThread(() -> {
+            LiveData<WorkInfo> liveData = WorkManager.getInstance(cordova.getContext()).getWorkInfoByIdLiveData(workId);
+            liveData.observeForever(new Observer<WorkInfo>() {
+                @Override
+                public void onChanged(WorkInfo info) {
+                    if (info == null) return;
+                    if (!info.getState().isFinished()) {
+                        forwardBackgroundProgress(info, job);
+                        return;
+                    }
+                    liveData.removeObserver(this);
+                    onBackgroundWorkFinished(info, job);
                 }
-                output.flush();
-                output.close();
-                output = null;
-                input.close();
-                input = null;
+            });
+        });
+    }
 
-                Log.d(TAG, "Download completed, verifying...");
+    /**
+     * Pass progress published by the worker (already throttled there) to the job.
+     */
+    private void forwardBackgroundProgress(WorkInfo info, HotUpdatesDownloadJob job) {
+        Data data = info.getProgress();
+        String phase = data.getString(WORK_KEY_PROGRESS_PHASE);
+        if (phase == null) return;
 
-                // Verify and extract
-                saveDownloadedUpdate(tempZip, callbackContext);
+        sendProgress(job, phase, data.getLong(WORK_KEY_PROGRESS_BYTES, 0), data.getLong(WORK_KEY_PROGRESS_TOTAL, -1),
+                data.getLong(WORK_KEY_PROGRESS_RATE, 0), data.getLong(WORK_KEY_PROGRESS_ETA, -1));
+    }
 
-            } catch (Exception e) {
-                Log.e(TAG, "Download failed: " + e.getMessage());
-                isDownloadingUpdate = false;
-                getPrefs().edit().putBoolean(PREF_DOWNLOAD_IN_PROGRESS, false).apply();
+    private void onBackgroundWorkFinished(WorkInfo info, HotUpdatesDownloadJob job) {
+        // A replacing background download owns the work id and version from here on
+        if (info.getId().equals(backgroundWorkId)) {
+            backgroundWorkId = null;
+            state.edit().remove(PREF_BACKGROUND_VERSION).apply();
+        }
 
-                String errorCode = ERROR_DOWNLOAD_FAILED;
-                if (e.getMessage() != null && e.getMessage().startsWith("HTTP error:")) {
-                    errorCode = ERROR_HTTP_ERROR;
+        if (info.getState() == WorkInfo.State.SUCCEEDED) {
+            // Worker staged the update and wrote pending state to the state file
+            completeDownload(job);
+            Log.d(TAG, "Background download completed (v" + pendingUpdateVersion + ")");
+            return;
+        }
+
+        String errorCode = info.getOutputData().getString(WORK_KEY_ERROR_CODE);
+        String message = info.getOutputData().getString(WORK_KEY_ERROR_MESSAGE);
+        if (info.getState() == WorkInfo.State.CANCELLED) {
+            errorCode = ERROR_CANCELLED;
+            message = "Background download cancelled";
+        } else if (errorCode == null) {
+            errorCode = ERROR_DOWNLOAD_FAILED;
+            message = "Background download failed";
+        }
+        Log.e(TAG, "Background download failed: " + message);
+        failDownload(job, errorCode, message);
+    }
+
+    /**
+     * Re-attach to background work that was queued or running when the app was killed.
+     * Called on the executor (WorkManager query blocks).
+     */
+    private void restoreBackgroundDownload() {
+        try {
+            List<WorkInfo> infos = WorkManager.getInstance(cordova.getContext())
+                    .getWorkInfosForUniqueWork(BACKGROUND_WORK_NAME).get();
+            for (WorkInfo info : infos) {
+                if (info.getState().isFinished()) continue;
+
+                HotUpdatesDownloadJob job = new HotUpdatesDownloadJob(
+                        state.getString(PREF_BACKGROUND_VERSION, "pending"), null, false);
+                synchronized (downloadLock) {
+                    if (downloadJob != null) return; // A getUpdate of this session came first
+                    downloadJob = job;
                 }
-                sendErrorOnMain(cordova, callbackContext, errorCode, "Download failed: " + e.getMessage());
 
-            } finally {
-                if (output != null) try { output.close(); } catch (Exception ignored) {}
-                if (input != null) try { input.close(); } catch (Exception ignored) {}
-                if (connection != null) connection.disconnect();
+                Log.d(TAG, "Background download still scheduled, re-attaching");
+                backgroundWorkId = info.getId();
+                state.edit().putBoolean(PREF_DOWNLOAD_IN_PROGRESS, true).apply();
+                observeBackgroundWork(backgroundWorkId, job);
+                return;
             }
-        });
+        } catch (Exception e) {
+            Log.w(TAG, "Failed to query background downloads: " + e.getMessage());
+        }
     }
 
-    private void saveDownloadedUpdate(File zipFile, CallbackContext callbackContext) {
-        try {
-            // Create temp directory for new download
-            File newDownloadDir = new File(filesDir, DIR_TEMP_NEW_DOWNLOAD);
-            deleteRecursive(newDownloadDir);
-            newDownloadDir.mkdirs();
+    // ============================================================
+    // Background prefetch (WorkManager periodic work)
+    // ============================================================
+
+    /**
+     * Plugin of the running app, null while only WorkManager runs the process.
+     */
+    static HotUpdates getActiveInstance() {
+        return activeInstance;
+    }
+
+    /**
+     * Schedule (or cancel, without HotUpdatesPrefetchUrl) the periodic update check.
+     * It runs only on an unmetered network while the device is charging and idle.
+     */
+    private void schedulePrefetch() {
+        WorkManager workManager = WorkManager.getInstance(cordova.getContext());
+        String prefetchURL = preferences.getString(CONFIG_PREFETCH_URL, null);
+        if (prefetchURL == null || prefetchURL.isEmpty()) {
+            workManager.cancelUniqueWork(PREFETCH_WORK_NAME);
+            return;
+        }
+
+        int intervalHours = Math.max(1, preferences.getInteger(CONFIG_PREFETCH_INTERVAL, DEFAULT_PREFETCH_INTERVAL_HOURS));
+        Constraints.Builder constraints = new Constraints.Builder()
+            .setRequiredNetworkType(NetworkType.UNMETERED)
+            .setRequiresCharging(true)
+            .setRequiresStorageNotLow(true);
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.M) {
+            constraints.setRequiresDeviceIdle(true);
+        }
 
-            // Extract ZIP
-            if (!extractZip(zipFile, newDownloadDir)) {
-                throw new IOException("Failed to extract ZIP");
+        PeriodicWorkRequest request = new PeriodicWorkRequest.Builder(
+                HotUpdatesPrefetchWorker.class, intervalHours, TimeUnit.HOURS)
+            .setConstraints(constraints.build())
+            .build();
+
+        // UPDATE keeps the schedule, but applies a changed interval
+        workManager.enqueueUniquePeriodicWork(PREFETCH_WORK_NAME, ExistingPeriodicWorkPolicy.UPDATE, request);
+        Log.d(TAG, "Background prefetch scheduled every " + intervalHours + " h");
+    }
+
+    /**
+     * Download an update found by the background prefetch, like getUpdate({background: true,
+     * wifiOnly: true, requiresCharging: true}) without a callback. A download started by
+     * JavaScript is never replaced.
+     */
+    void prefetch(String version, String downloadURL, boolean packed, String verifyManifestURL) {
+        HotUpdatesDownloadJob job = new HotUpdatesDownloadJob(version, null, false);
+        synchronized (downloadLock) {
+            if (downloadJob != null) {
+                Log.d(TAG, "Prefetch of v" + version + " skipped, download of v" + downloadJob.version + " in progress");
+                return;
             }
+            downloadJob = job;
+        }
+
+        Log.d(TAG, "Prefetching v" + version);
+        enqueueBackgroundDownload(job, downloadURL, 1, packed, verifyManifestURL, false, true, true);
+    }
+
+    // ============================================================
+    // Delta update - download only changed files
+    // ============================================================
+
+    private void downloadDeltaUpdate(HotUpdatesDownloadJob job, String manifestURL) {
+        executor.execute(() -> {
+            HotUpdatesProgress progress = beginDownload(job);
+            if (progress == null) return;
+
+            Log.d(TAG, "Starting delta update from manifest: " + manifestURL);
+
+            File newDownloadDir = new File(filesDir, DIR_TEMP_NEW_DOWNLOAD);
+            String version = job.version;
 
-            // Find www folder
-            File wwwInZip = findWwwFolder(newDownloadDir);
-            if (wwwInZip == null) {
+            try {
+                // With a configured key delta manifests must be signed as well
+                String publicKey = getPublicKey();
+                String json = publicKey != null
+                        ? HotUpdatesVerifier.loadSigned(manifestURL, publicKey) : downloadToString(manifestURL);
+                HotUpdatesManifest manifest = HotUpdatesManifest.parse(json, manifestURL);
+                if ("pending".equals(version) && manifest.getVersion() != null) {
+                    version = manifest.getVersion();
+                }
+
+                // Shares temp_new_download with ZIP downloads - partial ZIP data is dropped
+                downloader.clearResumeState();
                 deleteRecursive(newDownloadDir);
-                throw new IOException("www folder not found in archive");
-            }
+                File newWww = new File(newDownloadDir, DIR_WWW);
+                newWww.mkdirs();
+
+                // Reuse unchanged files of the installed www. Files equal to the bundled
+                // assets stay out of the version (overlay): the PathHandler falls through to them
+                File currentWww = getCurrentWwwDir();
+                AssetManager assets = cordova.getActivity().getAssets();
+                long copyStart = HotUpdatesMetrics.now();
+                int fromBundle = 0;
+                List<HotUpdatesManifest.Entry> missing = new ArrayList<>();
+                for (HotUpdatesManifest.Entry entry : manifest.getEntries()) {
+                    File local = new File(currentWww, entry.path);
+                    if (HotUpdatesManifest.matches(local, entry)) {
+                        linkFile(local, new File(newWww, entry.path));
+                    } else if (HotUpdatesManifest.matchesAsset(assets, DIR_WWW + "/" + entry.path, entry)) {
+                        fromBundle++;
+                    } else {
+                        missing.add(entry);
+                    }
+                }
+                if (fromBundle > 0) {
+                    // Marker records the app build: after a store update the overlay is dropped on launch
+                    writeTextFile(new File(newWww, OVERLAY_MARKER_FILE), appBundleBuild);
+                }
+                HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_COPY, copyStart);
 
-            // Move to temp_downloaded_update
-            File tempUpdateDir = new File(filesDir, DIR_TEMP_DOWNLOADED);
-            deleteRecursive(tempUpdateDir);
-            tempUpdateDir.mkdirs();
+                Log.d(TAG, "Delta: " + (manifest.getEntries().size() - missing.size() - fromBundle) + " files reused, "
+                        + fromBundle + " from bundle (overlay), " + missing.size() + " to download");
 
-            File destWww = new File(tempUpdateDir, DIR_WWW);
-            copyDirectory(wwwInZip, destWww);
+                // Prefer one patch archive over many small requests
+                String installedVersion = state.getString(PREF_INSTALLED_VERSION, appBundleVersion);
+                String patchURL = manifest.getPatchUrl(installedVersion);
+                if (!missing.isEmpty() && patchURL != null) {
+                    missing = applyPatchArchive(patchURL, missing, newWww);
+                }
 
-            // Also copy to pending_update for auto-install on next launch
-            File pendingDir = new File(filesDir, DIR_PENDING_UPDATE);
-            deleteRecursive(pendingDir);
-            pendingDir.mkdirs();
-            copyDirectory(tempUpdateDir, pendingDir);
+                long totalBytes = 0;
+                for (HotUpdatesManifest.Entry entry : missing) {
+                    totalBytes = entry.size >= 0 && totalBytes >= 0 ? totalBytes + entry.size : -1;
+                }
+                progress.startPhase(PROGRESS_PHASE_DOWNLOADING, 0, totalBytes);
+
+                long downloadStart = HotUpdatesMetrics.now();
+                long downloadedBytes = 0;
+                for (HotUpdatesManifest.Entry entry : missing) {
+                    if (job.isCancelled()) {
+                        throw new IOException("Download cancelled");
+                    }
+                    File dest = new File(newWww, entry.path);
+                    String hash = downloadToFile(manifest.getFileUrl(entry), dest);
+                    progress.add(dest.length());
+                    downloadedBytes += dest.length();
+                    if (!hash.equals(entry.sha256)) {
+                        throw new IOException("Hash mismatch: " + entry.path);
+                    }
+                }
+                if (!missing.isEmpty()) {
+                    HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_DOWNLOAD, downloadStart, downloadedBytes);
+                }
 
-            // Cleanup
-            deleteRecursive(newDownloadDir);
-            zipFile.delete();
+                // Every file of the new www matched its manifest entry: the store needs no hashing
+                Map<String, String> hashes = new HashMap<>();
+                for (HotUpdatesManifest.Entry entry : manifest.getEntries()) {
+                    hashes.put(new File(newWww, entry.path).getAbsolutePath(), entry.sha256);
+                }
+                downloader.stage(newDownloadDir, version, manifest.getWarmupPaths(), hashes);
+                completeDownload(job);
 
-            // Update state
-            isUpdateReadyToInstall = true;
-            isDownloadingUpdate = false;
-
-            SharedPreferences.Editor editor = getPrefs().edit();
-            editor.putBoolean(PREF_DOWNLOAD_IN_PROGRESS, false);
-            editor.putBoolean(PREF_PENDING_UPDATE_READY, true);
-            editor.putBoolean(PREF_HAS_PENDING, true);
-            editor.putString(PREF_PENDING_VERSION, pendingUpdateVersion);
-            editor.apply();
+            } catch (JSONException e) {
+                Log.e(TAG, "Invalid manifest: " + e.getMessage());
+                deleteRecursive(newDownloadDir);
+                failDownload(job, ERROR_MANIFEST_INVALID, "Invalid manifest: " + e.getMessage());
 
-            Log.d(TAG, "Update ready (v" + pendingUpdateVersion + ")");
+            } catch (Exception e) {
+                Log.e(TAG, "Delta update failed: " + e.getMessage());
+                deleteRecursive(newDownloadDir);
 
-            sendSuccessOnMain(cordova, callbackContext);
+                String errorCode = ERROR_DOWNLOAD_FAILED;
+                if (e.getMessage() != null && e.getMessage().startsWith("HTTP error:")) {
+                    errorCode = ERROR_HTTP_ERROR;
+                } else if (e.getMessage() != null && e.getMessage().startsWith("Hash mismatch:")) {
+                    errorCode = ERROR_HASH_MISMATCH;
+                } else if (e.getMessage() != null && e.getMessage().startsWith("Signature invalid:")) {
+                    errorCode = ERROR_SIGNATURE_INVALID;
+                } else if (e.getMessage() != null && e.getMessage().contains("www folder not found")) {
+                    errorCode = ERROR_WWW_NOT_FOUND;
+                }
+                failDownload(job, errorCode, "Delta update failed: " + e.getMessage());
+            }
+        });
+    }
 
-        } catch (Exception e) {
-            Log.e(TAG, "Save update failed: " + e.getMessage());
-            isDownloadingUpdate = false;
-            getPrefs().edit().putBoolean(PREF_DOWNLOAD_IN_PROGRESS, false).apply();
+    /**
+     * Download patch ZIP (changed files only) and move matching files into the new www.
+     *
+     * @param patchURL Patch archive URL
+     * @param missing Files still missing in the new www
+     * @param newWww New www directory being assembled
+     * @return Files not provided by the patch (to be downloaded one by one)
+     */
+    private List<HotUpdatesManifest.Entry> applyPatchArchive(String patchURL,
+                                                             List<HotUpdatesManifest.Entry> missing,
+                                                             File newWww) {
+        File patchZip = new File(filesDir, PATCH_TEMP_ZIP);
+        File patchDir = new File(filesDir, DIR_TEMP_PATCH);
+        List<HotUpdatesManifest.Entry> remaining = new ArrayList<>();
 
-            String errorCode = ERROR_EXTRACTION_FAILED;
-            if (e.getMessage() != null && e.getMessage().contains("www folder not found")) {
-                errorCode = ERROR_WWW_NOT_FOUND;
+        try {
+            Log.d(TAG, "Downloading patch archive: " + patchURL);
+            downloadToFile(patchURL, patchZip);
+
+            deleteRecursive(patchDir);
+            patchDir.mkdirs();
+            long extractStart = HotUpdatesMetrics.now();
+            File patchWww = extractZip(patchZip, patchDir) ? findWwwFolder(patchDir) : null;
+            HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_EXTRACT, extractStart, patchZip.length());
+
+            for (HotUpdatesManifest.Entry entry : missing) {
+                File patched = patchWww != null ? new File(patchWww, entry.path) : null;
+                if (patched != null && HotUpdatesManifest.matches(patched, entry)) {
+                    File dest = new File(newWww, entry.path);
+                    dest.getParentFile().mkdirs();
+                    if (!patched.renameTo(dest)) {
+                        copyFile(patched, dest);
+                    }
+                } else {
+                    remaining.add(entry);
+                }
             }
-            sendErrorOnMain(cordova, callbackContext, errorCode, e.getMessage());
+        } catch (IOException e) {
+            Log.w(TAG, "Patch archive failed, falling back to per-file download: " + e.getMessage());
+            remaining = missing;
+        } finally {
+            patchZip.delete();
+            deleteRecursive(patchDir);
         }
+
+        return remaining;
     }
 
     // ============================================================
@@ -455,43 +1119,45 @@ public class HotUpdates extends CordovaPlugin {
             return;
         }
 
-        String versionToInstall = getPrefs().getString(PREF_PENDING_VERSION, "unknown");
+        String versionToInstall = state.getString(PREF_PENDING_VERSION, "unknown");
+        String warmup = state.getString(PREF_PENDING_WARMUP, null);
         Log.d(TAG, "forceUpdate: installing v" + versionToInstall);
 
+        long installStart = HotUpdatesMetrics.now();
         try {
-            // Backup current version
-            backupCurrentVersion();
-
-            // Remove current www and copy new one
-            File wwwDir = new File(wwwPath);
-            deleteRecursive(wwwDir);
-            copyDirectory(tempWwwDir, wwwDir);
+            // Move update into its own version directory (single rename)
+            String versionDir = moveToVersionsDir(tempWwwDir, versionToInstall);
 
-            // Update preferences
-            SharedPreferences.Editor editor = getPrefs().edit();
-            editor.putString(PREF_INSTALLED_VERSION, versionToInstall);
+            // Flip current pointer - previous version directory stays as rollback target
+            HotUpdatesState.Editor editor = state.edit();
+            switchCurrentVersion(editor, versionToInstall, versionDir);
             editor.putBoolean(PREF_PENDING_UPDATE_READY, false);
             editor.putBoolean(PREF_HAS_PENDING, false);
             editor.remove(PREF_PENDING_VERSION);
+            editor.remove(PREF_PENDING_WARMUP);
             editor.remove(PREF_CANARY_VERSION);
-            editor.apply();
-
-            // Cleanup temp directories
-            deleteRecursive(tempUpdateDir);
-            deleteRecursive(new File(filesDir, DIR_PENDING_UPDATE));
+            // Add to version history (same write as the pointer flip)
+            addVersionToHistory(editor, versionToInstall);
+            editor.commit();
+            HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_INSTALL, installStart);
 
             // Update state
             isUpdateReadyToInstall = false;
             pendingUpdateVersion = null;
 
-            // Add to version history
-            addVersionToHistory(versionToInstall);
+            // Cleanup staging directory and stale versions off the install path
+            executor.execute(() -> {
+                deleteRecursive(tempUpdateDir);
+                pruneVersions();
+            });
 
             Log.d(TAG, "Update installed successfully");
 
             callbackContext.success();
 
             // Reload WebView with new content
+            refreshPathIndex();
+            warmUp(warmup);
             startCanaryTimer();
             reloadWebView();
 
@@ -513,39 +1179,156 @@ public class HotUpdates extends CordovaPlugin {
             return;
         }
 
-        // Save canary version (like iOS - accepts any version)
-        getPrefs().edit().putString(PREF_CANARY_VERSION, canaryVersion).apply();
+        canaryHandler.post(() -> {
+            // Save canary version (like iOS - accepts any version)
+            HotUpdatesState.Editor editor = state.edit();
+            editor.putString(PREF_CANARY_VERSION, canaryVersion);
+
+            // Stop canary timer
+            if (canaryRunnable != null) {
+                canaryHandler.removeCallbacks(canaryRunnable);
+                canaryRunnable = null;
+                HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_CANARY, canaryStartTime);
+                Log.d(TAG, "Canary confirmed: v" + canaryVersion);
+
+                // Load time held up by extendCanary() says nothing about the device
+                if (!canaryExtended) {
+                    long latencyMs = TimeUnit.NANOSECONDS.toMillis(HotUpdatesMetrics.now() - canaryStartTime);
+                    addCanaryLatency(editor, canaryVersion, latencyMs);
+                }
+            }
 
-        // Stop canary timer
-        if (canaryHandler != null && canaryRunnable != null) {
-            canaryHandler.removeCallbacks(canaryRunnable);
-            canaryRunnable = null;
-            Log.d(TAG, "Canary confirmed: v" + canaryVersion);
-        }
+            editor.apply();
+            callbackContext.success();
+        });
+    }
 
-        callbackContext.success();
+    // ============================================================
+    // extendCanary - Keep a slow but progressing load alive
+    // ============================================================
+
+    private void extendCanary(CallbackContext callbackContext) {
+        canaryHandler.post(() -> {
+            if (canaryRunnable != null) {
+                long elapsedMs = TimeUnit.NANOSECONDS.toMillis(HotUpdatesMetrics.now() - canaryStartTime);
+                long delayMs = Math.min(canaryTimeoutMs, CANARY_MAX_EXTENDED_MS - elapsedMs);
+                if (delayMs > 0) {
+                    canaryHandler.removeCallbacks(canaryRunnable);
+                    canaryHandler.postDelayed(canaryRunnable, delayMs);
+                    canaryExtended = true;
+                    Log.d(TAG, "Canary deadline extended by " + delayMs + " ms");
+                } else {
+                    Log.w(TAG, "Canary deadline not extended: load is running for " + elapsedMs + " ms");
+                }
+            }
+
+            callbackContext.success();
+        });
     }
 
     // ============================================================
     // Canary Timer
     // ============================================================
 
+    /**
+     * Called from the executor (startup, install, rollback); the timer state is set on the
+     * main thread, in order with canary() and extendCanary() of the reloaded page.
+     */
     private void startCanaryTimer() {
-        if (canaryHandler != null && canaryRunnable != null) {
-            canaryHandler.removeCallbacks(canaryRunnable);
+        long timeoutMs = getCanaryTimeoutMs(state.snapshot());
+        long startTime = HotUpdatesMetrics.now();
+
+        canaryHandler.post(() -> {
+            if (canaryRunnable != null) {
+                canaryHandler.removeCallbacks(canaryRunnable);
+            }
+
+            canaryTimeoutMs = timeoutMs;
+            canaryExtended = false;
+
+            canaryRunnable = () -> {
+                Log.w(TAG, "CANARY TIMEOUT - JS did not call canary() within " + timeoutMs + " ms");
+                canaryTimeout();
+            };
+
+            canaryStartTime = startTime;
+            canaryHandler.postDelayed(canaryRunnable, timeoutMs);
+        });
+    }
+
+    /**
+     * Canary deadline derived from the load times measured on this device:
+     * a multiple of their 90th percentile, within CANARY_MIN/MAX_TIMEOUT_MS.
+     * CANARY_TIMEOUT_MS until CANARY_MIN_SAMPLES loads were measured.
+     */
+    private long getCanaryTimeoutMs(HotUpdatesState.Snapshot snapshot) {
+        JSONArray samples = loadCanaryLatencies(snapshot);
+        if (samples.length() < CANARY_MIN_SAMPLES) {
+            return CANARY_TIMEOUT_MS;
         }
 
-        canaryRunnable = () -> {
-            Log.w(TAG, "CANARY TIMEOUT - JS did not call canary() within 20 seconds");
-            canaryTimeout();
-        };
+        long[] latencies = new long[samples.length()];
+        for (int i = 0; i < latencies.length; i++) {
+            latencies[i] = samples.optJSONObject(i).optLong("ms");
+        }
+        Arrays.sort(latencies);
+        // Nearest-rank percentile
+        int rank = (CANARY_LATENCY_PERCENTILE * latencies.length + 99) / 100;
+        long percentile = latencies[Math.max(0, rank - 1)];
 
-        canaryHandler.postDelayed(canaryRunnable, CANARY_TIMEOUT_MS);
+        long timeout = percentile * CANARY_TIMEOUT_FACTOR;
+        return Math.max(CANARY_MIN_TIMEOUT_MS, Math.min(CANARY_MAX_TIMEOUT_MS, timeout));
+    }
+
+    /**
+     * Measured load times, oldest first. Malformed entries are dropped.
+     */
+    private JSONArray loadCanaryLatencies(HotUpdatesState.Snapshot snapshot) {
+        JSONArray samples = new JSONArray();
+        String json = snapshot.getString(PREF_CANARY_LATENCIES, null);
+        if (json == null) {
+            return samples;
+        }
+        try {
+            JSONArray saved = new JSONArray(json);
+            for (int i = 0; i < saved.length(); i++) {
+                JSONObject sample = saved.optJSONObject(i);
+                if (sample != null && sample.optLong("ms", -1) >= 0) {
+                    samples.put(sample);
+                }
+            }
+        } catch (JSONException e) {
+            Log.w(TAG, "Invalid canary latencies, starting over");
+        }
+        return samples;
+    }
+
+    /**
+     * Append a load time; only the last CANARY_LATENCY_SAMPLES are kept.
+     */
+    private void addCanaryLatency(HotUpdatesState.Editor editor, String version, long latencyMs) {
+        JSONArray samples = loadCanaryLatencies(state.snapshot());
+        try {
+            JSONObject sample = new JSONObject();
+            sample.put("version", version);
+            sample.put("ms", latencyMs);
+            samples.put(sample);
+        } catch (JSONException e) {
+            return;
+        }
+
+        JSONArray kept = new JSONArray();
+        for (int i = Math.max(0, samples.length() - CANARY_LATENCY_SAMPLES); i < samples.length(); i++) {
+            kept.put(samples.opt(i));
+        }
+        editor.putString(PREF_CANARY_LATENCIES, kept.toString());
+        Log.d(TAG, "Canary load time of v" + version + ": " + latencyMs + " ms");
     }
 
     private void canaryTimeout() {
-        String currentVersion = getPrefs().getString(PREF_INSTALLED_VERSION, null);
-        String previousVersion = getPrefs().getString(PREF_PREVIOUS_VERSION, null);
+        HotUpdatesState.Snapshot snapshot = state.snapshot();
+        String currentVersion = snapshot.getString(PREF_INSTALLED_VERSION, null);
+        String previousVersion = snapshot.getString(PREF_PREVIOUS_VERSION, null);
 
         if (previousVersion == null || previousVersion.isEmpty()) {
             Log.d(TAG, "Fresh install from Store, rollback not possible");
@@ -568,83 +1351,444 @@ public class HotUpdates extends CordovaPlugin {
     // Rollback
     // ============================================================
 
-    private void backupCurrentVersion() {
-        File wwwDir = new File(wwwPath);
-        if (!wwwDir.exists()) return;
+    private boolean rollbackToPreviousVersion() {
+        HotUpdatesState.Snapshot snapshot = state.snapshot();
+        String currentVersion = snapshot.getString(PREF_INSTALLED_VERSION, null);
+        List<RetainedVersion> retained = loadRetainedVersions(snapshot);
 
-        File previousDir = new File(previousVersionPath);
-        deleteRecursive(previousDir);
+        if (retained.isEmpty()) {
+            Log.e(TAG, "Rollback failed: no previous version");
+            return false;
+        }
+        RetainedVersion previous = retained.remove(0);
 
-        try {
-            copyDirectory(wwwDir, previousDir);
+        Log.d(TAG, "Rollback: " + currentVersion + " -> " + previous.version);
 
-            String currentVersion = getPrefs().getString(PREF_INSTALLED_VERSION, appBundleVersion);
-            getPrefs().edit().putString(PREF_PREVIOUS_VERSION, currentVersion).apply();
-            Log.d(TAG, "Backed up version: " + currentVersion);
-        } catch (IOException e) {
-            Log.e(TAG, "Backup failed: " + e.getMessage());
+        // Prevent rollback loop
+        if (previous.version.equals(currentVersion)) {
+            Log.e(TAG, "Rollback failed: cannot rollback to same version");
+            return false;
         }
-    }
 
-    private boolean rollbackToPreviousVersion() {
-        String currentVersion = getPrefs().getString(PREF_INSTALLED_VERSION, null);
-        String previousVersion = getPrefs().getString(PREF_PREVIOUS_VERSION, null);
+        // Flip current pointer back - no files are moved or copied. The next
+        // retained version becomes the rollback target
+        HotUpdatesState.Editor editor = state.edit();
+        setCurrentVersion(editor, previous);
+        saveRetainedVersions(editor, retained);
 
-        Log.d(TAG, "Rollback: " + currentVersion + " -> " + previousVersion);
+        // Add failed version to ignore list (same write as the pointer flip)
+        if (currentVersion != null) {
+            addVersionToIgnoreList(editor, currentVersion);
+            removeVersionFromHistory(editor, currentVersion);
+        }
 
-        if (previousVersion == null || previousVersion.isEmpty()) {
-            Log.e(TAG, "Rollback failed: no previous version");
+        if (!editor.commit()) {
+            Log.e(TAG, "Rollback failed: cannot save state");
             return false;
         }
+        refreshPathIndex();
 
-        File previousDir = new File(previousVersionPath);
-        if (!previousDir.exists()) {
-            Log.e(TAG, "Rollback failed: previous version folder not found");
-            return false;
+        Log.d(TAG, "Rollback successful: " + currentVersion + " -> " + previous.version);
+
+        // Failed version directory is no longer referenced
+        executor.execute(this::pruneVersions);
+
+        return true;
+    }
+
+    // ============================================================
+    // rollbackTo - Switch to a retained version
+    // ============================================================
+
+    /**
+     * Make a retained version current without downloading it. The version left
+     * becomes the rollback target, so a canary timeout returns to it.
+     */
+    private void rollbackTo(JSONArray args, CallbackContext callbackContext) {
+        String version = args.optString(0, null);
+        if (version == null || version.isEmpty()) {
+            sendError(callbackContext, ERROR_VERSION_REQUIRED, "Version is required");
+            return;
         }
 
-        // Prevent rollback loop
-        if (previousVersion.equals(currentVersion)) {
-            Log.e(TAG, "Rollback failed: cannot rollback to same version");
-            return false;
+        HotUpdatesState.Snapshot snapshot = state.snapshot();
+        String currentVersion = snapshot.getString(PREF_INSTALLED_VERSION, appBundleVersion);
+        if (version.equals(currentVersion)) {
+            callbackContext.success();
+            return;
         }
 
-        try {
-            // Backup current to temp
-            File backupDir = new File(filesDir, DIR_WWW_BACKUP);
-            deleteRecursive(backupDir);
+        List<RetainedVersion> retained = loadRetainedVersions(snapshot);
+        RetainedVersion target = null;
+        for (RetainedVersion candidate : retained) {
+            if (candidate.version.equals(version)) {
+                target = candidate;
+                break;
+            }
+        }
+        if (target == null) {
+            sendError(callbackContext, ERROR_VERSION_NOT_RETAINED, "Version " + version + " is not retained");
+            return;
+        }
+
+        Log.d(TAG, "rollbackTo: " + currentVersion + " -> " + version);
+
+        retained.remove(target);
+        retained.add(0, new RetainedVersion(currentVersion, snapshot.getString(PREF_CURRENT_VERSION_DIR, null)));
+
+        HotUpdatesState.Editor editor = state.edit();
+        setCurrentVersion(editor, target);
+        saveRetainedVersions(editor, retained);
+        editor.remove(PREF_CANARY_VERSION);
+        if (!editor.commit()) {
+            sendError(callbackContext, ERROR_INSTALL_FAILED, "Rollback failed: cannot save state");
+            return;
+        }
+
+        callbackContext.success();
+
+        refreshPathIndex();
+        startCanaryTimer();
+        reloadWebView();
+
+        // Retention limit may drop the oldest version
+        executor.execute(this::pruneVersions);
+    }
+
+    // ============================================================
+    // Versioned Layout (versions/<dir>/www + current pointer)
+    // ============================================================
+
+    private File getVersionDir(String dirName) {
+        return new File(new File(filesDir, DIR_VERSIONS), dirName);
+    }
+
+    /**
+     * www directory of the version the WebView currently serves.
+     */
+    private File getCurrentWwwDir() {
+        String currentDir = state.getString(PREF_CURRENT_VERSION_DIR, null);
+        return currentDir != null ? new File(getVersionDir(currentDir), DIR_WWW) : new File(wwwPath);
+    }
+
+    /**
+     * Move a complete www tree into versions/&lt;dir&gt;/www.
+     * Rename is atomic and constant-time; link mirror is used only if rename fails.
+     *
+     * @param srcWww www directory to move
+     * @param version Version string used for the directory name
+     * @return Name of the created version directory
+     * @throws IOException if the tree cannot be moved
+     */
+    private String moveToVersionsDir(File srcWww, String version) throws IOException {
+        String dirName = allocateVersionDirName(version);
+        File versionDir = getVersionDir(dirName);
+        versionDir.mkdirs();
+
+        File destWww = new File(versionDir, DIR_WWW);
+        if (!srcWww.renameTo(destWww)) {
+            long copyStart = HotUpdatesMetrics.now();
+            linkDirectory(srcWww, destWww);
+            HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_COPY, copyStart);
+            deleteRecursive(srcWww);
+        }
+        return dirName;
+    }
+
+    /**
+     * Pick a directory name for the version that is not the current or a retained one.
+     * A stale directory with the same name is removed.
+     */
+    private String allocateVersionDirName(String version) {
+        String base = version.replaceAll("[^A-Za-z0-9._-]", "_");
+        if (base.isEmpty() || base.startsWith(".")) {
+            base = "_" + base;
+        }
+
+        Set<String> liveDirs = getLiveVersionDirs(state.snapshot(), false);
+
+        String name = base;
+        int suffix = 1;
+        while (liveDirs.contains(name)) {
+            name = base + "-" + suffix++;
+        }
+
+        deleteRecursive(getVersionDir(name));
+        return name;
+    }
+
+    /**
+     * Make the given version directory current; the old current becomes the rollback target
+     * and older targets move down the retained list.
+     */
+    private void switchCurrentVersion(HotUpdatesState.Editor editor, String version, String versionDir) {
+        HotUpdatesState.Snapshot snapshot = state.snapshot();
+        String currentDir = snapshot.getString(PREF_CURRENT_VERSION_DIR, null);
+        // Bundled assets are not copied: rolling back to them only clears the pointer
+        String currentVersion = currentDir != null
+                ? snapshot.getString(PREF_INSTALLED_VERSION, appBundleVersion) : appBundleVersion;
+
+        List<RetainedVersion> retained = loadRetainedVersions(snapshot);
+        // A directory name of a version pruned under disk pressure may have been reused
+        retained.removeIf(retainedVersion -> versionDir.equals(retainedVersion.dir));
+        retained.add(0, new RetainedVersion(currentVersion, currentDir));
+        saveRetainedVersions(editor, retained);
+        Log.d(TAG, "Kept version " + currentVersion + (currentDir != null ? "" : " (bundle)") + " for rollback");
+
+        editor.putString(PREF_CURRENT_VERSION_DIR, versionDir);
+        editor.putString(PREF_INSTALLED_VERSION, version);
+    }
+
+    /**
+     * Point current at a retained version (dir null: bundled assets).
+     */
+    private void setCurrentVersion(HotUpdatesState.Editor editor, RetainedVersion version) {
+        if (version.dir != null) {
+            editor.putString(PREF_INSTALLED_VERSION, version.version);
+            editor.putString(PREF_CURRENT_VERSION_DIR, version.dir);
+        } else {
+            editor.remove(PREF_INSTALLED_VERSION);
+            editor.remove(PREF_CURRENT_VERSION_DIR);
+        }
+    }
+
+    /**
+     * Delete version directories other than current and retained ones, then unreferenced store
+     * objects. On low storage only the current version and the rollback target are kept.
+     * Runs on the executor.
+     */
+    private void pruneVersions() {
+        pruneVersions(isStorageLow());
+    }
+
+    /**
+     * @param rollbackTargetOnly Keep only the current version and the rollback target
+     */
+    private void pruneVersions(boolean rollbackTargetOnly) {
+        // One snapshot: an install between two reads must not make a live directory look stale
+        Set<String> liveDirs = getLiveVersionDirs(state.snapshot(), rollbackTargetOnly);
+
+        File[] versionDirs = new File(filesDir, DIR_VERSIONS).listFiles();
+        if (versionDirs != null) {
+            for (File dir : versionDirs) {
+                String name = dir.getName();
+                if (!liveDirs.contains(name)) {
+                    Log.d(TAG, "Removing stale version directory: " + name);
+                    deleteRecursive(dir);
+                }
+            }
+        }
+
+        store.collectGarbage();
+    }
+
+    // ============================================================
+    // Version Retention (previous pointer + retained list)
+    // ============================================================
+
+    /**
+     * Installed version kept for rollback.
+     */
+    private static final class RetainedVersion {
+        final String version;
+        final String dir; // null: bundled assets
+
+        RetainedVersion(String version, String dir) {
+            this.version = version;
+            this.dir = dir;
+        }
+    }
+
+    /**
+     * Installed versions kept on disk (config.xml HotUpdatesKeepVersions), current included.
+     */
+    private int getKeepVersions() {
+        return Math.max(DEFAULT_KEEP_VERSIONS, preferences.getInteger(CONFIG_KEEP_VERSIONS, DEFAULT_KEEP_VERSIONS));
+    }
+
+    private boolean isStorageLow() {
+        return filesDir != null && new File(filesDir).getUsableSpace() < LOW_STORAGE_BYTES;
+    }
 
-            File wwwDir = new File(wwwPath);
-            if (wwwDir.exists()) {
-                wwwDir.renameTo(backupDir);
+    /**
+     * Rollback targets, newest first: the previous version followed by the retained list.
+     * Versions whose directory was removed under disk pressure are skipped.
+     */
+    private List<RetainedVersion> loadRetainedVersions(HotUpdatesState.Snapshot snapshot) {
+        List<RetainedVersion> retained = new ArrayList<>();
+        String previousVersion = snapshot.getString(PREF_PREVIOUS_VERSION, null);
+        if (previousVersion != null && !previousVersion.isEmpty()) {
+            retained.add(new RetainedVersion(previousVersion, snapshot.getString(PREF_PREVIOUS_VERSION_DIR, null)));
+        }
+
+        String saved = snapshot.getString(PREF_RETAINED_VERSIONS, null);
+        if (saved != null) {
+            try {
+                JSONArray arr = new JSONArray(saved);
+                for (int i = 0; i < arr.length(); i++) {
+                    JSONObject item = arr.getJSONObject(i);
+                    retained.add(new RetainedVersion(item.getString("version"), item.optString("dir", null)));
+                }
+            } catch (JSONException e) {
+                Log.e(TAG, "Failed to parse retained versions");
             }
+        }
 
-            // Copy previous to www
-            copyDirectory(previousDir, wwwDir);
+        List<RetainedVersion> existing = new ArrayList<>();
+        Set<String> seenDirs = new HashSet<>();
+        boolean seenBundle = false;
+        for (RetainedVersion version : retained) {
+            if (version.dir == null) {
+                if (seenBundle) continue;
+                seenBundle = true;
+            } else if (!seenDirs.add(version.dir) || !new File(getVersionDir(version.dir), DIR_WWW).exists()) {
+                continue;
+            }
+            existing.add(version);
+        }
+        return existing;
+    }
 
-            // Update preferences
-            SharedPreferences.Editor editor = getPrefs().edit();
-            editor.putString(PREF_INSTALLED_VERSION, previousVersion);
+    /**
+     * Add rollback targets to the editor: first one as previous version, the rest as
+     * retained list, cut to the retention limit.
+     */
+    private void saveRetainedVersions(HotUpdatesState.Editor editor, List<RetainedVersion> retained) {
+        int limit = Math.min(retained.size(), getKeepVersions() - 1);
+        if (limit == 0) {
             editor.remove(PREF_PREVIOUS_VERSION);
-            editor.apply();
+            editor.remove(PREF_PREVIOUS_VERSION_DIR);
+            editor.remove(PREF_RETAINED_VERSIONS);
+            return;
+        }
 
-            // Cleanup backup
-            deleteRecursive(backupDir);
+        RetainedVersion previous = retained.get(0);
+        editor.putString(PREF_PREVIOUS_VERSION, previous.version);
+        if (previous.dir != null) {
+            editor.putString(PREF_PREVIOUS_VERSION_DIR, previous.dir);
+        } else {
+            editor.remove(PREF_PREVIOUS_VERSION_DIR);
+        }
 
-            Log.d(TAG, "Rollback successful: " + currentVersion + " -> " + previousVersion);
+        if (limit == 1) {
+            editor.remove(PREF_RETAINED_VERSIONS);
+            return;
+        }
+        JSONArray arr = new JSONArray();
+        try {
+            for (RetainedVersion version : retained.subList(1, limit)) {
+                JSONObject item = new JSONObject();
+                item.put("version", version.version);
+                if (version.dir != null) item.put("dir", version.dir);
+                arr.put(item);
+            }
+        } catch (JSONException e) {
+            Log.e(TAG, "Failed to save retained versions");
+        }
+        editor.putString(PREF_RETAINED_VERSIONS, arr.toString());
+    }
+
+    /**
+     * Version directories that must not be deleted or reused.
+     *
+     * @param rollbackTargetOnly Keep only current and previous version (low storage)
+     */
+    private Set<String> getLiveVersionDirs(HotUpdatesState.Snapshot snapshot, boolean rollbackTargetOnly) {
+        Set<String> dirs = new HashSet<>();
+        String currentDir = snapshot.getString(PREF_CURRENT_VERSION_DIR, null);
+        if (currentDir != null) dirs.add(currentDir);
+
+        List<RetainedVersion> retained = loadRetainedVersions(snapshot);
+        for (RetainedVersion version : retained.subList(0, rollbackTargetOnly ? Math.min(1, retained.size()) : retained.size())) {
+            if (version.dir != null) dirs.add(version.dir);
+        }
+        return dirs;
+    }
+
+    /**
+     * Move www / www_previous of the single-directory layout into versions/.
+     */
+    private void migrateLegacyLayout() {
+        if (state.getString(PREF_CURRENT_VERSION_DIR, null) != null) return;
+
+        File legacyWww = new File(wwwPath);
+        if (!legacyWww.exists()) return;
 
-            // Add failed version to ignore list
-            if (currentVersion != null) {
-                addVersionToIgnoreList(currentVersion);
-                removeVersionFromHistory(currentVersion);
+        try {
+            HotUpdatesState.Editor editor = state.edit();
+
+            String previousVersion = state.getString(PREF_PREVIOUS_VERSION, null);
+            File legacyPrevious = new File(previousVersionPath);
+            if (previousVersion != null && legacyPrevious.exists()) {
+                String previousDir = moveToVersionsDir(legacyPrevious, previousVersion);
+                editor.putString(PREF_PREVIOUS_VERSION_DIR, previousDir);
+                // Reserve name before allocating the current directory
+                editor.commit();
+                editor = state.edit();
             }
 
-            return true;
+            String currentVersion = state.getString(PREF_INSTALLED_VERSION, appBundleVersion);
+            editor.putString(PREF_CURRENT_VERSION_DIR, moveToVersionsDir(legacyWww, currentVersion));
+            editor.commit();
 
-        } catch (Exception e) {
-            Log.e(TAG, "Rollback failed: " + e.getMessage());
-            return false;
+            Log.d(TAG, "Migrated www to versioned layout");
+        } catch (IOException e) {
+            Log.e(TAG, "Failed to migrate www layout: " + e.getMessage());
+        }
+    }
+
+    /**
+     * Overlay www made for another app build (the app was updated from the store): files it
+     * lacks would come from the new assets. A marker without build (older plugin) is stale too.
+     */
+    private boolean isStaleOverlay(File versionWww) {
+        File marker = new File(versionWww, OVERLAY_MARKER_FILE);
+        return marker.exists() && !appBundleBuild.equals(readTextFile(marker));
+    }
+
+    /**
+     * Drop overlay versions made for a previous app build. A stale current version falls back
+     * to the bundled assets, stale rollback targets and a stale staged update are forgotten;
+     * their directories are deleted by the prune.
+     */
+    private void dropStaleOverlays() {
+        HotUpdatesState.Snapshot snapshot = state.snapshot();
+        String currentDir = snapshot.getString(PREF_CURRENT_VERSION_DIR, null);
+        boolean currentStale = currentDir != null && isStaleOverlay(new File(getVersionDir(currentDir), DIR_WWW));
+
+        List<RetainedVersion> retained = loadRetainedVersions(snapshot);
+        // Rolling back to the assets is pointless once they are current
+        boolean retainedStale = retained.removeIf(version -> version.dir == null
+                ? currentStale : isStaleOverlay(new File(getVersionDir(version.dir), DIR_WWW)));
+
+        File stagedDir = new File(filesDir, DIR_TEMP_DOWNLOADED);
+        boolean stagedStale = isStaleOverlay(new File(stagedDir, DIR_WWW));
+
+        if (!currentStale && !retainedStale && !stagedStale) return;
+        Log.d(TAG, "App build changed to " + appBundleBuild + ": dropping overlay versions made for the previous build"
+                + (currentStale ? ", serving bundled assets" : ""));
+
+        HotUpdatesState.Editor editor = state.edit();
+        if (currentStale) {
+            editor.remove(PREF_INSTALLED_VERSION)
+                .remove(PREF_CURRENT_VERSION_DIR)
+                .remove(PREF_CANARY_VERSION);
+        }
+        saveRetainedVersions(editor, retained);
+        if (stagedStale) {
+            isUpdateReadyToInstall = false;
+            pendingUpdateVersion = null;
+            editor.putBoolean(PREF_PENDING_UPDATE_READY, false)
+                .putBoolean(PREF_HAS_PENDING, false)
+                .remove(PREF_PENDING_VERSION)
+                .remove(PREF_PENDING_WARMUP);
         }
+        editor.commit();
+
+        executor.execute(() -> {
+            if (stagedStale) deleteRecursive(stagedDir);
+            pruneVersions();
+        });
     }
 
     // ============================================================
@@ -652,18 +1796,22 @@ public class HotUpdates extends CordovaPlugin {
     // ============================================================
 
     private void loadIgnoreList() {
-        Set<String> saved = getPrefs().getStringSet(PREF_IGNORE_LIST, null);
-        ignoreList = saved != null ? new HashSet<>(saved) : new HashSet<>();
+        ignoreList = state.getStringSet(PREF_IGNORE_LIST, Collections.emptySet());
     }
 
-    private void saveIgnoreList() {
-        getPrefs().edit().putStringSet(PREF_IGNORE_LIST, ignoreList).apply();
+    /**
+     * Add ignore list to the editor of the transition that changed it.
+     */
+    private void saveIgnoreList(HotUpdatesState.Editor editor) {
+        editor.putStringSet(PREF_IGNORE_LIST, ignoreList);
     }
 
-    private void addVersionToIgnoreList(String version) {
+    private void addVersionToIgnoreList(HotUpdatesState.Editor editor, String version) {
         if (version != null && !ignoreList.contains(version)) {
-            ignoreList.add(version);
-            saveIgnoreList();
+            Set<String> updated = new HashSet<>(ignoreList);
+            updated.add(version);
+            ignoreList = Collections.unmodifiableSet(updated);
+            saveIgnoreList(editor);
             Log.d(TAG, "Added version " + version + " to ignore list");
         }
     }
@@ -687,48 +1835,58 @@ public class HotUpdates extends CordovaPlugin {
     // ============================================================
 
     private void loadVersionHistory() {
-        String saved = getPrefs().getString(PREF_VERSION_HISTORY, null);
-        versionHistory = new ArrayList<>();
+        String saved = state.getString(PREF_VERSION_HISTORY, null);
+        List<String> loaded = new ArrayList<>();
 
         if (saved != null && !saved.isEmpty()) {
             try {
                 JSONArray arr = new JSONArray(saved);
                 for (int i = 0; i < arr.length(); i++) {
-                    versionHistory.add(arr.getString(i));
+                    loaded.add(arr.getString(i));
                 }
             } catch (JSONException e) {
                 Log.e(TAG, "Failed to parse version history");
             }
+            versionHistory = Collections.unmodifiableList(loaded);
         } else {
             // Initialize with app bundle version on first launch
             if (appBundleVersion != null) {
-                versionHistory.add(appBundleVersion);
-                saveVersionHistory();
+                versionHistory = Collections.singletonList(appBundleVersion);
+                HotUpdatesState.Editor editor = state.edit();
+                saveVersionHistory(editor);
+                editor.apply();
                 Log.d(TAG, "Initial version history created with app version: " + appBundleVersion);
             }
         }
     }
 
-    private void saveVersionHistory() {
+    /**
+     * Add version history to the editor of the transition that changed it.
+     */
+    private void saveVersionHistory(HotUpdatesState.Editor editor) {
         JSONArray arr = new JSONArray();
         for (String v : versionHistory) {
             arr.put(v);
         }
-        getPrefs().edit().putString(PREF_VERSION_HISTORY, arr.toString()).apply();
+        editor.putString(PREF_VERSION_HISTORY, arr.toString());
     }
 
-    private void addVersionToHistory(String version) {
+    private void addVersionToHistory(HotUpdatesState.Editor editor, String version) {
         if (version != null && !versionHistory.contains(version)) {
-            versionHistory.add(version);
-            saveVersionHistory();
+            List<String> updated = new ArrayList<>(versionHistory);
+            updated.add(version);
+            versionHistory = Collections.unmodifiableList(updated);
+            saveVersionHistory(editor);
             Log.d(TAG, "Added version " + version + " to version history");
         }
     }
 
-    private void removeVersionFromHistory(String version) {
+    private void removeVersionFromHistory(HotUpdatesState.Editor editor, String version) {
         if (version != null && versionHistory.contains(version)) {
-            versionHistory.remove(version);
-            saveVersionHistory();
+            List<String> updated = new ArrayList<>(versionHistory);
+            updated.remove(version);
+            versionHistory = Collections.unmodifiableList(updated);
+            saveVersionHistory(editor);
             Log.d(TAG, "Removed version " + version + " from version history");
         }
     }
@@ -754,20 +1912,28 @@ public class HotUpdates extends CordovaPlugin {
     private void getVersionInfo(CallbackContext callbackContext) {
         try {
             JSONObject info = new JSONObject();
-            SharedPreferences prefs = getPrefs();
+            // One snapshot: all values come from the same state transition
+            HotUpdatesState.Snapshot snapshot = state.snapshot();
 
             info.put("appBundleVersion", appBundleVersion);
 
-            String installedVersion = prefs.getString(PREF_INSTALLED_VERSION, null);
-            String previousVersion = prefs.getString(PREF_PREVIOUS_VERSION, null);
-            String canaryVersion = prefs.getString(PREF_CANARY_VERSION, null);
-            String pendingVersion = prefs.getString(PREF_PENDING_VERSION, null);
+            String installedVersion = snapshot.getString(PREF_INSTALLED_VERSION, null);
+            String previousVersion = snapshot.getString(PREF_PREVIOUS_VERSION, null);
+            String canaryVersion = snapshot.getString(PREF_CANARY_VERSION, null);
+            String pendingVersion = snapshot.getString(PREF_PENDING_VERSION, null);
 
             info.put("installedVersion", installedVersion != null ? installedVersion : JSONObject.NULL);
             info.put("previousVersion", previousVersion != null ? previousVersion : JSONObject.NULL);
             info.put("canaryVersion", canaryVersion != null ? canaryVersion : JSONObject.NULL);
             info.put("pendingVersion", pendingVersion != null ? pendingVersion : JSONObject.NULL);
-            info.put("hasPendingUpdate", prefs.getBoolean(PREF_HAS_PENDING, false));
+            info.put("hasPendingUpdate", snapshot.getBoolean(PREF_HAS_PENDING, false));
+            info.put("canaryTimeoutMs", getCanaryTimeoutMs(snapshot));
+
+            JSONArray retainedArr = new JSONArray();
+            for (RetainedVersion version : loadRetainedVersions(snapshot)) {
+                retainedArr.put(version.version);
+            }
+            info.put("retainedVersions", retainedArr);
 
             JSONArray ignoreArr = new JSONArray();
             for (String v : ignoreList) {
@@ -781,85 +1947,187 @@ public class HotUpdates extends CordovaPlugin {
         }
     }
 
+    // ============================================================
+    // getMetrics - Update pipeline timings
+    // ============================================================
+
+    /**
+     * Stage timings of the ring buffer (see HotUpdatesMetrics), oldest first.
+     * Optional {clear: true} drops the returned samples.
+     */
+    private void getMetrics(JSONArray args, CallbackContext callbackContext) {
+        JSONObject options = args.optJSONObject(0);
+        boolean clear = options != null && options.optBoolean("clear", false);
+        try {
+            callbackContext.success(HotUpdatesMetrics.get().toJSON(clear));
+        } catch (JSONException e) {
+            callbackContext.error("Failed to get metrics");
+        }
+    }
+
     // ============================================================
     // WWW Folder Initialization
     // ============================================================
 
     private boolean checkAndInstallPendingUpdate() {
-        boolean hasPending = getPrefs().getBoolean(PREF_HAS_PENDING, false);
-        String pendingVersion = getPrefs().getString(PREF_PENDING_VERSION, null);
+        HotUpdatesState.Snapshot snapshot = state.snapshot();
+        boolean hasPending = snapshot.getBoolean(PREF_HAS_PENDING, false);
+        String pendingVersion = snapshot.getString(PREF_PENDING_VERSION, null);
 
         if (!hasPending || pendingVersion == null) return false;
 
         Log.d(TAG, "Auto-installing pending update: " + pendingVersion);
 
-        backupCurrentVersion();
-
-        File pendingDir = new File(filesDir, DIR_PENDING_UPDATE);
-        File pendingWww = new File(pendingDir, DIR_WWW);
-        File wwwDir = new File(wwwPath);
+        // Same staged directory forceUpdate installs; pending_update is only left by older plugin versions
+        File stagedDir = new File(filesDir, DIR_TEMP_DOWNLOADED);
+        File legacyPendingDir = new File(filesDir, DIR_PENDING_UPDATE);
+        File pendingWww = new File(stagedDir, DIR_WWW);
+        if (!pendingWww.exists()) {
+            pendingWww = new File(legacyPendingDir, DIR_WWW);
+        }
 
         if (pendingWww.exists()) {
+            long installStart = HotUpdatesMetrics.now();
             try {
-                deleteRecursive(wwwDir);
-                copyDirectory(pendingWww, wwwDir);
+                String versionDir = moveToVersionsDir(pendingWww, pendingVersion);
 
-                SharedPreferences.Editor editor = getPrefs().edit();
-                editor.putString(PREF_INSTALLED_VERSION, pendingVersion);
+                HotUpdatesState.Editor editor = state.edit();
+                switchCurrentVersion(editor, pendingVersion, versionDir);
                 editor.putBoolean(PREF_HAS_PENDING, false);
+                editor.putBoolean(PREF_PENDING_UPDATE_READY, false);
                 editor.remove(PREF_PENDING_VERSION);
+                editor.remove(PREF_PENDING_WARMUP);
                 editor.remove(PREF_CANARY_VERSION);
-                editor.apply();
-
-                deleteRecursive(pendingDir);
-                addVersionToHistory(pendingVersion);
+                addVersionToHistory(editor, pendingVersion);
+                editor.commit();
+                HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_INSTALL, installStart);
+
+                // Staged update is consumed, forceUpdate has nothing left to install
+                isUpdateReadyToInstall = false;
+                pendingUpdateVersion = null;
+                executor.execute(() -> {
+                    deleteRecursive(stagedDir);
+                    deleteRecursive(legacyPendingDir);
+                    pruneVersions();
+                });
 
                 Log.d(TAG, "Update " + pendingVersion + " installed successfully");
                 return true;
 
             } catch (IOException e) {
                 Log.e(TAG, "Failed to install pending update: " + e.getMessage());
-                SharedPreferences.Editor editor = getPrefs().edit();
+                HotUpdatesState.Editor editor = state.edit();
                 editor.putBoolean(PREF_HAS_PENDING, false);
+                editor.putBoolean(PREF_PENDING_UPDATE_READY, false);
                 editor.remove(PREF_PENDING_VERSION);
+                editor.remove(PREF_PENDING_WARMUP);
                 editor.apply();
-                deleteRecursive(pendingDir);
+                isUpdateReadyToInstall = false;
+                deleteRecursive(stagedDir);
+                deleteRecursive(legacyPendingDir);
             }
         }
         return false;
     }
 
-    private void initializeWWWFolder() {
-        File wwwDir = new File(wwwPath);
-        if (wwwDir.exists()) return;
-
-        Log.d(TAG, "Initializing www folder from assets...");
+    // ============================================================
+    // Warm-up
+    // ============================================================
 
+    /**
+     * Read files of the manifest warm-up list once, so the first load after install
+     * finds them in the page cache instead of waiting for flash.
+     * Reads through the path index: pack items, .gz files and extracted files alike.
+     * The WebView has no API to fill its code cache ahead of a load; scripts are
+     * compiled (and cached) on first use.
+     *
+     * @param warmup JSON array of www paths (PREF_PENDING_WARMUP), null to skip
+     */
+    private void warmUp(String warmup) {
+        HotUpdatesPathIndex index = pathIndex;
+        if (warmup == null || index == null) return;
+
+        long startTime = HotUpdatesMetrics.now();
+        long total = 0;
+        int count = 0;
+        byte[] buffer = HotUpdatesBuffers.acquire();
         try {
-            Context context = cordova.getActivity().getApplicationContext();
-            copyAssetsFolder(context, "www", wwwPath);
-            Log.d(TAG, "Initialized www folder from bundle");
-        } catch (IOException e) {
-            Log.e(TAG, "Failed to copy www folder: " + e.getMessage());
+            JSONArray paths = new JSONArray(warmup);
+            for (int i = 0; i < paths.length() && total < WARMUP_MAX_BYTES; i++) {
+                String path = paths.getString(i);
+                HotUpdatesPathIndex.Entry entry = index.get(path);
+                if (entry == null) continue;
+
+                try (InputStream in = entry.open()) {
+                    int n;
+                    while ((n = in.read(buffer)) != -1 && total < WARMUP_MAX_BYTES) {
+                        total += n;
+                    }
+                    count++;
+                } catch (IOException e) {
+                    Log.w(TAG, "Warm-up skipped " + path + ": " + e.getMessage());
+                }
+            }
+        } catch (JSONException e) {
+            Log.w(TAG, "Invalid warm-up list: " + e.getMessage());
+            return;
+        } finally {
+            HotUpdatesBuffers.release(buffer);
         }
+
+        HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_WARMUP, startTime, total);
+        Log.d(TAG, "Warm-up: " + count + " files, " + total + " bytes");
     }
 
     // ============================================================
     // WebView Reload
     // ============================================================
 
+    /**
+     * Clear service workers and Cache Storage of the local origin once the served version
+     * directory differs from the one they were last cleared for. The PathHandler serves every
+     * version from the same https://localhost origin, so a service worker registered by an older
+     * version would keep answering from its caches. No API removes them natively without also
+     * dropping IndexedDB (WebStorage.deleteOrigin), so the page does it and reloads only if it
+     * found something. Runs on the UI thread (onPageFinished), in both cache invalidation modes.
+     *
+     * @param url URL of the page that has finished loading
+     */
+    private void clearStaleServiceWorkers(String url) {
+        String hostname = preferences.getString("hostname", "localhost");
+        if (!url.startsWith("https://" + hostname + "/")) return;
+
+        String servedDir = state.getString(PREF_CURRENT_VERSION_DIR, "");
+        if (servedDir.equals(state.getString(PREF_CACHE_VERSION_DIR, null))) return;
+        state.edit().putString(PREF_CACHE_VERSION_DIR, servedDir).apply();
+
+        Log.d(TAG, "Served version changed: clearing service workers and Cache Storage of " + hostname);
+        ((android.webkit.WebView) webView.getView()).evaluateJavascript(CLEAR_SERVICE_WORKERS_JS, null);
+    }
+
     private void reloadWebView() {
         cordova.getActivity().runOnUiThread(() -> {
             try {
                 android.webkit.WebView androidWebView = (android.webkit.WebView) webView.getView();
                 WebSettings webSettings = androidWebView.getSettings();
 
-                // Clear cache to force fresh load from PathHandler
-                androidWebView.clearCache(true);
+                // History of the old version must not be navigable
                 androidWebView.clearHistory();
-                webView.clearCache(true);
                 webView.clearHistory();
-                webSettings.setCacheMode(WebSettings.LOAD_NO_CACHE);
+
+                if (CACHE_INVALIDATION_FULL.equals(preferences.getString(CONFIG_CACHE_INVALIDATION, ""))) {
+                    // Wipe the cache of every origin and bypass it from now on
+                    long clearStart = HotUpdatesMetrics.now();
+                    androidWebView.clearCache(true);
+                    webView.clearCache(true);
+                    webSettings.setCacheMode(WebSettings.LOAD_NO_CACHE);
+                    reloadStartTime = HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_CACHE_CLEAR, clearStart);
+                } else {
+                    // Local files are intercepted by PathHandler (no-cache) and never come
+                    // from the HTTP cache, so cached remote API / CDN responses are kept
+                    webSettings.setCacheMode(WebSettings.LOAD_DEFAULT);
+                    reloadStartTime = HotUpdatesMetrics.now();
+                }
 
                 // Always use https://localhost/ - PathHandler serves from files/www
                 String hostname = preferences.getString("hostname", "localhost");
@@ -0,0 +1,83 @@
+/**
+ * HotUpdatesBuffers.java
+ * Shared I/O buffers for Hot Updates Plugin
+ *
+ * Download, extraction, hashing and copy loops borrow their byte[] from one
+ * small pool instead of allocating per file or entry, so bundles with tens of
+ * thousands of entries do not churn the GC on low-RAM devices. The size comes
+ * from the HotUpdatesIOBufferSize preference; the pool keeps at most one
+ * buffer per core (plus the download threads), further borrowers get a fresh
+ * buffer that is dropped on release.
+ *
+ * File-to-file copies need no buffer: see HotUpdatesHelpers.copyFile.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import android.util.Log;
+
+import java.util.ArrayDeque;
+
+import static com.getmeback.hotupdates.HotUpdatesConstants.*;
+
+/**
+ * Thread-safe: extraction workers, segment downloads and the plugin executor
+ * borrow concurrently.
+ */
+public final class HotUpdatesBuffers {
+
+    private static final int MAX_POOLED = Runtime.getRuntime().availableProcessors() + 2;
+
+    // Guarded by POOL
+    private static final ArrayDeque<byte[]> POOL = new ArrayDeque<>();
+    private static int bufferSize = DEFAULT_IO_BUFFER_KB * 1024;
+
+    private HotUpdatesBuffers() {
+        // Prevent instantiation
+    }
+
+    /**
+     * Set buffer size (config.xml HotUpdatesIOBufferSize). Pooled buffers of the old size are
+     * dropped, borrowed ones are not taken back.
+     *
+     * @param kilobytes Clamped to MIN_IO_BUFFER_KB..MAX_IO_BUFFER_KB
+     */
+    public static void configure(int kilobytes) {
+        int size = Math.max(MIN_IO_BUFFER_KB, Math.min(MAX_IO_BUFFER_KB, kilobytes)) * 1024;
+        synchronized (POOL) {
+            if (size == bufferSize) return;
+            bufferSize = size;
+            POOL.clear();
+        }
+        Log.d(TAG, "I/O buffer size: " + (size / 1024) + " KB");
+    }
+
+    /**
+     * Borrow a buffer; hand it back with {@link #release(byte[])} in a finally block.
+     */
+    public static byte[] acquire() {
+        int size;
+        synchronized (POOL) {
+            byte[] buffer = POOL.pollFirst();
+            if (buffer != null) return buffer;
+            size = bufferSize;
+        }
+        return new byte[size];
+    }
+
+    /**
+     * Return a borrowed buffer. Contents are not cleared.
+     *
+     * @param buffer Buffer from {@link #acquire()}, null is ignored
+     */
+    public static void release(byte[] buffer) {
+        if (buffer == null) return;
+        synchronized (POOL) {
+            if (buffer.length == bufferSize && POOL.size() < MAX_POOLED) {
+                POOL.addFirst(buffer);
+            }
+        }
+    }
+}
@@ -9,7 +9,7 @@ package com.getmeback.hotupdates;
 
 /**
  * Contains all constants used by the Hot Updates plugin.
- * Includes error codes, SharedPreferences keys, and directory names.
+ * Includes error codes, state keys, and directory names.
  */
 public final class HotUpdatesConstants {
 
@@ -24,12 +24,18 @@ public final class HotUpdatesConstants {
     // getUpdate() errors
     public static final String ERROR_UPDATE_DATA_REQUIRED = "UPDATE_DATA_REQUIRED";
     public static final String ERROR_URL_REQUIRED = "URL_REQUIRED";
-    public static final String ERROR_DOWNLOAD_IN_PROGRESS = "DOWNLOAD_IN_PROGRESS";
+    public static final String ERROR_CANCELLED = "CANCELLED";
     public static final String ERROR_DOWNLOAD_FAILED = "DOWNLOAD_FAILED";
     public static final String ERROR_HTTP_ERROR = "HTTP_ERROR";
     public static final String ERROR_TEMP_DIR_ERROR = "TEMP_DIR_ERROR";
     public static final String ERROR_EXTRACTION_FAILED = "EXTRACTION_FAILED";
     public static final String ERROR_WWW_NOT_FOUND = "WWW_NOT_FOUND";
+    public static final String ERROR_MANIFEST_INVALID = "MANIFEST_INVALID";
+    public static final String ERROR_HASH_MISMATCH = "HASH_MISMATCH";
+    public static final String ERROR_SIGNATURE_INVALID = "SIGNATURE_INVALID";
+    // ZIP update without verifyManifestUrl while CONFIG_PUBLIC_KEY is set
+    public static final String MANIFEST_REQUIRED_MESSAGE = "verifyManifestUrl is required when HotUpdatesPublicKey is set";
+    public static final String ERROR_INSUFFICIENT_STORAGE = "INSUFFICIENT_STORAGE";
 
     // forceUpdate() errors
     public static final String ERROR_NO_UPDATE_READY = "NO_UPDATE_READY";
@@ -39,21 +45,47 @@ public final class HotUpdatesConstants {
     // canary() errors
     public static final String ERROR_VERSION_REQUIRED = "VERSION_REQUIRED";
 
+    // rollbackTo() errors
+    public static final String ERROR_VERSION_NOT_RETAINED = "VERSION_NOT_RETAINED";
+
     // ============================================================
-    // SharedPreferences Keys
+    // State Keys (HotUpdatesState)
     // ============================================================
 
+    // State file in filesDir, one atomic write per state transition
+    public static final String STATE_FILE = "hot_updates_state.json";
+    // SharedPreferences of older plugin versions, migrated into STATE_FILE
     public static final String PREFS_NAME = "HotUpdatesPrefs";
 
     public static final String PREF_INSTALLED_VERSION = "hot_updates_installed_version";
     public static final String PREF_PENDING_VERSION = "hot_updates_pending_version";
+    // Warm-up list of the staged update (JSON array of www paths)
+    public static final String PREF_PENDING_WARMUP = "hot_updates_pending_warmup";
     public static final String PREF_HAS_PENDING = "hot_updates_has_pending";
     public static final String PREF_PREVIOUS_VERSION = "hot_updates_previous_version";
     public static final String PREF_IGNORE_LIST = "hot_updates_ignore_list";
     public static final String PREF_VERSION_HISTORY = "hot_updates_version_history";
     public static final String PREF_CANARY_VERSION = "hot_updates_canary_version";
+    // Measured canary confirmation times, oldest first: [{version, ms}]
+    public static final String PREF_CANARY_LATENCIES = "hot_updates_canary_latencies";
     public static final String PREF_DOWNLOAD_IN_PROGRESS = "hot_updates_download_in_progress";
     public static final String PREF_PENDING_UPDATE_READY = "hot_updates_pending_ready";
+    public static final String PREF_CURRENT_VERSION_DIR = "hot_updates_current_dir";
+    public static final String PREF_PREVIOUS_VERSION_DIR = "hot_updates_previous_dir";
+    // Rollback targets older than the previous version, newest first: [{version, dir}]
+    public static final String PREF_RETAINED_VERSIONS = "hot_updates_retained_versions";
+    // Served version directory the local service workers / Cache Storage were last cleared for
+    public static final String PREF_CACHE_VERSION_DIR = "hot_updates_cache_dir";
+    public static final String PREF_RESUME_URL = "hot_updates_resume_url";
+    public static final String PREF_RESUME_VERSION = "hot_updates_resume_version";
+    public static final String PREF_RESUME_VALIDATOR = "hot_updates_resume_validator";
+    public static final String PREF_RESUME_OFFSET = "hot_updates_resume_offset";
+
+    // Last check API response with its validators: {url, etag?, lastModified?, body}
+    public static final String PREF_CHECK_CACHE = "hot_updates_check_cache";
+
+    // Background download (version of the queued WorkManager request)
+    public static final String PREF_BACKGROUND_VERSION = "hot_updates_background_version";
 
     // ============================================================
     // Directory Names
@@ -62,33 +94,213 @@ public final class HotUpdatesConstants {
     public static final String DIR_WWW = "www";
     public static final String DIR_WWW_PREVIOUS = "www_previous";
     public static final String DIR_WWW_BACKUP = "www_backup";
+    // Second staging copy of older plugin versions, only promoted on launch
     public static final String DIR_PENDING_UPDATE = "pending_update";
     public static final String DIR_TEMP_DOWNLOADED = "temp_downloaded_update";
     public static final String DIR_TEMP_NEW_DOWNLOAD = "temp_new_download";
+    public static final String DIR_TEMP_PATCH = "temp_patch";
+    public static final String DIR_VERSIONS = "versions";
+    public static final String DIR_STORE = "store";
+    public static final String DIR_STORE_OBJECTS = "objects";
+
+    /** Marker in www of an overlay version (only files differing from the assets), holds the app build it was made for */
+    public static final String OVERLAY_MARKER_FILE = ".hotupdates-overlay";
+
+    // ============================================================
+    // Version Retention
+    // ============================================================
+
+    /** Installed versions kept on disk by default, the current one included */
+    public static final int DEFAULT_KEEP_VERSIONS = 2;
+
+    /** Below this free space only current and previous version are kept (50 MB) */
+    public static final long LOW_STORAGE_BYTES = 50 * 1024 * 1024;
+
+    /** Free space left over after an update is written, on top of its expected size (10 MB) */
+    public static final long STORAGE_MARGIN_BYTES = 10 * 1024 * 1024;
 
     // ============================================================
     // Timing Constants
     // ============================================================
 
-    /** Canary timeout in milliseconds (20 seconds) */
+    /** Canary timeout until enough load times are measured (20 seconds) */
     public static final long CANARY_TIMEOUT_MS = 20000;
 
+    /** Bounds of the adaptive canary timeout (10 seconds - 60 seconds) */
+    public static final long CANARY_MIN_TIMEOUT_MS = 10000;
+    public static final long CANARY_MAX_TIMEOUT_MS = 60000;
+
+    /** Adaptive timeout: this many times the 90th percentile of measured load times */
+    public static final int CANARY_TIMEOUT_FACTOR = 3;
+    public static final int CANARY_LATENCY_PERCENTILE = 90;
+
+    /** Load times kept for the percentile, and measured before it replaces CANARY_TIMEOUT_MS */
+    public static final int CANARY_LATENCY_SAMPLES = 20;
+    public static final int CANARY_MIN_SAMPLES = 3;
+
+    /** extendCanary() does not push the deadline beyond this time after the load (5 minutes) */
+    public static final long CANARY_MAX_EXTENDED_MS = 300000;
+
+    /** Longest time a WebView request waits for async startup before falling back to assets (10 seconds) */
+    public static final long STARTUP_WAIT_TIMEOUT_MS = 10000;
+
     /** HTTP connection timeout in milliseconds (30 seconds) */
     public static final int HTTP_CONNECT_TIMEOUT_MS = 30000;
 
     /** HTTP read timeout in milliseconds (60 seconds) */
     public static final int HTTP_READ_TIMEOUT_MS = 60000;
 
+    /** HTTP 416, not defined in HttpURLConnection */
+    public static final int HTTP_RANGE_NOT_SATISFIABLE = 416;
+
+    /** Resume offset is persisted at most once per this many downloaded bytes (1 MB) */
+    public static final long RESUME_SAVE_INTERVAL_BYTES = 1024 * 1024;
+
+    /** Bytes read ahead at most by post-install warm-up (32 MB) */
+    public static final long WARMUP_MAX_BYTES = 32 * 1024 * 1024;
+
+    /** Upper bound for getUpdate({connections}) */
+    public static final int MAX_DOWNLOAD_CONNECTIONS = 8;
+
+    /** Archives below this size are downloaded over one connection (4 MB) */
+    public static final long SEGMENTED_MIN_SIZE_BYTES = 4 * 1024 * 1024;
+
+    // ============================================================
+    // Progress Events (getUpdate({progress: true}))
+    // ============================================================
+
+    /** At most one progress event per this interval; phase changes are sent at once */
+    public static final long PROGRESS_INTERVAL_MS = 250;
+
+    public static final String PROGRESS_PHASE_DOWNLOADING = "downloading";
+    public static final String PROGRESS_PHASE_VERIFYING = "verifying";
+    public static final String PROGRESS_PHASE_EXTRACTING = "extracting";
+    public static final String PROGRESS_PHASE_STAGING = "staging";
+
+    // ============================================================
+    // Metrics (getMetrics)
+    // ============================================================
+
+    /** Stage timings kept in memory; the oldest are overwritten */
+    public static final int METRICS_CAPACITY = 256;
+
+    // ============================================================
+    // Background Download (WorkManager)
+    // ============================================================
+
+    /** Unique work name - a new background download replaces the queued one */
+    public static final String BACKGROUND_WORK_NAME = "hot_updates_background_download";
+
+    /** Initial retry delay, doubled after every network failure */
+    public static final long BACKGROUND_BACKOFF_SECONDS = 30;
+
+    /** Network failures retried before the work fails with DOWNLOAD_FAILED */
+    public static final int BACKGROUND_MAX_ATTEMPTS = 5;
+
+    public static final String WORK_KEY_URL = "url";
+    public static final String WORK_KEY_VERSION = "version";
+    public static final String WORK_KEY_CONNECTIONS = "connections";
+    public static final String WORK_KEY_PACKED = "packed";
+    public static final String WORK_KEY_VERIFY_MANIFEST_URL = "verifyManifestUrl";
+    public static final String WORK_KEY_ERROR_CODE = "errorCode";
+    public static final String WORK_KEY_ERROR_MESSAGE = "errorMessage";
+    // Progress data of running work (WorkInfo#getProgress)
+    public static final String WORK_KEY_PROGRESS_PHASE = "progressPhase";
+    public static final String WORK_KEY_PROGRESS_BYTES = "progressBytes";
+    public static final String WORK_KEY_PROGRESS_TOTAL = "progressTotal";
+    public static final String WORK_KEY_PROGRESS_RATE = "progressRate";
+    public static final String WORK_KEY_PROGRESS_ETA = "progressEta";
+
+    // ============================================================
+    // Update Check (checkForUpdate, background prefetch)
+    // ============================================================
+
+    // Why a version of the check response is not an update
+    public static final String CHECK_REASON_UP_TO_DATE = "upToDate";
+    public static final String CHECK_REASON_IGNORED = "ignored";
+    public static final String CHECK_REASON_INCOMPATIBLE = "incompatible";
+
+    // ============================================================
+    // Background Prefetch (WorkManager periodic work)
+    // ============================================================
+
+    /** Unique periodic work name, rescheduled on every launch */
+    public static final String PREFETCH_WORK_NAME = "hot_updates_prefetch";
+
+    /** Check interval if HotUpdatesPrefetchInterval is not set (hours) */
+    public static final int DEFAULT_PREFETCH_INTERVAL_HOURS = 24;
+
+    // ============================================================
+    // I/O Buffers (HotUpdatesBuffers)
+    // ============================================================
+
+    /** Buffer size of download, extraction and hashing loops, in KB (HotUpdatesIOBufferSize) */
+    public static final int DEFAULT_IO_BUFFER_KB = 64;
+    public static final int MIN_IO_BUFFER_KB = 8;
+    public static final int MAX_IO_BUFFER_KB = 1024;
+
     // ============================================================
     // File Constants
     // ============================================================
 
     public static final String INDEX_HTML = "index.html";
     public static final String ZIP_EXTENSION = ".zip";
+    public static final String PATCH_TEMP_ZIP = "patch_temp.zip";
+    public static final String SEGMENTED_TEMP_ZIP = "update_segmented.zip";
+    public static final String PACKED_TEMP_ZIP = "update_packed.zip";
+
+    /** Packed version: www directory holds only this archive, served without extraction */
+    public static final String PACKED_BUNDLE_FILE = "bundle.pack";
+
+    /** Detached manifest signature: "<manifestUrl>.sig" */
+    public static final String SIGNATURE_SUFFIX = ".sig";
 
     // ZIP magic bytes (PK\x03\x04)
     public static final byte[] ZIP_MAGIC = {0x50, 0x4B, 0x03, 0x04};
 
+    // ============================================================
+    // config.xml Preferences
+    // ============================================================
+
+    /** Base64 DER (X.509 SubjectPublicKeyInfo) ECDSA P-256 key used to verify manifest signatures */
+    public static final String CONFIG_PUBLIC_KEY = "HotUpdatesPublicKey";
+
+    /** Run startup file work (pending install, first-launch copy) off the main thread */
+    public static final String CONFIG_ASYNC_STARTUP = "HotUpdatesAsyncStartup";
+
+    /** Check API of checkForUpdate without url and of the background prefetch (see README "Update Server API") */
+    public static final String CONFIG_PREFETCH_URL = "HotUpdatesPrefetchUrl";
+
+    /** Hours between background prefetch checks (minimum 1) */
+    public static final String CONFIG_PREFETCH_INTERVAL = "HotUpdatesPrefetchInterval";
+
+    /** Installed versions kept for rollbackTo, current included (minimum 2) */
+    public static final String CONFIG_KEEP_VERSIONS = "HotUpdatesKeepVersions";
+
+    /**
+     * WebView cache handling on reload: "selective" (default) keeps the HTTP cache,
+     * "full" clears it for every origin and disables it
+     */
+    public static final String CONFIG_CACHE_INVALIDATION = "HotUpdatesCacheInvalidation";
+    public static final String CACHE_INVALIDATION_FULL = "full";
+
+    /**
+     * Unregisters service workers and deletes Cache Storage of the page's origin, then reloads
+     * the page if anything was removed. IndexedDB and localStorage are kept.
+     */
+    public static final String CLEAR_SERVICE_WORKERS_JS = "(function() {"
+            + "var jobs = [];"
+            + "if (navigator.serviceWorker) jobs.push(navigator.serviceWorker.getRegistrations().then(function(rs) {"
+            + "  return Promise.all(rs.map(function(r) { return r.unregister(); })); }));"
+            + "if (window.caches) jobs.push(caches.keys().then(function(ks) {"
+            + "  return Promise.all(ks.map(function(k) { return caches.delete(k); })); }));"
+            + "Promise.all(jobs).then(function(results) {"
+            + "  if (results.some(function(r) { return r.length > 0; })) location.reload(); });"
+            + "})();";
+
+    /** I/O buffer size in KB (8-1024, default 64); larger means fewer syscalls, more memory per thread */
+    public static final String CONFIG_IO_BUFFER_SIZE = "HotUpdatesIOBufferSize";
+
     // ============================================================
     // Log Tag
     // ============================================================
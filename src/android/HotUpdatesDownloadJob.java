@@ -0,0 +1,96 @@
+/**
+ * HotUpdatesDownloadJob.java
+ * One in-flight update download for Hot Updates Plugin
+ *
+ * All getUpdate calls for the same version share one job and are answered
+ * together when its transfer finishes. A job is cancelled by cancelUpdate or
+ * by a getUpdate for another version; its callbacks are answered right away
+ * and a late result of the aborted transfer is dropped.
+ *
+ * Callbacks registered with progress also receive progress events (kept
+ * callbacks) until the job ends.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import org.apache.cordova.CallbackContext;
+
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * Thread-safe: callbacks attach on the Cordova thread while the transfer
+ * finishes on the plugin executor (or WorkManager).
+ */
+public class HotUpdatesDownloadJob {
+
+    public final String version;
+
+    private final List<CallbackContext> callbacks = new ArrayList<>();
+    private final List<CallbackContext> progressCallbacks = new ArrayList<>();
+    private boolean cancelled = false;
+    private boolean finished = false;
+
+    /**
+     * @param callbackContext Callback of the getUpdate call that started the job,
+     *                        null for a background download re-attached after relaunch
+     * @param progress Send progress events to this callback as well
+     */
+    public HotUpdatesDownloadJob(String version, CallbackContext callbackContext, boolean progress) {
+        this.version = version;
+        if (callbackContext != null) {
+            callbacks.add(callbackContext);
+            if (progress) progressCallbacks.add(callbackContext);
+        }
+    }
+
+    /**
+     * Wait for the result of this job.
+     *
+     * @param progress Send progress events to this callback as well
+     * @return false if the job already finished or was cancelled
+     */
+    public synchronized boolean attach(CallbackContext callbackContext, boolean progress) {
+        if (cancelled || finished) return false;
+        callbacks.add(callbackContext);
+        if (progress) progressCallbacks.add(callbackContext);
+        return true;
+    }
+
+    /**
+     * @return Callbacks that asked for progress events, empty once the job ended
+     */
+    public synchronized List<CallbackContext> getProgressCallbacks() {
+        if (cancelled || finished || progressCallbacks.isEmpty()) return new ArrayList<>();
+        return new ArrayList<>(progressCallbacks);
+    }
+
+    /**
+     * Mark job cancelled.
+     *
+     * @return Callbacks to report the cancellation to, empty if the job already finished
+     */
+    public synchronized List<CallbackContext> cancel() {
+        if (cancelled || finished) return new ArrayList<>();
+        cancelled = true;
+        return new ArrayList<>(callbacks);
+    }
+
+    /**
+     * Mark transfer finished.
+     *
+     * @return Callbacks to report the result to, null if the job was cancelled or
+     *         already finished (the result is stale, state belongs to the job that replaced it)
+     */
+    public synchronized List<CallbackContext> finish() {
+        if (cancelled || finished) return null;
+        finished = true;
+        return new ArrayList<>(callbacks);
+    }
+
+    public synchronized boolean isCancelled() {
+        return cancelled;
+    }
+}
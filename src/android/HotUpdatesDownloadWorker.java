@@ -0,0 +1,134 @@
+/**
+ * HotUpdatesDownloadWorker.java
+ * Background ZIP download for Hot Updates Plugin
+ *
+ * Runs HotUpdatesDownloader under WorkManager, so a download keeps going
+ * (or is retried) after the app is backgrounded or killed.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import android.content.Context;
+import android.util.Log;
+
+import androidx.annotation.NonNull;
+import androidx.work.BackoffPolicy;
+import androidx.work.Constraints;
+import androidx.work.Data;
+import androidx.work.NetworkType;
+import androidx.work.OneTimeWorkRequest;
+import androidx.work.Worker;
+import androidx.work.WorkerParameters;
+
+import org.apache.cordova.ConfigXmlParser;
+import org.apache.cordova.CordovaPreferences;
+
+import java.io.IOException;
+import java.util.concurrent.TimeUnit;
+
+import static com.getmeback.hotupdates.HotUpdatesConstants.*;
+
+/**
+ * Input data: WORK_KEY_URL, WORK_KEY_VERSION, WORK_KEY_CONNECTIONS, WORK_KEY_PACKED,
+ * WORK_KEY_VERIFY_MANIFEST_URL (the signing key is read from config.xml, not passed in).
+ * Output data on failure: WORK_KEY_ERROR_CODE, WORK_KEY_ERROR_MESSAGE.
+ * Progress data: WORK_KEY_PROGRESS_*.
+ */
+public class HotUpdatesDownloadWorker extends Worker {
+
+    private final HotUpdatesDownloader downloader;
+
+    public HotUpdatesDownloadWorker(@NonNull Context context, @NonNull WorkerParameters params) {
+        super(context, params);
+        downloader = new HotUpdatesDownloader(context, new HotUpdatesStore(context.getFilesDir()));
+        // Published as work progress, the plugin forwards it while it observes the work
+        downloader.setProgress(new HotUpdatesProgress((phase, bytes, totalBytes, bytesPerSecond, etaSeconds) ->
+            setProgressAsync(new Data.Builder()
+                .putString(WORK_KEY_PROGRESS_PHASE, phase)
+                .putLong(WORK_KEY_PROGRESS_BYTES, bytes)
+                .putLong(WORK_KEY_PROGRESS_TOTAL, totalBytes)
+                .putLong(WORK_KEY_PROGRESS_RATE, bytesPerSecond)
+                .putLong(WORK_KEY_PROGRESS_ETA, etaSeconds)
+                .build())));
+    }
+
+    /**
+     * Work request for a background download, enqueued as unique work BACKGROUND_WORK_NAME.
+     *
+     * @param verifyManifestURL Signed manifest every file is checked against, null to skip
+     * @param wifiOnly Run only on an unmetered network
+     * @param requiresCharging Run only while charging
+     */
+    public static OneTimeWorkRequest buildRequest(String downloadURL, String version, int connections,
+                                                  boolean packed, String verifyManifestURL,
+                                                  boolean wifiOnly, boolean requiresCharging) {
+        Constraints constraints = new Constraints.Builder()
+            .setRequiredNetworkType(wifiOnly ? NetworkType.UNMETERED : NetworkType.CONNECTED)
+            .setRequiresCharging(requiresCharging)
+            .build();
+
+        Data input = new Data.Builder()
+            .putString(WORK_KEY_URL, downloadURL)
+            .putString(WORK_KEY_VERSION, version)
+            .putInt(WORK_KEY_CONNECTIONS, connections)
+            .putBoolean(WORK_KEY_PACKED, packed)
+            .putString(WORK_KEY_VERIFY_MANIFEST_URL, verifyManifestURL)
+            .build();
+
+        return new OneTimeWorkRequest.Builder(HotUpdatesDownloadWorker.class)
+            .setConstraints(constraints)
+            .setInputData(input)
+            .setBackoffCriteria(BackoffPolicy.EXPONENTIAL, BACKGROUND_BACKOFF_SECONDS, TimeUnit.SECONDS)
+            .build();
+    }
+
+    @NonNull
+    @Override
+    public Result doWork() {
+        String downloadURL = getInputData().getString(WORK_KEY_URL);
+        String version = getInputData().getString(WORK_KEY_VERSION);
+        int connections = getInputData().getInt(WORK_KEY_CONNECTIONS, 1);
+        boolean packed = getInputData().getBoolean(WORK_KEY_PACKED, false);
+        String verifyManifestURL = getInputData().getString(WORK_KEY_VERIFY_MANIFEST_URL);
+
+        Log.d(TAG, "Background download (attempt " + (getRunAttemptCount() + 1) + ") from: " + downloadURL);
+
+        // The worker may run without the plugin, so config.xml is parsed here
+        ConfigXmlParser parser = new ConfigXmlParser();
+        parser.parse(getApplicationContext());
+        CordovaPreferences preferences = parser.getPreferences();
+        HotUpdatesBuffers.configure(preferences.getInteger(CONFIG_IO_BUFFER_SIZE, DEFAULT_IO_BUFFER_KB));
+
+        try {
+            // Queued before a key was configured, or by the prefetch: checked here as well
+            HotUpdatesVerifier verifier = HotUpdatesVerifier.forArchive(verifyManifestURL,
+                    preferences.getString(CONFIG_PUBLIC_KEY, null));
+            downloader.downloadZip(downloadURL, version, connections, packed, verifier);
+            return Result.success();
+
+        } catch (IOException e) {
+            String errorCode = HotUpdatesDownloader.getErrorCode(e);
+            Log.e(TAG, "Background download failed: " + e.getMessage());
+
+            // Network failures keep resume state - next attempt continues the transfer
+            if (errorCode.equals(ERROR_DOWNLOAD_FAILED) && getRunAttemptCount() + 1 < BACKGROUND_MAX_ATTEMPTS) {
+                return Result.retry();
+            }
+
+            Data output = new Data.Builder()
+                .putString(WORK_KEY_ERROR_CODE, errorCode)
+                .putString(WORK_KEY_ERROR_MESSAGE, HotUpdatesDownloader.getErrorMessage(e))
+                .build();
+            return Result.failure(output);
+        }
+    }
+
+    @Override
+    public void onStopped() {
+        // Constraints lost or work replaced - stop the transfer, WorkManager reschedules it
+        downloader.cancel();
+        super.onStopped();
+    }
+}
@@ -0,0 +1,571 @@
+/**
+ * HotUpdatesDownloader.java
+ * ZIP update download and staging for Hot Updates Plugin
+ *
+ * Shared by the plugin (foreground downloads) and HotUpdatesDownloadWorker
+ * (background downloads), so it depends only on a Context and keeps all
+ * state in HotUpdatesState and the files directory.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import android.content.Context;
+import android.util.Log;
+
+import org.json.JSONArray;
+
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.net.HttpURLConnection;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.zip.ZipException;
+
+import static com.getmeback.hotupdates.HotUpdatesConstants.*;
+import static com.getmeback.hotupdates.HotUpdatesHelpers.*;
+
+/**
+ * Downloads ZIP updates with streaming extraction and resume, and stages
+ * extracted updates into temp_downloaded_update.
+ */
+public class HotUpdatesDownloader {
+
+    private final File filesDir;
+    private final HotUpdatesState state;
+    private final HotUpdatesStore store;
+
+    // Connection of the running download, disconnected by cancel()
+    private volatile HttpURLConnection activeConnection;
+    private volatile HotUpdatesSegmentedDownload activeSegmented;
+    // Set by cancel(): a transfer starting afterwards fails at once (cleared by resetCancel())
+    private volatile boolean cancelled = false;
+    // Receives progress of the following downloads (see setProgress)
+    private volatile HotUpdatesProgress progress = HotUpdatesProgress.NONE;
+
+    public HotUpdatesDownloader(Context context, HotUpdatesStore store) {
+        this.filesDir = context.getFilesDir();
+        this.state = HotUpdatesState.get(context);
+        this.store = store;
+    }
+
+    /**
+     * Report phases and byte counts of the following downloads.
+     *
+     * @param progress Reporter, null to stop reporting
+     */
+    public void setProgress(HotUpdatesProgress progress) {
+        this.progress = progress != null ? progress : HotUpdatesProgress.NONE;
+    }
+
+    // ============================================================
+    // ZIP Download
+    // ============================================================
+
+    /**
+     * Download ZIP update, extract it while the body streams in, and stage it.
+     * Network and decompression overlap, and no disk space is needed for the archive itself.
+     * An interrupted transfer of the same URL and version continues from the last complete
+     * entry (HTTP Range / If-Range) instead of starting from zero.
+     * Free space is checked against the declared sizes before any file is written.
+     * With a verifier, digests are computed while entries are inflated; an update that does
+     * not match is deleted and never marked pending.
+     *
+     * @param downloadURL ZIP URL
+     * @param version Update version
+     * @param connections Parallel connections; more than 1 enables segmented download when the
+     *                    server supports ranges and the archive is large enough, otherwise falls
+     *                    back to a single streaming connection. The streaming connection is also
+     *                    used when archive and extracted files would not fit on disk together
+     * @param packed Keep the archive as one file served without extraction
+     *               (see {@link HotUpdatesPack}); archives with compressed entries are extracted
+     * @param verifier Loaded signed manifest, null to skip verification
+     * @throws IOException on failure, see {@link #getErrorCode(Exception)};
+     *         "Insufficient storage: ..." if the update does not fit;
+     *         "Hash mismatch: ..." if a file is missing, unlisted or differs
+     */
+    public void downloadZip(String downloadURL, String version, int connections, boolean packed,
+                            HotUpdatesVerifier verifier) throws IOException {
+        if (packed) {
+            downloadPacked(downloadURL, version, connections, verifier);
+            return;
+        }
+
+        if (connections > 1) {
+            File archive = new File(filesDir, SEGMENTED_TEMP_ZIP);
+            HotUpdatesSegmentedDownload segmented = HotUpdatesSegmentedDownload.prepare(downloadURL, archive, connections);
+            if (segmented != null) {
+                long archiveBytes = segmented.getTotalSize();
+                if (hasSpace(archiveBytes + getExpectedSize(verifier, archiveBytes))) {
+                    downloadSegmented(segmented, archive, version, verifier);
+                    return;
+                }
+                // Streaming needs no space for the archive
+                Log.d(TAG, "Not enough space for archive and extracted files, using single connection");
+            } else {
+                Log.d(TAG, "Segmented download not possible, using single connection");
+            }
+        }
+
+        HttpURLConnection connection = null;
+        HotUpdatesZipStream zipStream = null;
+        String validator = null;
+        File newDownloadDir = new File(filesDir, DIR_TEMP_NEW_DOWNLOAD);
+
+        try {
+            long resumeOffset = getResumeOffset(downloadURL, version, newDownloadDir);
+            connection = openRangeConnection(downloadURL, resumeOffset,
+                    state.getString(PREF_RESUME_VALIDATOR, null));
+            setActive(connection);
+
+            if (connection.getResponseCode() == HttpURLConnection.HTTP_PARTIAL) {
+                Log.d(TAG, "Resuming download at " + resumeOffset + " bytes");
+            } else {
+                // Fresh download (first attempt or server validator changed)
+                resumeOffset = 0;
+                deleteRecursive(newDownloadDir);
+                newDownloadDir.mkdirs();
+            }
+
+            validator = getValidator(connection);
+            saveResumeState(downloadURL, version, validator, resumeOffset);
+
+            // Entries are extracted while the body streams in: one phase for both
+            long contentLength = connection.getContentLengthLong();
+            long expectedSize = getExpectedSize(verifier, contentLength >= 0 ? resumeOffset + contentLength : -1);
+            // Entries of a resumed attempt are already on disk
+            checkStorage(expectedSize >= 0 ? Math.max(0, expectedSize - resumeOffset) : -1);
+            progress.startPhase(PROGRESS_PHASE_DOWNLOADING, resumeOffset,
+                    contentLength >= 0 ? resumeOffset + contentLength : -1);
+
+            long bodyStart = HotUpdatesMetrics.now();
+            try (InputStream input = progress.wrap(connection.getInputStream())) {
+                zipStream = new HotUpdatesZipStream(input, newDownloadDir, resumeOffset);
+                zipStream.setVerifier(verifier);
+                long[] lastSaved = {resumeOffset};
+                zipStream.setProgressListener(offset -> {
+                    // Throttled: a stale offset only means some entries are extracted again
+                    if (offset - lastSaved[0] >= RESUME_SAVE_INTERVAL_BYTES) {
+                        state.edit().putLong(PREF_RESUME_OFFSET, offset).apply();
+                        lastSaved[0] = offset;
+                    }
+                });
+                zipStream.extract();
+            }
+            HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_DOWNLOAD, bodyStart, zipStream.getCommittedOffset() - resumeOffset);
+
+            Log.d(TAG, "Download and extraction completed");
+
+            clearResumeState();
+            verifyAndStage(newDownloadDir, version, verifier, zipStream.getHashes());
+
+        } catch (IOException e) {
+            boolean networkError = ERROR_DOWNLOAD_FAILED.equals(getErrorCode(e));
+
+            if (networkError && zipStream != null && validator != null) {
+                // Keep extracted entries, next attempt continues from here
+                long offset = zipStream.getCommittedOffset();
+                state.edit().putLong(PREF_RESUME_OFFSET, offset).apply();
+                Log.d(TAG, "Download interrupted, can resume at " + offset + " bytes");
+            } else if (networkError && zipStream == null) {
+                // No response received - saved resume state is still valid
+                Log.d(TAG, "Connection failed, partial download kept");
+            } else {
+                clearResumeState();
+                deleteRecursive(newDownloadDir);
+            }
+            throw e;
+
+        } finally {
+            activeConnection = null;
+            if (connection != null) connection.disconnect();
+        }
+    }
+
+    /**
+     * Download archive in parallel segments into a file, then extract it.
+     * Segments are not resumable; a streaming resume state of an earlier attempt is dropped.
+     */
+    private void downloadSegmented(HotUpdatesSegmentedDownload segmented, File archive, String version,
+                                   HotUpdatesVerifier verifier) throws IOException {
+        clearResumeState();
+
+        try {
+            setActive(segmented);
+            long startTime = HotUpdatesMetrics.now();
+            segmented.setProgress(progress);
+            segmented.download();
+            long endTime = HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_DOWNLOAD, startTime, segmented.getTotalSize());
+            Log.d(TAG, "Segmented download completed in " + (endTime - startTime) / 1000000 + " ms");
+
+            installArchive(archive, version, false, verifier);
+
+        } finally {
+            activeSegmented = null;
+            archive.delete();
+        }
+    }
+
+    /**
+     * Download archive into a file (segmented when possible) and stage it as a pack.
+     * Like segmented downloads, not resumable.
+     */
+    private void downloadPacked(String downloadURL, String version, int connections,
+                                HotUpdatesVerifier verifier) throws IOException {
+        File archive = new File(filesDir, PACKED_TEMP_ZIP);
+        clearResumeState();
+
+        HotUpdatesSegmentedDownload segmented = connections > 1
+                ? HotUpdatesSegmentedDownload.prepare(downloadURL, archive, connections) : null;
+
+        try {
+            if (segmented != null) {
+                // The pack is moved into place as is: the archive is the only copy
+                checkStorage(segmented.getTotalSize());
+                setActive(segmented);
+                long startTime = HotUpdatesMetrics.now();
+                segmented.setProgress(progress);
+                segmented.download();
+                HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_DOWNLOAD, startTime, segmented.getTotalSize());
+            } else {
+                downloadArchive(downloadURL, archive);
+            }
+            Log.d(TAG, "Archive downloaded (" + archive.length() + " bytes)");
+
+            installArchive(archive, version, true, verifier);
+
+        } finally {
+            activeSegmented = null;
+            archive.delete();
+        }
+    }
+
+    /**
+     * Download archive over one connection into a file.
+     */
+    private void downloadArchive(String downloadURL, File archive) throws IOException {
+        HttpURLConnection connection = openConnection(downloadURL);
+        try {
+            setActive(connection);
+            checkStorage(connection.getContentLengthLong());
+        } catch (IOException e) {
+            connection.disconnect();
+            throw e;
+        }
+        progress.startPhase(PROGRESS_PHASE_DOWNLOADING, 0, connection.getContentLengthLong());
+        long startTime = HotUpdatesMetrics.now();
+        byte[] buffer = HotUpdatesBuffers.acquire();
+        try (InputStream input = progress.wrap(connection.getInputStream());
+             OutputStream output = new FileOutputStream(archive)) {
+            int bytesRead;
+            while ((bytesRead = input.read(buffer)) != -1) {
+                output.write(buffer, 0, bytesRead);
+            }
+        } finally {
+            HotUpdatesBuffers.release(buffer);
+            activeConnection = null;
+            connection.disconnect();
+        }
+        HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_DOWNLOAD, startTime, archive.length());
+    }
+
+    /**
+     * Stage complete archive: moved as is into www/bundle.pack when a pack is requested
+     * and the archive qualifies, extracted on all cores otherwise.
+     */
+    private void installArchive(File archive, String version, boolean packed,
+                                HotUpdatesVerifier verifier) throws IOException {
+        File newDownloadDir = new File(filesDir, DIR_TEMP_NEW_DOWNLOAD);
+        deleteRecursive(newDownloadDir);
+        Map<String, String> hashes = new ConcurrentHashMap<>();
+
+        try {
+            if (packed) {
+                // CRC (and manifest) check of all entries, no byte counts
+                progress.startPhase(PROGRESS_PHASE_VERIFYING, 0, -1);
+            }
+            long validateStart = HotUpdatesMetrics.now();
+            if (packed && HotUpdatesPack.isServable(archive, verifier)) {
+                HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_VALIDATE, validateStart);
+                File newWww = new File(newDownloadDir, DIR_WWW);
+                newWww.mkdirs();
+                if (!archive.renameTo(new File(newWww, PACKED_BUNDLE_FILE))) {
+                    throw new IOException("Cannot move pack into update directory");
+                }
+                Log.d(TAG, "Archive kept as pack, extraction skipped");
+            } else {
+                if (packed) {
+                    // Rejected pack: the check still took its time
+                    HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_VALIDATE, validateStart);
+                }
+                newDownloadDir.mkdirs();
+                long extractStart = HotUpdatesMetrics.now();
+                HotUpdatesParallelUnzip.extract(archive, newDownloadDir, verifier, progress, hashes);
+                HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_EXTRACT, extractStart, archive.length());
+            }
+
+            verifyAndStage(newDownloadDir, version, verifier, hashes);
+
+        } catch (IOException e) {
+            deleteRecursive(newDownloadDir);
+            throw e;
+        }
+    }
+
+    /**
+     * Abort running download. downloadZip fails with a network error and keeps
+     * resume state, so the transfer can continue later (see {@link #discard()}).
+     * Sticky: a download started before {@link #resetCancel()} fails as well.
+     */
+    public void cancel() {
+        cancelled = true;
+        HttpURLConnection connection = activeConnection;
+        if (connection != null) {
+            connection.disconnect();
+        }
+        HotUpdatesSegmentedDownload segmented = activeSegmented;
+        if (segmented != null) {
+            segmented.cancel();
+        }
+    }
+
+    /**
+     * Allow downloads again after cancel(). Called before each new download; a cancel()
+     * arriving later still aborts it.
+     */
+    public void resetCancel() {
+        cancelled = false;
+    }
+
+    /**
+     * Delete leftovers that do not belong to a resumable transfer: archives of segmented /
+     * packed downloads, patch files and the legacy pending_update copy. Partial files of
+     * a streaming download are kept. Must not run while a download is in progress.
+     */
+    public void deleteStaleFiles() {
+        new File(filesDir, SEGMENTED_TEMP_ZIP).delete();
+        new File(filesDir, PACKED_TEMP_ZIP).delete();
+        new File(filesDir, PATCH_TEMP_ZIP).delete();
+        deleteRecursive(new File(filesDir, DIR_TEMP_PATCH));
+        deleteRecursive(new File(filesDir, DIR_PENDING_UPDATE));
+    }
+
+    /**
+     * Delete partial files of an abandoned transfer together with its resume state.
+     * Must not run while a download is in progress.
+     */
+    public void discard() {
+        clearResumeState();
+        deleteRecursive(new File(filesDir, DIR_TEMP_NEW_DOWNLOAD));
+        new File(filesDir, SEGMENTED_TEMP_ZIP).delete();
+        new File(filesDir, PACKED_TEMP_ZIP).delete();
+        Log.d(TAG, "Partial download discarded");
+    }
+
+    private void setActive(HttpURLConnection connection) throws IOException {
+        activeConnection = connection;
+        if (cancelled) throw new IOException("Download cancelled");
+    }
+
+    private void setActive(HotUpdatesSegmentedDownload segmented) throws IOException {
+        activeSegmented = segmented;
+        if (cancelled) throw new IOException("Download cancelled");
+    }
+
+    /**
+     * Map download failure to a JavaScript error code.
+     */
+    public static String getErrorCode(Exception e) {
+        String message = e.getMessage();
+        if (isOutOfSpace(e)) return ERROR_INSUFFICIENT_STORAGE;
+        if (e instanceof ZipException) return ERROR_EXTRACTION_FAILED;
+        if (message != null && message.startsWith("HTTP error:")) return ERROR_HTTP_ERROR;
+        if (message != null && message.contains("www folder not found")) return ERROR_WWW_NOT_FOUND;
+        if (message != null && message.startsWith("Hash mismatch:")) return ERROR_HASH_MISMATCH;
+        if (message != null && message.startsWith("Signature invalid:")) return ERROR_SIGNATURE_INVALID;
+        if (message != null && message.startsWith("Invalid manifest:")) return ERROR_MANIFEST_INVALID;
+        return ERROR_DOWNLOAD_FAILED;
+    }
+
+    /**
+     * Map download failure to a JavaScript error message.
+     */
+    public static String getErrorMessage(Exception e) {
+        String code = getErrorCode(e);
+        if (code.equals(ERROR_DOWNLOAD_FAILED) || code.equals(ERROR_HTTP_ERROR)) {
+            return "Download failed: " + e.getMessage();
+        }
+        return e.getMessage();
+    }
+
+    private static boolean isOutOfSpace(Exception e) {
+        String message = e.getMessage();
+        return message != null && (message.startsWith("Insufficient storage:")
+                || message.contains("ENOSPC") || message.contains("No space left on device"));
+    }
+
+    // ============================================================
+    // Storage Preflight
+    // ============================================================
+
+    /**
+     * Expected size of the extracted update: the sizes declared by the signed manifest,
+     * otherwise the archive size (a lower bound, entries are at least as large as stored).
+     *
+     * @param archiveBytes Archive size from the response headers, -1 if unknown
+     * @return Bytes, -1 if neither is known
+     */
+    private static long getExpectedSize(HotUpdatesVerifier verifier, long archiveBytes) {
+        long declared = verifier != null ? verifier.getTotalSize() : -1;
+        return declared >= 0 ? declared : archiveBytes;
+    }
+
+    /**
+     * @param bytes Bytes about to be written, -1 if unknown (always fits)
+     */
+    private boolean hasSpace(long bytes) {
+        return bytes < 0 || bytes + STORAGE_MARGIN_BYTES <= filesDir.getUsableSpace();
+    }
+
+    /**
+     * Fail before writing an update that would run the disk full halfway through.
+     *
+     * @throws IOException "Insufficient storage: ..." if bytes plus margin exceed the free space
+     */
+    private void checkStorage(long bytes) throws IOException {
+        if (hasSpace(bytes)) return;
+        throw new IOException("Insufficient storage: " + (bytes + STORAGE_MARGIN_BYTES)
+                + " bytes needed, " + filesDir.getUsableSpace() + " available");
+    }
+
+    // ============================================================
+    // Staging
+    // ============================================================
+
+    /**
+     * Check files the extractor did not hash (entries of an earlier, resumed attempt), then stage.
+     *
+     * @param hashes Digests computed during extraction, see {@link #stage}
+     */
+    private void verifyAndStage(File newDownloadDir, String version, HotUpdatesVerifier verifier,
+                                Map<String, String> hashes) throws IOException {
+        File wwwInZip = verifier != null ? findWwwFolder(newDownloadDir) : null;
+        if (wwwInZip != null) {
+            progress.startPhase(PROGRESS_PHASE_VERIFYING, 0, -1);
+            long startTime = HotUpdatesMetrics.now();
+            verifier.verifyRemaining(wwwInZip);
+            HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_VALIDATE, startTime);
+        }
+        stage(newDownloadDir, version, verifier != null ? verifier.getWarmupPaths() : null, hashes);
+    }
+
+    /**
+     * Move freshly built update (temp_new_download) to temp_downloaded_update by
+     * rename and mark it ready. Shared by ZIP and delta downloads. This directory
+     * is the only staged copy: forceUpdate and the launch-time auto-install both
+     * promote it by rename.
+     *
+     * @param newDownloadDir Directory containing the www folder of the update
+     * @param version Update version
+     * @param warmupPaths Warm-up list of the update manifest, null or empty for none
+     * @param hashes SHA-256 hex by absolute path of the files whose digest is already known
+     *               (computed during extraction or checked against a manifest); the store
+     *               reads and hashes only the others. Null to hash every file
+     * @throws IOException if www folder is missing or cannot be moved
+     */
+    public void stage(File newDownloadDir, String version, List<String> warmupPaths,
+                      Map<String, String> hashes) throws IOException {
+        progress.startPhase(PROGRESS_PHASE_STAGING, 0, -1);
+        long startTime = HotUpdatesMetrics.now();
+
+        // Find www folder
+        File wwwInZip = findWwwFolder(newDownloadDir);
+        if (wwwInZip == null) {
+            deleteRecursive(newDownloadDir);
+            throw new IOException("www folder not found in archive");
+        }
+
+        // Store content once; every directory below only links to it. A pack is one
+        // archive unique to its version: nothing to share, hashing it is a full read pass
+        if (!new File(wwwInZip, PACKED_BUNDLE_FILE).exists()) {
+            store.ingest(wwwInZip, hashes);
+        }
+
+        // Move to temp_downloaded_update (single rename, hard link mirror only as fallback)
+        File tempUpdateDir = new File(filesDir, DIR_TEMP_DOWNLOADED);
+        deleteRecursive(tempUpdateDir);
+        deleteRecursive(new File(filesDir, DIR_PENDING_UPDATE));
+        tempUpdateDir.mkdirs();
+
+        File destWww = new File(tempUpdateDir, DIR_WWW);
+        if (!wwwInZip.renameTo(destWww)) {
+            long copyStart = HotUpdatesMetrics.now();
+            linkDirectory(wwwInZip, destWww);
+            HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_COPY, copyStart);
+        }
+
+        // Cleanup
+        deleteRecursive(newDownloadDir);
+
+        HotUpdatesState.Editor editor = state.edit();
+        editor.putBoolean(PREF_DOWNLOAD_IN_PROGRESS, false);
+        editor.putBoolean(PREF_PENDING_UPDATE_READY, true);
+        editor.putBoolean(PREF_HAS_PENDING, true);
+        editor.putString(PREF_PENDING_VERSION, version);
+        if (warmupPaths != null && !warmupPaths.isEmpty()) {
+            editor.putString(PREF_PENDING_WARMUP, new JSONArray(warmupPaths).toString());
+        } else {
+            editor.remove(PREF_PENDING_WARMUP);
+        }
+        editor.commit();
+        HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_STAGE, startTime);
+
+        Log.d(TAG, "Update ready (v" + version + ")");
+    }
+
+    // ============================================================
+    // Resume State
+    // ============================================================
+
+    /**
+     * Get archive offset to continue an interrupted download from.
+     *
+     * @return Saved offset if URL, version and partial files match, 0 otherwise
+     */
+    private long getResumeOffset(String downloadURL, String version, File partialDir) {
+        boolean sameTransfer = downloadURL.equals(state.getString(PREF_RESUME_URL, null))
+                && version != null && version.equals(state.getString(PREF_RESUME_VERSION, null))
+                && state.getString(PREF_RESUME_VALIDATOR, null) != null
+                && partialDir.exists();
+        return sameTransfer ? state.getLong(PREF_RESUME_OFFSET, 0) : 0;
+    }
+
+    private void saveResumeState(String downloadURL, String version, String validator, long offset) {
+        if (validator == null) {
+            // Server gives no validator - partial data could not be matched later
+            clearResumeState();
+            return;
+        }
+
+        state.edit()
+            .putString(PREF_RESUME_URL, downloadURL)
+            .putString(PREF_RESUME_VERSION, version)
+            .putString(PREF_RESUME_VALIDATOR, validator)
+            .putLong(PREF_RESUME_OFFSET, offset)
+            .apply();
+    }
+
+    public void clearResumeState() {
+        state.edit()
+            .remove(PREF_RESUME_URL)
+            .remove(PREF_RESUME_VERSION)
+            .remove(PREF_RESUME_VALIDATOR)
+            .remove(PREF_RESUME_OFFSET)
+            .apply();
+    }
+}
@@ -9,7 +9,8 @@
  */
 package com.getmeback.hotupdates;
 
-import android.content.Context;
+import android.system.ErrnoException;
+import android.system.Os;
 import android.util.Log;
 
 import org.apache.cordova.CallbackContext;
@@ -17,19 +18,19 @@ import org.apache.cordova.CordovaInterface;
 import org.json.JSONException;
 import org.json.JSONObject;
 
-import java.io.BufferedInputStream;
-import java.io.BufferedOutputStream;
+import java.io.ByteArrayOutputStream;
 import java.io.File;
 import java.io.FileInputStream;
 import java.io.FileOutputStream;
 import java.io.IOException;
 import java.io.InputStream;
 import java.io.OutputStream;
-import java.util.Enumeration;
-import java.util.jar.JarEntry;
-import java.util.jar.JarFile;
-import java.util.zip.ZipEntry;
-import java.util.zip.ZipInputStream;
+import java.net.HttpURLConnection;
+import java.net.URL;
+import java.nio.channels.FileChannel;
+import java.nio.charset.StandardCharsets;
+import java.security.MessageDigest;
+import java.security.NoSuchAlgorithmException;
 
 import static com.getmeback.hotupdates.HotUpdatesConstants.*;
 
@@ -43,6 +44,33 @@ public class HotUpdatesHelpers {
         // Prevent instantiation
     }
 
+    // ============================================================
+    // Versions
+    // ============================================================
+
+    /**
+     * Compare dotted numeric versions ("2.10.0" &gt; "2.9"). Missing parts count as 0,
+     * non-numeric parts are compared as text.
+     *
+     * @return Negative, zero or positive as a is lower, equal or higher than b
+     */
+    public static int compareVersions(String a, String b) {
+        String[] partsA = a.split("\\.");
+        String[] partsB = b.split("\\.");
+        for (int i = 0; i < Math.max(partsA.length, partsB.length); i++) {
+            String partA = i < partsA.length ? partsA[i] : "0";
+            String partB = i < partsB.length ? partsB[i] : "0";
+            int result;
+            try {
+                result = Long.compare(Long.parseLong(partA), Long.parseLong(partB));
+            } catch (NumberFormatException e) {
+                result = partA.compareTo(partB);
+            }
+            if (result != 0) return result;
+        }
+        return 0;
+    }
+
     // ============================================================
     // File Operations
     // ============================================================
@@ -88,72 +116,104 @@ public class HotUpdatesHelpers {
     }
 
     /**
-     * Copy single file.
+     * Recursively mirror directory with hard links.
+     * Costs one metadata operation per file instead of copying bytes.
+     * Falls back to a copy for files that cannot be linked.
+     *
+     * @param src Source directory
+     * @param dst Destination directory
+     * @throws IOException if copy fallback fails
+     */
+    public static void linkDirectory(File src, File dst) throws IOException {
+        if (src.isDirectory()) {
+            dst.mkdirs();
+            String[] children = src.list();
+            if (children != null) {
+                for (String child : children) {
+                    linkDirectory(new File(src, child), new File(dst, child));
+                }
+            }
+        } else {
+            linkFile(src, dst);
+        }
+    }
+
+    /**
+     * Hard link single file, falling back to copy.
      *
      * @param src Source file
-     * @param dst Destination file
-     * @throws IOException if copy fails
+     * @param dst Destination file (replaced if exists)
+     * @throws IOException if copy fallback fails
      */
-    public static void copyFile(File src, File dst) throws IOException {
+    public static void linkFile(File src, File dst) throws IOException {
         dst.getParentFile().mkdirs();
+        dst.delete();
 
-        InputStream in = new BufferedInputStream(new FileInputStream(src));
-        OutputStream out = new BufferedOutputStream(new FileOutputStream(dst));
-
-        byte[] buffer = new byte[8192];
-        int bytesRead;
-        while ((bytesRead = in.read(buffer)) != -1) {
-            out.write(buffer, 0, bytesRead);
+        try {
+            Os.link(src.getAbsolutePath(), dst.getAbsolutePath());
+        } catch (ErrnoException e) {
+            copyFile(src, dst);
         }
-
-        out.flush();
-        out.close();
-        in.close();
     }
 
     /**
-     * Copy folder from assets to destination path.
-     * Based on nordnetab/chcp utilities.
+     * Copy single file. FileChannel.transferTo copies in the kernel (sendfile),
+     * no data passes through the Java heap.
      *
-     * @param context Android context
-     * @param assetFolder Folder name in assets (e.g. "www")
-     * @param destPath Destination path on filesystem
+     * @param src Source file
+     * @param dst Destination file
      * @throws IOException if copy fails
      */
-    public static void copyAssetsFolder(Context context, String assetFolder, String destPath) throws IOException {
-        String appJarPath = context.getApplicationInfo().sourceDir;
-        String assetsDir = "assets/" + assetFolder;
-
-        JarFile jarFile = new JarFile(appJarPath);
-        Enumeration<JarEntry> entries = jarFile.entries();
-        int prefixLength = assetsDir.length();
-
-        while (entries.hasMoreElements()) {
-            JarEntry entry = entries.nextElement();
-            String name = entry.getName();
-
-            if (!entry.isDirectory() && name.startsWith(assetsDir)) {
-                String relativePath = name.substring(prefixLength);
-                String destFilePath = destPath + relativePath;
-
-                File destFile = new File(destFilePath);
-                destFile.getParentFile().mkdirs();
-
-                InputStream in = jarFile.getInputStream(entry);
-                OutputStream out = new FileOutputStream(destFilePath);
-
-                byte[] buffer = new byte[8192];
-                int bytesRead;
-                while ((bytesRead = in.read(buffer)) != -1) {
-                    out.write(buffer, 0, bytesRead);
+    public static void copyFile(File src, File dst) throws IOException {
+        dst.getParentFile().mkdirs();
+        // Never write through an existing hard link - it may be shared with another version
+        dst.delete();
+
+        try (FileChannel in = new FileInputStream(src).getChannel();
+             FileChannel out = new FileOutputStream(dst).getChannel()) {
+            long size = in.size();
+            long position = 0;
+            // transferTo may copy less than asked
+            while (position < size) {
+                long copied = in.transferTo(position, size - position, out);
+                if (copied <= 0) {
+                    throw new IOException("Copy of " + src.getName() + " stopped at " + position + " of " + size + " bytes");
                 }
-
-                out.close();
-                in.close();
+                position += copied;
             }
         }
+    }
+
+    /**
+     * Write small UTF-8 text file (e.g. marker), replacing an existing one.
+     *
+     * @throws IOException if write fails
+     */
+    public static void writeTextFile(File file, String text) throws IOException {
+        // Never write through an existing hard link - it may be shared with another version
+        file.delete();
+        try (OutputStream out = new FileOutputStream(file)) {
+            out.write(text.getBytes(StandardCharsets.UTF_8));
+        }
+    }
 
-        jarFile.close();
+    /**
+     * Read small UTF-8 text file.
+     *
+     * @return File contents, null if it cannot be read
+     */
+    public static String readTextFile(File file) {
+        try (InputStream in = new FileInputStream(file)) {
+            ByteArrayOutputStream out = new ByteArrayOutputStream();
+            byte[] buffer = new byte[256];
+            int count;
+            while ((count = in.read(buffer)) != -1) {
+                out.write(buffer, 0, count);
+            }
+            return new String(out.toByteArray(), StandardCharsets.UTF_8);
+        } catch (IOException e) {
+            return null;
+        }
     }
 
     // ============================================================
@@ -191,7 +251,7 @@ public class HotUpdatesHelpers {
     }
 
     /**
-     * Extract ZIP archive to destination directory.
+     * Extract ZIP archive to destination directory (all cores, see HotUpdatesParallelUnzip).
      *
      * @param zipFile ZIP file to extract
      * @param destDir Destination directory
@@ -199,46 +259,8 @@ public class HotUpdatesHelpers {
      */
     public static boolean extractZip(File zipFile, File destDir) {
         try {
-            // Validate ZIP file first
-            if (!isValidZipFile(zipFile)) {
-                Log.e(TAG, "Invalid file format (not a ZIP archive)");
-                return false;
-            }
-
-            ZipInputStream zis = new ZipInputStream(new FileInputStream(zipFile));
-            ZipEntry entry;
-
-            while ((entry = zis.getNextEntry()) != null) {
-                File outFile = new File(destDir, entry.getName());
-
-                // Security: prevent path traversal
-                String canonicalDestPath = destDir.getCanonicalPath();
-                String canonicalOutPath = outFile.getCanonicalPath();
-                if (!canonicalOutPath.startsWith(canonicalDestPath)) {
-                    Log.e(TAG, "ZIP entry outside destination directory: " + entry.getName());
-                    zis.close();
-                    return false;
-                }
-
-                if (entry.isDirectory()) {
-                    outFile.mkdirs();
-                } else {
-                    outFile.getParentFile().mkdirs();
-
-                    FileOutputStream fos = new FileOutputStream(outFile);
-                    byte[] buffer = new byte[8192];
-                    int bytesRead;
-                    while ((bytesRead = zis.read(buffer)) != -1) {
-                        fos.write(buffer, 0, bytesRead);
-                    }
-                    fos.close();
-                }
-                zis.closeEntry();
-            }
-
-            zis.close();
+            HotUpdatesParallelUnzip.extract(zipFile, destDir);
             return true;
-
         } catch (Exception e) {
             Log.e(TAG, "ZIP extraction failed: " + e.getMessage());
             return false;
@@ -275,6 +297,261 @@ public class HotUpdatesHelpers {
         return null;
     }
 
+    // ============================================================
+    // Hashing
+    // ============================================================
+
+    /**
+     * Compute SHA-256 of a file.
+     *
+     * @param file File to hash
+     * @return Lowercase hex digest, or null if file cannot be read
+     */
+    public static String sha256(File file) {
+        try (InputStream in = new FileInputStream(file)) {
+            return sha256(in);
+        } catch (IOException e) {
+            Log.e(TAG, "Failed to hash file " + file.getName() + ": " + e.getMessage());
+            return null;
+        }
+    }
+
+    /**
+     * Compute SHA-256 of a stream (read to the end, not closed).
+     *
+     * @param in Stream to hash
+     * @return Lowercase hex digest
+     * @throws IOException if reading fails
+     */
+    public static String sha256(InputStream in) throws IOException {
+        MessageDigest digest = newSha256();
+        byte[] buffer = HotUpdatesBuffers.acquire();
+        try {
+            int bytesRead;
+            while ((bytesRead = in.read(buffer)) != -1) {
+                digest.update(buffer, 0, bytesRead);
+            }
+        } finally {
+            HotUpdatesBuffers.release(buffer);
+        }
+        return toHex(digest.digest());
+    }
+
+    /**
+     * Create SHA-256 digest instance.
+     */
+    public static MessageDigest newSha256() {
+        try {
+            return MessageDigest.getInstance("SHA-256");
+        } catch (NoSuchAlgorithmException e) {
+            // SHA-256 is mandatory on every Android version
+            throw new IllegalStateException(e);
+        }
+    }
+
+    /**
+     * Convert bytes to lowercase hex string.
+     */
+    public static String toHex(byte[] bytes) {
+        StringBuilder sb = new StringBuilder(bytes.length * 2);
+        for (byte b : bytes) {
+            sb.append(Character.forDigit((b >> 4) & 0xF, 16));
+            sb.append(Character.forDigit(b & 0xF, 16));
+        }
+        return sb.toString();
+    }
+
+    // ============================================================
+    // Network Operations
+    // ============================================================
+
+    /**
+     * Connect and wait for the response headers, recording both as metrics.
+     * HttpURLConnection does not expose the DNS lookup and TLS handshake
+     * separately, they are part of the connect stage.
+     *
+     * @return HTTP status code
+     */
+    public static int connectTimed(HttpURLConnection connection) throws IOException {
+        long start = HotUpdatesMetrics.now();
+        connection.connect();
+        long connected = HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_CONNECT, start);
+        int responseCode = connection.getResponseCode();
+        HotUpdatesMetrics.record(HotUpdatesMetrics.STAGE_TTFB, connected);
+        return responseCode;
+    }
+
+    /**
+     * Open GET connection and check for HTTP 200.
+     *
+     * @param url URL to open
+     * @return Connected HttpURLConnection (caller must disconnect)
+     * @throws IOException with "HTTP error: N" message on non-200 status
+     */
+    public static HttpURLConnection openConnection(String url) throws IOException {
+        HttpURLConnection connection = (HttpURLConnection) new URL(url).openConnection();
+        connection.setConnectTimeout(HTTP_CONNECT_TIMEOUT_MS);
+        connection.setReadTimeout(HTTP_READ_TIMEOUT_MS);
+
+        int responseCode = connectTimed(connection);
+        if (responseCode != HttpURLConnection.HTTP_OK) {
+            connection.disconnect();
+            throw new IOException("HTTP error: " + responseCode);
+        }
+        return connection;
+    }
+
+    /**
+     * Open GET connection that continues a previous transfer.
+     * Sends Range / If-Range, so the server answers 206 only while the validator still
+     * matches and the full body (200) if the resource changed.
+     *
+     * @param url URL to open
+     * @param offset Byte offset to continue from (0 for full download)
+     * @param validator ETag or Last-Modified of the previous response (null for full download)
+     * @return Connected HttpURLConnection with status 200 or 206 starting at offset
+     * @throws IOException with "HTTP error: N" message on other status
+     */
+    public static HttpURLConnection openRangeConnection(String url, long offset, String validator) throws IOException {
+        boolean ranged = offset > 0 && validator != null;
+
+        HttpURLConnection connection = (HttpURLConnection) new URL(url).openConnection();
+        connection.setConnectTimeout(HTTP_CONNECT_TIMEOUT_MS);
+        connection.setReadTimeout(HTTP_READ_TIMEOUT_MS);
+        // Byte offsets must refer to the archive itself, not a compressed transfer
+        connection.setRequestProperty("Accept-Encoding", "identity");
+        if (ranged) {
+            connection.setRequestProperty("Range", "bytes=" + offset + "-");
+            connection.setRequestProperty("If-Range", validator);
+        }
+
+        int responseCode = connectTimed(connection);
+        if (responseCode == HttpURLConnection.HTTP_OK) {
+            return connection;
+        }
+        if (ranged && responseCode == HttpURLConnection.HTTP_PARTIAL
+                && getContentRangeStart(connection) == offset) {
+            return connection;
+        }
+
+        connection.disconnect();
+        if (ranged && (responseCode == HttpURLConnection.HTTP_PARTIAL || responseCode == HTTP_RANGE_NOT_SATISFIABLE)) {
+            // Range not usable - start over
+            return openRangeConnection(url, 0, null);
+        }
+        throw new IOException("HTTP error: " + responseCode);
+    }
+
+    /**
+     * Get strong validator of the response for a later If-Range request.
+     *
+     * @return ETag (weak ETags are not allowed in If-Range), Last-Modified, or null
+     */
+    public static String getValidator(HttpURLConnection connection) {
+        String etag = connection.getHeaderField("ETag");
+        if (etag != null && !etag.startsWith("W/")) {
+            return etag;
+        }
+        return connection.getHeaderField("Last-Modified");
+    }
+
+    /**
+     * Get first byte position of a 206 response (Content-Range), or -1.
+     */
+    public static long getContentRangeStart(HttpURLConnection connection) {
+        // Content-Range: bytes 1000-4999/5000
+        String range = connection.getHeaderField("Content-Range");
+        if (range == null || !range.startsWith("bytes ")) return -1;
+
+        int dash = range.indexOf('-');
+        if (dash < 0) return -1;
+        try {
+            return Long.parseLong(range.substring(6, dash).trim());
+        } catch (NumberFormatException e) {
+            return -1;
+        }
+    }
+
+    /**
+     * Get full resource size of a 206 response (Content-Range), or -1 if unknown.
+     */
+    public static long getContentRangeTotal(HttpURLConnection connection) {
+        // Content-Range: bytes 0-0/5000 (total may be "*")
+        String range = connection.getHeaderField("Content-Range");
+        if (range == null) return -1;
+
+        int slash = range.lastIndexOf('/');
+        if (slash < 0) return -1;
+        try {
+            return Long.parseLong(range.substring(slash + 1).trim());
+        } catch (NumberFormatException e) {
+            return -1;
+        }
+    }
+
+    /**
+     * Download small text resource (e.g. manifest) into memory.
+     *
+     * @param url URL to download
+     * @return Response body as UTF-8 string
+     * @throws IOException if download fails
+     */
+    public static String downloadToString(String url) throws IOException {
+        return new String(downloadToBytes(url), StandardCharsets.UTF_8);
+    }
+
+    /**
+     * Download small resource into memory.
+     *
+     * @param url URL to download
+     * @return Response body
+     * @throws IOException if download fails
+     */
+    public static byte[] downloadToBytes(String url) throws IOException {
+        HttpURLConnection connection = openConnection(url);
+        byte[] buffer = HotUpdatesBuffers.acquire();
+        try (InputStream in = connection.getInputStream()) {
+            ByteArrayOutputStream out = new ByteArrayOutputStream();
+            int bytesRead;
+            while ((bytesRead = in.read(buffer)) != -1) {
+                out.write(buffer, 0, bytesRead);
+            }
+            return out.toByteArray();
+        } finally {
+            HotUpdatesBuffers.release(buffer);
+            connection.disconnect();
+        }
+    }
+
+    /**
+     * Download URL to file, hashing bytes as they are written.
+     *
+     * @param url URL to download
+     * @param dest Destination file (parent directories are created)
+     * @return SHA-256 hex digest of downloaded content
+     * @throws IOException if download fails
+     */
+    public static String downloadToFile(String url, File dest) throws IOException {
+        dest.getParentFile().mkdirs();
+
+        HttpURLConnection connection = openConnection(url);
+        // Pooled buffer is large enough that stream buffering would only add a copy
+        byte[] buffer = HotUpdatesBuffers.acquire();
+        try (InputStream in = connection.getInputStream();
+             OutputStream out = new FileOutputStream(dest)) {
+            MessageDigest digest = newSha256();
+            int bytesRead;
+            while ((bytesRead = in.read(buffer)) != -1) {
+                digest.update(buffer, 0, bytesRead);
+                out.write(buffer, 0, bytesRead);
+            }
+            return toHex(digest.digest());
+        } finally {
+            HotUpdatesBuffers.release(buffer);
+            connection.disconnect();
+        }
+    }
+
     // ============================================================
     // Error Handling
     // ============================================================
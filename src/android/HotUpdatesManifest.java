@@ -0,0 +1,254 @@
+/**
+ * HotUpdatesManifest.java
+ * Per-file content manifest for delta updates
+ *
+ * The server publishes one manifest per version describing every file of
+ * the www folder by SHA-256 hash and size. The plugin compares it with the
+ * installed www and downloads only the files that changed.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import android.content.res.AssetManager;
+import android.net.Uri;
+
+import org.json.JSONArray;
+import org.json.JSONException;
+import org.json.JSONObject;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.InputStream;
+import java.net.MalformedURLException;
+import java.net.URL;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.Iterator;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+
+import static com.getmeback.hotupdates.HotUpdatesHelpers.*;
+
+/**
+ * Parsed update manifest.
+ *
+ * Format:
+ * <pre>
+ * {
+ *   "version": "2.0.0",
+ *   "baseUrl": "https://cdn.example.com/app/2.0.0/www/",
+ *   "patches": { "1.9.0": "https://cdn.example.com/app/patch-1.9.0-2.0.0.zip" },
+ *   "warmup": ["js/app.js", "css/app.css"],
+ *   "files": {
+ *     "index.html": { "sha256": "...", "size": 1234 },
+ *     "js/app.js":  { "sha256": "...", "size": 56789 }
+ *   }
+ * }
+ * </pre>
+ * {@code baseUrl} defaults to {@code www/} next to the manifest URL.
+ * {@code warmup} (optional) lists files read ahead before the WebView reloads after install.
+ */
+public class HotUpdatesManifest {
+
+    /** Default file location relative to the manifest URL */
+    private static final String DEFAULT_BASE_URL = "www/";
+
+    /**
+     * Single file record of the manifest.
+     */
+    public static final class Entry {
+        public final String path;
+        public final String sha256;
+        public final long size;
+
+        Entry(String path, String sha256, long size) {
+            this.path = path;
+            this.sha256 = sha256;
+            this.size = size;
+        }
+    }
+
+    private final String version;
+    private final String baseUrl;
+    private final Map<String, String> patches;
+    private final Map<String, Entry> entries;
+    private final List<String> warmupPaths;
+
+    private HotUpdatesManifest(String version, String baseUrl, Map<String, String> patches,
+                               Map<String, Entry> entries, List<String> warmupPaths) {
+        this.version = version;
+        this.baseUrl = baseUrl;
+        this.patches = patches;
+        this.entries = entries;
+        this.warmupPaths = warmupPaths;
+    }
+
+    /**
+     * Parse manifest JSON.
+     *
+     * @param json Manifest body
+     * @param manifestUrl URL the manifest was loaded from (used to resolve baseUrl)
+     * @return Parsed manifest
+     * @throws JSONException if manifest is malformed or contains unsafe paths
+     */
+    public static HotUpdatesManifest parse(String json, String manifestUrl) throws JSONException {
+        JSONObject root = new JSONObject(json);
+
+        JSONObject files = root.optJSONObject("files");
+        if (files == null) {
+            throw new JSONException("Manifest has no files");
+        }
+
+        Map<String, Entry> entries = new LinkedHashMap<>();
+        Iterator<String> keys = files.keys();
+        while (keys.hasNext()) {
+            String path = keys.next();
+            if (!isSafeRelativePath(path)) {
+                throw new JSONException("Invalid path in manifest: " + path);
+            }
+
+            JSONObject file = files.getJSONObject(path);
+            String sha256 = file.getString("sha256").toLowerCase(Locale.US);
+            long size = file.optLong("size", -1);
+            entries.put(path, new Entry(path, sha256, size));
+        }
+
+        Map<String, String> patches = new HashMap<>();
+        JSONObject patchesJson = root.optJSONObject("patches");
+        if (patchesJson != null) {
+            Iterator<String> fromVersions = patchesJson.keys();
+            while (fromVersions.hasNext()) {
+                String from = fromVersions.next();
+                patches.put(from, resolveUrl(manifestUrl, patchesJson.getString(from)));
+            }
+        }
+
+        String baseUrl = resolveUrl(manifestUrl, root.optString("baseUrl", DEFAULT_BASE_URL));
+        if (!baseUrl.endsWith("/")) {
+            baseUrl += "/";
+        }
+
+        List<String> warmupPaths = new ArrayList<>();
+        JSONArray warmupJson = root.optJSONArray("warmup");
+        if (warmupJson != null) {
+            for (int i = 0; i < warmupJson.length(); i++) {
+                String path = warmupJson.getString(i);
+                if (!isSafeRelativePath(path)) {
+                    throw new JSONException("Invalid warmup path in manifest: " + path);
+                }
+                warmupPaths.add(path);
+            }
+        }
+
+        String version = root.optString("version", null);
+        return new HotUpdatesManifest(version, baseUrl, patches, entries, warmupPaths);
+    }
+
+    public String getVersion() {
+        return version;
+    }
+
+    public List<Entry> getEntries() {
+        return Collections.unmodifiableList(new ArrayList<>(entries.values()));
+    }
+
+    public Entry getEntry(String path) {
+        return entries.get(path);
+    }
+
+    /**
+     * Sum of the declared file sizes.
+     *
+     * @return Bytes of the www folder, -1 if a file has no declared size
+     */
+    public long getTotalSize() {
+        long total = 0;
+        for (Entry entry : entries.values()) {
+            if (entry.size < 0) return -1;
+            total += entry.size;
+        }
+        return total;
+    }
+
+    /**
+     * Files to read ahead before the first load of this version (empty if not declared).
+     */
+    public List<String> getWarmupPaths() {
+        return Collections.unmodifiableList(warmupPaths);
+    }
+
+    /**
+     * Get patch archive URL for upgrading from the given version.
+     *
+     * @param fromVersion Currently installed version
+     * @return Patch ZIP URL or null if the server has no patch for this version
+     */
+    public String getPatchUrl(String fromVersion) {
+        return fromVersion != null ? patches.get(fromVersion) : null;
+    }
+
+    /**
+     * Get download URL for a single file.
+     */
+    public String getFileUrl(Entry entry) {
+        return baseUrl + Uri.encode(entry.path, "/");
+    }
+
+    /**
+     * Check if local file has the content described by entry.
+     * Compares size first so that changed files are usually rejected without hashing.
+     *
+     * @param file Local file
+     * @param entry Manifest entry
+     * @return true if file exists with the same size and SHA-256
+     */
+    public static boolean matches(File file, Entry entry) {
+        if (!file.isFile()) return false;
+        if (entry.size >= 0 && file.length() != entry.size) return false;
+
+        String hash = sha256(file);
+        return hash != null && hash.equals(entry.sha256);
+    }
+
+    /**
+     * Check if a bundled asset has the content described by entry.
+     * Used to leave files unchanged since the app bundle out of a delta version.
+     *
+     * @param assets Asset manager of the app
+     * @param assetPath Path in assets ("www/js/app.js")
+     * @param entry Manifest entry
+     * @return true if the asset exists with the same SHA-256
+     */
+    public static boolean matchesAsset(AssetManager assets, String assetPath, Entry entry) {
+        try (InputStream in = assets.open(assetPath)) {
+            return sha256(in).equals(entry.sha256);
+        } catch (IOException e) {
+            return false;
+        }
+    }
+
+    // ============================================================
+    // Private
+    // ============================================================
+
+    private static String resolveUrl(String base, String spec) throws JSONException {
+        try {
+            return new URL(new URL(base), spec).toString();
+        } catch (MalformedURLException e) {
+            throw new JSONException("Invalid URL in manifest: " + spec);
+        }
+    }
+
+    private static boolean isSafeRelativePath(String path) {
+        if (path.isEmpty() || path.startsWith("/") || path.contains("\\")) return false;
+        for (String segment : path.split("/")) {
+            if (segment.isEmpty() || segment.equals(".") || segment.equals("..")) return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,200 @@
+/**
+ * HotUpdatesMetrics.java
+ * Update pipeline timings for Hot Updates Plugin
+ *
+ * Every stage of an update (connection, transfer, validation, extraction,
+ * install, WebView reload, canary) records its duration into a fixed-size
+ * ring buffer shared by the plugin and the background worker. Recording
+ * writes into preallocated arrays only; JSON is built when getMetrics asks.
+ * Samples live in memory and are lost when the process ends.
+ *
+ * Each sample also keeps the free space of the data partition at the stage
+ * end, and getMetrics adds the process memory, so benchmarks can derive peak
+ * disk and memory of an update without sampling threads.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import android.os.Environment;
+import android.os.SystemClock;
+
+import org.json.JSONArray;
+import org.json.JSONException;
+import org.json.JSONObject;
+
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileReader;
+import java.io.IOException;
+
+import static com.getmeback.hotupdates.HotUpdatesConstants.*;
+
+/**
+ * Thread-safe: stages finish on the Cordova, UI, executor and worker threads.
+ */
+public final class HotUpdatesMetrics {
+
+    // Stage ids, index into STAGE_NAMES
+    public static final int STAGE_CONNECT = 0;     // TCP + TLS (includes DNS lookup)
+    public static final int STAGE_TTFB = 1;        // Request sent until response headers
+    public static final int STAGE_DOWNLOAD = 2;    // Response body (streaming: including inline extraction)
+    public static final int STAGE_VALIDATE = 3;    // Pack CRC check, signed manifest check of remaining files
+    public static final int STAGE_EXTRACT = 4;     // Archive extraction
+    public static final int STAGE_COPY = 5;        // Link / copy of files that could not be renamed or reused
+    public static final int STAGE_STAGE = 6;       // Store ingest and move to temp_downloaded_update
+    public static final int STAGE_INSTALL = 7;     // Move to versions/ and pointer switch
+    public static final int STAGE_CACHE_CLEAR = 8; // WebView cache clear before reload
+    public static final int STAGE_RELOAD = 9;      // WebView load until page finished
+    public static final int STAGE_CANARY = 10;     // Canary timer start until canary() call
+    public static final int STAGE_WARMUP = 11;     // Read-ahead of the manifest warm-up list before reload
+
+    private static final String[] STAGE_NAMES = {
+        "connect", "ttfb", "download", "validate", "extract", "copy",
+        "stage", "install", "cacheClear", "reload", "canary", "warmup"
+    };
+
+    private static final HotUpdatesMetrics INSTANCE = new HotUpdatesMetrics(METRICS_CAPACITY);
+
+    // Partition of the files directory (update, versions, store)
+    private static final File DATA_DIR = Environment.getDataDirectory();
+
+    // Ring buffer, guarded by this
+    private final int[] stages;
+    private final long[] timestamps;  // Wall clock of the stage end (ms)
+    private final long[] durations;   // Nanoseconds
+    private final long[] bytes;       // -1 if the stage transfers no data
+    private final long[] freeBytes;   // Usable space of DATA_DIR at the stage end
+    private int next = 0;
+    private int count = 0;
+    private long dropped = 0;  // Overwritten before they were read
+
+    private HotUpdatesMetrics(int capacity) {
+        stages = new int[capacity];
+        timestamps = new long[capacity];
+        durations = new long[capacity];
+        bytes = new long[capacity];
+        freeBytes = new long[capacity];
+    }
+
+    public static HotUpdatesMetrics get() {
+        return INSTANCE;
+    }
+
+    /**
+     * Start time for {@link #record(int, long)} (monotonic).
+     */
+    public static long now() {
+        return SystemClock.elapsedRealtimeNanos();
+    }
+
+    /**
+     * Record stage that started at startTime and ends now.
+     *
+     * @param startTime Value of {@link #now()} when the stage started
+     * @return End time, start of a directly following stage
+     */
+    public static long record(int stage, long startTime) {
+        return record(stage, startTime, -1);
+    }
+
+    /**
+     * Record stage with its byte count.
+     *
+     * @param byteCount Bytes transferred, -1 if not applicable
+     */
+    public static long record(int stage, long startTime, long byteCount) {
+        long end = now();
+        // statfs outside the lock
+        INSTANCE.add(stage, end - startTime, byteCount, DATA_DIR.getUsableSpace());
+        return end;
+    }
+
+    private synchronized void add(int stage, long duration, long byteCount, long free) {
+        stages[next] = stage;
+        timestamps[next] = System.currentTimeMillis();
+        durations[next] = duration;
+        bytes[next] = byteCount;
+        freeBytes[next] = free;
+        next = (next + 1) % stages.length;
+        if (count < stages.length) {
+            count++;
+        } else {
+            dropped++;
+        }
+    }
+
+    /**
+     * Samples in recording order (oldest first).
+     *
+     * @param clear Drop returned samples, so the next call only reports new ones
+     * @return {capacity, dropped, freeBytes, memory: {currentBytes, peakBytes},
+     *         samples: [{stage, durationMs, timestamp, bytes?, freeBytes}]};
+     *         dropped counts samples overwritten since the last clear
+     */
+    public synchronized JSONObject toJSON(boolean clear) throws JSONException {
+        int capacity = stages.length;
+
+        JSONArray samples = new JSONArray();
+        for (int i = 0; i < count; i++) {
+            int slot = (next - count + i + capacity) % capacity;
+            JSONObject sample = new JSONObject();
+            sample.put("stage", STAGE_NAMES[stages[slot]]);
+            sample.put("durationMs", durations[slot] / 1e6);
+            sample.put("timestamp", timestamps[slot]);
+            if (bytes[slot] >= 0) {
+                sample.put("bytes", bytes[slot]);
+            }
+            sample.put("freeBytes", freeBytes[slot]);
+            samples.put(sample);
+        }
+
+        JSONObject result = new JSONObject();
+        result.put("capacity", capacity);
+        result.put("dropped", dropped);
+        result.put("freeBytes", DATA_DIR.getUsableSpace());
+        result.put("memory", getMemory());
+        result.put("samples", samples);
+
+        if (clear) {
+            count = 0;
+            dropped = 0;
+        }
+        return result;
+    }
+
+    /**
+     * Resident set of this process (VmRSS) and its high-water mark since process start (VmHWM).
+     *
+     * @return {currentBytes, peakBytes}, -1 where /proc cannot be read
+     */
+    private static JSONObject getMemory() throws JSONException {
+        long current = -1;
+        long peak = -1;
+        try (BufferedReader reader = new BufferedReader(new FileReader("/proc/self/status"))) {
+            String line;
+            while ((line = reader.readLine()) != null) {
+                if (line.startsWith("VmRSS:")) {
+                    current = parseKilobytes(line);
+                } else if (line.startsWith("VmHWM:")) {
+                    peak = parseKilobytes(line);
+                }
+            }
+        } catch (IOException | NumberFormatException ignored) {
+            // Reported as unknown
+        }
+
+        JSONObject memory = new JSONObject();
+        memory.put("currentBytes", current);
+        memory.put("peakBytes", peak);
+        return memory;
+    }
+
+    // "VmRSS:     12345 kB"
+    private static long parseKilobytes(String line) {
+        String value = line.substring(line.indexOf(':') + 1).trim();
+        int space = value.indexOf(' ');
+        return Long.parseLong(space >= 0 ? value.substring(0, space) : value) * 1024;
+    }
+}
@@ -0,0 +1,273 @@
+/**
+ * HotUpdatesPack.java
+ * Packed bundle (single-file www) for Hot Updates Plugin
+ *
+ * A pack is the update ZIP itself, kept as one file instead of being
+ * extracted. All entries must be stored (no compression), so every file
+ * is a contiguous byte range of the archive and the PathHandler serves it
+ * straight from a memory mapping. Install is one file rename and the
+ * version occupies one inode.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import android.util.Log;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.charset.StandardCharsets;
+import java.security.MessageDigest;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.List;
+import java.util.zip.CRC32;
+import java.util.zip.ZipException;
+
+import static com.getmeback.hotupdates.HotUpdatesConstants.*;
+
+/**
+ * Only entries below the www folder of the archive (root or one level
+ * nested, as for extracted updates) are part of the pack; their paths are
+ * relative to that folder. Zip64 and encrypted archives are not packs.
+ */
+public class HotUpdatesPack {
+
+    private static final int LOCAL_HEADER_SIGNATURE = 0x04034b50;
+    private static final int CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+    private static final int END_OF_CENTRAL_DIR_SIGNATURE = 0x06054b50;
+
+    private static final int LOCAL_HEADER_SIZE = 30;
+    private static final int CENTRAL_HEADER_SIZE = 46;
+    private static final int END_OF_CENTRAL_DIR_SIZE = 22;
+
+    private static final int FLAG_ENCRYPTED = 0x0001;
+    private static final int METHOD_STORED = 0;
+
+    /**
+     * File inside the pack: byte range of the archive.
+     */
+    public static final class Item {
+        public final String path;
+        public final int offset;
+        public final int size;
+        final int crc;
+
+        Item(String path, int offset, int size, int crc) {
+            this.path = path;
+            this.offset = offset;
+            this.size = size;
+            this.crc = crc;
+        }
+    }
+
+    private final MappedByteBuffer buffer;
+    private final List<Item> items;
+
+    private HotUpdatesPack(MappedByteBuffer buffer, List<Item> items) {
+        this.buffer = buffer;
+        this.items = items;
+    }
+
+    /**
+     * Map pack into memory and read its table of contents (central directory).
+     *
+     * @param file Pack or candidate archive
+     * @return Opened pack
+     * @throws ZipException if the archive is not a valid pack (compressed entries, Zip64, no www)
+     * @throws IOException if the file cannot be mapped
+     */
+    public static HotUpdatesPack open(File file) throws IOException {
+        MappedByteBuffer buffer;
+        try (RandomAccessFile raf = new RandomAccessFile(file, "r")) {
+            if (raf.length() > Integer.MAX_VALUE) {
+                throw new ZipException("Archive too large to be used as pack");
+            }
+            // Mapping stays valid after the channel is closed and after the file is unlinked
+            buffer = raf.getChannel().map(FileChannel.MapMode.READ_ONLY, 0, raf.length());
+        }
+        buffer.order(ByteOrder.LITTLE_ENDIAN);
+
+        int eocd = findEndOfCentralDir(buffer);
+        if (eocd < 0) {
+            throw new ZipException("Corrupted ZIP archive (central directory not found)");
+        }
+
+        int entryCount = buffer.getShort(eocd + 10) & 0xFFFF;
+        long cdSize = buffer.getInt(eocd + 12) & 0xFFFFFFFFL;
+        long cdOffset = buffer.getInt(eocd + 16) & 0xFFFFFFFFL;
+        if (entryCount == 0xFFFF || cdSize == 0xFFFFFFFFL || cdOffset == 0xFFFFFFFFL) {
+            throw new ZipException("Zip64 archive cannot be used as pack");
+        }
+        if (cdOffset + cdSize > eocd) {
+            throw new ZipException("Corrupted ZIP archive (invalid central directory)");
+        }
+
+        List<String> names = new ArrayList<>(entryCount);
+        List<int[]> ranges = new ArrayList<>(entryCount);
+        int pos = (int) cdOffset;
+        int cdEnd = (int) (cdOffset + cdSize);
+
+        for (int i = 0; i < entryCount; i++) {
+            if (pos + CENTRAL_HEADER_SIZE > cdEnd || buffer.getInt(pos) != CENTRAL_HEADER_SIGNATURE) {
+                throw new ZipException("Corrupted ZIP archive (invalid central header)");
+            }
+
+            int flags = buffer.getShort(pos + 8) & 0xFFFF;
+            int method = buffer.getShort(pos + 10) & 0xFFFF;
+            int crc = buffer.getInt(pos + 16);
+            long compressedSize = buffer.getInt(pos + 20) & 0xFFFFFFFFL;
+            long size = buffer.getInt(pos + 24) & 0xFFFFFFFFL;
+            int nameLength = buffer.getShort(pos + 28) & 0xFFFF;
+            int extraLength = buffer.getShort(pos + 30) & 0xFFFF;
+            int commentLength = buffer.getShort(pos + 32) & 0xFFFF;
+            long localOffset = buffer.getInt(pos + 42) & 0xFFFFFFFFL;
+
+            if (pos + CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength > cdEnd) {
+                throw new ZipException("Corrupted ZIP archive (invalid central header)");
+            }
+            String name = readString(buffer, pos + CENTRAL_HEADER_SIZE, nameLength);
+            pos += CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength;
+
+            if (name.endsWith("/")) continue;
+
+            if ((flags & FLAG_ENCRYPTED) != 0) {
+                throw new ZipException("Encrypted entry cannot be served from pack: " + name);
+            }
+            if (method != METHOD_STORED || compressedSize != size) {
+                throw new ZipException("Compressed entry cannot be served from pack: " + name);
+            }
+
+            // Data starts after the local header, whose extra field may differ from the central one
+            if (localOffset + LOCAL_HEADER_SIZE > cdOffset || buffer.getInt((int) localOffset) != LOCAL_HEADER_SIGNATURE) {
+                throw new ZipException("Corrupted ZIP entry: " + name);
+            }
+            int local = (int) localOffset;
+            long dataOffset = localOffset + LOCAL_HEADER_SIZE
+                    + (buffer.getShort(local + 26) & 0xFFFF) + (buffer.getShort(local + 28) & 0xFFFF);
+            if (dataOffset + size > cdOffset) {
+                throw new ZipException("Corrupted ZIP entry: " + name);
+            }
+
+            names.add(name);
+            ranges.add(new int[] {(int) dataOffset, (int) size, crc});
+        }
+
+        String prefix = findWwwPrefix(names);
+        if (prefix == null) {
+            throw new ZipException("www folder not found in archive");
+        }
+
+        List<Item> items = new ArrayList<>();
+        for (int i = 0; i < names.size(); i++) {
+            String name = names.get(i);
+            if (name.startsWith(prefix) && name.length() > prefix.length()) {
+                int[] range = ranges.get(i);
+                items.add(new Item(name.substring(prefix.length()), range[0], range[1], range[2]));
+            }
+        }
+
+        return new HotUpdatesPack(buffer, Collections.unmodifiableList(items));
+    }
+
+    /**
+     * Check whether a downloaded archive can be installed as a pack.
+     * Reads every entry once to verify its CRC; an archive that fails here is
+     * installed by extraction instead, which reports the actual error.
+     *
+     * @param file Complete archive on disk
+     * @param verifier Signed manifest, items are hashed in the same pass as the CRC check; null to skip
+     * @return true if the archive is a valid pack containing index.html
+     */
+    public static boolean isServable(File file, HotUpdatesVerifier verifier) {
+        try {
+            HotUpdatesPack pack = open(file);
+            boolean hasIndex = false;
+            CRC32 crc = new CRC32();
+            MessageDigest digest = verifier != null ? HotUpdatesHelpers.newSha256() : null;
+            for (Item item : pack.items) {
+                crc.reset();
+                crc.update(pack.slice(item));
+                if ((int) crc.getValue() != item.crc) {
+                    throw new ZipException("CRC mismatch: " + item.path);
+                }
+                if (verifier != null) {
+                    digest.update(pack.slice(item));
+                    verifier.verifyEntry(DIR_WWW + "/" + item.path, digest.digest());
+                }
+                hasIndex |= item.path.equals(INDEX_HTML);
+            }
+            if (!hasIndex) {
+                throw new ZipException(INDEX_HTML + " not found in archive");
+            }
+            return true;
+        } catch (IOException | RuntimeException e) {
+            // RuntimeException: offsets of a malformed archive outside the mapping
+            Log.d(TAG, "Archive cannot be used as pack (" + e.getMessage() + "), extracting");
+            return false;
+        }
+    }
+
+    public List<Item> getItems() {
+        return items;
+    }
+
+    /**
+     * Read-only view of an item's bytes in the mapping (no copy).
+     */
+    public ByteBuffer slice(Item item) {
+        ByteBuffer view = buffer.duplicate();
+        view.position(item.offset);
+        view.limit(item.offset + item.size);
+        return view.slice();
+    }
+
+    // ============================================================
+    // Private
+    // ============================================================
+
+    private static int findEndOfCentralDir(ByteBuffer buffer) {
+        int length = buffer.capacity();
+        if (length < END_OF_CENTRAL_DIR_SIZE || buffer.getInt(0) != LOCAL_HEADER_SIGNATURE) return -1;
+
+        // EOCD is at the end, followed by a comment of up to 64 KB
+        int minPos = Math.max(0, length - 0xFFFF - END_OF_CENTRAL_DIR_SIZE);
+        for (int i = length - END_OF_CENTRAL_DIR_SIZE; i >= minPos; i--) {
+            if (buffer.getInt(i) == END_OF_CENTRAL_DIR_SIGNATURE) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Same rule as findWwwFolder: www at the archive root, or nested one level.
+     */
+    private static String findWwwPrefix(List<String> names) {
+        String nested = null;
+        for (String name : names) {
+            if (name.startsWith(DIR_WWW + "/")) {
+                return DIR_WWW + "/";
+            }
+            int slash = name.indexOf('/');
+            if (nested == null && slash > 0 && name.startsWith(DIR_WWW + "/", slash + 1)) {
+                nested = name.substring(0, slash + 1) + DIR_WWW + "/";
+            }
+        }
+        return nested;
+    }
+
+    private static String readString(ByteBuffer buffer, int offset, int length) {
+        byte[] bytes = new byte[length];
+        ByteBuffer view = buffer.duplicate();
+        view.position(offset);
+        view.get(bytes);
+        return new String(bytes, StandardCharsets.UTF_8);
+    }
+}
@@ -0,0 +1,252 @@
+/**
+ * HotUpdatesParallelUnzip.java
+ * Multi-core ZIP extraction for Hot Updates Plugin
+ *
+ * Reads the central directory of an archive on disk (random access ZipFile)
+ * and spreads entries over a worker pool sized to the device's core count.
+ * Bundles with thousands of small assets are CPU bound on inflate, a single
+ * ZipInputStream uses one core only.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import android.util.Log;
+
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.security.MessageDigest;
+import java.util.ArrayList;
+import java.util.Enumeration;
+import java.util.LinkedHashSet;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+import java.util.Set;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.zip.CRC32;
+import java.util.zip.ZipEntry;
+import java.util.zip.ZipException;
+import java.util.zip.ZipFile;
+
+import static com.getmeback.hotupdates.HotUpdatesConstants.*;
+import static com.getmeback.hotupdates.HotUpdatesHelpers.*;
+
+/**
+ * Streaming downloads keep using HotUpdatesZipStream; this engine is for
+ * archives that are already complete on disk (segmented, background and
+ * patch downloads).
+ */
+public class HotUpdatesParallelUnzip {
+
+    /**
+     * Extraction result, used for the throughput log line.
+     */
+    public static final class Stats {
+        public final int files;
+        public final long bytes;
+        public final long millis;
+        public final int threads;
+
+        Stats(int files, long bytes, long millis, int threads) {
+            this.files = files;
+            this.bytes = bytes;
+            this.millis = millis;
+            this.threads = threads;
+        }
+
+        /** Uncompressed megabytes written per second */
+        public double getThroughputMBps() {
+            return millis > 0 ? (bytes / (1024.0 * 1024.0)) / (millis / 1000.0) : 0;
+        }
+    }
+
+    /**
+     * Extract ZIP archive using all cores.
+     *
+     * @param zipFile Complete archive on disk
+     * @param destDir Destination directory
+     * @return Extraction statistics
+     * @throws ZipException if the archive is invalid, an entry fails its CRC or escapes destDir
+     * @throws IOException if writing files fails
+     */
+    public static Stats extract(File zipFile, File destDir) throws IOException {
+        return extract(zipFile, destDir, null, HotUpdatesProgress.NONE, null);
+    }
+
+    /**
+     * Extract ZIP archive using all cores, hashing every entry while it is inflated,
+     * and report written bytes as the extracting phase. The digests are collected,
+     * so staging does not read the files again (see {@link HotUpdatesStore#ingest}).
+     *
+     * @param verifier Signed manifest to check entries against, null to skip
+     * @param progress Reporter, total is the uncompressed size of all entries
+     * @param hashes Filled with SHA-256 hex by absolute file path; written by all workers,
+     *               so it must be thread-safe. Null to hash only for the verifier
+     * @throws IOException "Hash mismatch: ..." if an entry does not match the manifest
+     */
+    public static Stats extract(File zipFile, File destDir, HotUpdatesVerifier verifier,
+                                HotUpdatesProgress progress, Map<String, String> hashes) throws IOException {
+        if (!isValidZipFile(zipFile)) {
+            throw new ZipException("Invalid file format (not a ZIP archive)");
+        }
+
+        long startTime = System.currentTimeMillis();
+        String canonicalDestPath = destDir.getCanonicalPath() + File.separator;
+
+        try (ZipFile zip = new ZipFile(zipFile)) {
+            List<ZipEntry> files = new ArrayList<>();
+            Set<File> dirs = new LinkedHashSet<>();
+
+            Enumeration<? extends ZipEntry> entries = zip.entries();
+            while (entries.hasMoreElements()) {
+                ZipEntry entry = entries.nextElement();
+                File outFile = new File(destDir, entry.getName());
+
+                // Security: prevent path traversal
+                if (!outFile.getCanonicalPath().startsWith(canonicalDestPath)
+                        && !(outFile.getCanonicalPath() + File.separator).equals(canonicalDestPath)) {
+                    throw new ZipException("ZIP entry outside destination directory: " + entry.getName());
+                }
+
+                if (entry.isDirectory()) {
+                    dirs.add(outFile);
+                } else {
+                    files.add(entry);
+                    dirs.add(outFile.getParentFile());
+                }
+            }
+
+            // Create all directories once, before workers start writing
+            for (File dir : dirs) {
+                dir.mkdirs();
+            }
+
+            // Largest entries first, so one big file does not finish last on a single core
+            files.sort((a, b) -> Long.compare(b.getCompressedSize(), a.getCompressedSize()));
+
+            long totalSize = 0;
+            for (ZipEntry entry : files) {
+                totalSize = entry.getSize() >= 0 && totalSize >= 0 ? totalSize + entry.getSize() : -1;
+            }
+            progress.startPhase(PROGRESS_PHASE_EXTRACTING, 0, totalSize);
+
+            int threads = Math.max(1, Math.min(Runtime.getRuntime().availableProcessors(), files.size()));
+            AtomicInteger next = new AtomicInteger();
+            AtomicLong written = new AtomicLong();
+
+            ExecutorService pool = Executors.newFixedThreadPool(threads);
+            try {
+                List<Future<?>> futures = new ArrayList<>();
+                for (int i = 0; i < threads; i++) {
+                    futures.add(pool.submit(() -> {
+                        // One buffer and digest per worker, reused for all of its entries
+                        byte[] buffer = HotUpdatesBuffers.acquire();
+                        MessageDigest digest = verifier != null || hashes != null ? newSha256() : null;
+                        try {
+                            int index;
+                            while ((index = next.getAndIncrement()) < files.size()) {
+                                ZipEntry entry = files.get(index);
+                                long entryBytes = extractEntry(zip, entry, destDir, buffer, digest);
+                                written.addAndGet(entryBytes);
+                                progress.add(entryBytes);
+                                if (digest == null) continue;
+
+                                byte[] hash = digest.digest();
+                                if (verifier != null) {
+                                    verifier.verifyEntry(entry.getName(), hash);
+                                }
+                                if (hashes != null) {
+                                    hashes.put(new File(destDir, entry.getName()).getAbsolutePath(), toHex(hash));
+                                }
+                            }
+                        } finally {
+                            HotUpdatesBuffers.release(buffer);
+                        }
+                        return null;
+                    }));
+                }
+
+                for (Future<?> future : futures) {
+                    future.get();
+                }
+            } catch (ExecutionException e) {
+                Throwable cause = e.getCause();
+                throw cause instanceof IOException ? (IOException) cause : new IOException(cause);
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+                throw new IOException("Extraction interrupted");
+            } finally {
+                // On failure the caller closes the archive and deletes destDir:
+                // no worker may still be writing by then
+                next.set(files.size());
+                pool.shutdownNow();
+                awaitTermination(pool);
+            }
+
+            Stats stats = new Stats(files.size(), written.get(), System.currentTimeMillis() - startTime, threads);
+            Log.d(TAG, String.format(Locale.US, "Extracted %d files (%d KB) in %d ms on %d threads, %.1f MB/s",
+                    stats.files, stats.bytes / 1024, stats.millis, stats.threads, stats.getThroughputMBps()));
+            return stats;
+        }
+    }
+
+    // ============================================================
+    // Private
+    // ============================================================
+
+    /**
+     * Wait until every worker has finished its current entry, also if interrupted meanwhile.
+     */
+    private static void awaitTermination(ExecutorService pool) {
+        boolean interrupted = false;
+        while (true) {
+            try {
+                if (pool.awaitTermination(1, TimeUnit.SECONDS)) break;
+            } catch (InterruptedException e) {
+                interrupted = true;
+            }
+        }
+        if (interrupted) {
+            Thread.currentThread().interrupt();
+        }
+    }
+
+    /**
+     * Inflate one entry. ZipFile serializes reads of the underlying file,
+     * so workers run in parallel on inflate and write.
+     *
+     * @param digest Updated with the inflated bytes, null to skip hashing
+     * @return Bytes written
+     */
+    private static long extractEntry(ZipFile zip, ZipEntry entry, File destDir, byte[] buffer,
+                                     MessageDigest digest) throws IOException {
+        CRC32 crc = new CRC32();
+        long total = 0;
+
+        try (InputStream input = zip.getInputStream(entry);
+             FileOutputStream output = new FileOutputStream(new File(destDir, entry.getName()))) {
+            int bytesRead;
+            while ((bytesRead = input.read(buffer)) != -1) {
+                crc.update(buffer, 0, bytesRead);
+                if (digest != null) digest.update(buffer, 0, bytesRead);
+                output.write(buffer, 0, bytesRead);
+                total += bytesRead;
+            }
+        }
+
+        if (entry.getCrc() != -1 && crc.getValue() != entry.getCrc()) {
+            throw new ZipException("CRC mismatch: " + entry.getName());
+        }
+        return total;
+    }
+}
@@ -0,0 +1,308 @@
+/**
+ * HotUpdatesPathIndex.java
+ * In-memory file index of the served version for Hot Updates Plugin
+ *
+ * The PathHandler is hit for every module, stylesheet and image the WebView
+ * loads. Walking the www tree once per installed version and resolving
+ * requests from a map avoids prefs reads, stat calls and path
+ * canonicalisation on each of them.
+ *
+ * A file shipped only as "app.js.gz" (or next to "app.js") is indexed as
+ * "app.js" and inflated while it is streamed, so large bundles stay
+ * compressed on disk and are read from flash at their compressed size.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import android.util.Log;
+import android.webkit.MimeTypeMap;
+
+import java.io.BufferedInputStream;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.Locale;
+import java.util.Map;
+import java.util.zip.GZIPInputStream;
+
+import static com.getmeback.hotupdates.HotUpdatesConstants.*;
+
+/**
+ * Only regular files found under the www directory (or items of its pack) are
+ * indexed, so a request for a directory, a missing file or a path escaping www
+ * (../) simply misses the map and falls through to the Cordova default handler.
+ * The index is immutable; a version switch builds a new one.
+ */
+public class HotUpdatesPathIndex {
+
+    private static final int STREAM_BUFFER_SIZE = 32 * 1024;
+
+    private static final String GZIP_SUFFIX = ".gz";
+    private static final int GZIP_MAGIC = 0x8b1f;
+    private static final int GZIP_MIN_SIZE = 18; // 10 byte header + 8 byte trailer
+
+    private static final Map<String, String> MIME_TYPES = new HashMap<>();
+
+    static {
+        MIME_TYPES.put("js", "application/javascript");
+        MIME_TYPES.put("mjs", "application/javascript");
+        MIME_TYPES.put("wasm", "application/wasm");
+        MIME_TYPES.put("html", "text/html");
+        MIME_TYPES.put("htm", "text/html");
+        MIME_TYPES.put("css", "text/css");
+        MIME_TYPES.put("json", "application/json");
+        MIME_TYPES.put("map", "application/json");
+        MIME_TYPES.put("svg", "image/svg+xml");
+        MIME_TYPES.put("png", "image/png");
+        MIME_TYPES.put("jpg", "image/jpeg");
+        MIME_TYPES.put("jpeg", "image/jpeg");
+        MIME_TYPES.put("gif", "image/gif");
+        MIME_TYPES.put("webp", "image/webp");
+        MIME_TYPES.put("ico", "image/x-icon");
+        MIME_TYPES.put("woff", "font/woff");
+        MIME_TYPES.put("woff2", "font/woff2");
+        MIME_TYPES.put("ttf", "font/ttf");
+        MIME_TYPES.put("otf", "font/otf");
+        MIME_TYPES.put("txt", "text/plain");
+        MIME_TYPES.put("xml", "application/xml");
+        MIME_TYPES.put("mp3", "audio/mpeg");
+        MIME_TYPES.put("mp4", "video/mp4");
+    }
+
+    /**
+     * Indexed file. MIME type and headers are resolved at build time.
+     */
+    public static final class Entry {
+        public final File file;
+        public final long offset;       // Byte offset in file (non-zero for pack items)
+        public final long size;         // Served (inflated) size
+        public final String mimeType;
+        public final Map<String, String> headers;
+        public final boolean gzip;      // Stored as .gz, inflated in open()
+        private final ByteBuffer data;  // Slice of the pack mapping, null for loose files
+
+        Entry(File file, long offset, long size, String mimeType, boolean gzip, ByteBuffer data) {
+            this.file = file;
+            this.offset = offset;
+            this.size = size;
+            this.mimeType = mimeType;
+            this.gzip = gzip;
+            this.data = data;
+
+            // Content at a URL changes with every version - never let the WebView reuse it
+            Map<String, String> headers = new HashMap<>();
+            headers.put("Content-Length", String.valueOf(size));
+            headers.put("Cache-Control", "no-cache");
+            this.headers = Collections.unmodifiableMap(headers);
+        }
+
+        /**
+         * Open stream of the content: mapped bytes of a pack item, or a buffered file stream.
+         * Compressed entries are inflated here: WebView does not apply Content-Encoding
+         * to responses of a PathHandler.
+         */
+        public InputStream open() throws IOException {
+            InputStream stream = data != null
+                    ? new ByteBufferInputStream(data.duplicate())
+                    : new FileInputStream(file);
+            if (gzip) {
+                return new GZIPInputStream(stream, STREAM_BUFFER_SIZE);
+            }
+            return data != null ? stream : new BufferedInputStream(stream, STREAM_BUFFER_SIZE);
+        }
+    }
+
+    private final String dirName;
+    private final Map<String, Entry> entries;
+
+    private HotUpdatesPathIndex(String dirName, Map<String, Entry> entries) {
+        this.dirName = dirName;
+        this.entries = entries;
+    }
+
+    /**
+     * Walk www directory of a version once and index all regular files.
+     *
+     * @param wwwDir www directory to index
+     * @param dirName Version directory name the index belongs to
+     * @return Index keyed by path relative to wwwDir ("js/app.js")
+     */
+    public static HotUpdatesPathIndex build(File wwwDir, String dirName) {
+        long startTime = System.currentTimeMillis();
+        Map<String, Entry> entries = new HashMap<>();
+        addDirectory(wwwDir, "", entries);
+
+        Log.d(TAG, "Path index built: " + entries.size() + " files in "
+                + (System.currentTimeMillis() - startTime) + " ms");
+        return new HotUpdatesPathIndex(dirName, entries);
+    }
+
+    /**
+     * Index items of a packed version. Items are served from one shared read-only mapping.
+     *
+     * @param packFile Pack file in the www directory of the version
+     * @param dirName Version directory name the index belongs to
+     * @throws IOException if the pack cannot be mapped or is invalid
+     */
+    public static HotUpdatesPathIndex buildFromPack(File packFile, String dirName) throws IOException {
+        long startTime = System.currentTimeMillis();
+        HotUpdatesPack pack = HotUpdatesPack.open(packFile);
+
+        Map<String, Entry> entries = new HashMap<>();
+        for (HotUpdatesPack.Item item : pack.getItems()) {
+            ByteBuffer slice = pack.slice(item);
+            putUnlessCompressed(entries, item.path,
+                    new Entry(packFile, item.offset, item.size, getMimeType(item.path), false, slice));
+
+            long inflatedSize = item.path.endsWith(GZIP_SUFFIX) ? readGzipSize(slice) : -1;
+            if (inflatedSize >= 0) {
+                String path = stripGzipSuffix(item.path);
+                entries.put(path, new Entry(packFile, item.offset, inflatedSize, getMimeType(path), true, slice));
+            }
+        }
+
+        Log.d(TAG, "Path index built from pack: " + entries.size() + " files in "
+                + (System.currentTimeMillis() - startTime) + " ms");
+        return new HotUpdatesPathIndex(dirName, entries);
+    }
+
+    /**
+     * @param path Request path relative to the WebView origin, without leading slash
+     * @return Entry, or null if the version has no such file
+     */
+    public Entry get(String path) {
+        return entries.get(path);
+    }
+
+    public String getDirName() {
+        return dirName;
+    }
+
+    public int size() {
+        return entries.size();
+    }
+
+    /**
+     * MIME type for a file name: lookup table first, platform map for the rest.
+     */
+    public static String getMimeType(String name) {
+        int dot = name.lastIndexOf('.');
+        if (dot < 0 || dot < name.lastIndexOf('/')) return "application/octet-stream";
+
+        String extension = name.substring(dot + 1).toLowerCase(Locale.US);
+        String mime = MIME_TYPES.get(extension);
+        if (mime == null) {
+            mime = MimeTypeMap.getSingleton().getMimeTypeFromExtension(extension);
+        }
+        return mime != null ? mime : "application/octet-stream";
+    }
+
+    // ============================================================
+    // Private
+    // ============================================================
+
+    private static void addDirectory(File dir, String prefix, Map<String, Entry> entries) {
+        File[] children = dir.listFiles();
+        if (children == null) return;
+
+        for (File child : children) {
+            String path = prefix + child.getName();
+            if (child.isDirectory()) {
+                addDirectory(child, path + "/", entries);
+                continue;
+            }
+
+            // Plain file never replaces its compressed sibling, listing order is undefined
+            putUnlessCompressed(entries, path, new Entry(child, 0, child.length(), getMimeType(path), false, null));
+
+            long inflatedSize = path.endsWith(GZIP_SUFFIX) ? readGzipSize(child) : -1;
+            if (inflatedSize >= 0) {
+                String plainPath = stripGzipSuffix(path);
+                entries.put(plainPath, new Entry(child, 0, inflatedSize, getMimeType(plainPath), true, null));
+            }
+        }
+    }
+
+    private static void putUnlessCompressed(Map<String, Entry> entries, String path, Entry entry) {
+        Entry existing = entries.get(path);
+        if (existing == null || !existing.gzip) {
+            entries.put(path, entry);
+        }
+    }
+
+    private static String stripGzipSuffix(String path) {
+        return path.substring(0, path.length() - GZIP_SUFFIX.length());
+    }
+
+    /**
+     * Inflated size from the gzip trailer (ISIZE), -1 if the file is not gzip.
+     */
+    private static long readGzipSize(File file) {
+        try (RandomAccessFile raf = new RandomAccessFile(file, "r")) {
+            long length = raf.length();
+            if (length < GZIP_MIN_SIZE) return -1;
+
+            byte[] header = new byte[2];
+            byte[] trailer = new byte[4];
+            raf.readFully(header);
+            raf.seek(length - 4);
+            raf.readFully(trailer);
+            return readGzipSize(ByteBuffer.wrap(header), ByteBuffer.wrap(trailer));
+        } catch (IOException e) {
+            Log.w(TAG, "Cannot read gzip trailer of " + file.getName() + ": " + e.getMessage());
+            return -1;
+        }
+    }
+
+    private static long readGzipSize(ByteBuffer slice) {
+        if (slice.remaining() < GZIP_MIN_SIZE) return -1;
+        ByteBuffer trailer = slice.duplicate();
+        trailer.position(trailer.limit() - 4);
+        return readGzipSize(slice.duplicate(), trailer.slice());
+    }
+
+    private static long readGzipSize(ByteBuffer header, ByteBuffer trailer) {
+        header.order(ByteOrder.LITTLE_ENDIAN);
+        trailer.order(ByteOrder.LITTLE_ENDIAN);
+        if ((header.getShort(0) & 0xFFFF) != GZIP_MAGIC) return -1;
+        return trailer.getInt(0) & 0xFFFFFFFFL;
+    }
+
+    /**
+     * Stream over a mapped slice; reads copy from the page cache without syscalls.
+     */
+    private static final class ByteBufferInputStream extends InputStream {
+        private final ByteBuffer buffer;
+
+        ByteBufferInputStream(ByteBuffer buffer) {
+            this.buffer = buffer;
+        }
+
+        @Override
+        public int read() {
+            return buffer.hasRemaining() ? buffer.get() & 0xFF : -1;
+        }
+
+        @Override
+        public int read(byte[] bytes, int offset, int length) {
+            if (length == 0) return 0;
+            if (!buffer.hasRemaining()) return -1;
+            int count = Math.min(length, buffer.remaining());
+            buffer.get(bytes, offset, count);
+            return count;
+        }
+
+        @Override
+        public int available() {
+            return buffer.remaining();
+        }
+    }
+}
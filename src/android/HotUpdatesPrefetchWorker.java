@@ -0,0 +1,130 @@
+/**
+ * HotUpdatesPrefetchWorker.java
+ * Background update check for Hot Updates Plugin
+ *
+ * Periodic WorkManager work (unmetered network, charging, idle) that asks the
+ * check API configured as HotUpdatesPrefetchUrl for a newer version and
+ * queues its ZIP as a background download. The download is staged like any
+ * other, so the update is installed at the next launch without network.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import android.content.Context;
+import android.content.pm.PackageManager;
+import android.util.Log;
+
+import androidx.annotation.NonNull;
+import androidx.work.ExistingWorkPolicy;
+import androidx.work.WorkInfo;
+import androidx.work.WorkManager;
+import androidx.work.Worker;
+import androidx.work.WorkerParameters;
+
+import org.apache.cordova.ConfigXmlParser;
+import org.json.JSONException;
+import org.json.JSONObject;
+
+import java.io.IOException;
+import java.util.Collections;
+import java.util.List;
+
+import static com.getmeback.hotupdates.HotUpdatesConstants.*;
+
+/**
+ * Check API request and filtering: HotUpdatesUpdateCheck. A failed check waits for the
+ * next period, it is not retried.
+ */
+public class HotUpdatesPrefetchWorker extends Worker {
+
+    public HotUpdatesPrefetchWorker(@NonNull Context context, @NonNull WorkerParameters params) {
+        super(context, params);
+    }
+
+    @NonNull
+    @Override
+    public Result doWork() {
+        // The worker may run without the plugin, so config.xml is parsed here
+        ConfigXmlParser parser = new ConfigXmlParser();
+        parser.parse(getApplicationContext());
+        String checkURL = parser.getPreferences().getString(CONFIG_PREFETCH_URL, null);
+        if (checkURL == null || checkURL.isEmpty()) {
+            return Result.success();
+        }
+
+        HotUpdatesState state = HotUpdatesState.get(getApplicationContext());
+        String appVersion = getAppVersion();
+        String currentVersion = state.getString(PREF_INSTALLED_VERSION, appVersion);
+
+        try {
+            HotUpdatesUpdateCheck check = HotUpdatesUpdateCheck.fetch(state, checkURL, currentVersion);
+            HotUpdatesState.Snapshot snapshot = state.snapshot();
+            JSONObject update = check.evaluate(snapshot, currentVersion, appVersion,
+                    snapshot.getStringSet(PREF_IGNORE_LIST, Collections.emptySet()));
+
+            String version = update.optString("version");
+            String downloadURL = update.optString("url", "");
+            if (!update.optBoolean("hasUpdate")) {
+                Log.d(TAG, "Prefetch: no update for v" + currentVersion + " (" + update.optString("reason") + ")");
+                return Result.success();
+            }
+            if (update.optBoolean("ready") || downloadURL.isEmpty()) {
+                // Staged already, or a delta update (many small requests, foreground only)
+                Log.d(TAG, "Prefetch: v" + version + " not downloaded in background");
+                return Result.success();
+            }
+
+            boolean packed = update.optBoolean("packed");
+            String verifyManifestURL = update.optString("verifyManifestUrl", null);
+
+            HotUpdates plugin = HotUpdates.getActiveInstance();
+            if (plugin != null) {
+                // App is running: the plugin coordinates the download with calls from JavaScript
+                plugin.prefetch(version, downloadURL, packed, verifyManifestURL);
+            } else {
+                enqueueDownload(state, version, downloadURL, packed, verifyManifestURL);
+            }
+            return Result.success();
+
+        } catch (IOException | JSONException e) {
+            Log.w(TAG, "Prefetch check failed: " + e.getMessage());
+            return Result.success();
+        }
+    }
+
+    /**
+     * Queue the background download directly; the plugin re-attaches to it on the next launch.
+     * A background download that is already queued (getUpdate from JavaScript) is kept.
+     */
+    private void enqueueDownload(HotUpdatesState state, String version, String downloadURL,
+                                 boolean packed, String verifyManifestURL) throws IOException {
+        WorkManager workManager = WorkManager.getInstance(getApplicationContext());
+        try {
+            List<WorkInfo> infos = workManager.getWorkInfosForUniqueWork(BACKGROUND_WORK_NAME).get();
+            for (WorkInfo info : infos) {
+                if (!info.getState().isFinished()) {
+                    Log.d(TAG, "Prefetch of v" + version + " skipped, background download in progress");
+                    return;
+                }
+            }
+        } catch (Exception e) {
+            throw new IOException("Failed to query background downloads: " + e.getMessage());
+        }
+
+        state.edit().putString(PREF_BACKGROUND_VERSION, version).apply();
+        workManager.enqueueUniqueWork(BACKGROUND_WORK_NAME, ExistingWorkPolicy.KEEP,
+                HotUpdatesDownloadWorker.buildRequest(downloadURL, version, 1, packed, verifyManifestURL, true, true));
+        Log.d(TAG, "Prefetching v" + version + " in background");
+    }
+
+    private String getAppVersion() {
+        Context context = getApplicationContext();
+        try {
+            return context.getPackageManager().getPackageInfo(context.getPackageName(), 0).versionName;
+        } catch (PackageManager.NameNotFoundException e) {
+            return "1.0.0";
+        }
+    }
+}
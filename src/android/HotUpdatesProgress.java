@@ -0,0 +1,122 @@
+/**
+ * HotUpdatesProgress.java
+ * Throttled progress reporting for Hot Updates Plugin
+ *
+ * Transfer and extraction code counts bytes into a reporter; the reporter
+ * computes rate and ETA and calls its listener at most once per
+ * PROGRESS_INTERVAL_MS, so a fast download does not flood the Cordova bridge.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import android.os.SystemClock;
+
+import java.io.FilterInputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.util.concurrent.atomic.AtomicLong;
+
+import static com.getmeback.hotupdates.HotUpdatesConstants.*;
+
+/**
+ * Thread-safe: segmented downloads and parallel extraction count bytes from
+ * several workers at once.
+ */
+public class HotUpdatesProgress {
+
+    public interface Listener {
+        /**
+         * @param phase One of PROGRESS_PHASE_*
+         * @param bytes Bytes processed in this phase (received, or written for extraction)
+         * @param totalBytes Expected bytes of the phase, -1 if unknown
+         * @param bytesPerSecond Average rate since the phase started
+         * @param etaSeconds Estimated time left, -1 if unknown
+         */
+        void onProgress(String phase, long bytes, long totalBytes, long bytesPerSecond, long etaSeconds);
+    }
+
+    /** Reporter without listener, counting is a no-op */
+    public static final HotUpdatesProgress NONE = new HotUpdatesProgress(null);
+
+    private final Listener listener;
+    private final AtomicLong bytes = new AtomicLong();
+    private volatile long nextReportTime;
+
+    // Guarded by this
+    private String phase;
+    private long totalBytes = -1;
+    private long phaseStartBytes;
+    private long phaseStartTime;
+
+    public HotUpdatesProgress(Listener listener) {
+        this.listener = listener;
+    }
+
+    /**
+     * Enter a phase. Reported at once, regardless of the interval.
+     *
+     * @param bytes Bytes already done (resume offset of a continued download)
+     * @param totalBytes Expected bytes, -1 if unknown
+     */
+    public void startPhase(String phase, long bytes, long totalBytes) {
+        if (listener == null) return;
+        synchronized (this) {
+            this.phase = phase;
+            this.bytes.set(bytes);
+            this.totalBytes = totalBytes;
+            this.phaseStartBytes = bytes;
+            this.phaseStartTime = SystemClock.elapsedRealtime();
+            report(phaseStartTime);
+        }
+    }
+
+    /**
+     * Count processed bytes of the current phase.
+     */
+    public void add(long count) {
+        if (listener == null) return;
+        bytes.addAndGet(count);
+
+        long now = SystemClock.elapsedRealtime();
+        if (now < nextReportTime) return;
+        synchronized (this) {
+            if (now < nextReportTime) return;
+            report(now);
+        }
+    }
+
+    /**
+     * Count every byte read from input as received.
+     */
+    public InputStream wrap(InputStream input) {
+        if (listener == null) return input;
+        return new FilterInputStream(input) {
+            @Override
+            public int read() throws IOException {
+                int b = super.read();
+                if (b != -1) add(1);
+                return b;
+            }
+
+            @Override
+            public int read(byte[] buffer, int offset, int length) throws IOException {
+                int n = super.read(buffer, offset, length);
+                if (n > 0) add(n);
+                return n;
+            }
+        };
+    }
+
+    // Caller holds the lock
+    private void report(long now) {
+        nextReportTime = now + PROGRESS_INTERVAL_MS;
+
+        long current = bytes.get();
+        long elapsed = now - phaseStartTime;
+        long rate = elapsed > 0 ? (current - phaseStartBytes) * 1000 / elapsed : 0;
+        long eta = totalBytes >= 0 && rate > 0 ? (Math.max(0, totalBytes - current) + rate - 1) / rate : -1;
+        listener.onProgress(phase, current, totalBytes, rate, eta);
+    }
+}
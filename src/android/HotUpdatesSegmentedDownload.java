@@ -0,0 +1,231 @@
+/**
+ * HotUpdatesSegmentedDownload.java
+ * Parallel multi-connection download for Hot Updates Plugin
+ *
+ * Splits the archive into byte ranges fetched over several connections at
+ * once and writes every range straight into a preallocated file at its
+ * offset. On high-latency links one TCP stream leaves most of the bandwidth
+ * unused; a few concurrent streams fill it.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import android.util.Log;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.RandomAccessFile;
+import java.net.HttpURLConnection;
+import java.net.URL;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+
+import static com.getmeback.hotupdates.HotUpdatesConstants.*;
+import static com.getmeback.hotupdates.HotUpdatesHelpers.*;
+
+/**
+ * Every segment is checked: the server must answer 206 with exactly the requested
+ * range while the validator of the probe still matches (If-Range), and deliver
+ * exactly the requested number of bytes. Content itself is verified by ZIP CRCs
+ * during extraction.
+ */
+public class HotUpdatesSegmentedDownload {
+
+    private final String url;
+    private final File dest;
+    private final long totalSize;
+    private final String validator;
+    private final int connections;
+
+    private final List<HttpURLConnection> activeConnections = new ArrayList<>();
+    private volatile boolean cancelled;
+    private HotUpdatesProgress progress = HotUpdatesProgress.NONE;
+
+    private HotUpdatesSegmentedDownload(String url, File dest, long totalSize, String validator, int connections) {
+        this.url = url;
+        this.dest = dest;
+        this.totalSize = totalSize;
+        this.validator = validator;
+        this.connections = connections;
+    }
+
+    /**
+     * Probe the server with a one-byte range request.
+     *
+     * @param url Archive URL
+     * @param dest File to download into
+     * @param connections Requested number of parallel connections
+     * @return Download ready to start, or null if the server cannot serve ranges
+     *         or the archive is too small to benefit (caller uses a single stream)
+     * @throws IOException with "HTTP error: N" message if the server rejects the request
+     */
+    public static HotUpdatesSegmentedDownload prepare(String url, File dest, int connections) throws IOException {
+        HttpURLConnection connection = openSegment(url, 0, 0, null);
+        try {
+            int responseCode = connection.getResponseCode();
+            if (responseCode != HttpURLConnection.HTTP_PARTIAL) {
+                if (responseCode != HttpURLConnection.HTTP_OK) {
+                    throw new IOException("HTTP error: " + responseCode);
+                }
+                return null;
+            }
+
+            long totalSize = getContentRangeTotal(connection);
+            String validator = getValidator(connection);
+            if (totalSize < SEGMENTED_MIN_SIZE_BYTES || validator == null) {
+                // Without a validator segments could mix two versions of the archive
+                return null;
+            }
+
+            int count = Math.min(connections, MAX_DOWNLOAD_CONNECTIONS);
+            return new HotUpdatesSegmentedDownload(url, dest, totalSize, validator, count);
+        } finally {
+            connection.disconnect();
+        }
+    }
+
+    public long getTotalSize() {
+        return totalSize;
+    }
+
+    /**
+     * Count received bytes of all segments into this reporter.
+     */
+    public void setProgress(HotUpdatesProgress progress) {
+        this.progress = progress != null ? progress : HotUpdatesProgress.NONE;
+    }
+
+    /**
+     * Download all segments in parallel. The destination is preallocated to the full size.
+     *
+     * @throws IOException if any segment fails (remaining segments are aborted)
+     */
+    public void download() throws IOException {
+        Log.d(TAG, "Segmented download: " + totalSize + " bytes over " + connections + " connections");
+
+        progress.startPhase(PROGRESS_PHASE_DOWNLOADING, 0, totalSize);
+
+        ExecutorService pool = Executors.newFixedThreadPool(connections);
+        try (RandomAccessFile file = new RandomAccessFile(dest, "rw")) {
+            file.setLength(totalSize);
+            FileChannel channel = file.getChannel();
+
+            long segmentSize = (totalSize + connections - 1) / connections;
+            List<Future<?>> futures = new ArrayList<>();
+            for (long start = 0; start < totalSize; start += segmentSize) {
+                long end = Math.min(start + segmentSize, totalSize) - 1;
+                long segmentStart = start;
+                futures.add(pool.submit(() -> {
+                    downloadSegment(channel, segmentStart, end);
+                    return null;
+                }));
+            }
+
+            for (Future<?> future : futures) {
+                try {
+                    future.get();
+                } catch (ExecutionException e) {
+                    cancel();
+                    Throwable cause = e.getCause();
+                    throw cause instanceof IOException ? (IOException) cause : new IOException(cause);
+                } catch (InterruptedException e) {
+                    cancel();
+                    Thread.currentThread().interrupt();
+                    throw new IOException("Download interrupted");
+                }
+            }
+        } finally {
+            pool.shutdownNow();
+        }
+    }
+
+    /**
+     * Abort all running segments.
+     */
+    public void cancel() {
+        cancelled = true;
+        synchronized (activeConnections) {
+            for (HttpURLConnection connection : activeConnections) {
+                connection.disconnect();
+            }
+        }
+    }
+
+    // ============================================================
+    // Private
+    // ============================================================
+
+    private void downloadSegment(FileChannel channel, long start, long end) throws IOException {
+        if (cancelled) throw new IOException("Download cancelled");
+
+        HttpURLConnection connection = openSegment(url, start, end, validator);
+        synchronized (activeConnections) {
+            activeConnections.add(connection);
+        }
+
+        try {
+            int responseCode = connection.getResponseCode();
+            if (responseCode == HttpURLConnection.HTTP_OK) {
+                // If-Range failed: archive changed on the server since the probe
+                throw new IOException("Archive changed during download");
+            }
+            if (responseCode != HttpURLConnection.HTTP_PARTIAL) {
+                throw new IOException("HTTP error: " + responseCode);
+            }
+            if (getContentRangeStart(connection) != start) {
+                throw new IOException("Unexpected range for segment at " + start);
+            }
+
+            long position = start;
+            byte[] buffer = HotUpdatesBuffers.acquire();
+            try (InputStream input = connection.getInputStream()) {
+                int bytesRead;
+                while ((bytesRead = input.read(buffer)) != -1) {
+                    if (position + bytesRead > end + 1) {
+                        throw new IOException("Segment at " + start + " longer than requested");
+                    }
+                    ByteBuffer data = ByteBuffer.wrap(buffer, 0, bytesRead);
+                    while (data.hasRemaining()) {
+                        position += channel.write(data, position);
+                    }
+                    progress.add(bytesRead);
+                }
+            } finally {
+                HotUpdatesBuffers.release(buffer);
+            }
+
+            if (position != end + 1) {
+                throw new IOException("Segment at " + start + " incomplete: "
+                        + (position - start) + " of " + (end - start + 1) + " bytes");
+            }
+        } finally {
+            synchronized (activeConnections) {
+                activeConnections.remove(connection);
+            }
+            connection.disconnect();
+        }
+    }
+
+    private static HttpURLConnection openSegment(String url, long start, long end, String validator) throws IOException {
+        HttpURLConnection connection = (HttpURLConnection) new URL(url).openConnection();
+        connection.setConnectTimeout(HTTP_CONNECT_TIMEOUT_MS);
+        connection.setReadTimeout(HTTP_READ_TIMEOUT_MS);
+        // Byte offsets must refer to the archive itself, not a compressed transfer
+        connection.setRequestProperty("Accept-Encoding", "identity");
+        connection.setRequestProperty("Range", "bytes=" + start + "-" + end);
+        if (validator != null) {
+            connection.setRequestProperty("If-Range", validator);
+        }
+        connectTimed(connection);
+        return connection;
+    }
+}
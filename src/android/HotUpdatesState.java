@@ -0,0 +1,321 @@
+/**
+ * HotUpdatesState.java
+ * Persistent plugin state for Hot Updates Plugin
+ *
+ * All state (version pointers, pending update, ignore list, history, resume
+ * data) is one map kept in memory and saved as one JSON file. Each state
+ * transition collects its changes in an {@link Editor} and is written once
+ * through {@link AtomicFile} (temporary file + rename + fsync): after a crash
+ * the file holds either the old or the new key set, never a mix.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import android.content.Context;
+import android.content.SharedPreferences;
+import android.util.AtomicFile;
+import android.util.Log;
+
+import org.json.JSONArray;
+import org.json.JSONException;
+import org.json.JSONObject;
+
+import java.io.File;
+import java.io.FileNotFoundException;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.Iterator;
+import java.util.Map;
+import java.util.Objects;
+import java.util.Set;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.atomic.AtomicBoolean;
+
+import static com.getmeback.hotupdates.HotUpdatesConstants.*;
+
+/**
+ * Keys are the former SharedPreferences keys (PREF_*); values stored there by
+ * older plugin versions are moved into the file on first use. One instance per
+ * process, shared by the plugin and the background download worker, and
+ * independent of the Activity lifecycle.
+ *
+ * Reads are lock-free: values are an immutable snapshot published through a
+ * volatile field, replaced (copy-on-write) by every transition. WebView request
+ * threads can read state without contending with a running install.
+ */
+public class HotUpdatesState {
+
+    private static HotUpdatesState instance;
+
+    private final AtomicFile file;
+    // Writers replace it under the lock, readers never lock
+    private volatile Snapshot current = new Snapshot(Collections.emptyMap());
+
+    // apply(): writes coalesce, a pending write always saves the latest values
+    private final ExecutorService writer = Executors.newSingleThreadExecutor();
+    private final AtomicBoolean writeScheduled = new AtomicBoolean(false);
+
+    /**
+     * Get process-wide state, loading (or migrating) it on first call.
+     */
+    public static synchronized HotUpdatesState get(Context context) {
+        if (instance == null) {
+            instance = new HotUpdatesState(context.getApplicationContext());
+        }
+        return instance;
+    }
+
+    private HotUpdatesState(Context context) {
+        file = new AtomicFile(new File(context.getFilesDir(), STATE_FILE));
+        try {
+            current = new Snapshot(load());
+        } catch (FileNotFoundException e) {
+            migrateSharedPreferences(context);
+        } catch (IOException | JSONException e) {
+            Log.e(TAG, "State file unreadable, starting clean: " + e.getMessage());
+        }
+    }
+
+    // ============================================================
+    // Read
+    // ============================================================
+
+    /**
+     * Current values as one consistent view, for reading several keys of the same transition.
+     */
+    public Snapshot snapshot() {
+        return current;
+    }
+
+    public String getString(String key, String defValue) {
+        return current.getString(key, defValue);
+    }
+
+    public boolean getBoolean(String key, boolean defValue) {
+        return current.getBoolean(key, defValue);
+    }
+
+    public long getLong(String key, long defValue) {
+        return current.getLong(key, defValue);
+    }
+
+    /**
+     * @return Unmodifiable set (no copy), or defValue
+     */
+    public Set<String> getStringSet(String key, Set<String> defValue) {
+        return current.getStringSet(key, defValue);
+    }
+
+    /**
+     * Immutable state values.
+     */
+    public static final class Snapshot {
+        private final Map<String, Object> values;
+
+        Snapshot(Map<String, Object> values) {
+            this.values = Collections.unmodifiableMap(values);
+        }
+
+        public String getString(String key, String defValue) {
+            Object value = values.get(key);
+            return value instanceof String ? (String) value : defValue;
+        }
+
+        public boolean getBoolean(String key, boolean defValue) {
+            Object value = values.get(key);
+            return value instanceof Boolean ? (Boolean) value : defValue;
+        }
+
+        public long getLong(String key, long defValue) {
+            Object value = values.get(key);
+            return value instanceof Number ? ((Number) value).longValue() : defValue;
+        }
+
+        @SuppressWarnings("unchecked")
+        public Set<String> getStringSet(String key, Set<String> defValue) {
+            Object value = values.get(key);
+            return value instanceof Set ? (Set<String>) value : defValue;
+        }
+    }
+
+    // ============================================================
+    // Write
+    // ============================================================
+
+    /**
+     * Start a state transition. Nothing changes until commit() or apply().
+     */
+    public Editor edit() {
+        return new Editor();
+    }
+
+    /**
+     * Changes of one transition, applied to memory and written together.
+     * Same contract as SharedPreferences.Editor: a null value removes the key.
+     */
+    public class Editor {
+        private final Map<String, Object> changes = new HashMap<>();
+
+        public Editor putString(String key, String value) {
+            changes.put(key, value);
+            return this;
+        }
+
+        public Editor putBoolean(String key, boolean value) {
+            changes.put(key, value);
+            return this;
+        }
+
+        public Editor putLong(String key, long value) {
+            changes.put(key, value);
+            return this;
+        }
+
+        public Editor putStringSet(String key, Set<String> value) {
+            changes.put(key, value != null ? Collections.unmodifiableSet(new HashSet<>(value)) : null);
+            return this;
+        }
+
+        public Editor remove(String key) {
+            changes.put(key, null);
+            return this;
+        }
+
+        /**
+         * Apply changes and write the file on the calling thread.
+         * Nothing is written if no value actually changed.
+         *
+         * @return false if the file could not be written (memory keeps the new values)
+         */
+        public boolean commit() {
+            synchronized (HotUpdatesState.this) {
+                return !applyToMemory(changes) || write();
+            }
+        }
+
+        /**
+         * Apply changes and write the file in background.
+         * For values whose loss after a crash only costs repeated work (progress, flags).
+         */
+        public void apply() {
+            synchronized (HotUpdatesState.this) {
+                if (!applyToMemory(changes)) return;
+            }
+            if (writeScheduled.compareAndSet(false, true)) {
+                writer.execute(() -> {
+                    writeScheduled.set(false);
+                    synchronized (HotUpdatesState.this) {
+                        write();
+                    }
+                });
+            }
+        }
+    }
+
+    // ============================================================
+    // Private
+    // ============================================================
+
+    /**
+     * Publish a new snapshot with the changes. Called under the lock.
+     *
+     * @return true if any value changed
+     */
+    private boolean applyToMemory(Map<String, Object> changes) {
+        Map<String, Object> updated = new HashMap<>(current.values);
+        boolean changed = false;
+        for (Map.Entry<String, Object> change : changes.entrySet()) {
+            Object previous = change.getValue() == null
+                    ? updated.remove(change.getKey())
+                    : updated.put(change.getKey(), change.getValue());
+            changed |= !Objects.equals(previous, change.getValue());
+        }
+        if (changed) {
+            current = new Snapshot(updated);
+        }
+        return changed;
+    }
+
+    /**
+     * Write snapshot. Called under the lock, so files are written in transition order.
+     */
+    private boolean write() {
+        FileOutputStream out = null;
+        try {
+            JSONObject json = new JSONObject();
+            for (Map.Entry<String, Object> entry : current.values.entrySet()) {
+                Object value = entry.getValue();
+                json.put(entry.getKey(), value instanceof Set ? new JSONArray((Set<?>) value) : value);
+            }
+
+            out = file.startWrite();
+            out.write(json.toString().getBytes(StandardCharsets.UTF_8));
+            file.finishWrite(out);
+            return true;
+        } catch (IOException | JSONException e) {
+            if (out != null) file.failWrite(out);
+            Log.e(TAG, "Failed to save state: " + e.getMessage());
+            return false;
+        }
+    }
+
+    private Map<String, Object> load() throws IOException, JSONException {
+        Map<String, Object> loaded = new HashMap<>();
+        JSONObject json = new JSONObject(new String(file.readFully(), StandardCharsets.UTF_8));
+        Iterator<String> keys = json.keys();
+        while (keys.hasNext()) {
+            String key = keys.next();
+            Object value = json.get(key);
+            if (value instanceof JSONArray) {
+                // Only string sets are stored as arrays (ignore list)
+                JSONArray array = (JSONArray) value;
+                Set<String> set = new HashSet<>();
+                for (int i = 0; i < array.length(); i++) {
+                    set.add(array.getString(i));
+                }
+                value = Collections.unmodifiableSet(set);
+            }
+            loaded.put(key, value);
+        }
+        return loaded;
+    }
+
+    /**
+     * Move state of older plugin versions out of SharedPreferences.
+     * Preferences are cleared only after the file was written, so an
+     * interrupted migration is simply repeated on the next launch.
+     */
+    private void migrateSharedPreferences(Context context) {
+        SharedPreferences prefs = context.getSharedPreferences(PREFS_NAME, Context.MODE_PRIVATE);
+        Map<String, ?> saved = prefs.getAll();
+        if (saved.isEmpty()) return;
+
+        Map<String, Object> migrated = new HashMap<>();
+        for (Map.Entry<String, ?> entry : saved.entrySet()) {
+            Object value = entry.getValue();
+            if (value instanceof Set) {
+                Set<String> set = new HashSet<>();
+                for (Object item : (Set<?>) value) {
+                    set.add(String.valueOf(item));
+                }
+                value = Collections.unmodifiableSet(set);
+            }
+            migrated.put(entry.getKey(), value);
+        }
+
+        synchronized (this) {
+            current = new Snapshot(migrated);
+            if (write()) {
+                prefs.edit().clear().commit();
+                Log.d(TAG, "Migrated " + migrated.size() + " state values from SharedPreferences");
+            }
+        }
+    }
+}
@@ -0,0 +1,157 @@
+/**
+ * HotUpdatesStore.java
+ * Content-addressed file store for Hot Updates Plugin
+ *
+ * Every file of a downloaded update is stored once under its SHA-256 hash.
+ * Version directories (versions/<dir>/www, temp_downloaded_update, ...) are built from
+ * hard links into the store, so identical assets shared between versions take
+ * disk space only once and install/backup/rollback cost one link per file.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import android.system.ErrnoException;
+import android.system.Os;
+import android.util.Log;
+
+import java.io.File;
+import java.util.Map;
+
+import static com.getmeback.hotupdates.HotUpdatesConstants.*;
+import static com.getmeback.hotupdates.HotUpdatesHelpers.*;
+
+/**
+ * Object store layout: {@code store/objects/<first 2 hex chars>/<sha256>}.
+ * An object whose link count dropped to 1 is referenced by no version directory
+ * and is removed by {@link #collectGarbage()}.
+ *
+ * Thread-safe: ingest (plugin executor or download worker) and garbage collection
+ * share one process-wide lock, so an object is never removed while a file is being
+ * linked to it.
+ */
+public class HotUpdatesStore {
+
+    // Plugin and download worker each have their own instance
+    private static final Object LOCK = new Object();
+
+    // Link to an existing object, renamed over the version file
+    private static final String TEMP_SUFFIX = ".hu_tmp";
+
+    private final File objectsDir;
+
+    public HotUpdatesStore(File filesDir) {
+        this.objectsDir = new File(new File(filesDir, DIR_STORE), DIR_STORE_OBJECTS);
+    }
+
+    /**
+     * Move every file of the directory into the store.
+     * Files whose content is already stored are replaced by a link to the existing
+     * object (deduplication); new content becomes a new object.
+     *
+     * @param dir Freshly extracted update directory
+     * @param hashes SHA-256 hex by absolute file path, computed while the files were written;
+     *               only files not in it are read and hashed here. Null to hash every file
+     */
+    public void ingest(File dir, Map<String, String> hashes) {
+        int fromDisk;
+        synchronized (LOCK) {
+            fromDisk = ingestDirectory(dir, hashes);
+        }
+        if (fromDisk > 0) {
+            Log.d(TAG, "Store: " + fromDisk + " files hashed from disk");
+        }
+    }
+
+    /**
+     * Delete objects that are no longer referenced by any version directory.
+     *
+     * @return Number of deleted objects
+     */
+    public int collectGarbage() {
+        synchronized (LOCK) {
+            return collectUnreferenced();
+        }
+    }
+
+    // ============================================================
+    // Private
+    // ============================================================
+
+    private int collectUnreferenced() {
+        File[] buckets = objectsDir.listFiles();
+        if (buckets == null) return 0;
+
+        int deleted = 0;
+        for (File bucket : buckets) {
+            File[] objects = bucket.listFiles();
+            if (objects == null) continue;
+
+            for (File object : objects) {
+                try {
+                    if (Os.stat(object.getAbsolutePath()).st_nlink <= 1 && object.delete()) {
+                        deleted++;
+                    }
+                } catch (ErrnoException e) {
+                    Log.w(TAG, "Store GC: cannot stat " + object.getName());
+                }
+            }
+            bucket.delete(); // Removed only if empty
+        }
+
+        if (deleted > 0) {
+            Log.d(TAG, "Store GC: removed " + deleted + " unreferenced objects");
+        }
+        return deleted;
+    }
+
+    /**
+     * @return Files that had to be hashed from disk
+     */
+    private int ingestDirectory(File dir, Map<String, String> hashes) {
+        File[] children = dir.listFiles();
+        if (children == null) return 0;
+
+        int fromDisk = 0;
+        for (File child : children) {
+            if (child.isDirectory()) {
+                fromDisk += ingestDirectory(child, hashes);
+                continue;
+            }
+            String hash = hashes != null ? hashes.get(child.getAbsolutePath()) : null;
+            if (hash == null) {
+                hash = sha256(child);
+                if (hash == null) continue;
+                fromDisk++;
+            }
+            ingestFile(child, hash);
+        }
+        return fromDisk;
+    }
+
+    private void ingestFile(File file, String hash) {
+        File object = new File(new File(objectsDir, hash.substring(0, 2)), hash);
+        try {
+            if (object.exists()) {
+                // Same content already stored - share it. Link next to the file and rename
+                // over it, so the file is never missing if linking fails
+                String tempPath = file.getAbsolutePath() + TEMP_SUFFIX;
+                new File(tempPath).delete();
+                Os.link(object.getAbsolutePath(), tempPath);
+                try {
+                    Os.rename(tempPath, file.getAbsolutePath());
+                } catch (ErrnoException e) {
+                    new File(tempPath).delete();
+                    throw e;
+                }
+            } else {
+                object.getParentFile().mkdirs();
+                Os.link(file.getAbsolutePath(), object.getAbsolutePath());
+            }
+        } catch (ErrnoException e) {
+            // File keeps its own content, it is just not shared
+            Log.w(TAG, "Store: cannot link " + file.getName() + ": " + e.getMessage());
+        }
+    }
+}
@@ -0,0 +1,186 @@
+/**
+ * HotUpdatesUpdateCheck.java
+ * Check API request for Hot Updates Plugin
+ *
+ * Asks the check API (or a static release-channel manifest) which version to
+ * install. The response validators (ETag, Last-Modified) and body are kept in
+ * the state file, so a repeated check is a conditional request and an
+ * unchanged answer is a 304 without body. Used by checkForUpdate and by the
+ * background prefetch.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import org.json.JSONException;
+import org.json.JSONObject;
+
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.net.HttpURLConnection;
+import java.net.URL;
+import java.net.URLEncoder;
+import java.nio.charset.StandardCharsets;
+import java.util.Set;
+
+import static com.getmeback.hotupdates.HotUpdatesConstants.*;
+import static com.getmeback.hotupdates.HotUpdatesHelpers.*;
+
+/**
+ * Response: {hasUpdate?, version, downloadUrl | manifestUrl, minAppVersion?, packed?,
+ * verifyManifestUrl?}. Without hasUpdate (channel manifest) any version other than the
+ * current one is an update.
+ */
+public final class HotUpdatesUpdateCheck {
+
+    /** Check API response */
+    public final JSONObject response;
+    /** Answered with 304, response is the cached one */
+    public final boolean notModified;
+
+    private HotUpdatesUpdateCheck(JSONObject response, boolean notModified) {
+        this.response = response;
+        this.notModified = notModified;
+    }
+
+    /**
+     * Request the check URL with "version" and "platform" query parameters,
+     * conditional on the validators of the last response for the same URL.
+     *
+     * @throws IOException with "HTTP error: N" on unexpected status,
+     *         "Invalid manifest:" if the body is not a JSON object
+     */
+    public static HotUpdatesUpdateCheck fetch(HotUpdatesState state, String checkURL, String currentVersion)
+            throws IOException {
+        String url = checkURL + (checkURL.contains("?") ? "&" : "?")
+                + "version=" + URLEncoder.encode(currentVersion, "UTF-8") + "&platform=android";
+
+        JSONObject cache = loadCache(state, url);
+
+        HttpURLConnection connection = (HttpURLConnection) new URL(url).openConnection();
+        connection.setConnectTimeout(HTTP_CONNECT_TIMEOUT_MS);
+        connection.setReadTimeout(HTTP_READ_TIMEOUT_MS);
+        if (cache != null) {
+            String etag = cache.optString("etag", "");
+            String lastModified = cache.optString("lastModified", "");
+            if (!etag.isEmpty()) connection.setRequestProperty("If-None-Match", etag);
+            if (!lastModified.isEmpty()) connection.setRequestProperty("If-Modified-Since", lastModified);
+        }
+
+        try {
+            int responseCode = connectTimed(connection);
+            if (responseCode == HttpURLConnection.HTTP_NOT_MODIFIED && cache != null) {
+                return new HotUpdatesUpdateCheck(parse(cache.optString("body")), true);
+            }
+            if (responseCode != HttpURLConnection.HTTP_OK) {
+                throw new IOException("HTTP error: " + responseCode);
+            }
+
+            String body = readBody(connection);
+            JSONObject response = parse(body);
+            saveCache(state, url, connection.getHeaderField("ETag"), connection.getHeaderField("Last-Modified"), body);
+            return new HotUpdatesUpdateCheck(response, false);
+        } finally {
+            connection.disconnect();
+        }
+    }
+
+    /**
+     * Decide whether the response is an update for this app.
+     *
+     * @return {hasUpdate, version, url?, manifestUrl?, verifyManifestUrl?, packed, minAppVersion?,
+     *         ready, notModified, reason?}; reason (CHECK_REASON_*) tells why a version is skipped
+     */
+    public JSONObject evaluate(HotUpdatesState.Snapshot snapshot, String currentVersion, String appVersion,
+                               Set<String> ignoreList) throws JSONException {
+        String version = response.optString("version", "");
+        String downloadURL = response.optString("downloadUrl", "");
+        String manifestURL = response.optString("manifestUrl", "");
+        String minAppVersion = response.optString("minAppVersion", "");
+
+        JSONObject result = new JSONObject();
+        result.put("notModified", notModified);
+        if (!version.isEmpty()) result.put("version", version);
+        if (!downloadURL.isEmpty()) result.put("url", downloadURL);
+        if (!manifestURL.isEmpty()) result.put("manifestUrl", manifestURL);
+        if (!response.optString("verifyManifestUrl", "").isEmpty()) {
+            result.put("verifyManifestUrl", response.optString("verifyManifestUrl"));
+        }
+        result.put("packed", response.optBoolean("packed", false));
+        if (!minAppVersion.isEmpty()) result.put("minAppVersion", minAppVersion);
+
+        String reason = null;
+        if (!response.optBoolean("hasUpdate", true) || version.isEmpty() || version.equals(currentVersion)
+                || (downloadURL.isEmpty() && manifestURL.isEmpty())) {
+            reason = CHECK_REASON_UP_TO_DATE;
+        } else if (ignoreList.contains(version)) {
+            reason = CHECK_REASON_IGNORED;
+        } else if (!minAppVersion.isEmpty() && compareVersions(minAppVersion, appVersion) > 0) {
+            reason = CHECK_REASON_INCOMPATIBLE;
+        }
+
+        result.put("hasUpdate", reason == null);
+        if (reason != null) result.put("reason", reason);
+        // Already downloaded: getUpdate for it answers at once
+        result.put("ready", reason == null && snapshot.getBoolean(PREF_HAS_PENDING, false)
+                && version.equals(snapshot.getString(PREF_PENDING_VERSION, null)));
+        return result;
+    }
+
+    private static JSONObject parse(String body) throws IOException {
+        try {
+            return new JSONObject(body);
+        } catch (JSONException e) {
+            throw new IOException("Invalid manifest: check response is not a JSON object");
+        }
+    }
+
+    private static String readBody(HttpURLConnection connection) throws IOException {
+        byte[] buffer = HotUpdatesBuffers.acquire();
+        try (InputStream in = connection.getInputStream()) {
+            ByteArrayOutputStream out = new ByteArrayOutputStream();
+            int bytesRead;
+            while ((bytesRead = in.read(buffer)) != -1) {
+                out.write(buffer, 0, bytesRead);
+            }
+            return new String(out.toByteArray(), StandardCharsets.UTF_8);
+        } finally {
+            HotUpdatesBuffers.release(buffer);
+        }
+    }
+
+    /**
+     * Cached response of this exact URL, null if none or stale (URL changed with the version).
+     */
+    private static JSONObject loadCache(HotUpdatesState state, String url) {
+        String json = state.getString(PREF_CHECK_CACHE, null);
+        if (json == null) return null;
+        try {
+            JSONObject cache = new JSONObject(json);
+            return url.equals(cache.optString("url")) ? cache : null;
+        } catch (JSONException e) {
+            return null;
+        }
+    }
+
+    private static void saveCache(HotUpdatesState state, String url, String etag, String lastModified, String body) {
+        HotUpdatesState.Editor editor = state.edit();
+        if (etag == null && lastModified == null) {
+            // Nothing to revalidate with
+            editor.remove(PREF_CHECK_CACHE).apply();
+            return;
+        }
+        try {
+            JSONObject cache = new JSONObject();
+            cache.put("url", url);
+            if (etag != null) cache.put("etag", etag);
+            if (lastModified != null) cache.put("lastModified", lastModified);
+            cache.put("body", body);
+            editor.putString(PREF_CHECK_CACHE, cache.toString()).apply();
+        } catch (JSONException ignored) {
+            // Not cached, the next check is a full request
+        }
+    }
+}
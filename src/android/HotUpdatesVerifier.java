@@ -0,0 +1,203 @@
+/**
+ * HotUpdatesVerifier.java
+ * Signed manifest verification of ZIP updates for Hot Updates Plugin
+ *
+ * The server signs the manifest of a version (same format as for delta
+ * updates) with an ECDSA P-256 key; the app ships the public key in
+ * config.xml. Extractors hash every entry while it is inflated and hand the
+ * digest to the verifier, so checking the update costs no second read of the
+ * extracted tree. The update is rejected before it is staged.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import android.util.Base64;
+import android.util.Log;
+
+import org.json.JSONException;
+
+import java.io.File;
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.security.GeneralSecurityException;
+import java.security.KeyFactory;
+import java.security.PublicKey;
+import java.security.Signature;
+import java.security.spec.X509EncodedKeySpec;
+import java.util.Collections;
+import java.util.List;
+import java.util.Set;
+import java.util.concurrent.ConcurrentHashMap;
+
+import static com.getmeback.hotupdates.HotUpdatesConstants.*;
+import static com.getmeback.hotupdates.HotUpdatesHelpers.*;
+
+/**
+ * The detached signature is loaded from "&lt;manifestUrl&gt;.sig": base64 of the
+ * DER encoded ECDSA signature over the manifest bytes
+ * ({@code openssl dgst -sha256 -sign key.pem manifest.json | base64}).
+ *
+ * Every file below the www folder of the archive must be listed with a
+ * matching hash, and every listed file must be present. Thread-safe:
+ * parallel extraction workers verify entries concurrently.
+ */
+public class HotUpdatesVerifier {
+
+    private final HotUpdatesManifest manifest;
+    private final Set<String> verified = Collections.newSetFromMap(new ConcurrentHashMap<>());
+
+    private HotUpdatesVerifier(HotUpdatesManifest manifest) {
+        this.manifest = manifest;
+    }
+
+    /**
+     * Download manifest and its signature and check the signature.
+     *
+     * @param manifestUrl Manifest URL
+     * @param publicKey Base64 public key from config.xml ({@link HotUpdatesConstants#CONFIG_PUBLIC_KEY})
+     * @return Verifier for the archive of this manifest
+     * @throws IOException "Signature invalid: ..." / "Invalid manifest: ..." or a download error
+     */
+    public static HotUpdatesVerifier load(String manifestUrl, String publicKey) throws IOException {
+        try {
+            return new HotUpdatesVerifier(HotUpdatesManifest.parse(loadSigned(manifestUrl, publicKey), manifestUrl));
+        } catch (JSONException e) {
+            throw new IOException("Invalid manifest: " + e.getMessage());
+        }
+    }
+
+    /**
+     * Verifier for a ZIP update. With a public key configured every archive must come with a
+     * signed manifest, as delta updates always do.
+     *
+     * @param manifestUrl verifyManifestUrl of the update, null if not given
+     * @return Verifier, null if no manifest is given and no key is configured
+     * @throws IOException "Signature invalid: ..." if a key is configured but no manifest is given
+     */
+    public static HotUpdatesVerifier forArchive(String manifestUrl, String publicKey) throws IOException {
+        if (manifestUrl != null) {
+            return load(manifestUrl, publicKey);
+        }
+        if (publicKey != null && !publicKey.trim().isEmpty()) {
+            throw new IOException("Signature invalid: " + MANIFEST_REQUIRED_MESSAGE);
+        }
+        return null;
+    }
+
+    /**
+     * Download a signed document (manifest) and return its body once the signature is valid.
+     *
+     * @throws IOException "Signature invalid: ..." if no key is configured or the signature does not match
+     */
+    public static String loadSigned(String url, String publicKey) throws IOException {
+        if (publicKey == null || publicKey.trim().isEmpty()) {
+            throw new IOException("Signature invalid: " + CONFIG_PUBLIC_KEY + " preference not set");
+        }
+
+        byte[] body = downloadToBytes(url);
+        byte[] signature;
+        try {
+            String encoded = new String(downloadToBytes(url + SIGNATURE_SUFFIX), StandardCharsets.US_ASCII);
+            signature = Base64.decode(encoded.trim(), Base64.DEFAULT);
+        } catch (IllegalArgumentException e) {
+            throw new IOException("Signature invalid: malformed signature file");
+        }
+
+        if (!isSignatureValid(body, signature, publicKey)) {
+            throw new IOException("Signature invalid: " + url);
+        }
+        Log.d(TAG, "Manifest signature verified");
+        return new String(body, StandardCharsets.UTF_8);
+    }
+
+    /**
+     * Extracted size of the update declared by the signed manifest.
+     *
+     * @return Bytes, -1 if the manifest does not declare every file size
+     */
+    public long getTotalSize() {
+        return manifest.getTotalSize();
+    }
+
+    /**
+     * Warm-up list of the signed manifest.
+     */
+    public List<String> getWarmupPaths() {
+        return manifest.getWarmupPaths();
+    }
+
+    /**
+     * Check digest of one extracted entry.
+     *
+     * @param entryName Entry name in the archive ("www/js/app.js"); entries outside www are ignored
+     * @param digest SHA-256 of the inflated content
+     * @throws IOException "Hash mismatch: ..." if the file is not in the manifest or differs
+     */
+    public void verifyEntry(String entryName, byte[] digest) throws IOException {
+        String path = toWwwPath(entryName);
+        if (path == null) return;
+
+        HotUpdatesManifest.Entry entry = manifest.getEntry(path);
+        if (entry == null) {
+            throw new IOException("Hash mismatch: " + path + " is not in manifest");
+        }
+        if (!toHex(digest).equals(entry.sha256)) {
+            throw new IOException("Hash mismatch: " + path);
+        }
+        verified.add(path);
+    }
+
+    /**
+     * Check manifest files that were not verified during extraction.
+     * Normally none: only entries extracted before a resumed download are hashed here from disk.
+     *
+     * @param wwwDir Extracted www folder
+     * @throws IOException "Hash mismatch: ..." if a file is missing or differs
+     */
+    public void verifyRemaining(File wwwDir) throws IOException {
+        int fromDisk = 0;
+        for (HotUpdatesManifest.Entry entry : manifest.getEntries()) {
+            if (verified.contains(entry.path)) continue;
+
+            if (!HotUpdatesManifest.matches(new File(wwwDir, entry.path), entry)) {
+                throw new IOException("Hash mismatch: " + entry.path + " missing or modified");
+            }
+            fromDisk++;
+        }
+        Log.d(TAG, "Update verified: " + verified.size() + " files during extraction, " + fromDisk + " from disk");
+    }
+
+    // ============================================================
+    // Private
+    // ============================================================
+
+    private static boolean isSignatureValid(byte[] data, byte[] signature, String publicKey) throws IOException {
+        try {
+            PublicKey key = KeyFactory.getInstance("EC")
+                    .generatePublic(new X509EncodedKeySpec(Base64.decode(publicKey.trim(), Base64.DEFAULT)));
+            Signature verifier = Signature.getInstance("SHA256withECDSA");
+            verifier.initVerify(key);
+            verifier.update(data);
+            return verifier.verify(signature);
+        } catch (GeneralSecurityException | IllegalArgumentException e) {
+            throw new IOException("Signature invalid: " + e.getMessage());
+        }
+    }
+
+    /**
+     * Same rule as findWwwFolder: www at the archive root, or nested one level.
+     */
+    private static String toWwwPath(String entryName) {
+        String prefix = DIR_WWW + "/";
+        if (entryName.startsWith(prefix)) {
+            return entryName.substring(prefix.length());
+        }
+        int slash = entryName.indexOf('/');
+        if (slash > 0 && entryName.startsWith(prefix, slash + 1)) {
+            return entryName.substring(slash + 1 + prefix.length());
+        }
+        return null;
+    }
+}
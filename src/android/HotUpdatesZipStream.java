@@ -0,0 +1,322 @@
+/**
+ * HotUpdatesZipStream.java
+ * Streaming ZIP extraction for Hot Updates Plugin
+ *
+ * Parses ZIP local file headers and inflates entries as bytes arrive, so an
+ * update archive can be extracted directly from the HTTP body. Unlike
+ * ZipInputStream it knows the archive offset of every entry, which allows an
+ * interrupted transfer to continue from the last complete entry via HTTP Range.
+ *
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ */
+package com.getmeback.hotupdates;
+
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.nio.charset.StandardCharsets;
+import java.security.MessageDigest;
+import java.util.HashMap;
+import java.util.Map;
+import java.util.zip.CRC32;
+import java.util.zip.DataFormatException;
+import java.util.zip.Inflater;
+import java.util.zip.ZipException;
+
+/**
+ * Supported: stored and deflated entries, data descriptors, Zip64 sizes.
+ * Not supported: encrypted entries, stored entries with unknown size.
+ */
+public class HotUpdatesZipStream {
+
+    /**
+     * Notified after every complete entry with the offset where the next entry starts.
+     */
+    public interface ProgressListener {
+        void onEntryExtracted(long committedOffset);
+    }
+
+    private static final int LOCAL_HEADER_SIGNATURE = 0x04034b50;
+    private static final int CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+    private static final int END_OF_CENTRAL_DIR_SIGNATURE = 0x06054b50;
+    private static final int DATA_DESCRIPTOR_SIGNATURE = 0x08074b50;
+
+    private static final int LOCAL_HEADER_SIZE = 30;
+    private static final int BUFFER_SIZE = 64 * 1024;
+
+    private static final int FLAG_ENCRYPTED = 0x0001;
+    private static final int FLAG_DATA_DESCRIPTOR = 0x0008;
+
+    private static final int METHOD_STORED = 0;
+    private static final int METHOD_DEFLATED = 8;
+
+    private final InputStream input;
+    private final File destDir;
+    private final String canonicalDestPath;
+
+    private final byte[] buffer = new byte[BUFFER_SIZE];
+    private final byte[] output = new byte[BUFFER_SIZE];
+    private int pos;
+    private int limit;
+    private long bufferStart;       // Archive offset of buffer[0]
+    private long committedOffset;   // Start of the first entry not yet fully extracted
+
+    private final Inflater inflater = new Inflater(true);
+    private final CRC32 crc = new CRC32();
+    private ProgressListener listener;
+    private HotUpdatesVerifier verifier;
+    private final MessageDigest digest = HotUpdatesHelpers.newSha256();
+    private final Map<String, String> hashes = new HashMap<>();
+
+    /**
+     * @param input Archive bytes starting at startOffset
+     * @param destDir Destination directory (entries extracted earlier are kept)
+     * @param startOffset Archive offset of the first byte of input, must be an entry boundary
+     */
+    public HotUpdatesZipStream(InputStream input, File destDir, long startOffset) throws IOException {
+        this.input = input;
+        this.destDir = destDir;
+        this.canonicalDestPath = destDir.getCanonicalPath() + File.separator;
+        this.bufferStart = startOffset;
+        this.committedOffset = startOffset;
+    }
+
+    public void setProgressListener(ProgressListener listener) {
+        this.listener = listener;
+    }
+
+    /**
+     * Check every entry against a signed manifest while it is inflated.
+     */
+    public void setVerifier(HotUpdatesVerifier verifier) {
+        this.verifier = verifier;
+    }
+
+    /**
+     * SHA-256 hex of the entries extracted by this stream, by absolute file path
+     * (see {@link HotUpdatesStore#ingest}). Entries of an earlier, resumed attempt are not included.
+     */
+    public Map<String, String> getHashes() {
+        return hashes;
+    }
+
+    /**
+     * Archive offset from which an interrupted extraction can continue.
+     */
+    public long getCommittedOffset() {
+        return committedOffset;
+    }
+
+    /**
+     * Extract all entries until the central directory is reached.
+     *
+     * @throws ZipException if data is not a valid ZIP archive or an entry escapes destDir
+     * @throws IOException if the stream ends early or a file cannot be written
+     */
+    public void extract() throws IOException {
+        try {
+            byte[] header = new byte[LOCAL_HEADER_SIZE];
+            while (true) {
+                readFully(header, 0, 4);
+                int signature = readInt(header, 0);
+                if (signature == CENTRAL_HEADER_SIGNATURE || signature == END_OF_CENTRAL_DIR_SIGNATURE) {
+                    return;
+                }
+                if (signature != LOCAL_HEADER_SIGNATURE) {
+                    throw new ZipException("Invalid file format (not a ZIP archive)");
+                }
+
+                readFully(header, 4, LOCAL_HEADER_SIZE - 4);
+                extractEntry(header);
+
+                committedOffset = bufferStart + pos;
+                if (listener != null) {
+                    listener.onEntryExtracted(committedOffset);
+                }
+            }
+        } finally {
+            inflater.end();
+        }
+    }
+
+    // ============================================================
+    // Private
+    // ============================================================
+
+    private void extractEntry(byte[] header) throws IOException {
+        int flags = readShort(header, 6);
+        int method = readShort(header, 8);
+        long expectedCrc = readInt(header, 14) & 0xFFFFFFFFL;
+        long compressedSize = readInt(header, 18) & 0xFFFFFFFFL;
+
+        byte[] nameBytes = new byte[readShort(header, 26)];
+        byte[] extra = new byte[readShort(header, 28)];
+        readFully(nameBytes, 0, nameBytes.length);
+        readFully(extra, 0, extra.length);
+
+        // Zip64: real sizes are in extra field 0x0001 (uncompressed, compressed)
+        boolean zip64 = false;
+        for (int i = 0; i + 4 <= extra.length; ) {
+            int fieldId = readShort(extra, i);
+            int fieldSize = readShort(extra, i + 2);
+            if (fieldId == 0x0001) {
+                zip64 = true;
+                if (fieldSize >= 16 && i + 4 + 16 <= extra.length) {
+                    compressedSize = readLong(extra, i + 4 + 8);
+                }
+            }
+            i += 4 + fieldSize;
+        }
+
+        String name = new String(nameBytes, StandardCharsets.UTF_8);
+        boolean isDirectory = name.endsWith("/");
+        File outFile = new File(destDir, name);
+
+        // Security: prevent path traversal
+        if (!outFile.getCanonicalPath().startsWith(canonicalDestPath)
+                && !(outFile.getCanonicalPath() + File.separator).equals(canonicalDestPath)) {
+            throw new ZipException("ZIP entry outside destination directory: " + name);
+        }
+        if ((flags & FLAG_ENCRYPTED) != 0) {
+            throw new ZipException("Encrypted ZIP entry not supported: " + name);
+        }
+        if (method != METHOD_STORED && method != METHOD_DEFLATED) {
+            throw new ZipException("Unsupported compression method " + method + ": " + name);
+        }
+        if (method == METHOD_STORED && (flags & FLAG_DATA_DESCRIPTOR) != 0 && compressedSize == 0 && !isDirectory) {
+            throw new ZipException("Stored ZIP entry without size: " + name);
+        }
+
+        OutputStream out = null;
+        if (isDirectory) {
+            outFile.mkdirs();
+        } else {
+            outFile.getParentFile().mkdirs();
+            out = new FileOutputStream(outFile);
+        }
+
+        crc.reset();
+        digest.reset();
+        try {
+            if (method == METHOD_DEFLATED) {
+                inflateTo(out, name);
+            } else {
+                copyTo(out, compressedSize);
+            }
+        } finally {
+            if (out != null) out.close();
+        }
+
+        if ((flags & FLAG_DATA_DESCRIPTOR) != 0) {
+            byte[] descriptor = new byte[4];
+            readFully(descriptor, 0, 4);
+            if (readInt(descriptor, 0) == DATA_DESCRIPTOR_SIGNATURE) {
+                readFully(descriptor, 0, 4);
+            }
+            expectedCrc = readInt(descriptor, 0) & 0xFFFFFFFFL;
+            skipFully(zip64 ? 16 : 8);
+        }
+
+        if (!isDirectory && crc.getValue() != expectedCrc) {
+            throw new ZipException("CRC mismatch: " + name);
+        }
+        if (!isDirectory) {
+            byte[] hash = digest.digest();
+            if (verifier != null) {
+                verifier.verifyEntry(name, hash);
+            }
+            hashes.put(outFile.getAbsolutePath(), HotUpdatesHelpers.toHex(hash));
+        }
+    }
+
+    private void copyTo(OutputStream out, long size) throws IOException {
+        long remaining = size;
+        while (remaining > 0) {
+            if (pos == limit) fill();
+            int count = (int) Math.min(limit - pos, remaining);
+            write(out, buffer, pos, count);
+            pos += count;
+            remaining -= count;
+        }
+    }
+
+    private void inflateTo(OutputStream out, String name) throws IOException {
+        inflater.reset();
+        try {
+            while (!inflater.finished()) {
+                if (inflater.needsInput()) {
+                    if (pos == limit) fill();
+                    inflater.setInput(buffer, pos, limit - pos);
+                    pos = limit;
+                }
+
+                int produced = inflater.inflate(output);
+                if (produced > 0) {
+                    write(out, output, 0, produced);
+                } else if (inflater.needsDictionary()) {
+                    throw new ZipException("Corrupted ZIP entry: " + name);
+                }
+            }
+        } catch (DataFormatException e) {
+            throw new ZipException("Corrupted ZIP entry: " + name);
+        }
+
+        // Bytes after the end of the deflate stream belong to the next record
+        pos = limit - inflater.getRemaining();
+    }
+
+    private void write(OutputStream out, byte[] data, int offset, int length) throws IOException {
+        if (out == null) return; // Directory
+        crc.update(data, offset, length);
+        digest.update(data, offset, length);
+        out.write(data, offset, length);
+    }
+
+    private void fill() throws IOException {
+        bufferStart += limit;
+        pos = 0;
+        limit = 0;
+
+        int n = input.read(buffer);
+        if (n == -1) {
+            // Not a ZipException: connection closed early, transfer may be resumed
+            throw new IOException("Unexpected end of ZIP stream");
+        }
+        limit = n;
+    }
+
+    private void readFully(byte[] dst, int offset, int length) throws IOException {
+        while (length > 0) {
+            if (pos == limit) fill();
+            int count = Math.min(limit - pos, length);
+            System.arraycopy(buffer, pos, dst, offset, count);
+            pos += count;
+            offset += count;
+            length -= count;
+        }
+    }
+
+    private void skipFully(int length) throws IOException {
+        while (length > 0) {
+            if (pos == limit) fill();
+            int count = Math.min(limit - pos, length);
+            pos += count;
+            length -= count;
+        }
+    }
+
+    private static int readShort(byte[] b, int i) {
+        return (b[i] & 0xFF) | ((b[i + 1] & 0xFF) << 8);
+    }
+
+    private static int readInt(byte[] b, int i) {
+        return readShort(b, i) | (readShort(b, i + 2) << 16);
+    }
+
+    private static long readLong(byte[] b, int i) {
+        return (readInt(b, i) & 0xFFFFFFFFL) | ((long) readInt(b, i + 4) << 32);
+    }
+}
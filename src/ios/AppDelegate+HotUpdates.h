@@ -0,0 +1,23 @@
+/*!
+ * @file AppDelegate+HotUpdates.h
+ * @brief AppDelegate hook for Hot Updates background downloads
+ * @details Forwards background URLSession events to the plugin, so a download started with
+ *          getUpdate({background: true}) is completed after the app was relaunched by the system.
+ *
+ *          Note: the category implements application:handleEventsForBackgroundURLSession:completionHandler:.
+ *          If the app's AppDelegate implements it too, call
+ *          +[HotUpdates handleEventsForBackgroundURLSession:completionHandler:] from there instead.
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import "AppDelegate.h"
+
+@interface AppDelegate (HotUpdates)
+
+- (void)application:(UIApplication*)application
+handleEventsForBackgroundURLSession:(NSString*)identifier
+  completionHandler:(void (^)(void))completionHandler;
+
+@end
@@ -0,0 +1,23 @@
+/*!
+ * @file AppDelegate+HotUpdates.m
+ * @brief AppDelegate hook for Hot Updates background downloads
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import "AppDelegate+HotUpdates.h"
+#import "HotUpdates.h"
+
+@implementation AppDelegate (HotUpdates)
+
+- (void)application:(UIApplication*)application
+handleEventsForBackgroundURLSession:(NSString*)identifier
+  completionHandler:(void (^)(void))completionHandler {
+    // Чужие сессии: обработчик нужно вызвать сразу, иначе система считает событие необработанным
+    if (![HotUpdates handleEventsForBackgroundURLSession:identifier completionHandler:completionHandler]) {
+        completionHandler();
+    }
+}
+
+@end
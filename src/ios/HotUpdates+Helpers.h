@@ -20,4 +20,12 @@
  */
 - (NSDictionary*)createError:(NSString*)code message:(NSString*)message;
 
+/*!
+ * @brief Send error result to JavaScript callback
+ * @param code Error code (e.g., "DOWNLOAD_FAILED")
+ * @param message Detailed message for logs
+ * @param callbackId Cordova callback id
+ */
+- (void)sendError:(NSString*)code message:(NSString*)message callbackId:(NSString*)callbackId;
+
 @end
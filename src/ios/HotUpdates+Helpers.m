@@ -21,4 +21,10 @@
     };
 }
 
+- (void)sendError:(NSString*)code message:(NSString*)message callbackId:(NSString*)callbackId {
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
+                                             messageAsDictionary:[self createError:code message:message]];
+    [self.commandDelegate sendPluginResult:result callbackId:callbackId];
+}
+
 @end
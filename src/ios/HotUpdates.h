@@ -24,23 +24,32 @@
 @interface HotUpdates : CDVPlugin
 {
     NSString *documentsPath;
-    NSString *wwwPath;
+    NSString *wwwPath;                // Legacy Documents/www (переносится в versions/)
     NSString *appBundleVersion;
 
     // Settings
     NSMutableArray *ignoreList;       // Список игнорируемых версий (управляется только native)
     NSMutableArray *versionHistory;   // История успешно установленных версий (исключая откаченные)
-    NSString *previousVersionPath;    // Путь к предыдущей версии
+    NSString *previousVersionPath;    // Legacy Documents/www_previous (переносится в versions/)
 }
 
 // JavaScript API methods (v2.2.2)
+- (void)checkForUpdate:(CDVInvokedUrlCommand*)command;   // Ask check API for a newer version
 - (void)getUpdate:(CDVInvokedUrlCommand*)command;        // Download update
+- (void)cancelUpdate:(CDVInvokedUrlCommand*)command;     // Abort download
 - (void)forceUpdate:(CDVInvokedUrlCommand*)command;      // Install downloaded update
 - (void)canary:(CDVInvokedUrlCommand*)command;           // Confirm successful load
+- (void)extendCanary:(CDVInvokedUrlCommand*)command;     // Push canary deadline of a slow load
 - (void)getIgnoreList:(CDVInvokedUrlCommand*)command;    // Get ignore list (JS reads only)
 - (void)getVersionHistory:(CDVInvokedUrlCommand*)command; // Get version history (successful installs only)
 
 // Debug method
 - (void)getVersionInfo:(CDVInvokedUrlCommand*)command;   // Get all version info for debugging
+- (void)getMetrics:(CDVInvokedUrlCommand*)command;       // Get update pipeline timings
+- (void)rollbackTo:(CDVInvokedUrlCommand*)command;       // Switch to a retained version
+
+// Background downloads: called from AppDelegate+HotUpdates.
+// Returns NO if the session does not belong to the plugin (caller must call completionHandler)
++ (BOOL)handleEventsForBackgroundURLSession:(NSString*)identifier completionHandler:(void (^)(void))completionHandler;
 
 @end
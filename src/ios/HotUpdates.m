@@ -23,18 +23,69 @@
 #import "HotUpdates.h"
 #import "HotUpdates+Helpers.h"
 #import "HotUpdatesConstants.h"
+#import "HotUpdatesManifest.h"
+#import "HotUpdatesStore.h"
+#import "HotUpdatesState.h"
+#import "HotUpdatesZipStream.h"
+#import "HotUpdatesSegmentedDownload.h"
+#import "HotUpdatesParallelUnzip.h"
+#import "HotUpdatesPack.h"
+#import "HotUpdatesVerifier.h"
+#import "HotUpdatesDownloadJob.h"
+#import "HotUpdatesProgress.h"
+#import "HotUpdatesFileDownload.h"
+#import "HotUpdatesMetrics.h"
 #import <SSZipArchive/SSZipArchive.h>
+#import <BackgroundTasks/BackgroundTasks.h>
+#import <fcntl.h>
+#import <sys/mman.h>
 
 // Флаг для предотвращения повторных перезагрузок при навигации внутри WebView
 static BOOL hasPerformedInitialReload = NO;
 
-@interface HotUpdates ()
+// Completion handlers от AppDelegate по идентификатору фоновой сессии.
+// Могут прийти до инициализации плагина, поэтому хранятся статически
+static NSMutableDictionary<NSString*, void (^)(void)> *backgroundEventsCompletionHandlers = nil;
+
+// Плагин, обрабатывающий фоновую проверку обновлений (BGTaskScheduler регистрируется один раз за процесс)
+static __weak HotUpdates *prefetchPlugin = nil;
+
+@interface HotUpdates () <NSURLSessionDownloadDelegate>
 {
-    BOOL isDownloadingUpdate;
     NSString *pendingUpdateURL;
     NSString *pendingUpdateVersion;
     BOOL isUpdateReadyToInstall;
     NSTimer *canaryTimer;
+    HotUpdatesStore *store;   // Content-addressed хранилище, версии собираются из hard links
+    HotUpdatesState *state;   // Состояние плагина: один файл, одна атомарная запись на переход
+
+    NSMutableDictionary<NSString*, NSURLSession*> *backgroundSessions;  // По идентификатору
+    NSString *backgroundCallbackId;       // identifier задачи фоновой загрузки
+    BOOL isExtractingBackgroundDownload;  // Защита от повторной распаковки update_temp.zip
+
+    HotUpdatesPack *currentPack;          // Текущая версия упакована в один файл (nil - файлы в www)
+    NSString *servedWWWPath;              // www установленной распакованной версии (для .gz файлов)
+    BOOL servedWWWIsOverlay;              // В servedWWWPath только отличия от bundle, остальное из bundle
+    NSMutableSet<id<WKURLSchemeTask>> *activeSchemeTasks;  // Ответы .gz, распаковка которых ещё идёт (main thread)
+    NSString *bundleWWWFolderName;        // wwwFolderName Cordova до переключения на Documents
+    NSString *bundleStartPage;            // startPage Cordova, заменённый для первой навигации (nil - не заменён)
+    HotUpdatesVerifier *pendingVerifier;  // Подписанный манифест текущей загрузки (nil - без проверки)
+    NSArray<NSString*> *pendingWarmupPaths;  // warmup манифеста delta обновления до его подготовки
+    NSDictionary<NSString*, NSString*> *pendingHashes;  // Путь в www -> SHA-256, посчитанные при распаковке
+
+    // Координация загрузок (@synchronized self): getUpdate той же версии ждёт текущую задачу
+    HotUpdatesDownloadJob *downloadJob;   // Последний запрошенный getUpdate (nil - загрузки нет)
+    HotUpdatesDownloadJob *transferJob;   // Задача, чья загрузка идёт и занимает временные директории
+    NSMutableArray<NSString*> *cancelCallbackIds;  // cancelUpdate ждут остановки загрузки
+
+    dispatch_group_t startupGroup;        // Файловые операции запуска в async режиме (nil - синхронный запуск)
+    BOOL isStartupComplete;               // Команды JS до этого момента ждут завершения запуска
+
+    // Метрики (HotUpdatesMetrics now), main thread
+    NSTimeInterval reloadStartTime;       // Начало перезагрузки WebView (0 - не идёт)
+    NSTimeInterval canaryStartTime;       // Запуск canary таймера
+    NSTimeInterval canaryTimeoutInterval; // Срок текущего canary таймера
+    BOOL canaryExtended;                  // Был extendCanary: время загрузки не учитывается
 }
 @end
 
@@ -52,31 +103,90 @@ static BOOL hasPerformedInitialReload = NO;
     documentsPath = [paths objectAtIndex:0];
     wwwPath = [documentsPath stringByAppendingPathComponent:kWWWDirName];
     previousVersionPath = [documentsPath stringByAppendingPathComponent:kPreviousWWWDirName];
+    store = [[HotUpdatesStore alloc] initWithRootPath:documentsPath];
+    state = [[HotUpdatesState alloc] initWithRootPath:documentsPath];
+
+    if ([self.viewController isKindOfClass:[CDVViewController class]]) {
+        bundleWWWFolderName = ((CDVViewController *)self.viewController).wwwFolderName;
+    }
+    bundleWWWFolderName = bundleWWWFolderName ?: kWWWDirName;
 
     [self loadConfiguration];
     [self loadIgnoreList];
     [self loadVersionHistory];
 
-    // Сбрасываем флаг загрузки (если приложение было убито во время загрузки)
-    isDownloadingUpdate = NO;
-    [[NSUserDefaults standardUserDefaults] setBool:NO forKey:kDownloadInProgress];
+    // Сбрасываем флаг загрузки (если приложение было убито во время загрузки).
+    // Состояние докачки сохраняется - следующий getUpdate той же версии продолжит загрузку
+    [self setDownloadInProgress:NO];
+    cancelCallbackIds = [NSMutableArray array];
 
-    // Читаем состояние из UserDefaults
-    pendingUpdateURL = [[NSUserDefaults standardUserDefaults] stringForKey:kPendingUpdateURL];
-    isUpdateReadyToInstall = [[NSUserDefaults standardUserDefaults] boolForKey:kPendingUpdateReady];
+    // Читаем сохранённое состояние
+    pendingUpdateURL = [state stringForKey:kPendingUpdateURL];
+    isUpdateReadyToInstall = [state boolForKey:kPendingUpdateReady];
     if (isUpdateReadyToInstall) {
-        pendingUpdateVersion = [[NSUserDefaults standardUserDefaults] stringForKey:kPendingVersion];
+        pendingUpdateVersion = [state stringForKey:kPendingVersion];
     }
 
     NSLog(@"[HotUpdates] Initializing plugin...");
 
+    // Конец перезагрузки WebView для метрик
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(pageDidLoad:)
+                                                 name:CDVPageDidLoadNotification
+                                               object:nil];
+
+    if ([[self.commandDelegate.settings cordovaSettingForKey:kAsyncStartupPreference] boolValue]) {
+        // WebView показывает bundle, пока идут файловые операции; затем одна перезагрузка
+        startupGroup = dispatch_group_create();
+        dispatch_group_async(startupGroup, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+            [self prepareInstalledContent];
+        });
+        dispatch_group_notify(startupGroup, dispatch_get_main_queue(), ^{
+            [self finishStartup];
+        });
+    } else {
+        [self prepareInstalledContent];
+        [self finishStartup];
+    }
+
+    [self setupPrefetch];
+}
+
+/*!
+ * @brief File work of startup: migrate layout, promote the staged update, drop stale overlays
+ * @details The bundled www is not copied: without an installed version the WebView is served
+ *          from the app bundle directly.
+ *          Runs on a background queue in async startup mode (HotUpdatesAsyncStartup).
+ */
+- (void)prepareInstalledContent {
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    [self migrateLegacyLayout];
     [self checkAndInstallPendingUpdate];
-    [self initializeWWWFolder];
+    [self dropStaleOverlays];
+    NSLog(@"[HotUpdates] Startup file work took %.0f ms", (CFAbsoluteTimeGetCurrent() - startTime) * 1000);
+}
+
+/*!
+ * @brief Switch WebView to the installed version and start the canary timer (main thread)
+ */
+- (void)finishStartup {
+    isStartupComplete = YES;
+
+    // Фоновая загрузка могла продолжаться, пока приложение было выгружено.
+    // После установки: её завершение пишет в ту же директорию подготовки
+    [self restoreBackgroundDownload];
+
+    [self refreshCurrentPack];
     [self switchToUpdatedContentWithReload];
 
-    NSString *currentVersion = [[NSUserDefaults standardUserDefaults] stringForKey:kInstalledVersion];
+    // Мало места: оставляем только текущую версию и цель отката
+    if ([self isStorageLow]) {
+        [self pruneVersionsRemovingPaths:@[]];
+    }
+
+    NSString *currentVersion = [state stringForKey:kInstalledVersion];
     if (currentVersion) {
-        NSString *canaryVersion = [[NSUserDefaults standardUserDefaults] stringForKey:kCanaryVersion];
+        NSString *canaryVersion = [state stringForKey:kCanaryVersion];
 
         if (!canaryVersion || ![canaryVersion isEqualToString:currentVersion]) {
             NSLog(@"[HotUpdates] Starting canary timer for version %@", currentVersion);
@@ -87,6 +197,18 @@ static BOOL hasPerformedInitialReload = NO;
     NSLog(@"[HotUpdates] Plugin initialized (v%@)", appBundleVersion);
 }
 
+/*!
+ * @brief Defer a JS command until async startup has finished
+ * @return YES if the command was queued (caller returns), NO to run it now
+ */
+- (BOOL)deferUntilStartup:(void (^)(void))command {
+    if (isStartupComplete) {
+        return NO;
+    }
+    dispatch_group_notify(startupGroup, dispatch_get_main_queue(), command);
+    return YES;
+}
+
 - (void)loadConfiguration {
     appBundleVersion = [[[NSBundle mainBundle] infoDictionary] objectForKey:@"CFBundleShortVersionString"];
     if (!appBundleVersion) {
@@ -94,51 +216,78 @@ static BOOL hasPerformedInitialReload = NO;
     }
 }
 
+/*!
+ * @brief App bundle build an overlay version is made for, written into its marker
+ * @return "<CFBundleShortVersionString> (<CFBundleVersion>)"
+ */
+- (NSString*)bundleBuildIdentifier {
+    NSString *build = [[[NSBundle mainBundle] infoDictionary] objectForKey:@"CFBundleVersion"] ?: @"";
+    return [NSString stringWithFormat:@"%@ (%@)", appBundleVersion, build];
+}
+
+/*!
+ * @brief Public key for signed manifests (config.xml preference HotUpdatesPublicKey)
+ * @return Base64 SubjectPublicKeyInfo or nil if updates are not signed
+ */
+- (NSString*)manifestPublicKey {
+    NSString *publicKey = [self.commandDelegate.settings cordovaSettingForKey:kPublicKeyPreference];
+    return publicKey.length > 0 ? publicKey : nil;
+}
+
 /*!
  * @brief Check and install pending updates
- * @details Looks for pending updates and installs them to Documents/www
+ * @details Promotes the staged update (the same directory forceUpdate installs) to
+ *          Documents/versions/<dir>/www by rename
  */
 - (void)checkAndInstallPendingUpdate {
-    BOOL hasPendingUpdate = [[NSUserDefaults standardUserDefaults] boolForKey:kHasPending];
-    NSString *pendingVersion = [[NSUserDefaults standardUserDefaults] stringForKey:kPendingVersion];
+    BOOL hasPendingUpdate = [state boolForKey:kHasPending];
+    NSString *pendingVersion = [state stringForKey:kPendingVersion];
 
     if (hasPendingUpdate && pendingVersion) {
         NSLog(@"[HotUpdates] Auto-installing pending update: %@", pendingVersion);
 
-        [self backupCurrentVersion];
-
+        // pending_update остаётся только от старых версий плагина
+        NSString *stagedPath = [documentsPath stringByAppendingPathComponent:kTempDownloadedDirName];
         NSString *pendingUpdatePath = [documentsPath stringByAppendingPathComponent:kPendingUpdateDirName];
-        NSString *pendingWwwPath = [pendingUpdatePath stringByAppendingPathComponent:kWWWDirName];
-        NSString *documentsWwwPath = [documentsPath stringByAppendingPathComponent:kWWWDirName];
+        NSString *pendingWwwPath = [stagedPath stringByAppendingPathComponent:kWWWDirName];
+        if (![[NSFileManager defaultManager] fileExistsAtPath:pendingWwwPath]) {
+            pendingWwwPath = [pendingUpdatePath stringByAppendingPathComponent:kWWWDirName];
+        }
 
         if ([[NSFileManager defaultManager] fileExistsAtPath:pendingWwwPath]) {
-            if ([[NSFileManager defaultManager] fileExistsAtPath:documentsWwwPath]) {
-                [[NSFileManager defaultManager] removeItemAtPath:documentsWwwPath error:nil];
-            }
-
+            NSTimeInterval installStart = [HotUpdatesMetrics now];
             NSError *copyError = nil;
-            BOOL copySuccess = [[NSFileManager defaultManager] copyItemAtPath:pendingWwwPath toPath:documentsWwwPath error:&copyError];
+            NSString *versionDir = [self moveToVersionsDir:pendingWwwPath version:pendingVersion error:&copyError];
 
-            if (copySuccess) {
-                [[NSUserDefaults standardUserDefaults] setObject:pendingVersion forKey:kInstalledVersion];
-                [[NSUserDefaults standardUserDefaults] setBool:NO forKey:kHasPending];
-                [[NSUserDefaults standardUserDefaults] removeObjectForKey:kPendingVersion];
-                [[NSUserDefaults standardUserDefaults] removeObjectForKey:kCanaryVersion];
-                [[NSUserDefaults standardUserDefaults] synchronize];
+            if (versionDir) {
+                // Добавляем версию в историю при успешной установке - записывается вместе с указателями
+                [self addVersionToHistory:pendingVersion];
+                [state commitChanges:^(NSMutableDictionary *values) {
+                    [self switchCurrentVersion:pendingVersion dirName:versionDir values:values];
+                    values[kHasPending] = @NO;
+                    values[kPendingUpdateReady] = @NO;
+                    [values removeObjectsForKeys:@[kPendingVersion, kPendingWarmup, kCanaryVersion]];
+                }];
+                [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageInstall since:installStart];
 
-                [[NSFileManager defaultManager] removeItemAtPath:pendingUpdatePath error:nil];
+                // Подготовленное обновление израсходовано - forceUpdate ставить нечего
+                isUpdateReadyToInstall = NO;
+                pendingUpdateVersion = nil;
 
-                // Добавляем версию в историю при успешной установке
-                [self addVersionToHistory:pendingVersion];
+                [self pruneVersionsRemovingPaths:@[stagedPath, pendingUpdatePath]];
 
                 NSLog(@"[HotUpdates] Update %@ installed successfully", pendingVersion);
             } else {
                 NSLog(@"[HotUpdates] Failed to install pending update: %@", copyError.localizedDescription);
                 // Очищаем флаги чтобы не пытаться снова при следующем запуске
-                [[NSUserDefaults standardUserDefaults] setBool:NO forKey:kHasPending];
-                [[NSUserDefaults standardUserDefaults] removeObjectForKey:kPendingVersion];
-                [[NSUserDefaults standardUserDefaults] synchronize];
+                [state commitChanges:^(NSMutableDictionary *values) {
+                    values[kHasPending] = @NO;
+                    values[kPendingUpdateReady] = @NO;
+                    [values removeObjectsForKeys:@[kPendingVersion, kPendingWarmup]];
+                }];
+                isUpdateReadyToInstall = NO;
                 // Удаляем битое обновление
+                [[NSFileManager defaultManager] removeItemAtPath:stagedPath error:nil];
                 [[NSFileManager defaultManager] removeItemAtPath:pendingUpdatePath error:nil];
             }
         }
@@ -147,7 +296,7 @@ static BOOL hasPerformedInitialReload = NO;
 
 /*!
  * @brief Switch WebView to updated content with reload
- * @details Changes wwwFolderName to Documents/www and reloads WebView if updates are installed
+ * @details Changes wwwFolderName to the current version directory and reloads WebView if updates are installed
  *          Uses static flag to prevent reload on every page navigation (only once per app launch)
  */
 - (void)switchToUpdatedContentWithReload {
@@ -156,10 +305,22 @@ static BOOL hasPerformedInitialReload = NO;
         return;
     }
 
-    NSString *installedVersion = [[NSUserDefaults standardUserDefaults] stringForKey:kInstalledVersion];
+    NSString *installedVersion = [state stringForKey:kInstalledVersion];
+
+    if (installedVersion && [self selectStartPageBeforeFirstLoad]) {
+        NSLog(@"[HotUpdates] Loading installed version: %@ (first navigation)", installedVersion);
+        hasPerformedInitialReload = YES;
+    } else if (installedVersion && (currentPack || servedWWWIsOverlay)) {
+        // Упакованная версия или overlay: файлы отдаёт overrideSchemeTask, остальное - bundle
+        NSLog(@"[HotUpdates] Loading installed version: %@ (%@)", installedVersion, currentPack ? @"packed" : @"overlay");
+        ((CDVViewController *)self.viewController).wwwFolderName = bundleWWWFolderName;
+        hasPerformedInitialReload = YES;
 
-    if (installedVersion) {
-        NSString *documentsWwwPath = [documentsPath stringByAppendingPathComponent:kWWWDirName];
+        [self invalidateWebViewCacheWithCompletion:^{
+            [self reloadWebView];
+        }];
+    } else if (installedVersion) {
+        NSString *documentsWwwPath = [self currentWWWPath];
         NSString *indexPath = [documentsWwwPath stringByAppendingPathComponent:@"index.html"];
 
         if ([[NSFileManager defaultManager] fileExistsAtPath:indexPath]) {
@@ -169,17 +330,85 @@ static BOOL hasPerformedInitialReload = NO;
             hasPerformedInitialReload = YES;
 
             // Очищаем кэш перед перезагрузкой, иначе может загрузиться старая версия
-            [self clearWebViewCacheWithCompletion:^{
+            [self invalidateWebViewCacheWithCompletion:^{
                 [self reloadWebView];
             }];
         } else {
-            NSLog(@"[HotUpdates] WARNING: Documents/www/index.html not found, using bundle");
+            NSLog(@"[HotUpdates] WARNING: %@/index.html not found, using bundle", documentsWwwPath);
         }
     } else {
         hasPerformedInitialReload = YES;
     }
 }
 
+/*!
+ * @brief Point Cordova's start page at the installed version so that it is the only navigation
+ * @details Only possible while CDVViewController has not loaded its start page yet: onload plugins
+ *          are initialized in viewDidLoad right before appUrl is resolved, so this works with
+ *          synchronous startup only. Falls back (returns NO) when the WebView is already loading,
+ *          when the cache of the local content must be invalidated first (new version, full
+ *          invalidation mode) and for extracted versions under a custom scheme, whose file:// start
+ *          page the engine would rewrite into the bundle scheme URL.
+ *          config.xml HotUpdatesSingleLoad=true enables it.
+ * @return YES if the first navigation loads the installed version
+ */
+- (BOOL)selectStartPageBeforeFirstLoad {
+    if (![[self.commandDelegate.settings cordovaSettingForKey:kSingleLoadPreference] boolValue]
+        || ![self.viewController isKindOfClass:[CDVViewController class]]) {
+        return NO;
+    }
+    CDVViewController *cdvViewController = (CDVViewController *)self.viewController;
+
+    id webViewEngine = cdvViewController.webViewEngine;
+    WKWebView *webView = [webViewEngine respondsToSelector:@selector(engineWebView)]
+        ? [webViewEngine performSelector:@selector(engineWebView)] : nil;
+    if (![webView isKindOfClass:[WKWebView class]] || webView.URL || webView.isLoading) {
+        return NO;
+    }
+    if (![self isWebViewCacheCurrent]) {
+        return NO;
+    }
+
+    NSURL *startURL = nil;
+    if (currentPack || servedWWWIsOverlay) {
+        cdvViewController.wwwFolderName = bundleWWWFolderName;
+        startURL = [self packedStartURL];
+    } else if (![self canServePackedBundle]) {
+        NSString *indexPath = [[self currentWWWPath] stringByAppendingPathComponent:@"index.html"];
+        if (![[NSFileManager defaultManager] fileExistsAtPath:indexPath]) {
+            return NO;
+        }
+        // Engine даёт доступ на чтение к директории стартовой страницы - www версии
+        cdvViewController.wwwFolderName = [self currentWWWPath];
+        startURL = [NSURL fileURLWithPath:indexPath];
+    } else {
+        return NO;
+    }
+
+    // appUrl берёт startPage как есть, если в нём есть схема; восстанавливается после загрузки
+    bundleStartPage = cdvViewController.startPage;
+    cdvViewController.startPage = startURL.absoluteString;
+    reloadStartTime = [HotUpdatesMetrics now];
+    return YES;
+}
+
+/*!
+ * @brief Version directory served now ("" - app bundle)
+ */
+- (NSString*)servedVersionDir {
+    return [state stringForKey:kInstalledVersion] ? ([state stringForKey:kCurrentVersionDir] ?: @"") : @"";
+}
+
+/*!
+ * @brief Whether the WebView data of the local content belongs to the served version
+ * @return NO if invalidateWebViewCacheWithCompletion: would remove data
+ */
+- (BOOL)isWebViewCacheCurrent {
+    NSString *mode = [self.commandDelegate.settings cordovaSettingForKey:kCacheInvalidationPreference];
+    return ![mode isEqualToString:kCacheInvalidationFull]
+        && [[self servedVersionDir] isEqualToString:[state stringForKey:kCacheVersionDir]];
+}
+
 /*!
  * @brief Clear WebView cache
  * @details Clears disk cache, memory cache, offline storage and service workers
@@ -190,6 +419,7 @@ static BOOL hasPerformedInitialReload = NO;
 
 /*!
  * @brief Clear WebView cache with completion handler
+ * @details Full wipe (disk, memory, offline cache and service workers of every origin)
  * @param completion Block called after cache is cleared (on main thread)
  */
 - (void)clearWebViewCacheWithCompletion:(void (^)(void))completion {
@@ -201,20 +431,91 @@ static BOOL hasPerformedInitialReload = NO;
     ]];
 
     NSDate *dateFrom = [NSDate dateWithTimeIntervalSince1970:0];
+    NSTimeInterval startTime = [HotUpdatesMetrics now];
     [[WKWebsiteDataStore defaultDataStore] removeDataOfTypes:websiteDataTypes
                                                modifiedSince:dateFrom
                                            completionHandler:^{
+        [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageCacheClear since:startTime];
         if (completion) {
             dispatch_async(dispatch_get_main_queue(), completion);
         }
     }];
 }
 
+/*!
+ * @brief Invalidate WebView data that may be stale for the version about to be served
+ * @details Selective mode (default): the cache is only touched when the served version directory
+ *          differs from the one it was last invalidated for, so a relaunch with the same version
+ *          keeps everything. Then only data of the local origins (file://, scheme handler host) is
+ *          removed; remote API / CDN responses stay cached. Files of an extracted version live under
+ *          versions/<dir>/, so their URLs already change with every version; packed and overlay
+ *          versions are served no-cache. config.xml HotUpdatesCacheInvalidation=full wipes all
+ *          website data every time, as before.
+ * @param completion Block called when done (on main thread)
+ */
+- (void)invalidateWebViewCacheWithCompletion:(void (^)(void))completion {
+    NSString *mode = [self.commandDelegate.settings cordovaSettingForKey:kCacheInvalidationPreference];
+    if ([mode isEqualToString:kCacheInvalidationFull]) {
+        [self clearWebViewCacheWithCompletion:completion];
+        return;
+    }
+
+    NSString *servedDir = [self servedVersionDir];
+    if ([self isWebViewCacheCurrent]) {
+        NSLog(@"[HotUpdates] WebView cache is current, not cleared");
+        dispatch_async(dispatch_get_main_queue(), completion ?: ^{});
+        return;
+    }
+
+    NSSet *websiteDataTypes = [NSSet setWithArray:@[
+        WKWebsiteDataTypeDiskCache,
+        WKWebsiteDataTypeMemoryCache,
+        WKWebsiteDataTypeOfflineWebApplicationCache,
+        WKWebsiteDataTypeServiceWorkerRegistrations
+    ]];
+    // file:// записи не имеют домена
+    NSSet *localNames = [NSSet setWithObjects:@"", @"file", @"localhost", [self packedStartURL].host, nil];
+
+    NSTimeInterval startTime = [HotUpdatesMetrics now];
+    WKWebsiteDataStore *dataStore = [WKWebsiteDataStore defaultDataStore];
+    [dataStore fetchDataRecordsOfTypes:websiteDataTypes completionHandler:^(NSArray<WKWebsiteDataRecord*> *records) {
+        NSMutableArray<WKWebsiteDataRecord*> *localRecords = [NSMutableArray array];
+        for (WKWebsiteDataRecord *record in records) {
+            if ([localNames containsObject:record.displayName.lowercaseString ?: @""]) {
+                [localRecords addObject:record];
+            }
+        }
+
+        [dataStore removeDataOfTypes:websiteDataTypes forDataRecords:localRecords completionHandler:^{
+            [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageCacheClear since:startTime];
+            NSLog(@"[HotUpdates] WebView cache invalidated for local content (%lu of %lu records)",
+                  (unsigned long)localRecords.count, (unsigned long)records.count);
+
+            [self->state commitChanges:^(NSMutableDictionary *values) {
+                values[kCacheVersionDir] = servedDir;
+            }];
+            if (completion) {
+                dispatch_async(dispatch_get_main_queue(), completion);
+            }
+        }];
+    }];
+}
+
 - (void)reloadWebView {
+    // Указатель текущей версии мог смениться (install, rollback)
+    [self refreshCurrentPack];
+
     if ([self.viewController isKindOfClass:[CDVViewController class]]) {
         CDVViewController *cdvViewController = (CDVViewController *)self.viewController;
 
-        NSString *documentsWwwPath = [documentsPath stringByAppendingPathComponent:kWWWDirName];
+        // Без установленной версии (например, после rollback на bundle) - www из приложения
+        BOOL servesBundle = ![state stringForKey:kInstalledVersion];
+        BOOL viaSchemeHandler = currentPack || servedWWWIsOverlay || (servesBundle && [self canServePackedBundle]);
+        if (servesBundle || viaSchemeHandler) {
+            cdvViewController.wwwFolderName = bundleWWWFolderName;
+        }
+
+        NSString *documentsWwwPath = servesBundle ? [self bundleWWWPath] : [self currentWWWPath];
         NSString *indexPath = [documentsWwwPath stringByAppendingPathComponent:@"index.html"];
         NSURL *fileURL = [NSURL fileURLWithPath:indexPath];
         NSURL *allowReadAccessToURL = [NSURL fileURLWithPath:documentsWwwPath];
@@ -224,8 +525,14 @@ static BOOL hasPerformedInitialReload = NO;
             WKWebView *webView = [webViewEngine performSelector:@selector(engineWebView)];
 
             if (webView && [webView isKindOfClass:[WKWebView class]]) {
+                NSURL *packedURL = viaSchemeHandler ? [self packedStartURL] : nil;
                 dispatch_async(dispatch_get_main_queue(), ^{
-                    [webView loadFileURL:fileURL allowingReadAccessToURL:allowReadAccessToURL];
+                    self->reloadStartTime = [HotUpdatesMetrics now];
+                    if (packedURL) {
+                        [webView loadRequest:[NSURLRequest requestWithURL:packedURL]];
+                    } else {
+                        [webView loadFileURL:fileURL allowingReadAccessToURL:allowReadAccessToURL];
+                    }
                 });
             } else {
                 NSLog(@"[HotUpdates] ERROR: Could not access WKWebView for reload");
@@ -239,26 +546,23 @@ static BOOL hasPerformedInitialReload = NO;
 }
 
 
-- (void)initializeWWWFolder {
-    NSFileManager *fileManager = [NSFileManager defaultManager];
-
-    if (![fileManager fileExistsAtPath:wwwPath]) {
-        NSString *bundleWWWPath = [[NSBundle mainBundle] pathForResource:@"www" ofType:nil];
-        if (bundleWWWPath) {
-            NSError *error;
-            [fileManager copyItemAtPath:bundleWWWPath toPath:wwwPath error:&error];
-            if (error) {
-                NSLog(@"[HotUpdates] ERROR: Failed to copy www folder: %@", error.localizedDescription);
-            } else {
-                NSLog(@"[HotUpdates] Initialized www folder from bundle");
-            }
-        } else {
-            NSLog(@"[HotUpdates] ERROR: Bundle www folder not found");
-        }
-    }
+- (BOOL)unzipFile:(NSString*)zipPath toDestination:(NSString*)destination {
+    return [self unzipFile:zipPath toDestination:destination verifier:nil reporter:nil hashes:nil];
 }
 
-- (BOOL)unzipFile:(NSString*)zipPath toDestination:(NSString*)destination {
+/*!
+ * @brief Extract ZIP archive, reporting written bytes as the extracting phase
+ * @param verifier Signed manifest, entries are hashed while they are inflated (nil to skip);
+ *                 on mismatch verifier.failure is set and NO returned
+ * @param reporter Progress of the download (nil to skip)
+ * @param hashes Filled with path relative to destination/www -> SHA-256 hex (nil to skip).
+ *               Left empty if the archive had to be extracted by SSZipArchive.
+ */
+- (BOOL)unzipFile:(NSString*)zipPath
+    toDestination:(NSString*)destination
+         verifier:(HotUpdatesVerifier*)verifier
+         reporter:(HotUpdatesProgress*)reporter
+           hashes:(NSMutableDictionary<NSString*, NSString*>*)hashes {
     NSFileManager *fileManager = [NSFileManager defaultManager];
     NSError *error = nil;
 
@@ -269,10 +573,12 @@ static BOOL hasPerformedInitialReload = NO;
     }
 
     // Проверяем magic bytes (PK\x03\x04)
+    NSTimeInterval validateStart = [HotUpdatesMetrics now];
     if (![self isValidZipFile:zipPath]) {
         NSLog(@"[HotUpdates] ERROR: Invalid file format (not a ZIP archive)");
         return NO;
     }
+    [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageValidate since:validateStart];
 
     NSLog(@"[HotUpdates] Extracting update package...");
 
@@ -297,13 +603,76 @@ static BOOL hasPerformedInitialReload = NO;
         return NO;
     }
 
-    BOOL extractSuccess = [SSZipArchive unzipFileAtPath:zipPath toDestination:tempExtractPath];
+    // Все ядра: central directory + пул workers. SSZipArchive - запасной вариант для архивов,
+    // которые параллельный распаковщик не поддерживает (например, зашифрованных)
+    NSError *extractError = nil;
+    NSTimeInterval extractStart = [HotUpdatesMetrics now];
+    BOOL extractSuccess = [HotUpdatesParallelUnzip extractArchiveAtPath:zipPath
+                                                            toDirectory:tempExtractPath
+                                                               verifier:verifier
+                                                               reporter:reporter
+                                                                 hashes:hashes
+                                                                  error:&extractError];
+    // Несовпадение хеша - не повод пробовать другой распаковщик
+    if (!extractSuccess && !verifier.failure) {
+        NSLog(@"[HotUpdates] Parallel extraction failed (%@), retrying with SSZipArchive", extractError.localizedDescription);
+        [fileManager removeItemAtPath:tempExtractPath error:nil];
+        [fileManager createDirectoryAtPath:tempExtractPath withIntermediateDirectories:YES attributes:nil error:nil];
+        [hashes removeAllObjects];
+        extractSuccess = [SSZipArchive unzipFileAtPath:zipPath toDestination:tempExtractPath];
+    }
 
     if (!extractSuccess) {
         NSLog(@"[HotUpdates] ERROR: Failed to extract ZIP archive");
         [fileManager removeItemAtPath:tempExtractPath error:nil];
         return NO;
     }
+    [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageExtract
+                             since:extractStart
+                             bytes:[[fileManager attributesOfItemAtPath:zipPath error:nil] fileSize]];
+
+    return [self moveExtractedWWWFrom:tempExtractPath toDestination:destination hashes:hashes];
+}
+
+/*!
+ * @brief Keep archive as pack: move it to destination/www/bundle.pack without extraction
+ * @param verifier Signed manifest, items are hashed in the same pass as the CRC check (nil to skip)
+ * @return NO if the archive is not a valid pack or cannot be moved (caller extracts it instead)
+ */
+- (BOOL)packArchive:(NSString*)zipPath toDestination:(NSString*)destination verifier:(HotUpdatesVerifier*)verifier {
+    NSTimeInterval validateStart = [HotUpdatesMetrics now];
+    BOOL servable = [HotUpdatesPack isServableArchiveAtPath:zipPath verifier:verifier];
+    [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageValidate since:validateStart];
+    if (!servable) {
+        return NO;
+    }
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSString *packedWwwPath = [destination stringByAppendingPathComponent:kWWWDirName];
+    NSError *error = nil;
+
+    if (![fileManager createDirectoryAtPath:packedWwwPath withIntermediateDirectories:YES attributes:nil error:&error]
+        || ![fileManager moveItemAtPath:zipPath toPath:[packedWwwPath stringByAppendingPathComponent:kPackedBundleFileName] error:&error]) {
+        NSLog(@"[HotUpdates] ERROR: Failed to keep archive as pack: %@", error.localizedDescription);
+        [fileManager removeItemAtPath:destination error:nil];
+        return NO;
+    }
+
+    NSLog(@"[HotUpdates] Archive kept as pack, extraction skipped");
+    return YES;
+}
+
+/*!
+ * @brief Find www folder in extracted archive and move it to destination/www
+ * @details www may be at the archive root or nested one level. Extract directory is removed.
+ * @param hashes Extraction digests, entry name -> SHA-256 hex; re-keyed in place to paths inside
+ *               www, entries outside the moved www are dropped (nil to skip)
+ * @return NO if www folder not found or cannot be moved
+ */
+- (BOOL)moveExtractedWWWFrom:(NSString*)tempExtractPath
+               toDestination:(NSString*)destination
+                      hashes:(NSMutableDictionary<NSString*, NSString*>*)hashes {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
 
     NSArray *extractedContents = [fileManager contentsOfDirectoryAtPath:tempExtractPath error:nil];
 
@@ -337,16 +706,30 @@ static BOOL hasPerformedInitialReload = NO;
         [fileManager removeItemAtPath:finalWwwPath error:nil];
     }
 
-    NSError *copyError = nil;
-    BOOL copySuccess = [fileManager copyItemAtPath:wwwSourcePath toPath:finalWwwPath error:&copyError];
+    // temp_extract удаляется сразу после, поэтому переносим а не копируем
+    NSError *moveError = nil;
+    BOOL moveSuccess = [fileManager moveItemAtPath:wwwSourcePath toPath:finalWwwPath error:&moveError];
 
     [fileManager removeItemAtPath:tempExtractPath error:nil];
 
-    if (!copySuccess) {
-        NSLog(@"[HotUpdates] ERROR: Failed to copy www folder: %@", copyError.localizedDescription);
+    if (!moveSuccess) {
+        NSLog(@"[HotUpdates] ERROR: Failed to move www folder: %@", moveError.localizedDescription);
+        [hashes removeAllObjects];
         return NO;
     }
 
+    if (hashes.count > 0) {
+        // "www/" или "<папка>/www/" - остальные записи архива в итоговую www не попали
+        NSString *prefix = [[wwwSourcePath substringFromIndex:tempExtractPath.length + 1] stringByAppendingString:@"/"];
+        NSMutableDictionary<NSString*, NSString*> *wwwHashes = [NSMutableDictionary dictionaryWithCapacity:hashes.count];
+        [hashes enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSString *hash, BOOL *stop) {
+            if ([name hasPrefix:prefix] && name.length > prefix.length) {
+                wwwHashes[[name substringFromIndex:prefix.length]] = hash;
+            }
+        }];
+        [hashes setDictionary:wwwHashes];
+    }
+
     NSLog(@"[HotUpdates] Extraction completed successfully");
     return YES;
 }
@@ -365,476 +748,2868 @@ static BOOL hasPerformedInitialReload = NO;
     return (bytes[0] == 0x50 && bytes[1] == 0x4B && bytes[2] == 0x03 && bytes[3] == 0x04);
 }
 
-#pragma mark - Settings Management
+#pragma mark - Versioned Layout
 
-- (void)loadIgnoreList {
-    NSArray *savedList = [[NSUserDefaults standardUserDefaults] arrayForKey:kIgnoreList];
-    ignoreList = savedList ? [savedList mutableCopy] : [NSMutableArray array];
+- (NSString*)versionDirPath:(NSString*)dirName {
+    return [[documentsPath stringByAppendingPathComponent:kVersionsDirName] stringByAppendingPathComponent:dirName];
 }
 
-- (NSArray*)getIgnoreListInternal {
-    return [ignoreList copy];
+/*!
+ * @brief www directory of the version the WebView currently serves
+ * @return Documents/versions/<dir>/www, or legacy Documents/www if no pointer is saved
+ */
+- (NSString*)currentWWWPath {
+    NSString *currentDir = [state stringForKey:kCurrentVersionDir];
+    if (!currentDir) {
+        return wwwPath;
+    }
+    return [[self versionDirPath:currentDir] stringByAppendingPathComponent:kWWWDirName];
 }
 
-- (void)saveIgnoreList {
-    [[NSUserDefaults standardUserDefaults] setObject:ignoreList forKey:kIgnoreList];
-    [[NSUserDefaults standardUserDefaults] synchronize];
+/*!
+ * @brief Read-only www of the app bundle (served when no version is installed, overlay fallback)
+ */
+- (NSString*)bundleWWWPath {
+    return [[NSBundle mainBundle] pathForResource:kWWWDirName ofType:nil];
 }
 
-- (void)addVersionToIgnoreList:(NSString*)version {
-    if (version && ![ignoreList containsObject:version]) {
-        [ignoreList addObject:version];
-        [self saveIgnoreList];
-        NSLog(@"[HotUpdates] Added version %@ to ignore list", version);
-    }
-}
+/*!
+ * @brief Move a complete www tree into Documents/versions/<dir>/www
+ * @details Rename is atomic and constant-time; hard link mirror is used only if rename fails
+ * @param srcWww www directory to move
+ * @param version Version string used for the directory name
+ * @param error Set on failure
+ * @return Name of the created version directory or nil on error
+ */
+- (NSString*)moveToVersionsDir:(NSString*)srcWww version:(NSString*)version error:(NSError**)error {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSString *dirName = [self allocateVersionDirName:version];
+    NSString *versionPath = [self versionDirPath:dirName];
 
-- (void)getIgnoreList:(CDVInvokedUrlCommand*)command {
-    NSArray *ignoreList = [self getIgnoreListInternal];
+    if (![fileManager createDirectoryAtPath:versionPath withIntermediateDirectories:YES attributes:nil error:error]) {
+        return nil;
+    }
 
-    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK
-                                             messageAsDictionary:@{
-        @"versions": ignoreList
-    }];
-    [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+    NSString *destWww = [versionPath stringByAppendingPathComponent:kWWWDirName];
+    if (![fileManager moveItemAtPath:srcWww toPath:destWww error:nil]) {
+        NSTimeInterval copyStart = [HotUpdatesMetrics now];
+        if (![store linkItemAtPath:srcWww toPath:destWww error:error]) {
+            [fileManager removeItemAtPath:versionPath error:nil];
+            return nil;
+        }
+        [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageCopy since:copyStart];
+        [fileManager removeItemAtPath:srcWww error:nil];
+    }
+    return dirName;
 }
 
-#pragma mark - Version History Management
+/*!
+ * @brief Pick a directory name for the version that is not the current or a retained one
+ * @details Stale directory with the same name is removed
+ */
+- (NSString*)allocateVersionDirName:(NSString*)version {
+    NSCharacterSet *unsafe = [[NSCharacterSet characterSetWithCharactersInString:
+        @"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789._-"] invertedSet];
+    NSString *base = [[version componentsSeparatedByCharactersInSet:unsafe] componentsJoinedByString:@"_"];
+    if (base.length == 0 || [base hasPrefix:@"."]) {
+        base = [@"_" stringByAppendingString:base];
+    }
 
-- (void)loadVersionHistory {
-    NSArray *savedHistory = [[NSUserDefaults standardUserDefaults] arrayForKey:kVersionHistory];
-    if (savedHistory) {
-        versionHistory = [savedHistory mutableCopy];
-    } else {
-        versionHistory = [NSMutableArray array];
-        // При первом запуске добавляем исходную версию приложения
-        if (appBundleVersion) {
-            [versionHistory addObject:appBundleVersion];
-            [self saveVersionHistory];
-            NSLog(@"[HotUpdates] Initial version history created with app version: %@", appBundleVersion);
-        }
+    NSSet<NSString*> *liveDirs = [self liveVersionDirsInValues:[state snapshot] rollbackTargetOnly:NO];
+
+    NSString *name = base;
+    NSInteger suffix = 1;
+    while ([liveDirs containsObject:name]) {
+        name = [NSString stringWithFormat:@"%@-%ld", base, (long)suffix++];
     }
-}
 
-- (NSArray*)getVersionHistoryInternal {
-    return [versionHistory copy];
+    [[NSFileManager defaultManager] removeItemAtPath:[self versionDirPath:name] error:nil];
+    return name;
 }
 
-- (void)saveVersionHistory {
-    [[NSUserDefaults standardUserDefaults] setObject:versionHistory forKey:kVersionHistory];
-    [[NSUserDefaults standardUserDefaults] synchronize];
+/*!
+ * @brief Make version directory current, old current becomes rollback target
+ * @details Called inside commitChanges: of the install transition. Older rollback targets
+ *          move down the retained list
+ * @param values State values of the transition
+ */
+- (void)switchCurrentVersion:(NSString*)version dirName:(NSString*)dirName values:(NSMutableDictionary*)values {
+    NSString *currentDir = values[kCurrentVersionDir];
+    // Bundle не копируется в Documents: откат на него - просто сброс указателя
+    NSString *currentVersion = currentDir ? (values[kInstalledVersion] ?: appBundleVersion) : appBundleVersion;
+
+    NSMutableArray<NSDictionary*> *retained = [self retainedVersionsInValues:values];
+    // Имя директории версии, удалённой при нехватке места, могло быть занято заново
+    [retained filterUsingPredicate:[NSPredicate predicateWithFormat:@"dir == nil OR dir != %@", dirName]];
+    [retained insertObject:[self retainedVersion:currentVersion dir:currentDir] atIndex:0];
+    [self saveRetainedVersions:retained values:values];
+    NSLog(@"[HotUpdates] Kept version %@%@ for rollback", currentVersion, currentDir ? @"" : @" (bundle)");
+
+    values[kCurrentVersionDir] = dirName;
+    values[kInstalledVersion] = version;
 }
 
-- (void)addVersionToHistory:(NSString*)version {
-    if (version && ![versionHistory containsObject:version]) {
-        [versionHistory addObject:version];
-        [self saveVersionHistory];
-        NSLog(@"[HotUpdates] Added version %@ to version history", version);
+/*!
+ * @brief Point current at a retained version (without dir: app bundle)
+ */
+- (void)setCurrentVersion:(NSDictionary*)version values:(NSMutableDictionary*)values {
+    if (version[@"dir"]) {
+        values[kInstalledVersion] = version[@"version"];
+        values[kCurrentVersionDir] = version[@"dir"];
+    } else {
+        [values removeObjectsForKeys:@[kInstalledVersion, kCurrentVersionDir]];
     }
 }
 
-- (void)removeVersionFromHistory:(NSString*)version {
-    if (version && [versionHistory containsObject:version]) {
-        [versionHistory removeObject:version];
-        [self saveVersionHistory];
-        NSLog(@"[HotUpdates] Removed version %@ from version history", version);
-    }
-}
+#pragma mark - Version Retention
 
-- (void)getVersionHistory:(CDVInvokedUrlCommand*)command {
-    NSArray *history = [self getVersionHistoryInternal];
+- (NSDictionary*)retainedVersion:(NSString*)version dir:(NSString*)dir {
+    return dir ? @{@"version": version, @"dir": dir} : @{@"version": version};
+}
 
-    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK
-                                             messageAsDictionary:@{
-        @"versions": history
-    }];
-    [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+/*!
+ * @brief Installed versions kept on disk (config.xml HotUpdatesKeepVersions), current included
+ */
+- (NSInteger)keepVersions {
+    NSInteger keep = [[self.commandDelegate.settings cordovaSettingForKey:kKeepVersionsPreference] integerValue];
+    return MAX(kDefaultKeepVersions, keep);
 }
 
-#pragma mark - Canary Timer
+- (BOOL)isStorageLow {
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfFileSystemForPath:documentsPath error:nil];
+    NSNumber *freeSize = attributes[NSFileSystemFreeSize];
+    return freeSize && freeSize.unsignedLongLongValue < kLowStorageBytes;
+}
 
 /*!
- * @brief Start canary timer with weak self to prevent retain cycle
- * @details Uses block-based timer (iOS 10+) with weak reference
+ * @brief Rollback targets, newest first: the previous version followed by the retained list
+ * @details Versions whose directory was removed under disk pressure are skipped
+ * @param values State values (snapshot or values of a transition)
+ * @return [{version, dir}], no dir - app bundle
  */
-- (void)startCanaryTimer {
-    // Инвалидируем предыдущий таймер если есть
-    if (canaryTimer && [canaryTimer isValid]) {
-        [canaryTimer invalidate];
-        canaryTimer = nil;
+- (NSMutableArray<NSDictionary*>*)retainedVersionsInValues:(NSDictionary*)values {
+    NSMutableArray<NSDictionary*> *candidates = [NSMutableArray array];
+    NSString *previousVersion = values[kPreviousVersion];
+    if ([previousVersion isKindOfClass:[NSString class]] && previousVersion.length > 0) {
+        [candidates addObject:[self retainedVersion:previousVersion dir:values[kPreviousVersionDir]]];
+    }
+    NSArray *saved = values[kRetainedVersions];
+    if ([saved isKindOfClass:[NSArray class]]) {
+        for (NSDictionary *item in saved) {
+            if ([item isKindOfClass:[NSDictionary class]] && [item[@"version"] isKindOfClass:[NSString class]]) {
+                [candidates addObject:item];
+            }
+        }
     }
 
-    // Используем weak self для предотвращения retain cycle
-    __weak __typeof__(self) weakSelf = self;
-    canaryTimer = [NSTimer scheduledTimerWithTimeInterval:20.0
-                                                  repeats:NO
-                                                    block:^(NSTimer * _Nonnull timer) {
-        [weakSelf canaryTimeout];
-    }];
+    NSMutableArray<NSDictionary*> *retained = [NSMutableArray array];
+    NSMutableSet<NSString*> *seenDirs = [NSMutableSet set];
+    BOOL seenBundle = NO;
+    for (NSDictionary *version in candidates) {
+        NSString *dir = version[@"dir"];
+        if (!dir) {
+            if (seenBundle) continue;
+            seenBundle = YES;
+        } else {
+            NSString *versionWww = [[self versionDirPath:dir] stringByAppendingPathComponent:kWWWDirName];
+            if ([seenDirs containsObject:dir] || ![[NSFileManager defaultManager] fileExistsAtPath:versionWww]) {
+                continue;
+            }
+            [seenDirs addObject:dir];
+        }
+        [retained addObject:version];
+    }
+    return retained;
 }
 
-#pragma mark - Canary Timeout Handler
-
-- (void)canaryTimeout {
-    NSLog(@"[HotUpdates] CANARY TIMEOUT - JS did not call canary() within 20 seconds");
-
-    NSString *currentVersion = [[NSUserDefaults standardUserDefaults] stringForKey:kInstalledVersion];
-    NSString *previousVersion = [self getPreviousVersion];
-
-    if (!previousVersion || previousVersion.length == 0) {
-        NSLog(@"[HotUpdates] Fresh install from Store, rollback not possible");
+/*!
+ * @brief Save rollback targets: first one as previous version, the rest as retained list
+ * @details Cut to the retention limit; called inside commitChanges:
+ */
+- (void)saveRetainedVersions:(NSArray<NSDictionary*>*)retained values:(NSMutableDictionary*)values {
+    NSUInteger limit = MIN(retained.count, (NSUInteger)([self keepVersions] - 1));
+    if (limit == 0) {
+        [values removeObjectsForKeys:@[kPreviousVersion, kPreviousVersionDir, kRetainedVersions]];
         return;
     }
 
-    NSLog(@"[HotUpdates] Version %@ considered faulty, performing rollback", currentVersion);
+    NSDictionary *previous = retained.firstObject;
+    values[kPreviousVersion] = previous[@"version"];
+    if (previous[@"dir"]) {
+        values[kPreviousVersionDir] = previous[@"dir"];
+    } else {
+        [values removeObjectForKey:kPreviousVersionDir];
+    }
 
-    // Примечание: версия добавляется в ignoreList внутри rollbackToPreviousVersion
-    BOOL rollbackSuccess = [self rollbackToPreviousVersion];
+    if (limit > 1) {
+        values[kRetainedVersions] = [retained subarrayWithRange:NSMakeRange(1, limit - 1)];
+    } else {
+        [values removeObjectForKey:kRetainedVersions];
+    }
+}
 
-    if (rollbackSuccess) {
-        NSLog(@"[HotUpdates] Automatic rollback completed successfully");
+/*!
+ * @brief Version directories that must not be deleted or reused
+ * @param rollbackTargetOnly Keep only current and previous version (low storage)
+ */
+- (NSSet<NSString*>*)liveVersionDirsInValues:(NSDictionary*)values rollbackTargetOnly:(BOOL)rollbackTargetOnly {
+    NSMutableSet<NSString*> *dirs = [NSMutableSet set];
+    if (values[kCurrentVersionDir]) {
+        [dirs addObject:values[kCurrentVersionDir]];
+    }
 
-        hasPerformedInitialReload = NO;
+    NSArray<NSDictionary*> *retained = [self retainedVersionsInValues:values];
+    if (rollbackTargetOnly && retained.count > 1) {
+        retained = [retained subarrayWithRange:NSMakeRange(0, 1)];
+    }
+    for (NSDictionary *version in retained) {
+        if (version[@"dir"]) {
+            [dirs addObject:version[@"dir"]];
+        }
+    }
+    return dirs;
+}
 
-        [self clearWebViewCacheWithCompletion:^{
-            [self reloadWebView];
+/*!
+ * @brief Delete unused version directories and unreferenced store objects
+ * @details Runs in background, install path does not wait for it. On low storage only the
+ *          current version and the rollback target are kept
+ * @param paths Additional temp directories to remove
+ */
+- (void)pruneVersionsRemovingPaths:(NSArray<NSString*>*)paths {
+    [self pruneVersionsRemovingPaths:paths rollbackTargetOnly:[self isStorageLow] completion:nil];
+}
+
+/*!
+ * @param rollbackTargetOnly Keep only the current version and the rollback target
+ * @param completion Called on the main thread once the files are deleted (nil - nobody waits)
+ */
+- (void)pruneVersionsRemovingPaths:(NSArray<NSString*>*)paths
+                rollbackTargetOnly:(BOOL)rollbackTargetOnly
+                        completion:(void (^)(void))completion {
+    NSSet<NSString*> *liveDirs = [self liveVersionDirsInValues:[state snapshot] rollbackTargetOnly:rollbackTargetOnly];
+    NSString *versionsPath = [documentsPath stringByAppendingPathComponent:kVersionsDirName];
+    HotUpdatesStore *currentStore = store;
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+
+    // Сразу освобождаем имена (rename), чтобы новая загрузка не пересеклась с удалением
+    NSMutableArray<NSString*> *trashPaths = [NSMutableArray array];
+    for (NSString *path in paths) {
+        NSString *trashPath = [path stringByAppendingFormat:@".trash-%@", [[NSUUID UUID] UUIDString]];
+        if ([fileManager moveItemAtPath:path toPath:trashPath error:nil]) {
+            [trashPaths addObject:trashPath];
+        }
+    }
+
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_BACKGROUND, 0), ^{
+        NSFileManager *fileManager = [NSFileManager defaultManager];
+
+        for (NSString *path in trashPaths) {
+            [fileManager removeItemAtPath:path error:nil];
+        }
+
+        for (NSString *name in [fileManager contentsOfDirectoryAtPath:versionsPath error:nil]) {
+            if (![liveDirs containsObject:name]) {
+                NSLog(@"[HotUpdates] Removing stale version directory: %@", name);
+                [fileManager removeItemAtPath:[versionsPath stringByAppendingPathComponent:name] error:nil];
+            }
+        }
+
+        [currentStore collectGarbage];
+
+        if (completion) {
+            dispatch_async(dispatch_get_main_queue(), completion);
+        }
+    });
+}
+
+/*!
+ * @brief Move www / www_previous of the single-directory layout into versions/
+ */
+- (void)migrateLegacyLayout {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+
+    if ([state stringForKey:kCurrentVersionDir] || ![fileManager fileExistsAtPath:wwwPath]) {
+        return;
+    }
+
+    NSError *error = nil;
+    NSString *previousVersion = [state stringForKey:kPreviousVersion];
+    if (previousVersion && [fileManager fileExistsAtPath:previousVersionPath]) {
+        NSString *previousDir = [self moveToVersionsDir:previousVersionPath version:previousVersion error:&error];
+        if (previousDir) {
+            // Сохраняем сразу, чтобы имя не было занято текущей версией
+            [state commitChanges:^(NSMutableDictionary *values) {
+                values[kPreviousVersionDir] = previousDir;
+            }];
+        }
+    }
+
+    NSString *currentVersion = [state stringForKey:kInstalledVersion] ?: appBundleVersion;
+    NSString *currentDir = [self moveToVersionsDir:wwwPath version:currentVersion error:&error];
+    if (currentDir) {
+        [state commitChanges:^(NSMutableDictionary *values) {
+            values[kCurrentVersionDir] = currentDir;
         }];
+        NSLog(@"[HotUpdates] Migrated www to versioned layout");
     } else {
-        NSLog(@"[HotUpdates] Automatic rollback failed");
+        NSLog(@"[HotUpdates] Failed to migrate www layout: %@", error.localizedDescription);
     }
 }
 
-#pragma mark - Rollback Mechanism
+/*!
+ * @brief Overlay www made for another app bundle build (the app was updated from the store)
+ * @details Files it lacks would come from the new bundle. A marker without build (older plugin) is stale too
+ */
+- (BOOL)isStaleOverlayAtWWWPath:(NSString*)versionWww {
+    NSString *markerPath = [versionWww stringByAppendingPathComponent:kOverlayMarkerFileName];
+    if (![[NSFileManager defaultManager] fileExistsAtPath:markerPath]) {
+        return NO;
+    }
+    NSString *bundleBuild = [NSString stringWithContentsOfFile:markerPath encoding:NSUTF8StringEncoding error:nil];
+    return ![bundleBuild isEqualToString:[self bundleBuildIdentifier]];
+}
+
+/*!
+ * @brief Drop overlay versions made for a previous app bundle build
+ * @details A stale current version falls back to the app bundle, stale rollback targets and a stale
+ *          staged update are forgotten; their directories are deleted by the prune
+ */
+- (void)dropStaleOverlays {
+    NSDictionary *snapshot = [state snapshot];
+    NSString *currentDir = snapshot[kCurrentVersionDir];
+    BOOL currentStale = currentDir
+        && [self isStaleOverlayAtWWWPath:[[self versionDirPath:currentDir] stringByAppendingPathComponent:kWWWDirName]];
+
+    NSMutableArray<NSDictionary*> *retained = [self retainedVersionsInValues:snapshot];
+    NSIndexSet *staleRetained = [retained indexesOfObjectsPassingTest:^BOOL(NSDictionary *version, NSUInteger idx, BOOL *stop) {
+        if (!version[@"dir"]) {
+            // Откат на bundle, когда текущим становится сам bundle, не нужен
+            return currentStale;
+        }
+        return [self isStaleOverlayAtWWWPath:[[self versionDirPath:version[@"dir"]] stringByAppendingPathComponent:kWWWDirName]];
+    }];
+
+    NSString *stagedPath = [documentsPath stringByAppendingPathComponent:kTempDownloadedDirName];
+    BOOL stagedStale = [self isStaleOverlayAtWWWPath:[stagedPath stringByAppendingPathComponent:kWWWDirName]];
+
+    if (!currentStale && staleRetained.count == 0 && !stagedStale) {
+        return;
+    }
+    NSLog(@"[HotUpdates] App bundle changed to %@: dropping overlay versions made for the previous build%@",
+          [self bundleBuildIdentifier], currentStale ? @", serving the app bundle" : @"");
+
+    [retained removeObjectsAtIndexes:staleRetained];
+    [state commitChanges:^(NSMutableDictionary *values) {
+        if (currentStale) {
+            [values removeObjectsForKeys:@[kInstalledVersion, kCurrentVersionDir, kCanaryVersion]];
+        }
+        [self saveRetainedVersions:retained values:values];
+        if (stagedStale) {
+            values[kHasPending] = @NO;
+            values[kPendingUpdateReady] = @NO;
+            [values removeObjectsForKeys:@[kPendingVersion, kPendingWarmup]];
+        }
+    }];
+    if (stagedStale) {
+        isUpdateReadyToInstall = NO;
+        pendingUpdateVersion = nil;
+    }
+    [self pruneVersionsRemovingPaths:stagedStale ? @[stagedPath] : @[]];
+}
 
-- (void)savePreviousVersion:(NSString*)version {
-    if (!version) return;
+#pragma mark - Settings Management
 
-    [[NSUserDefaults standardUserDefaults] setObject:version forKey:kPreviousVersion];
-    [[NSUserDefaults standardUserDefaults] synchronize];
-    NSLog(@"[HotUpdates] Saved previous version: %@", version);
+- (void)loadIgnoreList {
+    NSArray *savedList = [state arrayForKey:kIgnoreList];
+    ignoreList = savedList ? [savedList mutableCopy] : [NSMutableArray array];
 }
 
-- (NSString*)getPreviousVersion {
-    return [[NSUserDefaults standardUserDefaults] stringForKey:kPreviousVersion];
+- (NSArray*)getIgnoreListInternal {
+    return [ignoreList copy];
 }
 
-- (void)backupCurrentVersion {
-    NSFileManager *fileManager = [NSFileManager defaultManager];
+/*!
+ * @brief Stage ignore list, written with the commit of the transition that changed it
+ */
+- (void)saveIgnoreList {
+    NSArray *list = [ignoreList copy];
+    [state stageChanges:^(NSMutableDictionary *values) {
+        values[kIgnoreList] = list;
+    }];
+}
+
+- (void)addVersionToIgnoreList:(NSString*)version {
+    if (version && ![ignoreList containsObject:version]) {
+        [ignoreList addObject:version];
+        [self saveIgnoreList];
+        NSLog(@"[HotUpdates] Added version %@ to ignore list", version);
+    }
+}
+
+- (void)getIgnoreList:(CDVInvokedUrlCommand*)command {
+    if ([self deferUntilStartup:^{ [self getIgnoreList:command]; }]) {
+        return;
+    }
+
+    NSArray *ignoreList = [self getIgnoreListInternal];
+
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK
+                                             messageAsDictionary:@{
+        @"versions": ignoreList
+    }];
+    [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+}
+
+#pragma mark - Version History Management
 
-    // Если текущая www папка существует
-    if ([fileManager fileExistsAtPath:wwwPath]) {
-        // Удаляем старую резервную копию
-        if ([fileManager fileExistsAtPath:previousVersionPath]) {
-            [fileManager removeItemAtPath:previousVersionPath error:nil];
+- (void)loadVersionHistory {
+    NSArray *savedHistory = [state arrayForKey:kVersionHistory];
+    if (savedHistory) {
+        versionHistory = [savedHistory mutableCopy];
+    } else {
+        versionHistory = [NSMutableArray array];
+        // При первом запуске добавляем исходную версию приложения
+        if (appBundleVersion) {
+            [versionHistory addObject:appBundleVersion];
+            [self saveVersionHistory];
+            NSLog(@"[HotUpdates] Initial version history created with app version: %@", appBundleVersion);
         }
+    }
+}
 
-        // Копируем текущую www в www_previous
-        NSError *error = nil;
-        BOOL success = [fileManager copyItemAtPath:wwwPath
-                                            toPath:previousVersionPath
-                                             error:&error];
+- (NSArray*)getVersionHistoryInternal {
+    return [versionHistory copy];
+}
 
-        if (success) {
-            NSString *currentVersion = [[NSUserDefaults standardUserDefaults] stringForKey:kInstalledVersion];
-            [self savePreviousVersion:currentVersion ?: appBundleVersion];
-            NSLog(@"[HotUpdates] Backed up version: %@", currentVersion ?: appBundleVersion);
-        } else {
-            NSLog(@"[HotUpdates] Backup failed: %@", error.localizedDescription);
+/*!
+ * @brief Stage version history, written with the commit of the transition that changed it
+ */
+- (void)saveVersionHistory {
+    NSArray *history = [versionHistory copy];
+    [state stageChanges:^(NSMutableDictionary *values) {
+        values[kVersionHistory] = history;
+    }];
+}
+
+- (void)addVersionToHistory:(NSString*)version {
+    if (version && ![versionHistory containsObject:version]) {
+        [versionHistory addObject:version];
+        [self saveVersionHistory];
+        NSLog(@"[HotUpdates] Added version %@ to version history", version);
+    }
+}
+
+- (void)removeVersionFromHistory:(NSString*)version {
+    if (version && [versionHistory containsObject:version]) {
+        [versionHistory removeObject:version];
+        [self saveVersionHistory];
+        NSLog(@"[HotUpdates] Removed version %@ from version history", version);
+    }
+}
+
+- (void)getVersionHistory:(CDVInvokedUrlCommand*)command {
+    if ([self deferUntilStartup:^{ [self getVersionHistory:command]; }]) {
+        return;
+    }
+
+    NSArray *history = [self getVersionHistoryInternal];
+
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK
+                                             messageAsDictionary:@{
+        @"versions": history
+    }];
+    [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+}
+
+#pragma mark - Canary Timer
+
+/*!
+ * @brief Start canary timer with the deadline measured for this device
+ */
+- (void)startCanaryTimer {
+    canaryStartTime = [HotUpdatesMetrics now];
+    canaryTimeoutInterval = [self canaryTimeoutInValues:[state snapshot]];
+    canaryExtended = NO;
+    [self scheduleCanaryTimerAfter:canaryTimeoutInterval];
+}
+
+/*!
+ * @brief (Re)schedule canary timer with weak self to prevent retain cycle
+ * @details Uses block-based timer (iOS 10+) with weak reference
+ */
+- (void)scheduleCanaryTimerAfter:(NSTimeInterval)interval {
+    // Инвалидируем предыдущий таймер если есть
+    if (canaryTimer && [canaryTimer isValid]) {
+        [canaryTimer invalidate];
+        canaryTimer = nil;
+    }
+
+    // Используем weak self для предотвращения retain cycle
+    __weak __typeof__(self) weakSelf = self;
+    canaryTimer = [NSTimer scheduledTimerWithTimeInterval:interval
+                                                  repeats:NO
+                                                    block:^(NSTimer * _Nonnull timer) {
+        [weakSelf canaryTimeout];
+    }];
+}
+
+/*!
+ * @brief Canary deadline derived from the load times measured on this device
+ * @details A multiple of their 90th percentile within kCanaryMinTimeout...kCanaryMaxTimeout;
+ *          kCanaryTimeout until kCanaryMinSamples loads were measured
+ */
+- (NSTimeInterval)canaryTimeoutInValues:(NSDictionary*)values {
+    NSArray<NSDictionary*> *samples = [self canaryLatenciesInValues:values];
+    if (samples.count < kCanaryMinSamples) {
+        return kCanaryTimeout;
+    }
+
+    NSArray<NSNumber*> *latencies = [[samples valueForKey:@"ms"] sortedArrayUsingSelector:@selector(compare:)];
+    // Nearest-rank percentile
+    NSUInteger rank = (kCanaryLatencyPercentile * latencies.count + 99) / 100;
+    NSTimeInterval percentile = latencies[MAX(rank, 1) - 1].doubleValue / 1000.0;
+
+    return MAX(kCanaryMinTimeout, MIN(kCanaryMaxTimeout, percentile * kCanaryTimeoutFactor));
+}
+
+/*!
+ * @brief Measured load times, oldest first; malformed entries are dropped
+ */
+- (NSArray<NSDictionary*>*)canaryLatenciesInValues:(NSDictionary*)values {
+    NSArray *saved = values[kCanaryLatencies];
+    if (![saved isKindOfClass:[NSArray class]]) {
+        return @[];
+    }
+    NSMutableArray<NSDictionary*> *samples = [NSMutableArray array];
+    for (NSDictionary *sample in saved) {
+        if ([sample isKindOfClass:[NSDictionary class]] && [sample[@"ms"] isKindOfClass:[NSNumber class]]) {
+            [samples addObject:sample];
         }
     }
+    return samples;
 }
 
-- (BOOL)rollbackToPreviousVersion {
-    NSFileManager *fileManager = [NSFileManager defaultManager];
+/*!
+ * @brief Append a load time, only the last kCanaryLatencySamples are kept
+ * @details Called inside commitChanges:
+ */
+- (void)addCanaryLatency:(NSTimeInterval)latency version:(NSString*)version values:(NSMutableDictionary*)values {
+    NSMutableArray<NSDictionary*> *samples = [[self canaryLatenciesInValues:values] mutableCopy];
+    [samples addObject:@{@"version": version, @"ms": @((long long)(latency * 1000))}];
+    if (samples.count > kCanaryLatencySamples) {
+        [samples removeObjectsInRange:NSMakeRange(0, samples.count - kCanaryLatencySamples)];
+    }
+    values[kCanaryLatencies] = samples;
+    NSLog(@"[HotUpdates] Canary load time of v%@: %.0f ms", version, latency * 1000);
+}
 
-    NSString *currentVersion = [[NSUserDefaults standardUserDefaults] stringForKey:kInstalledVersion];
-    NSString *previousVersion = [self getPreviousVersion];
+#pragma mark - Canary Timeout Handler
 
-    NSLog(@"[HotUpdates] Rollback: %@ -> %@", currentVersion ?: @"bundle", previousVersion ?: @"nil");
+- (void)canaryTimeout {
+    NSLog(@"[HotUpdates] CANARY TIMEOUT - JS did not call canary() within %.0f seconds", canaryTimeoutInterval);
+
+    NSString *currentVersion = [state stringForKey:kInstalledVersion];
+    NSString *previousVersion = [self getPreviousVersion];
 
     if (!previousVersion || previousVersion.length == 0) {
+        NSLog(@"[HotUpdates] Fresh install from Store, rollback not possible");
+        return;
+    }
+
+    NSLog(@"[HotUpdates] Version %@ considered faulty, performing rollback", currentVersion);
+
+    // Примечание: версия добавляется в ignoreList внутри rollbackToPreviousVersion
+    BOOL rollbackSuccess = [self rollbackToPreviousVersion];
+
+    if (rollbackSuccess) {
+        NSLog(@"[HotUpdates] Automatic rollback completed successfully");
+
+        hasPerformedInitialReload = NO;
+
+        [self invalidateWebViewCacheWithCompletion:^{
+            [self reloadWebView];
+        }];
+    } else {
+        NSLog(@"[HotUpdates] Automatic rollback failed");
+    }
+}
+
+#pragma mark - Rollback Mechanism
+
+- (NSString*)getPreviousVersion {
+    return [state stringForKey:kPreviousVersion];
+}
+
+- (BOOL)rollbackToPreviousVersion {
+    NSString *currentVersion = [state stringForKey:kInstalledVersion];
+    NSMutableArray<NSDictionary*> *retained = [self retainedVersionsInValues:[state snapshot]];
+
+    if (retained.count == 0) {
         NSLog(@"[HotUpdates] Rollback failed: no previous version");
         return NO;
     }
+    NSDictionary *previous = retained.firstObject;
+    [retained removeObjectAtIndex:0];
+    NSString *previousVersion = previous[@"version"];
+
+    NSLog(@"[HotUpdates] Rollback: %@ -> %@", currentVersion ?: @"bundle", previousVersion);
+
+    // Защита от цикла rollback
+    NSString *effectiveCurrentVersion = currentVersion ?: appBundleVersion;
+    if ([previousVersion isEqualToString:effectiveCurrentVersion]) {
+        NSLog(@"[HotUpdates] Rollback failed: cannot rollback to same version");
+        return NO;
+    }
+
+    if (currentVersion) {
+        [self addVersionToIgnoreList:currentVersion];
+        // Удаляем откаченную версию из истории (она не прошла canary)
+        [self removeVersionFromHistory:currentVersion];
+    }
+
+    // Переключаем указатель обратно, файлы не копируются и не переносятся.
+    // Целью следующего отката становится следующая сохранённая версия.
+    // Ignore list и история записываются тем же коммитом
+    [state commitChanges:^(NSMutableDictionary *values) {
+        [self setCurrentVersion:previous values:values];
+        [self saveRetainedVersions:retained values:values];
+    }];
+
+    NSLog(@"[HotUpdates] Rollback successful: %@ -> %@", currentVersion, previousVersion);
+
+    // Директория сбойной версии больше не нужна
+    [self pruneVersionsRemovingPaths:@[]];
+
+    return YES;
+}
+
+#pragma mark - Rollback To (Retained Version)
+
+/*!
+ * @brief Make a retained version current without downloading it
+ * @details The version left becomes the rollback target, so a canary timeout returns to it
+ */
+- (void)rollbackTo:(CDVInvokedUrlCommand*)command {
+    if ([self deferUntilStartup:^{ [self rollbackTo:command]; }]) {
+        return;
+    }
+
+    NSString *version = nil;
+    if (command.arguments.count > 0 && [command.arguments[0] isKindOfClass:[NSString class]]) {
+        version = command.arguments[0];
+    }
+    if (version.length == 0) {
+        [self sendError:kErrorVersionRequired message:@"Version is required" callbackId:command.callbackId];
+        return;
+    }
+
+    NSDictionary *snapshot = [state snapshot];
+    NSString *currentDir = snapshot[kCurrentVersionDir];
+    NSString *currentVersion = currentDir ? (snapshot[kInstalledVersion] ?: appBundleVersion) : appBundleVersion;
+    if ([version isEqualToString:currentVersion]) {
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK];
+        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+        return;
+    }
+
+    NSMutableArray<NSDictionary*> *retained = [self retainedVersionsInValues:snapshot];
+    NSUInteger index = [retained indexOfObjectPassingTest:^BOOL(NSDictionary *item, NSUInteger idx, BOOL *stop) {
+        return [item[@"version"] isEqualToString:version];
+    }];
+    if (index == NSNotFound) {
+        [self sendError:kErrorVersionNotRetained
+                message:[NSString stringWithFormat:@"Version %@ is not retained", version]
+             callbackId:command.callbackId];
+        return;
+    }
+
+    NSLog(@"[HotUpdates] rollbackTo: %@ -> %@", currentVersion, version);
+
+    NSDictionary *target = retained[index];
+    [retained removeObjectAtIndex:index];
+    [retained insertObject:[self retainedVersion:currentVersion dir:currentDir] atIndex:0];
+
+    BOOL saved = [state commitChanges:^(NSMutableDictionary *values) {
+        [self setCurrentVersion:target values:values];
+        [self saveRetainedVersions:retained values:values];
+        [values removeObjectForKey:kCanaryVersion];
+    }];
+    if (!saved) {
+        [self sendError:kErrorInstallFailed message:@"Rollback failed: cannot save state" callbackId:command.callbackId];
+        return;
+    }
+
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK];
+    [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+
+    [self startCanaryTimer];
+    hasPerformedInitialReload = NO;
+
+    [self invalidateWebViewCacheWithCompletion:^{
+        [self reloadWebView];
+    }];
+
+    // Лимит хранения мог вытеснить самую старую версию
+    [self pruneVersionsRemovingPaths:@[]];
+}
+
+#pragma mark - Get Update (Download Only)
+
+- (void)getUpdate:(CDVInvokedUrlCommand*)command {
+    if ([self deferUntilStartup:^{ [self getUpdate:command]; }]) {
+        return;
+    }
+
+    // Безопасное получение первого аргумента
+    NSDictionary *updateData = nil;
+    if (command.arguments.count > 0 && [command.arguments[0] isKindOfClass:[NSDictionary class]]) {
+        updateData = command.arguments[0];
+    }
+
+    if (!updateData) {
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
+                                                 messageAsDictionary:[self createError:kErrorUpdateDataRequired
+                                                                                message:@"Update data required"]];
+        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+        return;
+    }
+
+    NSString *downloadURL = [updateData objectForKey:@"url"];
+    NSString *manifestURL = [updateData objectForKey:@"manifestUrl"];
+
+    if (!downloadURL && !manifestURL) {
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
+                                                 messageAsDictionary:[self createError:kErrorURLRequired
+                                                                                message:@"URL is required"]];
+        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+        return;
+    }
+
+    NSString *updateVersion = [updateData objectForKey:@"version"];
+    if (!updateVersion) {
+        updateVersion = @"pending";
+    }
+
+    NSLog(@"[HotUpdates] getUpdate: v%@ from %@", updateVersion, manifestURL ?: downloadURL);
+
+    NSString *installedVersion = [state stringForKey:kInstalledVersion];
+    if (installedVersion && [installedVersion isEqualToString:updateVersion]) {
+        NSLog(@"[HotUpdates] Version %@ already installed, skipping download", updateVersion);
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK];
+        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+        return;
+    }
+
+    BOOL hasPending = [state boolForKey:kHasPending];
+    NSString *existingPendingVersion = [state stringForKey:kPendingVersion];
+
+    if (hasPending && existingPendingVersion && [existingPendingVersion isEqualToString:updateVersion]) {
+        NSLog(@"[HotUpdates] Version %@ already downloaded, skipping re-download", updateVersion);
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK];
+        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+        return;
+    }
+
+    BOOL background = [[updateData objectForKey:@"background"] boolValue];
+    BOOL packed = [[updateData objectForKey:@"packed"] boolValue];
+    BOOL progress = [[updateData objectForKey:@"progress"] boolValue];
+    BOOL lowStorage = [[updateData objectForKey:@"lowStorage"] boolValue];
+    NSString *verifyManifestURL = [updateData objectForKey:@"verifyManifestUrl"];
+    if (![verifyManifestURL isKindOfClass:[NSString class]] || verifyManifestURL.length == 0) {
+        verifyManifestURL = nil;
+    }
+    if (!manifestURL && !verifyManifestURL && [self manifestPublicKey]) {
+        // Ключ подписи задан: неподписанный архив отклоняем, как и неподписанный delta манифест
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
+                                                 messageAsDictionary:[self createError:kErrorSignatureInvalid
+                                                                                message:kManifestRequiredMessage]];
+        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+        return;
+    }
+
+    // Та же версия уже загружается - ждём её результата. Любая другая версия заменяет загрузку
+    HotUpdatesDownloadJob *job = [[HotUpdatesDownloadJob alloc] initWithVersion:updateVersion
+                                                                     callbackId:command.callbackId
+                                                                       progress:progress];
+    HotUpdatesDownloadJob *replaced = nil;
+    @synchronized (self) {
+        if ([downloadJob.version isEqualToString:updateVersion] && [downloadJob attachCallbackId:command.callbackId progress:progress]) {
+            NSLog(@"[HotUpdates] Download of v%@ already in progress, waiting for it", updateVersion);
+            return;
+        }
+        replaced = downloadJob;
+        downloadJob = job;
+    }
+    if (replaced) {
+        NSLog(@"[HotUpdates] Download of v%@ replaced by v%@", replaced.version, updateVersion);
+        [self abortDownloadJob:replaced message:[NSString stringWithFormat:@"Download replaced by v%@", updateVersion]];
+    }
+
+    NSString *callbackId = command.callbackId;
+    void (^startDownload)(void) = ^{
+        if (manifestURL) {
+            // Delta - много мелких запросов, всегда в foreground
+            [self downloadDeltaUpdate:manifestURL callbackId:callbackId];
+        } else if (background) {
+            void (^startBackground)(void) = ^{
+                [self startBackgroundDownload:downloadURL
+                                       packed:packed
+                                     wifiOnly:[[updateData objectForKey:@"wifiOnly"] boolValue]
+                             requiresCharging:[[updateData objectForKey:@"requiresCharging"] boolValue]
+                                   callbackId:callbackId];
+            };
+            if (!lowStorage) {
+                startBackground();
+                return;
+            }
+            [self freeStorageWithCompletion:^{
+                if (![self endIfDownloadCancelled:callbackId]) {
+                    startBackground();
+                }
+            }];
+        } else {
+            [self downloadUpdateOnly:downloadURL
+                         connections:[[updateData objectForKey:@"connections"] integerValue]
+                              packed:packed
+                          lowStorage:lowStorage
+                          callbackId:callbackId];
+        }
+    };
+
+    // Запускается, когда загрузка заменённой задачи остановлена и освободила временные директории
+    job.start = ^{
+        // Сохраняем только в память, в state запишем после успешной загрузки
+        self->pendingUpdateURL = manifestURL ?: downloadURL;
+        self->pendingUpdateVersion = updateVersion;
+        self->pendingVerifier = nil;
+
+        if (!verifyManifestURL || manifestURL) {
+            startDownload();
+            return;
+        }
+
+        // Подписанный манифест нужен до начала загрузки: хеши считаются во время распаковки
+        NSURLSession *session = [NSURLSession sessionWithConfiguration:[NSURLSessionConfiguration defaultSessionConfiguration]];
+        [HotUpdatesVerifier loadManifestAtURL:[NSURL URLWithString:verifyManifestURL]
+                                    publicKey:[self manifestPublicKey]
+                                      session:session
+                                   completion:^(HotUpdatesVerifier *verifier, NSError *error) {
+            [session finishTasksAndInvalidate];
+            dispatch_async(dispatch_get_main_queue(), ^{
+                if ([self endIfDownloadCancelled:callbackId]) {
+                    return;
+                }
+
+                if (!verifier) {
+                    NSString *code = kErrorManifestInvalid;
+                    if (error.code == HotUpdatesVerifierErrorSignature) {
+                        code = kErrorSignatureInvalid;
+                    } else if (error.code == HotUpdatesVerifierErrorDownload) {
+                        code = [error.localizedDescription hasPrefix:@"HTTP error:"] ? kErrorHTTPError : kErrorDownloadFailed;
+                    }
+                    [self failDownload:code message:error.localizedDescription callbackId:callbackId];
+                    return;
+                }
+
+                NSLog(@"[HotUpdates] Update will be verified against signed manifest");
+                self->pendingVerifier = verifier;
+                startDownload();
+            });
+        }];
+        [self registerSession:session callbackId:callbackId];
+    };
+
+    [self startNextDownload];
+}
+
+#pragma mark - Download Coordination
+
+/*!
+ * @brief Start the latest requested job once no transfer is running
+ * @details A replaced job keeps the temp directories until its transfer has stopped; the next
+ *          job is started from its failDownload / staging result. Main thread.
+ */
+- (void)startNextDownload {
+    void (^start)(void) = nil;
+    @synchronized (self) {
+        start = downloadJob.start;
+        if (transferJob || !start) {
+            return;
+        }
+        transferJob = downloadJob;
+        transferJob.start = nil;
+    }
+    [self attachProgressToJob:transferJob];
+    start();
+}
+
+/*!
+ * @brief Create the progress reporter of a job whose transfer starts
+ * @details Events go to the getUpdate callbacks that asked for them, and keep those callbacks open
+ */
+- (void)attachProgressToJob:(HotUpdatesDownloadJob*)job {
+    __weak HotUpdatesDownloadJob *weakJob = job;
+    job.progress = [[HotUpdatesProgress alloc] initWithHandler:^(NSString *phase, long long bytes, long long totalBytes,
+                                                                 long long bytesPerSecond, long long etaSeconds) {
+        HotUpdatesDownloadJob *strongJob = weakJob;
+        NSArray<NSString*> *callbackIds = strongJob.progressCallbackIds;
+        if (callbackIds.count == 0) {
+            return;
+        }
+
+        NSDictionary *event = @{
+            @"type": @"progress",
+            @"version": strongJob.version ?: @"pending",
+            @"phase": phase,
+            @"bytesReceived": @(bytes),
+            @"totalBytes": @(totalBytes),
+            @"bytesPerSecond": @(bytesPerSecond),
+            @"etaSeconds": @(etaSeconds)
+        };
+        for (NSString *callbackId in callbackIds) {
+            CDVPluginResult *result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:event];
+            [result setKeepCallbackAsBool:YES];
+            [self.commandDelegate sendPluginResult:result callbackId:callbackId];
+        }
+    }];
+}
+
+/*!
+ * @brief Progress reporter of the running transfer
+ * @return nil if the job of callbackId is not the running transfer (messages to nil are no-ops)
+ */
+- (HotUpdatesProgress*)progressForDownload:(NSString*)callbackId {
+    @synchronized (self) {
+        return [transferJob.identifier isEqualToString:callbackId] ? transferJob.progress : nil;
+    }
+}
+
+/*!
+ * @brief Cancel job: report CANCELLED to its callbacks now and cancel its URL session tasks
+ * @details The transfer ends shortly after through failDownload, its result is dropped
+ */
+- (void)abortDownloadJob:(HotUpdatesDownloadJob*)job message:(NSString*)message {
+    for (NSString *callbackId in [job cancel]) {
+        [self sendError:kErrorCancelled message:message callbackId:callbackId];
+    }
+}
+
+/*!
+ * @brief Cancel the tasks of this session when the running job is cancelled
+ * @param callbackId Identifier of the job passed through the download methods
+ */
+- (void)registerSession:(NSURLSession*)session callbackId:(NSString*)callbackId {
+    HotUpdatesDownloadJob *job = nil;
+    @synchronized (self) {
+        if ([transferJob.identifier isEqualToString:callbackId]) {
+            job = transferJob;
+        }
+    }
+    [job addSession:session];
+}
+
+- (BOOL)isDownloadCancelled:(NSString*)callbackId {
+    @synchronized (self) {
+        return [transferJob.identifier isEqualToString:callbackId] && transferJob.isCancelled;
+    }
+}
+
+/*!
+ * @brief Stop a cancelled job before its next transfer step (fallback, retry, staging)
+ * @return YES if the job was cancelled and has been finished
+ */
+- (BOOL)endIfDownloadCancelled:(NSString*)callbackId {
+    if (![self isDownloadCancelled:callbackId]) {
+        return NO;
+    }
+    [self failDownload:kErrorCancelled message:@"Download cancelled" callbackId:callbackId];
+    return YES;
+}
+
+/*!
+ * @brief Release the transfer of a job once it stopped
+ * @details Partial files of a cancelled job are deleted here and waiting cancelUpdate calls
+ *          answered; then the next requested job starts.
+ * @return Callback ids to report the result to, nil if the job was cancelled (already answered)
+ */
+- (NSArray<NSString*>*)finishDownloadJob:(NSString*)callbackId {
+    HotUpdatesDownloadJob *job = nil;
+    NSArray<NSString*> *cancelled = nil;
+    @synchronized (self) {
+        if (![transferJob.identifier isEqualToString:callbackId]) {
+            return @[callbackId];
+        }
+        job = transferJob;
+        transferJob = nil;
+        if (downloadJob == job) {
+            downloadJob = nil;
+        }
+        if (job.isCancelled) {
+            cancelled = [cancelCallbackIds copy];
+            [cancelCallbackIds removeAllObjects];
+        }
+    }
+
+    NSArray<NSString*> *callbackIds = [job finish];
+    if (!callbackIds) {
+        NSLog(@"[HotUpdates] Cancelled download of v%@ stopped", job.version);
+        [self discardPartialDownload];
+        for (NSString *cancelCallbackId in cancelled) {
+            [self.commandDelegate sendPluginResult:[CDVPluginResult resultWithStatus:CDVCommandStatus_OK]
+                                        callbackId:cancelCallbackId];
+        }
+    }
+
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self startNextDownload];
+    });
+    return callbackIds;
+}
+
+/*!
+ * @brief Delete partial files of an abandoned transfer together with its resume state
+ * @details Only while no transfer is running
+ */
+- (void)discardPartialDownload {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    for (NSString *name in @[kTempNewDownloadDirName, kSegmentedZipFileName, kPackedZipFileName, kBackgroundZipFileName]) {
+        [fileManager removeItemAtPath:[documentsPath stringByAppendingPathComponent:name] error:nil];
+    }
+    [self clearBackgroundDownloadStateKeepingResumeData:NO];
+    [self clearResumeState];
+    NSLog(@"[HotUpdates] Partial download discarded");
+}
+
+#pragma mark - Cancel Update
+
+/*!
+ * @brief Abort the running download and delete its partial files
+ * @details Also drops resume data of an earlier interrupted transfer. Waiting getUpdate calls get
+ *          CANCELLED right away; this callback fires once the transfer has stopped and the temp
+ *          files are gone.
+ */
+- (void)cancelUpdate:(CDVInvokedUrlCommand*)command {
+    if ([self deferUntilStartup:^{ [self cancelUpdate:command]; }]) {
+        return;
+    }
+
+    HotUpdatesDownloadJob *job = nil;
+    BOOL transferRunning = NO;
+    @synchronized (self) {
+        job = downloadJob;
+        downloadJob = nil;
+        transferRunning = transferJob != nil;
+        if (transferRunning) {
+            [cancelCallbackIds addObject:command.callbackId];
+        }
+    }
+
+    if (job) {
+        NSLog(@"[HotUpdates] Cancelling download of v%@", job.version);
+        [self abortDownloadJob:job message:@"Download cancelled"];
+    }
+
+    if (!transferRunning) {
+        [self discardPartialDownload];
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK];
+        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+    }
+}
+
+/*!
+ * @brief Download ZIP update (foreground)
+ * @details Free space is checked first against the declared sizes (archive size from a HEAD
+ *          request, extracted size from the signed manifest). An update that does not fit
+ *          switches to low-storage mode; if it still does not fit, INSUFFICIENT_STORAGE.
+ * @param connections Parallel connections; more than 1 enables segmented download when the server
+ *                    supports ranges and the archive is large enough, otherwise one streaming connection
+ * @param packed Keep the archive as one file served without extraction (see HotUpdatesPack)
+ * @param lowStorage Start in low-storage mode (see freeStorageWithCompletion:)
+ */
+- (void)downloadUpdateOnly:(NSString*)downloadURL
+               connections:(NSInteger)connections
+                    packed:(BOOL)packed
+                lowStorage:(BOOL)lowStorage
+                callbackId:(NSString*)callbackId {
+    [self setDownloadInProgress:YES];
+
+    NSLog(@"[HotUpdates] Starting download%@", lowStorage ? @" (low storage)" : @"");
+
+    NSURL *url = [NSURL URLWithString:downloadURL];
+    if (!url) {
+        [self failDownload:kErrorURLRequired message:@"Invalid URL format" callbackId:callbackId];
+        return;
+    }
+
+    NSURLSessionConfiguration *config = [NSURLSessionConfiguration defaultSessionConfiguration];
+    config.timeoutIntervalForRequest = 30.0;  // ТЗ: 30-60 секунд
+    config.timeoutIntervalForResource = 60.0; // ТЗ: максимум 60 секунд на всю загрузку
+
+    [self fetchArchiveSizeAtURL:url configuration:config callbackId:callbackId completion:^(long long archiveSize) {
+        if ([self endIfDownloadCancelled:callbackId]) {
+            return;
+        }
+
+        // Поток распаковывается сразу: на диске только файлы, записи прерванной загрузки уже там
+        NSString *extractPath = [[self->documentsPath stringByAppendingPathComponent:kTempNewDownloadDirName]
+                                 stringByAppendingPathComponent:@"temp_extract"];
+        long long expectedSize = [self expectedSizeForArchiveSize:archiveSize];
+        long long resumeOffset = [self resumeOffsetForURL:url.absoluteString version:self->pendingUpdateVersion partialPath:extractPath];
+        long long streamBytes = expectedSize >= 0 ? MAX(0, expectedSize - resumeOffset) : -1;
+        // Пакет переносится как есть; сегментированная загрузка держит архив рядом с распакованными файлами
+        long long packedBytes = archiveSize;
+        long long segmentedBytes = archiveSize >= 0 && expectedSize >= 0 ? archiveSize + expectedSize : -1;
+
+        long long requiredBytes = packed ? packedBytes : (connections > 1 ? segmentedBytes : streamBytes);
+        if (!lowStorage && [self hasSpaceForBytes:requiredBytes]) {
+            if (connections > 1) {
+                [self segmentedUpdateFromURL:url configuration:config connections:connections packed:packed callbackId:callbackId];
+            } else if (packed) {
+                [self packedUpdateFromURL:url configuration:config callbackId:callbackId];
+            } else {
+                [self streamUpdateFromURL:url configuration:config allowResume:YES callbackId:callbackId];
+            }
+            return;
+        }
+
+        if (!lowStorage) {
+            NSLog(@"[HotUpdates] Not enough storage for download, switching to low-storage mode");
+        }
+        [self freeStorageWithCompletion:^{
+            if ([self endIfDownloadCancelled:callbackId]) {
+                return;
+            }
+
+            long long bytes = packed ? packedBytes : streamBytes;
+            if (![self hasSpaceForBytes:bytes]) {
+                [self failDownload:kErrorInsufficientStorage message:[self insufficientStorageMessage:bytes] callbackId:callbackId];
+                return;
+            }
+
+            // Одно соединение: распаковка в потоке, архив на диск не пишется
+            if (packed) {
+                [self packedUpdateFromURL:url configuration:config callbackId:callbackId];
+            } else {
+                [self streamUpdateFromURL:url configuration:config allowResume:YES callbackId:callbackId];
+            }
+        }];
+    }];
+}
+
+/*!
+ * @brief Download ZIP over several parallel connections into a file, then extract it
+ * @details Falls back to the streaming download if the server cannot serve ranges.
+ *          Segments are not resumable; streaming resume state of an earlier attempt is dropped.
+ */
+- (void)segmentedUpdateFromURL:(NSURL*)url
+                 configuration:(NSURLSessionConfiguration*)config
+                   connections:(NSInteger)connections
+                        packed:(BOOL)packed
+                    callbackId:(NSString*)callbackId {
+    NSString *zipPath = [documentsPath stringByAppendingPathComponent:kSegmentedZipFileName];
+    NSTimeInterval startTime = [HotUpdatesMetrics now];
+
+    NSURLSession *session = [HotUpdatesSegmentedDownload downloadURL:url
+                                                              toFile:zipPath
+                                                         connections:connections
+                                                       configuration:config
+                                                            reporter:[self progressForDownload:callbackId]
+                                                          completion:^(BOOL supported, NSInteger statusCode, NSError *error) {
+        if ([self endIfDownloadCancelled:callbackId]) {
+            return;
+        }
+
+        if (!supported && statusCode == 0) {
+            NSLog(@"[HotUpdates] Segmented download not possible, using single connection");
+            if (packed) {
+                [self packedUpdateFromURL:url configuration:config callbackId:callbackId];
+            } else {
+                [self streamUpdateFromURL:url configuration:config allowResume:YES callbackId:callbackId];
+            }
+            return;
+        }
+
+        if (statusCode != 0 || [error.localizedDescription hasPrefix:@"HTTP error:"]) {
+            [self failDownload:kErrorHTTPError
+                       message:statusCode != 0 ? [NSString stringWithFormat:@"HTTP error: %ld", (long)statusCode] : error.localizedDescription
+                    callbackId:callbackId];
+            return;
+        }
+
+        if (error) {
+            [self failDownload:kErrorDownloadFailed
+                       message:[NSString stringWithFormat:@"Download failed: %@", error.localizedDescription]
+                    callbackId:callbackId];
+            return;
+        }
+
+        long long size = [[[NSFileManager defaultManager] attributesOfItemAtPath:zipPath error:nil] fileSize];
+        NSTimeInterval endTime = [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageDownload since:startTime bytes:size];
+        NSLog(@"[HotUpdates] Segmented download completed in %.0f ms", (endTime - startTime) * 1000);
+
+        [self clearResumeState];
+        [self installArchiveAtPath:zipPath packed:packed callbackId:callbackId];
+    }];
+    [self registerSession:session callbackId:callbackId];
+}
+
+/*!
+ * @brief Download ZIP over one connection into a file, then install it
+ * @details Used for packed updates, which need the complete archive on disk. Not resumable.
+ */
+- (void)packedUpdateFromURL:(NSURL*)url
+              configuration:(NSURLSessionConfiguration*)config
+                 callbackId:(NSString*)callbackId {
+    NSString *zipPath = [documentsPath stringByAppendingPathComponent:kPackedZipFileName];
+
+    [self clearResumeState];
+    NSTimeInterval startTime = [HotUpdatesMetrics now];
+
+    NSURLSession *session = [HotUpdatesFileDownload downloadURL:url
+                                                         toFile:zipPath
+                                                  configuration:config
+                                                       reporter:[self progressForDownload:callbackId]
+                                                     completion:^(NSInteger statusCode, NSError *error) {
+        if (error) {
+            [self failDownload:kErrorDownloadFailed
+                       message:[NSString stringWithFormat:@"Download failed: %@", error.localizedDescription]
+                    callbackId:callbackId];
+        } else if (statusCode != 200) {
+            [self failDownload:kErrorHTTPError
+                       message:[NSString stringWithFormat:@"HTTP error: %ld", (long)statusCode]
+                    callbackId:callbackId];
+        } else {
+            [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageDownload
+                                     since:startTime
+                                     bytes:[[[NSFileManager defaultManager] attributesOfItemAtPath:zipPath error:nil] fileSize]];
+            [self installArchiveAtPath:zipPath packed:YES callbackId:callbackId];
+        }
+    }];
+    [self registerSession:session callbackId:callbackId];
+}
+
+/*!
+ * @brief Stage complete archive and report result
+ * @details With packed the archive is moved as is into www/bundle.pack when it qualifies
+ *          (stored entries, scheme handler available); otherwise it is extracted on all cores.
+ *          The archive file is consumed in both cases.
+ */
+- (void)installArchiveAtPath:(NSString*)zipPath packed:(BOOL)packed callbackId:(NSString*)callbackId {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSString *newDownloadPath = [documentsPath stringByAppendingPathComponent:kTempNewDownloadDirName];
+    [fileManager removeItemAtPath:newDownloadPath error:nil];
+
+    HotUpdatesVerifier *verifier = pendingVerifier;
+    HotUpdatesProgress *progress = [self progressForDownload:callbackId];
+    NSMutableDictionary<NSString*, NSString*> *hashes = [NSMutableDictionary dictionary];
+    BOOL success = [self installArchive:zipPath packed:packed toDestination:newDownloadPath
+                               verifier:verifier progress:progress hashes:hashes];
+    [fileManager removeItemAtPath:zipPath error:nil];
+
+    if (!success) {
+        // До удаления распакованного: диск, заполненный распаковкой, - нехватка места
+        NSString *code = verifier.failure ? kErrorHashMismatch : [self extractionErrorCode:nil];
+        [fileManager removeItemAtPath:newDownloadPath error:nil];
+        if (verifier.failure) {
+            [self failDownload:code message:verifier.failure.localizedDescription callbackId:callbackId];
+        } else {
+            [self failDownload:code message:[self extractionErrorMessage:code] callbackId:callbackId];
+        }
+        return;
+    }
+
+    pendingHashes = hashes;
+    [self stageUpdateFromDirectory:newDownloadPath callbackId:callbackId];
+}
+
+/*!
+ * @brief Keep complete archive as pack when requested and possible, extract it otherwise
+ * @param progress Receives the verifying (pack CRC check) or extracting phase (nil to skip)
+ * @param hashes Filled with the digests of the extracted files, see unzipFile:...hashes: (nil to skip)
+ */
+- (BOOL)installArchive:(NSString*)zipPath
+                packed:(BOOL)packed
+         toDestination:(NSString*)destination
+              verifier:(HotUpdatesVerifier*)verifier
+              progress:(HotUpdatesProgress*)progress
+                hashes:(NSMutableDictionary<NSString*, NSString*>*)hashes {
+    if (packed && [self canServePackedBundle]) {
+        [progress startPhase:kProgressPhaseVerifying bytes:0 totalBytes:-1];
+        if ([self packArchive:zipPath toDestination:destination verifier:verifier]) {
+            return YES;
+        }
+    }
+    return !verifier.failure && [self unzipFile:zipPath toDestination:destination verifier:verifier reporter:progress hashes:hashes];
+}
+
+/*!
+ * @brief Download ZIP and extract it while bytes arrive
+ * @details Network and inflate overlap, and no disk space is needed for the archive itself.
+ *          An interrupted transfer of the same URL and version continues from the last
+ *          complete entry (Range / If-Range) with the entries extracted so far kept.
+ * @param allowResume NO to force a full download (server rejected the saved range)
+ */
+- (void)streamUpdateFromURL:(NSURL*)url
+              configuration:(NSURLSessionConfiguration*)config
+                allowResume:(BOOL)allowResume
+                 callbackId:(NSString*)callbackId {
+    // Используем временную папку для новой загрузки (не трогаем существующую temp_downloaded_update)
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSString *newDownloadPath = [documentsPath stringByAppendingPathComponent:kTempNewDownloadDirName];
+    NSString *extractPath = [newDownloadPath stringByAppendingPathComponent:@"temp_extract"];
+
+    NSString *version = pendingUpdateVersion;
+    long long resumeOffset = allowResume ? [self resumeOffsetForURL:url.absoluteString version:version partialPath:extractPath] : 0;
+    NSString *validator = resumeOffset > 0 ? [state stringForKey:kResumeValidator] : nil;
+
+    if (resumeOffset > 0) {
+        NSLog(@"[HotUpdates] Resuming download at %lld bytes", resumeOffset);
+    } else {
+        [self clearResumeState];
+        [fileManager removeItemAtPath:newDownloadPath error:nil];
+        if (![fileManager createDirectoryAtPath:extractPath withIntermediateDirectories:YES attributes:nil error:nil]) {
+            [self failDownload:kErrorTempDirError message:@"Cannot create temp directory" callbackId:callbackId];
+            return;
+        }
+    }
+
+    __block long long lastSavedOffset = resumeOffset;
+    NSTimeInterval startTime = [HotUpdatesMetrics now];
+
+    // Распаковываем по мере поступления байтов: сеть и inflate идут параллельно,
+    // и место под сам архив на диске не нужно
+    NSURLSession *session = [HotUpdatesZipStream extractArchiveAtURL:url
+                                                         toDirectory:extractPath
+                                                        resumeOffset:resumeOffset
+                                                           validator:validator
+                                                       configuration:config
+                                                            verifier:pendingVerifier
+                                                            progress:^(long long committedOffset) {
+        // Не чаще раза в мегабайт: устаревшее смещение лишь распакует часть записей повторно
+        if (committedOffset - lastSavedOffset >= kResumeSaveIntervalBytes) {
+            [self->state stageChanges:^(NSMutableDictionary *values) {
+                values[kResumeOffset] = @(committedOffset);
+            }];
+            lastSavedOffset = committedOffset;
+        }
+    }
+                                                            reporter:[self progressForDownload:callbackId]
+                                                          completion:^(HotUpdatesZipStreamResult *result) {
+        BOOL httpOK = result.statusCode == 200 || result.statusCode == 206;
+
+        if (httpOK && result.validator) {
+            [self saveResumeStateForURL:url.absoluteString version:version validator:result.validator];
+        }
+
+        if (result.networkError) {
+            if (result.validator) {
+                // Оставляем распакованные записи, следующий getUpdate продолжит с этого места
+                // (записывается вместе с failDownload)
+                [self->state stageChanges:^(NSMutableDictionary *values) {
+                    values[kResumeOffset] = @(result.committedOffset);
+                }];
+                NSLog(@"[HotUpdates] Download interrupted, can resume at %lld bytes", result.committedOffset);
+            } else if (resumeOffset == 0) {
+                [self clearResumeState];
+                [fileManager removeItemAtPath:newDownloadPath error:nil];
+            }
+            // Иначе ответа не было: сохранённое состояние остаётся прежним
+            [self failDownload:kErrorDownloadFailed
+                       message:[NSString stringWithFormat:@"Download failed: %@", result.networkError.localizedDescription]
+                    callbackId:callbackId];
+            return;
+        }
+
+        if (!httpOK) {
+            [self clearResumeState];
+            if (resumeOffset > 0 && result.statusCode == 416) {
+                // Сохранённый диапазон не подходит - начинаем заново
+                NSLog(@"[HotUpdates] Cannot resume (HTTP %ld), restarting download", (long)result.statusCode);
+                if ([self endIfDownloadCancelled:callbackId]) {
+                    return;
+                }
+                [self streamUpdateFromURL:url configuration:config allowResume:NO callbackId:callbackId];
+                return;
+            }
+
+            [fileManager removeItemAtPath:newDownloadPath error:nil];
+            [self failDownload:kErrorHTTPError
+                       message:[NSString stringWithFormat:@"HTTP error: %ld", (long)result.statusCode]
+                    callbackId:callbackId];
+            return;
+        }
+
+        [self clearResumeState];
+
+        HotUpdatesVerifier *verifier = self->pendingVerifier;
+        if (verifier.failure) {
+            [fileManager removeItemAtPath:newDownloadPath error:nil];
+            [self failDownload:kErrorHashMismatch message:verifier.failure.localizedDescription callbackId:callbackId];
+            return;
+        }
+
+        NSMutableDictionary<NSString*, NSString*> *hashes = [result.hashes mutableCopy];
+        if (result.extractError || ![self moveExtractedWWWFrom:extractPath toDestination:newDownloadPath hashes:hashes]) {
+            NSLog(@"[HotUpdates] ERROR: %@", result.extractError.localizedDescription ?: @"www folder not found in ZIP archive");
+            NSString *code = result.extractError ? [self extractionErrorCode:result.extractError] : kErrorExtractionFailed;
+            [fileManager removeItemAtPath:newDownloadPath error:nil];
+            [self failDownload:code message:[self extractionErrorMessage:code] callbackId:callbackId];
+            return;
+        }
+
+        [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageDownload since:startTime bytes:result.committedOffset - resumeOffset];
+        NSLog(@"[HotUpdates] Download and extraction completed");
+
+        self->pendingHashes = hashes;
+        [self stageUpdateFromDirectory:newDownloadPath callbackId:callbackId];
+    }];
+    [self registerSession:session callbackId:callbackId];
+}
+
+#pragma mark - Storage Preflight
+
+- (long long)freeDiskSpace {
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfFileSystemForPath:documentsPath error:nil];
+    NSNumber *freeSize = attributes[NSFileSystemFreeSize];
+    return freeSize ? freeSize.longLongValue : -1;
+}
+
+/*!
+ * @param bytes Bytes about to be written, -1 if unknown (always fits)
+ * @return YES if bytes plus margin fit into the free space
+ */
+- (BOOL)hasSpaceForBytes:(long long)bytes {
+    long long freeSpace = [self freeDiskSpace];
+    return bytes < 0 || freeSpace < 0 || bytes + kStorageMarginBytes <= freeSpace;
+}
+
+- (NSString*)insufficientStorageMessage:(long long)bytes {
+    return [NSString stringWithFormat:@"Insufficient storage: %lld bytes needed, %lld available",
+            MAX(0, bytes) + kStorageMarginBytes, [self freeDiskSpace]];
+}
+
+/*!
+ * @brief Expected size of the extracted update
+ * @details Sizes declared by the signed manifest of the running download, otherwise the archive
+ *          size (a lower bound, entries are at least as large as stored)
+ * @param archiveSize Archive size from the response headers, -1 if unknown
+ * @return Bytes, -1 if neither is known
+ */
+- (long long)expectedSizeForArchiveSize:(long long)archiveSize {
+    long long declared = pendingVerifier ? pendingVerifier.totalSize : -1;
+    return declared >= 0 ? declared : archiveSize;
+}
+
+/*!
+ * @brief Archive size from a HEAD request, before anything is written
+ * @param completion Main thread; -1 if the server does not tell (the download decides then)
+ */
+- (void)fetchArchiveSizeAtURL:(NSURL*)url
+                configuration:(NSURLSessionConfiguration*)config
+                   callbackId:(NSString*)callbackId
+                   completion:(void (^)(long long archiveSize))completion {
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:url];
+    request.HTTPMethod = @"HEAD";
+
+    NSURLSession *session = [NSURLSession sessionWithConfiguration:config];
+    [[session dataTaskWithRequest:request completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+        NSInteger statusCode = [response isKindOfClass:[NSHTTPURLResponse class]] ? ((NSHTTPURLResponse*)response).statusCode : 0;
+        long long archiveSize = !error && statusCode == 200 ? response.expectedContentLength : -1;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completion(archiveSize);
+        });
+    }] resume];
+    [session finishTasksAndInvalidate];
+    [self registerSession:session callbackId:callbackId];
+}
+
+/*!
+ * @brief Low-storage mode: delete what the download replaces anyway
+ * @details Keeps peak extra usage near one copy of the update on top of the current and previous
+ *          version: drops stale archives and patch files, the legacy pending_update copy, a staged
+ *          update (of another version, the same one is never downloaded again) and retained
+ *          versions except the rollback target. The download then streams over one connection.
+ * @param completion Main thread, once the files are deleted
+ */
+- (void)freeStorageWithCompletion:(void (^)(void))completion {
+    NSMutableArray<NSString*> *paths = [NSMutableArray array];
+    for (NSString *name in @[kSegmentedZipFileName, kPackedZipFileName, kBackgroundZipFileName,
+                             kTempPatchDirName, kPendingUpdateDirName]) {
+        [paths addObject:[documentsPath stringByAppendingPathComponent:name]];
+    }
+
+    if (isUpdateReadyToInstall || [state boolForKey:kHasPending]) {
+        NSLog(@"[HotUpdates] Low storage: dropping staged update v%@", [state stringForKey:kPendingVersion]);
+        isUpdateReadyToInstall = NO;
+        [state commitChanges:^(NSMutableDictionary *values) {
+            values[kPendingUpdateReady] = @NO;
+            values[kHasPending] = @NO;
+            [values removeObjectsForKeys:@[kPendingVersion, kPendingUpdateURL, kPendingWarmup]];
+        }];
+        [paths addObject:[documentsPath stringByAppendingPathComponent:kTempDownloadedDirName]];
+    }
+
+    [self pruneVersionsRemovingPaths:paths rollbackTargetOnly:YES completion:completion];
+}
+
+/*!
+ * @brief Error code of a failed extraction
+ * @details A full disk is reported as INSUFFICIENT_STORAGE. Extractors that only return NO are
+ *          checked by the free space left (call before the partial files are deleted)
+ * @param error Extraction error, nil if the extractor gave none
+ */
+- (NSString*)extractionErrorCode:(NSError*)error {
+    if (!error) {
+        return [self hasSpaceForBytes:0] ? kErrorExtractionFailed : kErrorInsufficientStorage;
+    }
+    NSError *underlying = error.userInfo[NSUnderlyingErrorKey];
+    return [self isOutOfSpaceError:error] || [self isOutOfSpaceError:underlying]
+        ? kErrorInsufficientStorage : kErrorExtractionFailed;
+}
+
+- (BOOL)isOutOfSpaceError:(NSError*)error {
+    return ([error.domain isEqualToString:NSCocoaErrorDomain] && error.code == NSFileWriteOutOfSpaceError)
+        || ([error.domain isEqualToString:NSPOSIXErrorDomain] && error.code == ENOSPC);
+}
+
+- (NSString*)extractionErrorMessage:(NSString*)code {
+    return [code isEqualToString:kErrorInsufficientStorage]
+        ? [self insufficientStorageMessage:0] : @"Failed to extract update package";
+}
+
+#pragma mark - Resume State
+
+/*!
+ * @brief Get archive offset to continue an interrupted download from
+ * @return Saved offset if URL, version and partial files match, 0 otherwise
+ */
+- (long long)resumeOffsetForURL:(NSString*)urlString version:(NSString*)version partialPath:(NSString*)partialPath {
+    BOOL sameTransfer = [urlString isEqualToString:[state stringForKey:kResumeURL]]
+        && version && [version isEqualToString:[state stringForKey:kResumeVersion]]
+        && [state stringForKey:kResumeValidator]
+        && [[NSFileManager defaultManager] fileExistsAtPath:partialPath];
+    return sameTransfer ? [state longLongForKey:kResumeOffset] : 0;
+}
+
+- (void)saveResumeStateForURL:(NSString*)urlString version:(NSString*)version validator:(NSString*)validator {
+    [state commitChanges:^(NSMutableDictionary *values) {
+        values[kResumeURL] = urlString;
+        values[kResumeVersion] = version;
+        values[kResumeValidator] = validator;
+    }];
+}
+
+- (void)clearResumeState {
+    [state commitChanges:^(NSMutableDictionary *values) {
+        [values removeObjectsForKeys:@[kResumeURL, kResumeVersion, kResumeValidator, kResumeOffset]];
+    }];
+}
+
+/*!
+ * @brief Download flag is informational (reset on launch), kept in memory and written with the next commit
+ */
+- (void)setDownloadInProgress:(BOOL)inProgress {
+    [state stageChanges:^(NSMutableDictionary *values) {
+        values[kDownloadInProgress] = @(inProgress);
+    }];
+}
+
+/*!
+ * @brief Stage freshly built update as ready to install
+ * @details Moves temp_new_download to temp_downloaded_update (one rename) and saves pending
+ *          state. Shared by ZIP and delta downloads. That directory is the only staged copy:
+ *          forceUpdate and the launch-time auto-install both promote it by rename. With a signed
+ *          manifest the files not hashed during extraction are checked first; a mismatch is never staged.
+ * @param newDownloadPath Directory containing www folder of the update
+ */
+- (void)stageUpdateFromDirectory:(NSString*)newDownloadPath callbackId:(NSString*)callbackId {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSError *error;
+    NSString *tempUpdatePath = [documentsPath stringByAppendingPathComponent:kTempDownloadedDirName];
+
+    NSString *newWwwPath = [newDownloadPath stringByAppendingPathComponent:kWWWDirName];
+    // Ошибки через failDownload: он же записывает состояние, подготовленное загрузкой.
+    // Отменённая задача не подготавливается, её файлы удалит failDownload
+    if ([self endIfDownloadCancelled:callbackId]) {
+        return;
+    }
+    [[self progressForDownload:callbackId] startPhase:kProgressPhaseStaging bytes:0 totalBytes:-1];
+    if (![fileManager fileExistsAtPath:newWwwPath]) {
+        [fileManager removeItemAtPath:newDownloadPath error:nil];
+        [self failDownload:kErrorWWWNotFound message:@"www folder not found in package" callbackId:callbackId];
+        return;
+    }
+
+    HotUpdatesVerifier *verifier = pendingVerifier;
+    pendingVerifier = nil;
+    NSArray<NSString*> *warmupPaths = verifier ? verifier.warmupPaths : pendingWarmupPaths;
+    pendingWarmupPaths = nil;
+    NSDictionary<NSString*, NSString*> *hashes = pendingHashes;
+    pendingHashes = nil;
+    NSError *verifyError = nil;
+    NSTimeInterval startTime = [HotUpdatesMetrics now];
+    if (verifier && ![verifier verifyRemainingInDirectory:newWwwPath error:&verifyError]) {
+        [fileManager removeItemAtPath:newDownloadPath error:nil];
+        [self failDownload:kErrorHashMismatch message:verifyError.localizedDescription callbackId:callbackId];
+        return;
+    }
+    if (verifier) {
+        startTime = [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageValidate since:startTime];
+    }
+
+    // Сохраняем контент в хранилище один раз, дальше только hard links. Дайджесты уже
+    // посчитаны при распаковке; пакет - один архив своей версии, его чтение - лишний проход
+    if (![fileManager fileExistsAtPath:[newWwwPath stringByAppendingPathComponent:kPackedBundleFileName]]) {
+        [store ingestDirectoryAtPath:newWwwPath hashes:hashes];
+    }
+
+    // Успех! Теперь безопасно заменяем старую temp_downloaded_update на новую
+    if ([fileManager fileExistsAtPath:tempUpdatePath]) {
+        [fileManager removeItemAtPath:tempUpdatePath error:nil];
+    }
+    // Вторая копия (pending_update) больше не нужна: автоустановка берёт эту же директорию
+    [fileManager removeItemAtPath:[documentsPath stringByAppendingPathComponent:kPendingUpdateDirName] error:nil];
+
+    if (![fileManager moveItemAtPath:newDownloadPath toPath:tempUpdatePath error:&error]) {
+        [fileManager removeItemAtPath:newDownloadPath error:nil];
+        [self failDownload:kErrorTempDirError
+                   message:[NSString stringWithFormat:@"Cannot stage update: %@", error.localizedDescription]
+                callbackId:callbackId];
+        return;
+    }
+
+    isUpdateReadyToInstall = YES;
+    // Сохраняем URL и версию только после успешной загрузки, одной записью с концом загрузки
+    NSString *url = pendingUpdateURL;
+    NSString *version = pendingUpdateVersion;
+    [state commitChanges:^(NSMutableDictionary *values) {
+        values[kPendingUpdateURL] = url;
+        values[kPendingVersion] = version;
+        values[kPendingUpdateReady] = @YES;
+        values[kHasPending] = @YES;
+        values[kDownloadInProgress] = @NO;
+        if (warmupPaths.count > 0) {
+            values[kPendingWarmup] = warmupPaths;
+        } else {
+            [values removeObjectForKey:kPendingWarmup];
+        }
+    }];
+    [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageStage since:startTime];
+
+    NSLog(@"[HotUpdates] Update ready (v%@)", pendingUpdateVersion);
+
+    for (NSString *recipient in [self finishDownloadJob:callbackId]) {
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK];
+        [self.commandDelegate sendPluginResult:result callbackId:recipient];
+    }
+}
+
+#pragma mark - Packed Bundle
+
+/*!
+ * @brief Packs are served through the Cordova scheme handler (app://localhost)
+ * @details Plugin scheme task hooks exist since cordova-ios 6.2. With older platforms or the
+ *          file:// scheme packed downloads are extracted as usual.
+ */
+- (BOOL)canServePackedBundle {
+    NSString *scheme = [self.commandDelegate.settings cordovaSettingForKey:@"scheme"];
+    return NSClassFromString(@"CDVURLSchemeHandler") != nil && ![scheme isEqualToString:@"file"];
+}
+
+/*!
+ * @brief Open pack of the current version (nil if the version is extracted or nothing is installed)
+ */
+- (void)refreshCurrentPack {
+    NSString *currentDir = [state stringForKey:kCurrentVersionDir];
+    BOOL installed = [state stringForKey:kInstalledVersion] != nil;
+    NSString *packPath = [[self currentWWWPath] stringByAppendingPathComponent:kPackedBundleFileName];
+
+    if (!installed || !currentDir || ![[NSFileManager defaultManager] fileExistsAtPath:packPath]) {
+        currentPack = nil;
+        servedWWWPath = installed && currentDir ? [[self currentWWWPath] stringByStandardizingPath] : nil;
+        servedWWWIsOverlay = servedWWWPath && [self canServePackedBundle]
+            && [[NSFileManager defaultManager] fileExistsAtPath:[servedWWWPath stringByAppendingPathComponent:kOverlayMarkerFileName]];
+        return;
+    }
+    servedWWWPath = nil;
+    servedWWWIsOverlay = NO;
+
+    NSError *error = nil;
+    currentPack = [HotUpdatesPack packAtPath:packPath error:&error];
+    if (currentPack) {
+        NSLog(@"[HotUpdates] Serving version %@ from pack (%lu files)", currentDir, (unsigned long)currentPack.count);
+    } else {
+        NSLog(@"[HotUpdates] ERROR: Cannot open pack of version %@: %@", currentDir, error.localizedDescription);
+    }
+}
+
+- (NSURL*)packedStartURL {
+    NSString *scheme = [self.commandDelegate.settings cordovaSettingForKey:@"scheme"] ?: @"app";
+    NSString *hostname = [self.commandDelegate.settings cordovaSettingForKey:@"hostname"] ?: @"localhost";
+    return [NSURL URLWithString:[NSString stringWithFormat:@"%@://%@/index.html", scheme, hostname]];
+}
+
+/*!
+ * @brief Serve request of the WebView from the current pack or a pre-compressed file
+ * @details Called by CDVURLSchemeHandler before it reads the www folder. "app.js.gz" is served
+ *          inflated for "app.js" (preferred over the plain file), because WebKit does not apply
+ *          Content-Encoding to scheme handler responses; it is inflated on a background queue and
+ *          streamed in chunks. Other paths fall through to the default handler.
+ * @return YES if the task was answered or is being answered
+ */
+- (BOOL)overrideSchemeTask:(id<WKURLSchemeTask>)urlSchemeTask {
+    HotUpdatesPack *pack = currentPack;
+    NSString *wwwRoot = servedWWWPath;
+    if (!pack && !wwwRoot) {
+        return NO;
+    }
+
+    NSURL *url = urlSchemeTask.request.URL;
+    NSString *path = [url.path hasPrefix:@"/"] ? [url.path substringFromIndex:1] : url.path;
+    if (path.length == 0) {
+        path = @"index.html";
+    }
+    NSString *compressedPath = [path stringByAppendingString:kCompressedAssetSuffix];
+
+    NSData *data = nil;
+    NSData *compressed = nil;
+    if (pack) {
+        compressed = [pack dataForPath:compressedPath];
+        data = compressed ? nil : [pack dataForPath:path];
+    } else {
+        // Обычные файлы отдаёт CDVURLSchemeHandler, здесь только .gz внутри www.
+        // Overlay: и обычные файлы версии, отсутствующие отдаются из bundle
+        NSString *filePath = [[wwwRoot stringByAppendingPathComponent:compressedPath] stringByStandardizingPath];
+        if ([filePath hasPrefix:[wwwRoot stringByAppendingString:@"/"]]
+            && [[NSFileManager defaultManager] fileExistsAtPath:filePath]) {
+            compressed = [NSData dataWithContentsOfFile:filePath options:NSDataReadingMappedIfSafe error:nil];
+        } else if (servedWWWIsOverlay) {
+            filePath = [[wwwRoot stringByAppendingPathComponent:path] stringByStandardizingPath];
+            if ([filePath hasPrefix:[wwwRoot stringByAppendingString:@"/"]]) {
+                data = [NSData dataWithContentsOfFile:filePath options:NSDataReadingMappedIfSafe error:nil];
+            }
+        }
+    }
+    if (compressed) {
+        [self sendInflatedData:compressed path:path toSchemeTask:urlSchemeTask];
+        return YES;
+    }
+    if (!data) {
+        return NO;
+    }
+
+    // Содержимое URL меняется с каждой версией - WebView не должен его переиспользовать
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:url
+                                                              statusCode:200
+                                                             HTTPVersion:@"HTTP/1.1"
+                                                            headerFields:@{
+        @"Content-Type": [HotUpdatesPack mimeTypeForPath:path],
+        @"Content-Length": [NSString stringWithFormat:@"%lu", (unsigned long)data.length],
+        @"Cache-Control": @"no-cache"
+    }];
+    [urlSchemeTask didReceiveResponse:response];
+    [urlSchemeTask didReceiveData:data];
+    [urlSchemeTask didFinish];
+    return YES;
+}
+
+/*!
+ * @brief Answer scheme task with a pre-compressed asset, inflated off the main thread
+ * @details Every chunk is handed to the task on the main thread while the inflating thread
+ *          waits, so memory stays at one chunk however large the asset is. Stopped tasks get
+ *          no further calls and their inflation ends at the next chunk.
+ * @param compressed Complete .gz file
+ * @param path Requested path, for the MIME type
+ */
+- (void)sendInflatedData:(NSData*)compressed path:(NSString*)path toSchemeTask:(id<WKURLSchemeTask>)urlSchemeTask {
+    if (!activeSchemeTasks) {
+        activeSchemeTasks = [NSMutableSet set];
+    }
+    [activeSchemeTasks addObject:urlSchemeTask];
+
+    // ISIZE в трейлере не проверен до конца распаковки - ответ без Content-Length
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:urlSchemeTask.request.URL
+                                                              statusCode:200
+                                                             HTTPVersion:@"HTTP/1.1"
+                                                            headerFields:@{
+        @"Content-Type": [HotUpdatesPack mimeTypeForPath:path],
+        @"Cache-Control": @"no-cache"
+    }];
+    [urlSchemeTask didReceiveResponse:response];
+
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        BOOL complete = [HotUpdatesPack inflateGzipData:compressed
+                                               maxBytes:kMaxInflatedAssetBytes
+                                                handler:^BOOL(NSData *chunk) {
+            __block BOOL active = NO;
+            dispatch_sync(dispatch_get_main_queue(), ^{
+                // Остановленная задача бросает исключение на любой вызов
+                active = [self->activeSchemeTasks containsObject:urlSchemeTask];
+                if (active) {
+                    [urlSchemeTask didReceiveData:chunk];
+                }
+            });
+            return active;
+        }];
+
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (![self->activeSchemeTasks containsObject:urlSchemeTask]) {
+                return;
+            }
+            [self->activeSchemeTasks removeObject:urlSchemeTask];
+            if (complete) {
+                [urlSchemeTask didFinish];
+            } else {
+                [urlSchemeTask didFailWithError:[NSError errorWithDomain:NSURLErrorDomain
+                                                                    code:NSURLErrorCannotDecodeContentData
+                                                                userInfo:nil]];
+            }
+        });
+    });
+}
+
+- (void)stopSchemeTask:(id<WKURLSchemeTask>)urlSchemeTask {
+    // Обычные ответы отправлены синхронно; распаковка .gz остановится на следующей части
+    [activeSchemeTasks removeObject:urlSchemeTask];
+}
+
+#pragma mark - Background Prefetch
+
+/*!
+ * @brief Register the BGProcessingTask of the update check and schedule it (HotUpdatesPrefetchUrl)
+ * @details Called from pluginInitialize, i.e. within application:didFinishLaunchingWithOptions:,
+ *          as BGTaskScheduler requires. Without the preference a scheduled check is cancelled.
+ *          Nothing is registered if Info.plist does not permit the identifier (plugin installed
+ *          without IOS_BACKGROUND_PREFETCH=true)
+ */
+- (void)setupPrefetch {
+    if (@available(iOS 13.0, *)) {
+        // Регистрация неразрешённого идентификатора - исключение BGTaskScheduler
+        NSArray *permitted = [[NSBundle mainBundle] objectForInfoDictionaryKey:@"BGTaskSchedulerPermittedIdentifiers"];
+        if (![permitted isKindOfClass:[NSArray class]] || ![permitted containsObject:kPrefetchTaskIdentifier]) {
+            if ([self.commandDelegate.settings cordovaSettingForKey:kPrefetchURLPreference].length > 0) {
+                NSLog(@"[HotUpdates] Background prefetch is not enabled in Info.plist (install with IOS_BACKGROUND_PREFETCH=true)");
+            }
+            return;
+        }
+        prefetchPlugin = self;
+
+        static dispatch_once_t onceToken;
+        dispatch_once(&onceToken, ^{
+            // Регистрируем всегда: запуск по ранее запланированной задаче без обработчика - crash
+            [[BGTaskScheduler sharedScheduler] registerForTaskWithIdentifier:kPrefetchTaskIdentifier
+                                                                  usingQueue:dispatch_get_main_queue()
+                                                               launchHandler:^(BGTask *task) {
+                HotUpdates *plugin = prefetchPlugin;
+                if (plugin) {
+                    [plugin handlePrefetchTask:task];
+                } else {
+                    [task setTaskCompletedWithSuccess:NO];
+                }
+            }];
+        });
+
+        NSString *prefetchURL = [self.commandDelegate.settings cordovaSettingForKey:kPrefetchURLPreference];
+        if (prefetchURL.length == 0) {
+            [[BGTaskScheduler sharedScheduler] cancelTaskRequestWithIdentifier:kPrefetchTaskIdentifier];
+            return;
+        }
+
+        // Повторная отправка заменяет запрос и сдвигает срок - каждый запуск откладывал бы проверку
+        [[BGTaskScheduler sharedScheduler] getPendingTaskRequestsWithCompletionHandler:^(NSArray<BGTaskRequest*> *requests) {
+            for (BGTaskRequest *request in requests) {
+                if ([request.identifier isEqualToString:kPrefetchTaskIdentifier]) {
+                    return;
+                }
+            }
+            [self submitPrefetchRequest];
+        }];
+    }
+}
+
+/*!
+ * @brief Schedule the next check: charging, with network, not earlier than the interval
+ */
+- (void)submitPrefetchRequest API_AVAILABLE(ios(13.0)) {
+    NSInteger hours = [[self.commandDelegate.settings cordovaSettingForKey:kPrefetchIntervalPreference] integerValue];
+    hours = hours > 0 ? hours : kDefaultPrefetchIntervalHours;
+
+    BGProcessingTaskRequest *request = [[BGProcessingTaskRequest alloc] initWithIdentifier:kPrefetchTaskIdentifier];
+    request.requiresNetworkConnectivity = YES;
+    request.requiresExternalPower = YES;
+    request.earliestBeginDate = [NSDate dateWithTimeIntervalSinceNow:hours * 3600];
+
+    NSError *error = nil;
+    if (![[BGTaskScheduler sharedScheduler] submitTaskRequest:request error:&error]) {
+        NSLog(@"[HotUpdates] Failed to schedule prefetch: %@", error.localizedDescription);
+    }
+}
+
+/*!
+ * @brief Ask the check API for a newer version and hand its ZIP to a background download
+ * @details The download is the same as getUpdate({background, wifiOnly, requiresCharging})
+ *          without a callback: the system finishes it after the task ends, and the staged
+ *          update is installed at the next launch. Runs on main thread
+ */
+- (void)handlePrefetchTask:(BGTask*)task API_AVAILABLE(ios(13.0)) {
+    [self submitPrefetchRequest];
+
+    BOOL downloading = NO;
+    @synchronized (self) {
+        downloading = downloadJob != nil;
+    }
+    if (downloading) {
+        NSLog(@"[HotUpdates] Prefetch skipped, download in progress");
+        [task setTaskCompletedWithSuccess:YES];
+        return;
+    }
+
+    NSURLSessionDataTask *check = [self fetchUpdateCheck:[self.commandDelegate.settings cordovaSettingForKey:kPrefetchURLPreference]
+                                          allowsCellular:NO
+                                              completion:^(NSDictionary *update, NSString *errorCode, NSString *message) {
+        if (!update) {
+            NSLog(@"[HotUpdates] Prefetch check failed: %@", message);
+            [task setTaskCompletedWithSuccess:NO];
+            return;
+        }
+        [self prefetchUpdate:update];
+        [task setTaskCompletedWithSuccess:YES];
+    }];
+    task.expirationHandler = ^{
+        [check cancel];
+    };
+}
+
+/*!
+ * @brief Start background download of a version found by the prefetch check
+ */
+- (void)prefetchUpdate:(NSDictionary*)update {
+    NSString *version = update[@"version"];
+    if (![update[@"hasUpdate"] boolValue]) {
+        NSLog(@"[HotUpdates] Prefetch: no update (%@)", update[@"reason"]);
+        return;
+    }
+    // Уже подготовлено, или delta (много мелких запросов, только foreground)
+    if ([update[@"ready"] boolValue] || !update[@"url"]) {
+        NSLog(@"[HotUpdates] Prefetch: v%@ not downloaded in background", version);
+        return;
+    }
+    // Загрузку, начатую из JS за время проверки, не заменяем
+    @synchronized (self) {
+        if (downloadJob) {
+            NSLog(@"[HotUpdates] Prefetch of v%@ skipped, download in progress", version);
+            return;
+        }
+    }
+
+    NSMutableDictionary *updateData = [@{
+        @"url": update[@"url"],
+        @"version": version,
+        @"background": @YES,
+        @"wifiOnly": @YES,
+        @"requiresCharging": @YES,
+        @"packed": update[@"packed"]
+    } mutableCopy];
+    updateData[@"verifyManifestUrl"] = update[@"verifyManifestUrl"];
+
+    NSLog(@"[HotUpdates] Prefetching v%@", version);
+    // Результат уходит в callbackId, которого нет в JS, и игнорируется
+    CDVInvokedUrlCommand *command = [[CDVInvokedUrlCommand alloc] initWithArguments:@[updateData]
+                                                                         callbackId:[@"HotUpdatesPrefetch" stringByAppendingString:[NSUUID UUID].UUIDString]
+                                                                          className:@"HotUpdates"
+                                                                         methodName:@"getUpdate"];
+    [self getUpdate:command];
+}
+
+#pragma mark - Check For Update
+
+/*!
+ * @brief Ask the check API (or a release-channel manifest) for a newer version
+ * @details Conditional request: an unchanged answer costs a 304 without body. The result is
+ *          filtered against the ignore list and the app version
+ */
+- (void)checkForUpdate:(CDVInvokedUrlCommand*)command {
+    if ([self deferUntilStartup:^{ [self checkForUpdate:command]; }]) {
+        return;
+    }
+
+    NSDictionary *options = nil;
+    if (command.arguments.count > 0 && [command.arguments[0] isKindOfClass:[NSDictionary class]]) {
+        options = command.arguments[0];
+    }
+    NSString *checkURL = [options[@"url"] isKindOfClass:[NSString class]] ? options[@"url"] : nil;
+    if (checkURL.length == 0) {
+        checkURL = [self.commandDelegate.settings cordovaSettingForKey:kPrefetchURLPreference];
+    }
+    if (checkURL.length == 0) {
+        [self sendError:kErrorURLRequired message:@"URL is required" callbackId:command.callbackId];
+        return;
+    }
+
+    [self fetchUpdateCheck:checkURL allowsCellular:YES completion:^(NSDictionary *update, NSString *errorCode, NSString *message) {
+        if (!update) {
+            NSLog(@"[HotUpdates] checkForUpdate failed: %@", message);
+            [self sendError:errorCode message:message callbackId:command.callbackId];
+            return;
+        }
+        NSLog(@"[HotUpdates] checkForUpdate: %@%@",
+              [update[@"hasUpdate"] boolValue] ? [@"v" stringByAppendingString:update[@"version"]]
+                                              : [NSString stringWithFormat:@"no update (%@)", update[@"reason"]],
+              [update[@"notModified"] boolValue] ? @", not modified" : @"");
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:update];
+        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+    }];
+}
+
+/*!
+ * @brief Request the check URL with "version" and "platform" query parameters
+ * @details Validators (ETag, Last-Modified) and body of the last response for the same URL
+ *          are kept in state; NSURLCache is bypassed so a 304 reaches the plugin
+ * @param completion Called on main thread with the evaluated result, or error code and message
+ * @return Started task (nil if the URL is invalid, completion is still called)
+ */
+- (NSURLSessionDataTask*)fetchUpdateCheck:(NSString*)checkURL
+                           allowsCellular:(BOOL)allowsCellular
+                               completion:(void (^)(NSDictionary *update, NSString *errorCode, NSString *message))completion {
+    NSString *currentVersion = [state stringForKey:kInstalledVersion] ?: appBundleVersion;
+    NSURLComponents *components = [NSURLComponents componentsWithString:checkURL];
+    NSMutableArray<NSURLQueryItem*> *query = [NSMutableArray arrayWithArray:components.queryItems ?: @[]];
+    [query addObject:[NSURLQueryItem queryItemWithName:@"version" value:currentVersion]];
+    [query addObject:[NSURLQueryItem queryItemWithName:@"platform" value:@"ios"]];
+    components.queryItems = query;
+    NSURL *url = components.URL;
+    if (!url) {
+        completion(nil, kErrorURLRequired, @"Invalid URL format");
+        return nil;
+    }
+
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:url];
+    NSDictionary *cache = [state objectForKey:kCheckCache];
+    if (![cache isKindOfClass:[NSDictionary class]] || ![cache[@"url"] isEqualToString:url.absoluteString]) {
+        // URL меняется вместе с версией - старый ответ не подходит
+        cache = nil;
+    }
+    if (cache[@"etag"]) {
+        [request setValue:cache[@"etag"] forHTTPHeaderField:@"If-None-Match"];
+    }
+    if (cache[@"lastModified"]) {
+        [request setValue:cache[@"lastModified"] forHTTPHeaderField:@"If-Modified-Since"];
+    }
+
+    NSURLSessionConfiguration *config = [NSURLSessionConfiguration defaultSessionConfiguration];
+    config.allowsCellularAccess = allowsCellular;
+    config.requestCachePolicy = NSURLRequestReloadIgnoringLocalCacheData;
+    config.URLCache = nil;
+    NSURLSession *session = [NSURLSession sessionWithConfiguration:config];
+
+    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
+                                            completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+        [session finishTasksAndInvalidate];
+        NSHTTPURLResponse *http = [response isKindOfClass:[NSHTTPURLResponse class]] ? (NSHTTPURLResponse *)response : nil;
+
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (error || !http) {
+                completion(nil, kErrorDownloadFailed, [NSString stringWithFormat:@"Download failed: %@", error.localizedDescription]);
+                return;
+            }
+
+            BOOL notModified = http.statusCode == 304 && cache[@"body"];
+            if (!notModified && http.statusCode != 200) {
+                completion(nil, kErrorHTTPError, [NSString stringWithFormat:@"HTTP error: %ld", (long)http.statusCode]);
+                return;
+            }
+
+            NSData *body = notModified ? cache[@"body"] : data;
+            NSDictionary *checkResponse = body ? [NSJSONSerialization JSONObjectWithData:body options:0 error:nil] : nil;
+            if (![checkResponse isKindOfClass:[NSDictionary class]]) {
+                completion(nil, kErrorManifestInvalid, @"Invalid manifest: check response is not a JSON object");
+                return;
+            }
+
+            if (!notModified) {
+                NSString *etag = http.allHeaderFields[@"ETag"];
+                NSString *lastModified = http.allHeaderFields[@"Last-Modified"];
+                [self->state commitChanges:^(NSMutableDictionary *values) {
+                    if (etag || lastModified) {
+                        NSMutableDictionary *entry = [@{@"url": url.absoluteString, @"body": body} mutableCopy];
+                        entry[@"etag"] = etag;
+                        entry[@"lastModified"] = lastModified;
+                        values[kCheckCache] = entry;
+                    } else {
+                        // Нечем проверять актуальность
+                        [values removeObjectForKey:kCheckCache];
+                    }
+                }];
+            }
+
+            completion([self evaluateUpdateCheck:checkResponse currentVersion:currentVersion notModified:notModified], nil, nil);
+        });
+    }];
+    [task resume];
+    return task;
+}
+
+/*!
+ * @brief Decide whether a check response is an update for this app
+ * @details Without hasUpdate (channel manifest) any version other than the current one is an update
+ * @return {hasUpdate, version, url?, manifestUrl?, verifyManifestUrl?, packed, minAppVersion?,
+ *          ready, notModified, reason?}; reason (kCheckReason*) tells why a version is skipped
+ */
+- (NSDictionary*)evaluateUpdateCheck:(NSDictionary*)response currentVersion:(NSString*)currentVersion notModified:(BOOL)notModified {
+    NSString *(^stringValue)(NSString *) = ^NSString *(NSString *key) {
+        id value = response[key];
+        return [value isKindOfClass:[NSString class]] && [value length] > 0 ? value : nil;
+    };
+    NSString *version = stringValue(@"version");
+    NSString *downloadURL = stringValue(@"downloadUrl");
+    NSString *manifestURL = stringValue(@"manifestUrl");
+    NSString *minAppVersion = stringValue(@"minAppVersion");
+
+    NSMutableDictionary *result = [NSMutableDictionary dictionary];
+    result[@"notModified"] = @(notModified);
+    result[@"version"] = version;
+    result[@"url"] = downloadURL;
+    result[@"manifestUrl"] = manifestURL;
+    result[@"verifyManifestUrl"] = stringValue(@"verifyManifestUrl");
+    result[@"packed"] = @([response[@"packed"] boolValue]);
+    result[@"minAppVersion"] = minAppVersion;
+
+    id hasUpdate = response[@"hasUpdate"];
+    NSString *reason = nil;
+    if ((hasUpdate && ![hasUpdate boolValue]) || !version || [version isEqualToString:currentVersion]
+        || (!downloadURL && !manifestURL)) {
+        reason = kCheckReasonUpToDate;
+    } else if ([ignoreList containsObject:version]) {
+        reason = kCheckReasonIgnored;
+    } else if (minAppVersion && [minAppVersion compare:appBundleVersion options:NSNumericSearch] == NSOrderedDescending) {
+        reason = kCheckReasonIncompatible;
+    }
+
+    result[@"hasUpdate"] = @(reason == nil);
+    result[@"reason"] = reason;
+    // Уже загружено: getUpdate для этой версии ответит сразу
+    result[@"ready"] = @(reason == nil && [state boolForKey:kHasPending] && [version isEqualToString:[state stringForKey:kPendingVersion]]);
+    return result;
+}
+
+#pragma mark - Background Download
+
+/*!
+ * @brief Background session identifier
+ * @details Discretionary sessions (requiresCharging) need their own identifier,
+ *          configuration of a background session cannot be changed after creation
+ */
++ (NSString*)backgroundSessionIdentifierDiscretionary:(BOOL)discretionary {
+    NSString *identifier = [[[NSBundle mainBundle] bundleIdentifier] stringByAppendingString:kBackgroundSessionSuffix];
+    return discretionary ? [identifier stringByAppendingString:kBackgroundDiscretionarySuffix] : identifier;
+}
+
++ (BOOL)handleEventsForBackgroundURLSession:(NSString*)identifier completionHandler:(void (^)(void))completionHandler {
+    if (![identifier isEqualToString:[self backgroundSessionIdentifierDiscretionary:NO]]
+        && ![identifier isEqualToString:[self backgroundSessionIdentifierDiscretionary:YES]]) {
+        return NO;
+    }
+
+    // Вызывается на main thread, как и URLSessionDidFinishEventsForBackgroundURLSession
+    if (!backgroundEventsCompletionHandlers) {
+        backgroundEventsCompletionHandlers = [NSMutableDictionary dictionary];
+    }
+    backgroundEventsCompletionHandlers[identifier] = [completionHandler copy];
+    return YES;
+}
+
+/*!
+ * @brief Get or create background session
+ * @details Session with the same identifier must be created only once per process.
+ *          Delegate callbacks arrive on main queue, like the rest of plugin state changes.
+ */
+- (NSURLSession*)backgroundSessionWithIdentifier:(NSString*)identifier {
+    if (!backgroundSessions) {
+        backgroundSessions = [NSMutableDictionary dictionary];
+    }
+
+    NSURLSession *session = backgroundSessions[identifier];
+    if (!session) {
+        NSURLSessionConfiguration *config = [NSURLSessionConfiguration backgroundSessionConfigurationWithIdentifier:identifier];
+        config.sessionSendsLaunchEvents = YES;
+        config.discretionary = [identifier hasSuffix:kBackgroundDiscretionarySuffix];
+        config.timeoutIntervalForRequest = 30.0;
+        // timeoutIntervalForResource не ограничиваем: система сама выбирает время загрузки
+
+        session = [NSURLSession sessionWithConfiguration:config
+                                                delegate:self
+                                           delegateQueue:[NSOperationQueue mainQueue]];
+        backgroundSessions[identifier] = session;
+    }
+    return session;
+}
+
+/*!
+ * @brief Download ZIP in a background URLSession
+ * @details Transfer is performed by the system and continues while the app is suspended or
+ *          terminated. The app is relaunched in background when it finishes; the archive is then
+ *          extracted and staged like a foreground download. An interrupted transfer of the same
+ *          URL and version continues from saved resume data.
+ * @param packed Keep the archive as pack instead of extracting it
+ * @param wifiOnly Do not use cellular network
+ * @param requiresCharging Discretionary transfer: system waits for Wi-Fi and power
+ */
+- (void)startBackgroundDownload:(NSString*)downloadURL
+                         packed:(BOOL)packed
+                       wifiOnly:(BOOL)wifiOnly
+               requiresCharging:(BOOL)requiresCharging
+                     callbackId:(NSString*)callbackId {
+    NSURL *url = [NSURL URLWithString:downloadURL];
+    if (!url) {
+        [self failDownload:kErrorURLRequired message:@"Invalid URL format" callbackId:callbackId];
+        return;
+    }
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSString *resumeDataPath = [documentsPath stringByAppendingPathComponent:kBackgroundResumeDataFileName];
+
+    // Resume data годится только для той же загрузки
+    NSData *resumeData = nil;
+    if ([downloadURL isEqualToString:[state stringForKey:kBackgroundDownloadURL]]
+        && [pendingUpdateVersion isEqualToString:[state stringForKey:kBackgroundDownloadVersion]]) {
+        resumeData = [NSData dataWithContentsOfFile:resumeDataPath];
+    }
+    [fileManager removeItemAtPath:resumeDataPath error:nil];
+
+    NSString *identifier = [HotUpdates backgroundSessionIdentifierDiscretionary:requiresCharging];
+
+    backgroundCallbackId = callbackId;
+    NSString *version = pendingUpdateVersion;
+    [state commitChanges:^(NSMutableDictionary *values) {
+        values[kDownloadInProgress] = @YES;
+        values[kBackgroundDownloadURL] = downloadURL;
+        values[kBackgroundDownloadVersion] = version;
+        values[kBackgroundSessionId] = identifier;
+        values[kBackgroundPacked] = @(packed);
+    }];
+
+    // Манифест нужен и после перезапуска приложения, подпись проверяется повторно при чтении
+    NSString *verifyManifestPath = [documentsPath stringByAppendingPathComponent:kBackgroundVerifyManifestFileName];
+    [fileManager removeItemAtPath:verifyManifestPath error:nil];
+    [fileManager removeItemAtPath:[verifyManifestPath stringByAppendingString:kSignatureSuffix] error:nil];
+    [pendingVerifier writeToFile:verifyManifestPath error:nil];
+
+    NSURLSession *session = [self backgroundSessionWithIdentifier:identifier];
+    NSURLSessionDownloadTask *task = nil;
 
-    if (![fileManager fileExistsAtPath:previousVersionPath]) {
-        NSLog(@"[HotUpdates] Rollback failed: previous version folder not found");
-        return NO;
+    if (resumeData) {
+        NSLog(@"[HotUpdates] Resuming background download");
+        task = [session downloadTaskWithResumeData:resumeData];
+    } else {
+        NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:url];
+        request.allowsCellularAccess = !wifiOnly;
+        task = [session downloadTaskWithRequest:request];
     }
 
-    // Защита от цикла rollback
-    NSString *effectiveCurrentVersion = currentVersion ?: appBundleVersion;
-    if ([previousVersion isEqualToString:effectiveCurrentVersion]) {
-        NSLog(@"[HotUpdates] Rollback failed: cannot rollback to same version");
-        return NO;
-    }
+    NSLog(@"[HotUpdates] Starting background download%@%@",
+          wifiOnly ? @" (wifi only)" : @"", requiresCharging ? @" (discretionary)" : @"");
+    [[self progressForDownload:callbackId] startPhase:kProgressPhaseDownloading bytes:0 totalBytes:-1];
+    [task resume];
+    [self registerSession:session callbackId:callbackId];
+}
 
-    NSString *tempBackupPath = [documentsPath stringByAppendingPathComponent:kBackupWWWDirName];
-    if ([fileManager fileExistsAtPath:tempBackupPath]) {
-        [fileManager removeItemAtPath:tempBackupPath error:nil];
+/*!
+ * @brief Re-attach to background download started in a previous process
+ * @details Recreating the session with the same identifier delivers pending delegate events.
+ */
+- (void)restoreBackgroundDownload {
+    NSString *identifier = [state stringForKey:kBackgroundSessionId];
+    if (!identifier) {
+        return;
     }
 
-    NSError *error = nil;
-
-    if ([fileManager fileExistsAtPath:wwwPath]) {
-        [fileManager moveItemAtPath:wwwPath toPath:tempBackupPath error:&error];
-        if (error) {
-            NSLog(@"[HotUpdates] Rollback failed: cannot backup current version");
-            return NO;
+    HotUpdatesDownloadJob *job = [[HotUpdatesDownloadJob alloc] initWithVersion:[state stringForKey:kBackgroundDownloadVersion]
+                                                                     callbackId:nil];
+    @synchronized (self) {
+        if (downloadJob || transferJob) {
+            return;
         }
+        downloadJob = transferJob = job;
     }
+    [self attachProgressToJob:job];
+    [job.progress startPhase:kProgressPhaseDownloading bytes:0 totalBytes:-1];
+
+    pendingUpdateURL = [state stringForKey:kBackgroundDownloadURL];
+    pendingUpdateVersion = job.version;
+    backgroundCallbackId = job.identifier;
+    [self setDownloadInProgress:YES];
+
+    NSURLSession *session = [self backgroundSessionWithIdentifier:identifier];
+    [job addSession:session];
+    [session getTasksWithCompletionHandler:^(NSArray *dataTasks, NSArray *uploadTasks, NSArray *downloadTasks) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (downloadTasks.count > 0 || self->isExtractingBackgroundDownload) {
+                NSLog(@"[HotUpdates] Background download still running");
+                return;
+            }
 
-    BOOL success = [fileManager copyItemAtPath:previousVersionPath
-                                        toPath:wwwPath
-                                         error:&error];
+            NSString *zipPath = [self->documentsPath stringByAppendingPathComponent:kBackgroundZipFileName];
+            if ([[NSFileManager defaultManager] fileExistsAtPath:zipPath]) {
+                // Архив скачан, но приложение завершилось до распаковки
+                [self finishBackgroundDownload];
+                return;
+            }
 
-    if (success) {
-        [[NSUserDefaults standardUserDefaults] setObject:previousVersion forKey:kInstalledVersion];
-        [[NSUserDefaults standardUserDefaults] removeObjectForKey:kPreviousVersion];
-        [[NSUserDefaults standardUserDefaults] synchronize];
+            NSLog(@"[HotUpdates] Background download no longer active");
+            [self failBackgroundDownload:kErrorDownloadFailed
+                                 message:@"Background download interrupted"
+                          keepResumeData:YES];
+        });
+    }];
+}
 
-        [fileManager removeItemAtPath:tempBackupPath error:nil];
+- (void)URLSession:(NSURLSession*)session
+      downloadTask:(NSURLSessionDownloadTask*)downloadTask
+didFinishDownloadingToURL:(NSURL*)location {
+    // Файл в location удаляется сразу после возврата из метода - переносим синхронно
+    NSHTTPURLResponse *response = (NSHTTPURLResponse*)downloadTask.response;
+    if (![response isKindOfClass:[NSHTTPURLResponse class]] || response.statusCode != 200) {
+        return;
+    }
 
-        NSLog(@"[HotUpdates] Rollback successful: %@ -> %@", currentVersion, previousVersion);
+    NSString *zipPath = [documentsPath stringByAppendingPathComponent:kBackgroundZipFileName];
+    [[NSFileManager defaultManager] removeItemAtPath:zipPath error:nil];
 
-        if (currentVersion) {
-            [self addVersionToIgnoreList:currentVersion];
-            // Удаляем откаченную версию из истории (она не прошла canary)
-            [self removeVersionFromHistory:currentVersion];
-        }
+    NSError *error = nil;
+    if (![[NSFileManager defaultManager] moveItemAtURL:location toURL:[NSURL fileURLWithPath:zipPath] error:&error]) {
+        NSLog(@"[HotUpdates] ERROR: Failed to keep downloaded archive: %@", error.localizedDescription);
+    }
+}
 
-        return YES;
-    } else {
-        NSLog(@"[HotUpdates] Rollback failed: %@", error.localizedDescription);
+- (void)URLSession:(NSURLSession*)session
+      downloadTask:(NSURLSessionDownloadTask*)downloadTask
+      didWriteData:(int64_t)bytesWritten
+ totalBytesWritten:(int64_t)totalBytesWritten
+totalBytesExpectedToWrite:(int64_t)totalBytesExpectedToWrite {
+    [[self progressForDownload:backgroundCallbackId] setBytes:totalBytesWritten
+                                                   totalBytes:totalBytesExpectedToWrite == NSURLSessionTransferSizeUnknown ? -1 : totalBytesExpectedToWrite];
+}
 
-        if ([fileManager fileExistsAtPath:tempBackupPath]) {
-            [fileManager moveItemAtPath:tempBackupPath toPath:wwwPath error:nil];
-        }
+- (void)URLSession:(NSURLSession*)session task:(NSURLSessionTask*)task didFinishCollectingMetrics:(NSURLSessionTaskMetrics*)metrics {
+    [HotUpdatesMetrics recordTaskMetrics:metrics];
 
-        return NO;
+    // Фоновая загрузка переживает перезапуск приложения - длительность берём из метрик задачи
+    if (!task.error && [(NSHTTPURLResponse*)task.response statusCode] == 200) {
+        [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageDownload
+                              duration:metrics.taskInterval.duration
+                                 bytes:task.countOfBytesReceived];
     }
 }
 
-#pragma mark - Get Update (Download Only)
+- (void)URLSession:(NSURLSession*)session task:(NSURLSessionTask*)task didCompleteWithError:(NSError*)error {
+    if (error) {
+        NSData *resumeData = error.userInfo[NSURLSessionDownloadTaskResumeDataKey];
+        if (resumeData) {
+            [resumeData writeToFile:[documentsPath stringByAppendingPathComponent:kBackgroundResumeDataFileName]
+                         atomically:YES];
+            NSLog(@"[HotUpdates] Background download interrupted, resume data saved");
+        }
 
-- (void)getUpdate:(CDVInvokedUrlCommand*)command {
-    // Безопасное получение первого аргумента
-    NSDictionary *updateData = nil;
-    if (command.arguments.count > 0 && [command.arguments[0] isKindOfClass:[NSDictionary class]]) {
-        updateData = command.arguments[0];
+        [self failBackgroundDownload:kErrorDownloadFailed
+                             message:[NSString stringWithFormat:@"Download failed: %@", error.localizedDescription]
+                      keepResumeData:resumeData != nil];
+        return;
     }
 
-    if (!updateData) {
-        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
-                                                 messageAsDictionary:[self createError:kErrorUpdateDataRequired
-                                                                                message:@"Update data required"]];
-        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+    NSInteger statusCode = [(NSHTTPURLResponse*)task.response statusCode];
+    if (statusCode != 200) {
+        [self failBackgroundDownload:kErrorHTTPError
+                             message:[NSString stringWithFormat:@"HTTP error: %ld", (long)statusCode]
+                      keepResumeData:NO];
         return;
     }
 
-    NSString *downloadURL = [updateData objectForKey:@"url"];
+    [self finishBackgroundDownload];
+}
 
-    if (!downloadURL) {
-        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
-                                                 messageAsDictionary:[self createError:kErrorURLRequired
-                                                                                message:@"URL is required"]];
-        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
-        return;
-    }
+- (void)URLSessionDidFinishEventsForBackgroundURLSession:(NSURLSession*)session {
+    NSString *identifier = session.configuration.identifier;
+    void (^completionHandler)(void) = backgroundEventsCompletionHandlers[identifier];
+    [backgroundEventsCompletionHandlers removeObjectForKey:identifier];
 
-    NSString *updateVersion = [updateData objectForKey:@"version"];
-    if (!updateVersion) {
-        updateVersion = @"pending";
+    if (completionHandler) {
+        dispatch_async(dispatch_get_main_queue(), completionHandler);
     }
+}
 
-    NSLog(@"[HotUpdates] getUpdate: v%@ from %@", updateVersion, downloadURL);
-
-    NSString *installedVersion = [[NSUserDefaults standardUserDefaults] stringForKey:kInstalledVersion];
-    if (installedVersion && [installedVersion isEqualToString:updateVersion]) {
-        NSLog(@"[HotUpdates] Version %@ already installed, skipping download", updateVersion);
-        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK];
-        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+/*!
+ * @brief Extract downloaded archive and stage it
+ * @details Runs inside a background task: the app may have been launched only to handle
+ *          session events and is suspended again soon after.
+ */
+- (void)finishBackgroundDownload {
+    if (isExtractingBackgroundDownload) {
         return;
     }
+    isExtractingBackgroundDownload = YES;
 
-    BOOL hasPending = [[NSUserDefaults standardUserDefaults] boolForKey:kHasPending];
-    NSString *existingPendingVersion = [[NSUserDefaults standardUserDefaults] stringForKey:kPendingVersion];
+    UIApplication *application = [UIApplication sharedApplication];
+    __block UIBackgroundTaskIdentifier taskId = [application beginBackgroundTaskWithName:@"HotUpdatesExtract" expirationHandler:^{
+        [application endBackgroundTask:taskId];
+        taskId = UIBackgroundTaskInvalid;
+    }];
 
-    if (hasPending && existingPendingVersion && [existingPendingVersion isEqualToString:updateVersion]) {
-        NSLog(@"[HotUpdates] Version %@ already downloaded, skipping re-download", updateVersion);
-        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK];
-        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
-        return;
-    }
+    NSString *zipPath = [documentsPath stringByAppendingPathComponent:kBackgroundZipFileName];
+    NSString *newDownloadPath = [documentsPath stringByAppendingPathComponent:kTempNewDownloadDirName];
+    BOOL packed = [state boolForKey:kBackgroundPacked] && [self canServePackedBundle];
+    NSString *verifyManifestPath = [documentsPath stringByAppendingPathComponent:kBackgroundVerifyManifestFileName];
+    NSString *publicKey = [self manifestPublicKey];
+    HotUpdatesVerifier *restoredVerifier = pendingVerifier;
+    HotUpdatesProgress *progress = [self progressForDownload:backgroundCallbackId];
 
-    if (isDownloadingUpdate) {
-        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
-                                                 messageAsDictionary:[self createError:kErrorDownloadInProgress
-                                                                                message:@"Download already in progress"]];
-        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
-        return;
-    }
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        NSFileManager *fileManager = [NSFileManager defaultManager];
+        [fileManager removeItemAtPath:newDownloadPath error:nil];
+
+        // После перезапуска верификатор восстанавливаем из файла - подпись проверяется заново
+        HotUpdatesVerifier *verifier = restoredVerifier;
+        NSError *verifierError = nil;
+        BOOL verifierReady = YES;
+        if (!verifier && [fileManager fileExistsAtPath:verifyManifestPath]) {
+            verifier = [HotUpdatesVerifier verifierWithContentsOfFile:verifyManifestPath publicKey:publicKey error:&verifierError];
+            verifierReady = verifier != nil;
+        } else if (!verifier && publicKey) {
+            // Загрузка начата до того, как в config.xml появился ключ
+            verifierError = [NSError errorWithDomain:NSCocoaErrorDomain code:0
+                                            userInfo:@{NSLocalizedDescriptionKey: kManifestRequiredMessage}];
+            verifierReady = NO;
+        }
+
+        // Архив уже на диске: для распаковки нужно место под файлы (пакет переносится как есть)
+        long long archiveSize = [[fileManager attributesOfItemAtPath:zipPath error:nil] fileSize];
+        long long requiredBytes = packed ? 0 : (verifier.totalSize >= 0 ? verifier.totalSize : archiveSize);
+        BOOL hasSpace = [self hasSpaceForBytes:requiredBytes];
+
+        NSMutableDictionary<NSString*, NSString*> *hashes = [NSMutableDictionary dictionary];
+        BOOL success = verifierReady && hasSpace
+            && [self installArchive:zipPath packed:packed toDestination:newDownloadPath
+                           verifier:verifier progress:progress hashes:hashes];
+        NSString *extractionCode = success ? nil : [self extractionErrorCode:nil];
+        [fileManager removeItemAtPath:zipPath error:nil];
+
+        dispatch_async(dispatch_get_main_queue(), ^{
+            self->isExtractingBackgroundDownload = NO;
+            NSString *callbackId = self->backgroundCallbackId ?: @"INVALID";
+
+            if (success) {
+                NSLog(@"[HotUpdates] Background download and extraction completed");
+                [self clearBackgroundDownloadStateKeepingResumeData:NO];
+
+                self->pendingVerifier = verifier;
+                self->pendingHashes = hashes;
+                [self stageUpdateFromDirectory:newDownloadPath callbackId:callbackId];
+            } else {
+                [fileManager removeItemAtPath:newDownloadPath error:nil];
+                if (!verifierReady) {
+                    [self failBackgroundDownload:kErrorSignatureInvalid
+                                         message:verifierError.localizedDescription
+                                  keepResumeData:NO];
+                } else if (verifier.failure) {
+                    [self failBackgroundDownload:kErrorHashMismatch
+                                         message:verifier.failure.localizedDescription
+                                  keepResumeData:NO];
+                } else if (!hasSpace) {
+                    [self failBackgroundDownload:kErrorInsufficientStorage
+                                         message:[self insufficientStorageMessage:requiredBytes]
+                                  keepResumeData:NO];
+                } else {
+                    [self failBackgroundDownload:extractionCode
+                                         message:[self extractionErrorMessage:extractionCode]
+                                  keepResumeData:NO];
+                }
+            }
 
-    // Сохраняем только в память, в UserDefaults запишем после успешной загрузки
-    pendingUpdateURL = downloadURL;
-    pendingUpdateVersion = updateVersion;
+            if (taskId != UIBackgroundTaskInvalid) {
+                [application endBackgroundTask:taskId];
+                taskId = UIBackgroundTaskInvalid;
+            }
+        });
+    });
+}
 
-    [self downloadUpdateOnly:downloadURL callbackId:command.callbackId];
+- (void)failBackgroundDownload:(NSString*)code message:(NSString*)message keepResumeData:(BOOL)keepResumeData {
+    NSString *callbackId = backgroundCallbackId ?: @"INVALID";
+    [self clearBackgroundDownloadStateKeepingResumeData:keepResumeData];
+    [self failDownload:code message:message callbackId:callbackId];
 }
 
-- (void)downloadUpdateOnly:(NSString*)downloadURL callbackId:(NSString*)callbackId {
-    isDownloadingUpdate = YES;
-    [[NSUserDefaults standardUserDefaults] setBool:YES forKey:kDownloadInProgress];
-    [[NSUserDefaults standardUserDefaults] synchronize];
+/*!
+ * @brief Forget finished background download
+ * @details Staged only: written by the staging or failDownload commit that always follows
+ * @param keepResumeData YES to keep URL, version and resume data for the next getUpdate
+ */
+- (void)clearBackgroundDownloadStateKeepingResumeData:(BOOL)keepResumeData {
+    [state stageChanges:^(NSMutableDictionary *values) {
+        [values removeObjectForKey:kBackgroundSessionId];
+        if (!keepResumeData) {
+            [values removeObjectsForKeys:@[kBackgroundPacked, kBackgroundDownloadURL, kBackgroundDownloadVersion]];
+        }
+    }];
+    if (!keepResumeData) {
+        [[NSFileManager defaultManager] removeItemAtPath:[documentsPath stringByAppendingPathComponent:kBackgroundResumeDataFileName]
+                                                   error:nil];
 
-    NSLog(@"[HotUpdates] Starting download");
+        NSString *verifyManifestPath = [documentsPath stringByAppendingPathComponent:kBackgroundVerifyManifestFileName];
+        [[NSFileManager defaultManager] removeItemAtPath:verifyManifestPath error:nil];
+        [[NSFileManager defaultManager] removeItemAtPath:[verifyManifestPath stringByAppendingString:kSignatureSuffix] error:nil];
+    }
+    backgroundCallbackId = nil;
+}
 
-    NSURL *url = [NSURL URLWithString:downloadURL];
-    if (!url) {
-        NSLog(@"[HotUpdates] ERROR: Invalid URL format");
-        isDownloadingUpdate = NO;
-        [[NSUserDefaults standardUserDefaults] setBool:NO forKey:kDownloadInProgress];
-        [[NSUserDefaults standardUserDefaults] synchronize];
+#pragma mark - Delta Update
 
-        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
-                                                 messageAsDictionary:[self createError:kErrorURLRequired
-                                                                                message:@"Invalid URL format"]];
-        [self.commandDelegate sendPluginResult:result callbackId:callbackId];
+/*!
+ * @brief Download update described by a per-file manifest
+ * @details Fetches the manifest, reuses unchanged files from the installed www and downloads
+ *          only changed/new files (from a patch archive if the server offers one for the
+ *          installed version). The assembled tree goes through the same staging as a ZIP update.
+ */
+- (void)downloadDeltaUpdate:(NSString*)manifestURLString callbackId:(NSString*)callbackId {
+    [self setDownloadInProgress:YES];
+
+    NSLog(@"[HotUpdates] Starting delta update");
+
+    NSURL *manifestURL = [NSURL URLWithString:manifestURLString];
+    if (!manifestURL) {
+        NSLog(@"[HotUpdates] ERROR: Invalid manifest URL format");
+        [self failDownload:kErrorURLRequired message:@"Invalid URL format" callbackId:callbackId];
         return;
     }
 
     NSURLSessionConfiguration *config = [NSURLSessionConfiguration defaultSessionConfiguration];
-    config.timeoutIntervalForRequest = 30.0;  // ТЗ: 30-60 секунд
-    config.timeoutIntervalForResource = 60.0; // ТЗ: максимум 60 секунд на всю загрузку
+    config.timeoutIntervalForRequest = 30.0;
+    config.HTTPMaximumConnectionsPerHost = 4;
 
     NSURLSession *session = [NSURLSession sessionWithConfiguration:config];
 
-    NSURLSessionDownloadTask *downloadTask = [session downloadTaskWithURL:url
-                                                        completionHandler:^(NSURL *location, NSURLResponse *response, NSError *error) {
-        // Инвалидируем сессию для предотвращения утечки памяти
-        [session finishTasksAndInvalidate];
-
-        self->isDownloadingUpdate = NO;
-        [[NSUserDefaults standardUserDefaults] setBool:NO forKey:kDownloadInProgress];
-        [[NSUserDefaults standardUserDefaults] synchronize];
-
+    NSURLSessionDataTask *task = [session dataTaskWithURL:manifestURL
+                                        completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
         if (error) {
-            NSLog(@"[HotUpdates] ERROR: Download failed: %@", error.localizedDescription);
-
-            CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
-                                                     messageAsDictionary:[self createError:kErrorDownloadFailed
-                                                                                    message:[NSString stringWithFormat:@"Download failed: %@", error.localizedDescription]]];
-            [self.commandDelegate sendPluginResult:result callbackId:callbackId];
+            [session invalidateAndCancel];
+            dispatch_async(dispatch_get_main_queue(), ^{
+                [self failDownload:kErrorDownloadFailed
+                           message:[NSString stringWithFormat:@"Manifest download failed: %@", error.localizedDescription]
+                        callbackId:callbackId];
+            });
             return;
         }
 
         NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
         if (httpResponse.statusCode != 200) {
-            NSLog(@"[HotUpdates] ERROR: HTTP %ld", (long)httpResponse.statusCode);
+            [session invalidateAndCancel];
+            dispatch_async(dispatch_get_main_queue(), ^{
+                [self failDownload:kErrorHTTPError
+                           message:[NSString stringWithFormat:@"HTTP error: %ld", (long)httpResponse.statusCode]
+                        callbackId:callbackId];
+            });
+            return;
+        }
 
-            CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
-                                                     messageAsDictionary:[self createError:kErrorHTTPError
-                                                                                    message:[NSString stringWithFormat:@"HTTP error: %ld", (long)httpResponse.statusCode]]];
-            [self.commandDelegate sendPluginResult:result callbackId:callbackId];
+        NSString *publicKey = [self manifestPublicKey];
+        if (!publicKey) {
+            [self buildDeltaUpdateFromData:data manifestURL:manifestURL session:session callbackId:callbackId];
             return;
         }
 
-        NSLog(@"[HotUpdates] Download completed, verifying...");
-        [self saveDownloadedUpdate:location callbackId:callbackId];
+        // С ключом в config.xml принимаются только подписанные манифесты
+        [HotUpdatesVerifier verifyData:data
+                           signedAtURL:manifestURL
+                             publicKey:publicKey
+                               session:session
+                            completion:^(NSError *signatureError) {
+            if (signatureError) {
+                [session invalidateAndCancel];
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    [self failDownload:kErrorSignatureInvalid message:signatureError.localizedDescription callbackId:callbackId];
+                });
+                return;
+            }
+            [self buildDeltaUpdateFromData:data manifestURL:manifestURL session:session callbackId:callbackId];
+        }];
     }];
 
-    [downloadTask resume];
+    [task resume];
+    [self registerSession:session callbackId:callbackId];
 }
 
-- (void)saveDownloadedUpdate:(NSURL*)updateLocation callbackId:(NSString*)callbackId {
-    NSFileManager *fileManager = [NSFileManager defaultManager];
-    NSError *error;
+- (void)buildDeltaUpdateFromData:(NSData*)data
+                     manifestURL:(NSURL*)manifestURL
+                         session:(NSURLSession*)session
+                      callbackId:(NSString*)callbackId {
+    NSError *parseError = nil;
+    HotUpdatesManifest *manifest = [HotUpdatesManifest manifestWithData:data manifestURL:manifestURL error:&parseError];
+    if (!manifest) {
+        [session invalidateAndCancel];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self failDownload:kErrorManifestInvalid
+                       message:[NSString stringWithFormat:@"Invalid manifest: %@", parseError.localizedDescription]
+                    callbackId:callbackId];
+        });
+        return;
+    }
 
-    // Используем временную папку для новой загрузки (не трогаем существующую temp_downloaded_update)
-    NSString *newDownloadPath = [documentsPath stringByAppendingPathComponent:@"temp_new_download"];
-    NSString *tempUpdatePath = [documentsPath stringByAppendingPathComponent:@"temp_downloaded_update"];
+    // Сборка идёт синхронными загрузками - уходим с очереди делегата сессии
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        [self buildDeltaUpdate:manifest session:session callbackId:callbackId];
+        [session finishTasksAndInvalidate];
+    });
+}
 
-    // Очищаем только папку для новой загрузки
-    if ([fileManager fileExistsAtPath:newDownloadPath]) {
-        [fileManager removeItemAtPath:newDownloadPath error:nil];
+/*!
+ * @brief Assemble the new www from a parsed manifest
+ * @details Runs on a global queue; plugin state (pending* ivars, staging, failDownload) is touched
+ *          only in blocks dispatched to the main queue
+ */
+- (void)buildDeltaUpdate:(HotUpdatesManifest*)manifest session:(NSURLSession*)session callbackId:(NSString*)callbackId {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSString *newDownloadPath = [documentsPath stringByAppendingPathComponent:kTempNewDownloadDirName];
+    NSString *newWwwPath = [newDownloadPath stringByAppendingPathComponent:kWWWDirName];
+
+    // temp_new_download общая с ZIP загрузкой - частично загруженный архив сбрасываем
+    [self clearResumeState];
+    [fileManager removeItemAtPath:newDownloadPath error:nil];
+    if (![fileManager createDirectoryAtPath:newWwwPath withIntermediateDirectories:YES attributes:nil error:nil]) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self failDownload:kErrorTempDirError message:@"Cannot create temp directory" callbackId:callbackId];
+        });
+        return;
     }
 
-    [fileManager createDirectoryAtPath:newDownloadPath
-           withIntermediateDirectories:YES
-                            attributes:nil
-                                 error:&error];
+    // Переиспользуем неизменённые файлы установленной версии. Файлы, совпадающие с bundle,
+    // в overlay версию не попадают вовсе: их отдаёт bundle через scheme handler
+    NSString *currentWwwPath = [self currentWWWPath];
+    NSString *bundleWwwPath = [self bundleWWWPath];
+    BOOL overlay = bundleWwwPath && [self canServePackedBundle];
+    NSTimeInterval copyStart = [HotUpdatesMetrics now];
+    NSUInteger fromBundle = 0;
+    NSMutableArray<HotUpdatesManifestEntry*> *missing = [NSMutableArray array];
+    for (HotUpdatesManifestEntry *entry in manifest.entries) {
+        NSString *localPath = [currentWwwPath stringByAppendingPathComponent:entry.path];
+        NSString *bundlePath = [bundleWwwPath stringByAppendingPathComponent:entry.path];
+        NSString *destPath = [newWwwPath stringByAppendingPathComponent:entry.path];
+
+        if ([HotUpdatesManifest fileAtPath:localPath matchesEntry:entry]) {
+            [fileManager createDirectoryAtPath:[destPath stringByDeletingLastPathComponent]
+                   withIntermediateDirectories:YES attributes:nil error:nil];
+            if ([store linkItemAtPath:localPath toPath:destPath error:nil]) {
+                continue;
+            }
+        } else if (bundleWwwPath && [HotUpdatesManifest fileAtPath:bundlePath matchesEntry:entry]) {
+            if (overlay) {
+                fromBundle++;
+                continue;
+            }
+            // file:// - WebView читает только одну директорию, копируем из bundle
+            [fileManager createDirectoryAtPath:[destPath stringByDeletingLastPathComponent]
+                   withIntermediateDirectories:YES attributes:nil error:nil];
+            if ([HotUpdatesStore cloneItemAtPath:bundlePath toPath:destPath error:nil]) {
+                fromBundle++;
+                continue;
+            }
+        }
+        [missing addObject:entry];
+    }
 
-    if (error) {
-        NSLog(@"[HotUpdates] ERROR: Failed to create temp directory: %@", error.localizedDescription);
-        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
-                                                 messageAsDictionary:[self createError:kErrorTempDirError
-                                                                                message:@"Cannot create temp directory"]];
-        [self.commandDelegate sendPluginResult:result callbackId:callbackId];
-        return;
+    if (overlay) {
+        // Marker records the bundle build: after a store update the overlay is dropped on launch
+        [[[self bundleBuildIdentifier] dataUsingEncoding:NSUTF8StringEncoding]
+            writeToFile:[newWwwPath stringByAppendingPathComponent:kOverlayMarkerFileName] atomically:NO];
     }
+    [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageCopy since:copyStart];
 
-    BOOL unzipSuccess = [self unzipFile:updateLocation.path toDestination:newDownloadPath];
+    NSLog(@"[HotUpdates] Delta: %lu files reused, %lu from bundle%@, %lu to download",
+          (unsigned long)(manifest.entries.count - missing.count - fromBundle), (unsigned long)fromBundle,
+          overlay ? @" (overlay)" : @"", (unsigned long)missing.count);
 
-    if (!unzipSuccess) {
-        [fileManager removeItemAtPath:newDownloadPath error:nil];
+    // Один patch-архив вместо множества мелких запросов
+    NSString *installedVersion = [state stringForKey:kInstalledVersion] ?: appBundleVersion;
+    NSURL *patchURL = [manifest patchURLForVersion:installedVersion];
+    if (missing.count > 0 && patchURL) {
+        missing = [self applyPatchArchive:patchURL entries:missing toWWWPath:newWwwPath session:session];
+    }
 
-        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
-                                                 messageAsDictionary:[self createError:kErrorExtractionFailed
-                                                                                message:@"Failed to extract update package"]];
-        [self.commandDelegate sendPluginResult:result callbackId:callbackId];
-        return;
+    long long totalBytes = 0;
+    for (HotUpdatesManifestEntry *entry in missing) {
+        totalBytes = entry.size >= 0 && totalBytes >= 0 ? totalBytes + entry.size : -1;
     }
+    HotUpdatesProgress *progress = [self progressForDownload:callbackId];
+    [progress startPhase:kProgressPhaseDownloading bytes:0 totalBytes:totalBytes];
+
+    // Загружаем оставшиеся файлы параллельно (ограничено HTTPMaximumConnectionsPerHost)
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_semaphore_t slots = dispatch_semaphore_create(4);
+    NSMutableArray<NSString*> *failures = [NSMutableArray array];
+    __block NSString *failureCode = nil;
+    __block long long downloadedBytes = 0;
+    NSTimeInterval downloadStart = [HotUpdatesMetrics now];
+
+    for (HotUpdatesManifestEntry *entry in missing) {
+        dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+        if ([self isDownloadCancelled:callbackId]) {
+            // Отменено: новые задачи не создаём, остановку обработает staging
+            dispatch_semaphore_signal(slots);
+            break;
+        }
+        dispatch_group_enter(group);
 
-    NSString *newWwwPath = [newDownloadPath stringByAppendingPathComponent:kWWWDirName];
-    if (![fileManager fileExistsAtPath:newWwwPath]) {
-        NSLog(@"[HotUpdates] ERROR: www folder not found in update package");
-        [fileManager removeItemAtPath:newDownloadPath error:nil];
+        NSString *destPath = [newWwwPath stringByAppendingPathComponent:entry.path];
+        NSURLSessionDownloadTask *task = [session downloadTaskWithURL:[manifest URLForEntry:entry]
+                                                    completionHandler:^(NSURL *location, NSURLResponse *response, NSError *error) {
+            NSString *code = nil;
+            if (error) {
+                code = kErrorDownloadFailed;
+            } else if (((NSHTTPURLResponse *)response).statusCode != 200) {
+                code = kErrorHTTPError;
+            } else {
+                [fileManager createDirectoryAtPath:[destPath stringByDeletingLastPathComponent]
+                       withIntermediateDirectories:YES attributes:nil error:nil];
+                [fileManager removeItemAtPath:destPath error:nil];
+                if (![fileManager moveItemAtPath:location.path toPath:destPath error:nil]) {
+                    code = kErrorDownloadFailed;
+                } else if (![[HotUpdatesManifest sha256OfFileAtPath:destPath] isEqualToString:entry.sha256]) {
+                    code = kErrorHashMismatch;
+                } else {
+                    // Файлы мелкие - считаем целиком по завершении
+                    long long size = [[fileManager attributesOfItemAtPath:destPath error:nil] fileSize];
+                    [progress addBytes:size];
+                    @synchronized (failures) {
+                        downloadedBytes += size;
+                    }
+                }
+            }
 
-        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
-                                                 messageAsDictionary:[self createError:kErrorWWWNotFound
-                                                                                message:@"www folder not found in package"]];
-        [self.commandDelegate sendPluginResult:result callbackId:callbackId];
-        return;
+            if (code) {
+                @synchronized (failures) {
+                    [failures addObject:entry.path];
+                    failureCode = failureCode ?: code;
+                }
+            }
+            dispatch_semaphore_signal(slots);
+            dispatch_group_leave(group);
+        }];
+        [task resume];
     }
 
-    // Успех! Теперь безопасно заменяем старую temp_downloaded_update на новую
-    if ([fileManager fileExistsAtPath:tempUpdatePath]) {
-        [fileManager removeItemAtPath:tempUpdatePath error:nil];
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    if (missing.count > 0 && failures.count == 0) {
+        [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageDownload since:downloadStart bytes:downloadedBytes];
     }
-    [fileManager moveItemAtPath:newDownloadPath toPath:tempUpdatePath error:nil];
-
-    // Копируем в pending_update для автоустановки при следующем запуске
-    NSString *pendingPath = [documentsPath stringByAppendingPathComponent:kPendingUpdateDirName];
 
-    if ([fileManager fileExistsAtPath:pendingPath]) {
-        [fileManager removeItemAtPath:pendingPath error:nil];
+    if (failures.count > 0) {
+        NSLog(@"[HotUpdates] ERROR: Delta update failed for %lu files (%@)", (unsigned long)failures.count, failureCode);
+        [fileManager removeItemAtPath:newDownloadPath error:nil];
+        NSString *code = failureCode;
+        NSString *message = [NSString stringWithFormat:@"Delta update failed: %@", failures.firstObject];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self failDownload:code message:message callbackId:callbackId];
+        });
+        return;
     }
 
-    BOOL copySuccess = [fileManager copyItemAtPath:tempUpdatePath
-                                            toPath:pendingPath
-                                             error:&error];
+    // Каждый файл новой www совпал со своей записью манифеста: хранилищу хешировать нечего
+    NSMutableDictionary<NSString*, NSString*> *hashes = [NSMutableDictionary dictionaryWithCapacity:manifest.entries.count];
+    for (HotUpdatesManifestEntry *entry in manifest.entries) {
+        hashes[entry.path] = entry.sha256;
+    }
+    NSString *version = manifest.version;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        // Версия "pending": берём её из манифеста
+        if ([self->pendingUpdateVersion isEqualToString:@"pending"] && version) {
+            self->pendingUpdateVersion = version;
+        }
+        self->pendingHashes = hashes;
+        self->pendingWarmupPaths = manifest.warmupPaths;
+        [self stageUpdateFromDirectory:newDownloadPath callbackId:callbackId];
+    });
+}
 
-    if (!copySuccess) {
-        NSLog(@"[HotUpdates] WARNING: Failed to copy to pending_update (auto-install disabled): %@", error.localizedDescription);
+/*!
+ * @brief Download patch ZIP (changed files only) and move matching files into the new www
+ * @return Entries not provided by the patch (to be downloaded one by one)
+ */
+- (NSMutableArray<HotUpdatesManifestEntry*>*)applyPatchArchive:(NSURL*)patchURL
+                                                       entries:(NSMutableArray<HotUpdatesManifestEntry*>*)missing
+                                                     toWWWPath:(NSString*)newWwwPath
+                                                       session:(NSURLSession*)session {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSString *patchPath = [documentsPath stringByAppendingPathComponent:kTempPatchDirName];
+    NSString *patchZipPath = [documentsPath stringByAppendingPathComponent:@"patch_temp.zip"];
+
+    NSLog(@"[HotUpdates] Downloading patch archive");
+
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    __block BOOL downloaded = NO;
+    [[session downloadTaskWithURL:patchURL
+                completionHandler:^(NSURL *location, NSURLResponse *response, NSError *error) {
+        if (!error && ((NSHTTPURLResponse *)response).statusCode == 200) {
+            [fileManager removeItemAtPath:patchZipPath error:nil];
+            downloaded = [fileManager moveItemAtPath:location.path toPath:patchZipPath error:nil];
+        }
+        dispatch_semaphore_signal(done);
+    }] resume];
+    dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+
+    NSMutableArray<HotUpdatesManifestEntry*> *remaining = missing;
+
+    // unzipFile кладёт найденную папку www в patchPath/www
+    if (downloaded && [self unzipFile:patchZipPath toDestination:patchPath]) {
+        NSString *patchWwwPath = [patchPath stringByAppendingPathComponent:kWWWDirName];
+        remaining = [NSMutableArray array];
+
+        for (HotUpdatesManifestEntry *entry in missing) {
+            NSString *patchedPath = [patchWwwPath stringByAppendingPathComponent:entry.path];
+            NSString *destPath = [newWwwPath stringByAppendingPathComponent:entry.path];
+
+            if ([HotUpdatesManifest fileAtPath:patchedPath matchesEntry:entry]) {
+                [fileManager createDirectoryAtPath:[destPath stringByDeletingLastPathComponent]
+                       withIntermediateDirectories:YES attributes:nil error:nil];
+                if ([fileManager moveItemAtPath:patchedPath toPath:destPath error:nil]) {
+                    continue;
+                }
+            }
+            [remaining addObject:entry];
+        }
+    } else {
+        NSLog(@"[HotUpdates] WARNING: Patch archive failed, falling back to per-file download");
     }
 
-    isUpdateReadyToInstall = YES;
-    // Сохраняем URL и версию в UserDefaults только после успешной загрузки
-    [[NSUserDefaults standardUserDefaults] setObject:pendingUpdateURL forKey:kPendingUpdateURL];
-    [[NSUserDefaults standardUserDefaults] setObject:pendingUpdateVersion forKey:kPendingVersion];
-    [[NSUserDefaults standardUserDefaults] setBool:YES forKey:kPendingUpdateReady];
-    [[NSUserDefaults standardUserDefaults] setBool:YES forKey:kHasPending];
-    [[NSUserDefaults standardUserDefaults] synchronize];
+    [fileManager removeItemAtPath:patchZipPath error:nil];
+    [fileManager removeItemAtPath:patchPath error:nil];
 
-    NSLog(@"[HotUpdates] Update ready (v%@)", pendingUpdateVersion);
+    return remaining;
+}
 
-    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK];
-    [self.commandDelegate sendPluginResult:result callbackId:callbackId];
+/*!
+ * @brief Reset download state and report error to JavaScript
+ */
+- (void)failDownload:(NSString*)code message:(NSString*)message callbackId:(NSString*)callbackId {
+    pendingVerifier = nil;
+    pendingWarmupPaths = nil;
+    pendingHashes = nil;
+    [state commitChanges:^(NSMutableDictionary *values) {
+        values[kDownloadInProgress] = @NO;
+    }];
+
+    NSLog(@"[HotUpdates] ERROR: %@", message);
+    // Отменённой задаче уже ответили CANCELLED
+    for (NSString *recipient in [self finishDownloadJob:callbackId]) {
+        [self sendError:code message:message callbackId:recipient];
+    }
 }
 
 #pragma mark - Force Update (Install Only)
 
 - (void)forceUpdate:(CDVInvokedUrlCommand*)command {
+    if ([self deferUntilStartup:^{ [self forceUpdate:command]; }]) {
+        return;
+    }
+
     if (!isUpdateReadyToInstall) {
         CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
                                                  messageAsDictionary:[self createError:kErrorNoUpdateReady
@@ -843,7 +3618,7 @@ static BOOL hasPerformedInitialReload = NO;
         return;
     }
 
-    NSString *tempUpdatePath = [documentsPath stringByAppendingPathComponent:@"temp_downloaded_update"];
+    NSString *tempUpdatePath = [documentsPath stringByAppendingPathComponent:kTempDownloadedDirName];
     NSString *tempWwwPath = [tempUpdatePath stringByAppendingPathComponent:kWWWDirName];
 
     if (![[NSFileManager defaultManager] fileExistsAtPath:tempWwwPath]) {
@@ -860,27 +3635,21 @@ static BOOL hasPerformedInitialReload = NO;
 }
 
 - (void)installDownloadedUpdate:(NSString*)tempWwwPath callbackId:(NSString*)callbackId {
-    NSString *versionToInstall = [[NSUserDefaults standardUserDefaults] stringForKey:kPendingVersion];
+    NSString *versionToInstall = [state stringForKey:kPendingVersion];
     if (!versionToInstall) {
         versionToInstall = @"unknown";
     }
 
+    NSArray<NSString*> *warmupPaths = [state arrayForKey:kPendingWarmup];
     NSLog(@"[HotUpdates] forceUpdate: installing v%@", versionToInstall);
 
-    NSFileManager *fileManager = [NSFileManager defaultManager];
-    NSError *error;
-
-    [self backupCurrentVersion];
-
-    if ([fileManager fileExistsAtPath:wwwPath]) {
-        [fileManager removeItemAtPath:wwwPath error:nil];
-    }
+    NSError *error = nil;
+    NSTimeInterval installStart = [HotUpdatesMetrics now];
 
-    BOOL copySuccess = [fileManager copyItemAtPath:tempWwwPath
-                                            toPath:wwwPath
-                                             error:&error];
+    // Переносим обновление в отдельную директорию версии (один rename)
+    NSString *versionDir = [self moveToVersionsDir:tempWwwPath version:versionToInstall error:&error];
 
-    if (!copySuccess) {
+    if (!versionDir) {
         NSLog(@"[HotUpdates] ERROR: Failed to install update: %@", error.localizedDescription);
 
         CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
@@ -892,25 +3661,25 @@ static BOOL hasPerformedInitialReload = NO;
 
     NSString *newVersion = versionToInstall;
 
-    [[NSUserDefaults standardUserDefaults] setObject:newVersion forKey:kInstalledVersion];
-    [[NSUserDefaults standardUserDefaults] setBool:NO forKey:kPendingUpdateReady];
-    [[NSUserDefaults standardUserDefaults] setBool:NO forKey:kHasPending];
-    [[NSUserDefaults standardUserDefaults] removeObjectForKey:kPendingUpdateURL];
-    [[NSUserDefaults standardUserDefaults] removeObjectForKey:kPendingVersion];
-    [[NSUserDefaults standardUserDefaults] removeObjectForKey:kCanaryVersion];
-    [[NSUserDefaults standardUserDefaults] synchronize];
+    // Добавляем версию в историю при успешной установке
+    [self addVersionToHistory:newVersion];
 
-    NSString *tempUpdatePath = [documentsPath stringByAppendingPathComponent:@"temp_downloaded_update"];
-    NSString *pendingPath = [documentsPath stringByAppendingPathComponent:kPendingUpdateDirName];
-    [fileManager removeItemAtPath:tempUpdatePath error:nil];
-    [fileManager removeItemAtPath:pendingPath error:nil];
+    // Переключаем указатель, предыдущая директория остаётся для rollback. Один коммит на установку
+    [state commitChanges:^(NSMutableDictionary *values) {
+        [self switchCurrentVersion:newVersion dirName:versionDir values:values];
+        values[kPendingUpdateReady] = @NO;
+        values[kHasPending] = @NO;
+        [values removeObjectsForKeys:@[kPendingUpdateURL, kPendingVersion, kPendingWarmup, kCanaryVersion]];
+    }];
+    [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageInstall since:installStart];
 
     isUpdateReadyToInstall = NO;
     pendingUpdateURL = nil;
     pendingUpdateVersion = nil;
 
-    // Добавляем версию в историю при успешной установке
-    [self addVersionToHistory:newVersion];
+    // Директория подготовки и устаревшие версии удаляются в фоне
+    NSString *tempUpdatePath = [documentsPath stringByAppendingPathComponent:kTempDownloadedDirName];
+    [self pruneVersionsRemovingPaths:@[tempUpdatePath]];
 
     NSLog(@"[HotUpdates] Update installed successfully");
     NSLog(@"[HotUpdates] Starting canary timer for version %@", newVersion);
@@ -921,14 +3690,100 @@ static BOOL hasPerformedInitialReload = NO;
     [self startCanaryTimer];
     hasPerformedInitialReload = NO;
 
-    [self clearWebViewCacheWithCompletion:^{
-        [self reloadWebView];
+    [self warmUpPaths:warmupPaths completion:^{
+        [self invalidateWebViewCacheWithCompletion:^{
+            [self reloadWebView];
+        }];
     }];
 }
 
+#pragma mark - Warm-up
+
+/*!
+ * @brief Read ahead files of the manifest warm-up list before the WebView reloads
+ * @details Extracted files get an F_RDADVISE read-ahead, pack items a MADV_WILLNEED on their range
+ *          of the mapping; both only schedule reads, so the reload is not held back by the disk.
+ *          Files missing in an overlay version are taken from the bundle. WKWebView offers no way
+ *          to fill its JavaScript code cache ahead of a load.
+ * @param paths www paths (kPendingWarmup), nil to skip
+ * @param completion Called on main thread
+ */
+- (void)warmUpPaths:(NSArray<NSString*>*)paths completion:(void (^)(void))completion {
+    if (paths.count == 0) {
+        completion();
+        return;
+    }
+
+    [self refreshCurrentPack];
+    HotUpdatesPack *pack = currentPack;
+    NSString *wwwRoot = [self currentWWWPath];
+    NSString *bundleRoot = [self bundleWWWPath];
+
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        NSTimeInterval startTime = [HotUpdatesMetrics now];
+        unsigned long long total = 0;
+        NSUInteger count = 0;
+        uintptr_t pageMask = (uintptr_t)getpagesize() - 1;
+
+        for (NSString *path in paths) {
+            if (total >= kWarmupMaxBytes) {
+                break;
+            }
+            NSString *compressedPath = [path stringByAppendingString:kCompressedAssetSuffix];
+
+            if (pack) {
+                NSData *data = [pack dataForPath:compressedPath] ?: [pack dataForPath:path];
+                if (data.length > 0) {
+                    uintptr_t start = (uintptr_t)data.bytes & ~pageMask;
+                    uintptr_t end = (uintptr_t)data.bytes + data.length;
+                    madvise((void *)start, end - start, MADV_WILLNEED);
+                    total += data.length;
+                    count++;
+                }
+                continue;
+            }
+
+            for (NSString *root in @[wwwRoot ?: @"", bundleRoot ?: @""]) {
+                if (root.length == 0) {
+                    continue;
+                }
+                NSString *filePath = [root stringByAppendingPathComponent:compressedPath];
+                int fd = open(filePath.fileSystemRepresentation, O_RDONLY);
+                if (fd < 0) {
+                    filePath = [root stringByAppendingPathComponent:path];
+                    fd = open(filePath.fileSystemRepresentation, O_RDONLY);
+                }
+                if (fd < 0) {
+                    continue;
+                }
+                struct stat info;
+                if (fstat(fd, &info) == 0 && info.st_size > 0) {
+                    struct radvisory advice = {
+                        .ra_offset = 0,
+                        .ra_count = (int)MIN((unsigned long long)info.st_size, kWarmupMaxBytes)
+                    };
+                    fcntl(fd, F_RDADVISE, &advice);
+                    total += info.st_size;
+                    count++;
+                }
+                close(fd);
+                break;
+            }
+        }
+
+        [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageWarmup since:startTime bytes:(long long)total];
+        NSLog(@"[HotUpdates] Warm-up: %lu files, %llu bytes", (unsigned long)count, total);
+        dispatch_async(dispatch_get_main_queue(), completion);
+    });
+}
+
 #pragma mark - Canary
 
 - (void)canary:(CDVInvokedUrlCommand*)command {
+    if ([self deferUntilStartup:^{ [self canary:command]; }]) {
+        return;
+    }
+
     // Безопасное получение первого аргумента
     NSString *canaryVersion = nil;
     if (command.arguments.count > 0 && [command.arguments[0] isKindOfClass:[NSString class]]) {
@@ -943,30 +3798,72 @@ static BOOL hasPerformedInitialReload = NO;
         return;
     }
 
-    // Сохраняем canary версию
-    [[NSUserDefaults standardUserDefaults] setObject:canaryVersion forKey:kCanaryVersion];
-    [[NSUserDefaults standardUserDefaults] synchronize];
-
     // Останавливаем canary таймер если он запущен
+    NSTimeInterval latency = -1;
     if (canaryTimer && [canaryTimer isValid]) {
         [canaryTimer invalidate];
         canaryTimer = nil;
+        [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageCanary since:canaryStartTime];
         NSLog(@"[HotUpdates] Canary confirmed: v%@", canaryVersion);
+        // Загрузка, продлённая через extendCanary, не говорит о скорости устройства
+        if (!canaryExtended) {
+            latency = [HotUpdatesMetrics now] - canaryStartTime;
+        }
     }
 
+    // Сохраняем canary версию и время загрузки одним коммитом
+    [state commitChanges:^(NSMutableDictionary *values) {
+        values[kCanaryVersion] = canaryVersion;
+        if (latency >= 0) {
+            [self addCanaryLatency:latency version:canaryVersion values:values];
+        }
+    }];
+
     // ТЗ: при успехе callback возвращает null
     CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK];
     [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
 }
 
+#pragma mark - Extend Canary
+
+/*!
+ * @brief Push the canary deadline of a slow load that still makes progress
+ * @details Deadline moves by the current canary timeout, at most to kCanaryMaxExtended after
+ *          the timer start. Without running timer nothing happens
+ */
+- (void)extendCanary:(CDVInvokedUrlCommand*)command {
+    if ([self deferUntilStartup:^{ [self extendCanary:command]; }]) {
+        return;
+    }
+
+    if (canaryTimer && [canaryTimer isValid]) {
+        NSTimeInterval elapsed = [HotUpdatesMetrics now] - canaryStartTime;
+        NSTimeInterval delay = MIN(canaryTimeoutInterval, kCanaryMaxExtended - elapsed);
+        if (delay > 0) {
+            [self scheduleCanaryTimerAfter:delay];
+            canaryExtended = YES;
+            NSLog(@"[HotUpdates] Canary deadline extended by %.1f s", delay);
+        } else {
+            NSLog(@"[HotUpdates] Canary deadline not extended: load is running for %.0f s", elapsed);
+        }
+    }
+
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK];
+    [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+}
+
 #pragma mark - Debug Methods
 
 - (void)getVersionInfo:(CDVInvokedUrlCommand*)command {
-    NSString *installedVersion = [[NSUserDefaults standardUserDefaults] stringForKey:kInstalledVersion];
-    NSString *previousVersion = [[NSUserDefaults standardUserDefaults] stringForKey:kPreviousVersion];
-    NSString *canaryVersion = [[NSUserDefaults standardUserDefaults] stringForKey:kCanaryVersion];
-    NSString *pendingVersion = [[NSUserDefaults standardUserDefaults] stringForKey:kPendingVersion];
-    BOOL hasPendingUpdate = [[NSUserDefaults standardUserDefaults] boolForKey:kHasPending];
+    if ([self deferUntilStartup:^{ [self getVersionInfo:command]; }]) {
+        return;
+    }
+
+    NSString *installedVersion = [state stringForKey:kInstalledVersion];
+    NSString *previousVersion = [state stringForKey:kPreviousVersion];
+    NSString *canaryVersion = [state stringForKey:kCanaryVersion];
+    NSString *pendingVersion = [state stringForKey:kPendingVersion];
+    BOOL hasPendingUpdate = [state boolForKey:kHasPending];
 
     NSDictionary *info = @{
         @"appBundleVersion": appBundleVersion ?: @"unknown",
@@ -975,7 +3872,9 @@ static BOOL hasPerformedInitialReload = NO;
         @"canaryVersion": canaryVersion ?: [NSNull null],
         @"pendingVersion": pendingVersion ?: [NSNull null],
         @"hasPendingUpdate": @(hasPendingUpdate),
-        @"ignoreList": [self getIgnoreListInternal]
+        @"ignoreList": [self getIgnoreListInternal],
+        @"retainedVersions": [[self retainedVersionsInValues:[state snapshot]] valueForKey:@"version"],
+        @"canaryTimeoutMs": @((long long)([self canaryTimeoutInValues:[state snapshot]] * 1000))
     };
 
     CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK
@@ -983,4 +3882,37 @@ static BOOL hasPerformedInitialReload = NO;
     [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
 }
 
+/*!
+ * @brief Stage timings of the ring buffer (HotUpdatesMetrics), oldest first
+ * @details Optional {clear: true} drops the returned samples. Not deferred until startup:
+ *          startup stages are part of the answer once they are recorded.
+ */
+- (void)getMetrics:(CDVInvokedUrlCommand*)command {
+    NSDictionary *options = command.arguments.count > 0 && [command.arguments[0] isKindOfClass:[NSDictionary class]]
+        ? command.arguments[0] : nil;
+    BOOL clear = [options[@"clear"] boolValue];
+
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK
+                                                 messageAsDictionary:[[HotUpdatesMetrics sharedMetrics] dictionaryClearing:clear]];
+    [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+}
+
+#pragma mark - Metrics
+
+/*!
+ * @brief CDVPageDidLoadNotification: ends the reload stage started by reloadWebView
+ */
+- (void)pageDidLoad:(NSNotification*)notification {
+    if (reloadStartTime > 0) {
+        [HotUpdatesMetrics recordStage:HotUpdatesMetricsStageReload since:reloadStartTime];
+        reloadStartTime = 0;
+    }
+
+    // Первая навигация прошла - дальше Cordova работает с исходной стартовой страницей
+    if (bundleStartPage && [self.viewController isKindOfClass:[CDVViewController class]]) {
+        ((CDVViewController *)self.viewController).startPage = bundleStartPage;
+        bundleStartPage = nil;
+    }
+}
+
 @end
@@ -16,30 +16,57 @@
 // Error codes returned to JavaScript
 extern NSString * const kErrorUpdateDataRequired;
 extern NSString * const kErrorURLRequired;
-extern NSString * const kErrorDownloadInProgress;
+extern NSString * const kErrorCancelled;
 extern NSString * const kErrorDownloadFailed;
 extern NSString * const kErrorHTTPError;
 extern NSString * const kErrorTempDirError;
 extern NSString * const kErrorExtractionFailed;
 extern NSString * const kErrorWWWNotFound;
+extern NSString * const kErrorManifestInvalid;
+extern NSString * const kErrorHashMismatch;
+extern NSString * const kErrorSignatureInvalid;
+// ZIP update without verifyManifestUrl while HotUpdatesPublicKey is set
+extern NSString * const kManifestRequiredMessage;
+extern NSString * const kErrorInsufficientStorage;
 extern NSString * const kErrorNoUpdateReady;
 extern NSString * const kErrorUpdateFilesNotFound;
 extern NSString * const kErrorInstallFailed;
 extern NSString * const kErrorVersionRequired;
+extern NSString * const kErrorVersionNotRetained;
 
 #pragma mark - Storage Keys
 
-// NSUserDefaults keys
+// HotUpdatesState keys (NSUserDefaults keys of older plugin versions)
 extern NSString * const kInstalledVersion;
 extern NSString * const kPendingVersion;
+// Warm-up list of the staged update (array of www paths)
+extern NSString * const kPendingWarmup;
 extern NSString * const kHasPending;
 extern NSString * const kPreviousVersion;
 extern NSString * const kIgnoreList;
 extern NSString * const kCanaryVersion;
+// Measured canary confirmation times, oldest first: [{version, ms}]
+extern NSString * const kCanaryLatencies;
 extern NSString * const kDownloadInProgress;
 extern NSString * const kPendingUpdateURL;
 extern NSString * const kPendingUpdateReady;
 extern NSString * const kVersionHistory;
+extern NSString * const kCurrentVersionDir;
+extern NSString * const kPreviousVersionDir;
+// Rollback targets older than the previous version, newest first: [{version, dir}]
+extern NSString * const kRetainedVersions;
+extern NSString * const kResumeURL;
+extern NSString * const kResumeVersion;
+extern NSString * const kResumeValidator;
+extern NSString * const kResumeOffset;
+extern NSString * const kBackgroundDownloadURL;
+extern NSString * const kBackgroundDownloadVersion;
+extern NSString * const kBackgroundSessionId;
+extern NSString * const kBackgroundPacked;
+// Last check API response with its validators: {url, etag?, lastModified?, body}
+extern NSString * const kCheckCache;
+// Version directory the WebView cache was last invalidated for ("" - app bundle)
+extern NSString * const kCacheVersionDir;
 
 #pragma mark - Directory Names
 
@@ -47,6 +74,133 @@ extern NSString * const kVersionHistory;
 extern NSString * const kWWWDirName;
 extern NSString * const kPreviousWWWDirName;
 extern NSString * const kBackupWWWDirName;
-extern NSString * const kPendingUpdateDirName;
+extern NSString * const kPendingUpdateDirName;     // Вторая копия старых версий плагина, только для автоустановки
+extern NSString * const kTempNewDownloadDirName;
+extern NSString * const kTempDownloadedDirName;
+extern NSString * const kTempPatchDirName;
+extern NSString * const kSegmentedZipFileName;
+extern NSString * const kPackedZipFileName;
+// Packed version: www directory holds only this archive, served without extraction
+extern NSString * const kPackedBundleFileName;
+// Marker in www of a version that holds only files differing from the app bundle;
+// contents: app bundle build the version was made for
+extern NSString * const kOverlayMarkerFileName;
+// Pre-compressed asset: "app.js.gz" is served inflated for "app.js"
+extern NSString * const kCompressedAssetSuffix;
+// Inflated size limit of a pre-compressed asset (256 MB); larger output is not served
+extern const unsigned long long kMaxInflatedAssetBytes;
+extern NSString * const kVersionsDirName;
+extern NSString * const kStoreDirName;
+extern NSString * const kStoreObjectsDirName;
+// Plugin state file (HotUpdatesState)
+extern NSString * const kStateFileName;
+
+#pragma mark - Download
+
+// Resume offset is persisted at most once per this many bytes (1 MB)
+extern const long long kResumeSaveIntervalBytes;
+
+// Upper bound for getUpdate({connections})
+extern const NSInteger kMaxDownloadConnections;
+// Archives below this size are downloaded over one connection (4 MB)
+extern const long long kSegmentedMinSizeBytes;
+
+#pragma mark - Progress Events
+
+// At most one progress event per this interval (seconds); phase changes are sent at once
+extern const NSTimeInterval kProgressInterval;
+extern NSString * const kProgressPhaseDownloading;
+extern NSString * const kProgressPhaseVerifying;
+extern NSString * const kProgressPhaseExtracting;
+extern NSString * const kProgressPhaseStaging;
+
+#pragma mark - Metrics
+
+// Stage timings kept in memory for getMetrics; the oldest are overwritten
+extern const NSUInteger kMetricsCapacity;
+
+#pragma mark - Canary
+
+// Canary timeout until enough load times are measured (20 seconds)
+extern const NSTimeInterval kCanaryTimeout;
+// Bounds of the adaptive canary timeout
+extern const NSTimeInterval kCanaryMinTimeout;
+extern const NSTimeInterval kCanaryMaxTimeout;
+// Adaptive timeout: this many times the 90th percentile of measured load times
+extern const NSInteger kCanaryTimeoutFactor;
+extern const NSInteger kCanaryLatencyPercentile;
+// Load times kept for the percentile, and measured before it replaces kCanaryTimeout
+extern const NSUInteger kCanaryLatencySamples;
+extern const NSUInteger kCanaryMinSamples;
+// extendCanary does not push the deadline beyond this time after the load (5 minutes)
+extern const NSTimeInterval kCanaryMaxExtended;
+
+#pragma mark - Warm-up
+
+// Bytes read ahead at most by post-install warm-up (32 MB)
+extern const unsigned long long kWarmupMaxBytes;
+
+#pragma mark - Background Download
+
+// Suffix of the NSURLSession background identifier (appended to bundle id)
+extern NSString * const kBackgroundSessionSuffix;
+// Suffix added for discretionary sessions (requiresCharging)
+extern NSString * const kBackgroundDiscretionarySuffix;
+// Downloaded archive waiting for extraction, and resume data of an interrupted transfer
+extern NSString * const kBackgroundZipFileName;
+extern NSString * const kBackgroundResumeDataFileName;
+// Signed manifest of the background download (kept until the archive is extracted)
+extern NSString * const kBackgroundVerifyManifestFileName;
+
+#pragma mark - Update Check
+
+// Why a version of the check response is not an update
+extern NSString * const kCheckReasonUpToDate;
+extern NSString * const kCheckReasonIgnored;
+extern NSString * const kCheckReasonIncompatible;
+
+#pragma mark - Background Prefetch
+
+// config.xml preference: check API of checkForUpdate without url and of the background prefetch
+// (README "Update Server API")
+extern NSString * const kPrefetchURLPreference;
+// config.xml preference: hours between prefetch checks (minimum 1)
+extern NSString * const kPrefetchIntervalPreference;
+extern const NSInteger kDefaultPrefetchIntervalHours;
+// BGProcessingTask identifier, listed in BGTaskSchedulerPermittedIdentifiers by
+// scripts/iosBackgroundPrefetch.js (IOS_BACKGROUND_PREFETCH=true)
+extern NSString * const kPrefetchTaskIdentifier;
+
+#pragma mark - Signed Manifest
+
+// config.xml preference: base64 DER public key (ECDSA P-256) for manifest signatures
+extern NSString * const kPublicKeyPreference;
+// Detached manifest signature: "<manifestUrl>.sig"
+extern NSString * const kSignatureSuffix;
+
+#pragma mark - Startup
+
+// config.xml preference: run startup file work (pending install, first-launch copy) off the main thread
+extern NSString * const kAsyncStartupPreference;
+// config.xml preference: point Cordova's start page at the installed version before the first
+// navigation instead of reloading the WebView after the bundled page has started loading
+extern NSString * const kSingleLoadPreference;
+
+#pragma mark - Version Retention
+
+// config.xml preference: installed versions kept for rollbackTo, current included (minimum 2)
+extern NSString * const kKeepVersionsPreference;
+extern const NSInteger kDefaultKeepVersions;
+// Below this free space only current and previous version are kept (50 MB)
+extern const unsigned long long kLowStorageBytes;
+// Free space left over after an update is written, on top of its expected size (10 MB)
+extern const long long kStorageMarginBytes;
+
+#pragma mark - WebView Cache
+
+// config.xml preference: "selective" (default) clears only local content data when the served
+// version changed, "full" wipes all website data on every install and launch
+extern NSString * const kCacheInvalidationPreference;
+extern NSString * const kCacheInvalidationFull;
 
 #endif /* HotUpdatesConstants_h */
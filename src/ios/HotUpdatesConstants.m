@@ -15,29 +15,50 @@
 
 NSString * const kErrorUpdateDataRequired = @"UPDATE_DATA_REQUIRED";
 NSString * const kErrorURLRequired = @"URL_REQUIRED";
-NSString * const kErrorDownloadInProgress = @"DOWNLOAD_IN_PROGRESS";
+NSString * const kErrorCancelled = @"CANCELLED";
 NSString * const kErrorDownloadFailed = @"DOWNLOAD_FAILED";
 NSString * const kErrorHTTPError = @"HTTP_ERROR";
 NSString * const kErrorTempDirError = @"TEMP_DIR_ERROR";
 NSString * const kErrorExtractionFailed = @"EXTRACTION_FAILED";
 NSString * const kErrorWWWNotFound = @"WWW_NOT_FOUND";
+NSString * const kErrorManifestInvalid = @"MANIFEST_INVALID";
+NSString * const kErrorHashMismatch = @"HASH_MISMATCH";
+NSString * const kErrorSignatureInvalid = @"SIGNATURE_INVALID";
+NSString * const kManifestRequiredMessage = @"verifyManifestUrl is required when HotUpdatesPublicKey is set";
+NSString * const kErrorInsufficientStorage = @"INSUFFICIENT_STORAGE";
 NSString * const kErrorNoUpdateReady = @"NO_UPDATE_READY";
 NSString * const kErrorUpdateFilesNotFound = @"UPDATE_FILES_NOT_FOUND";
 NSString * const kErrorInstallFailed = @"INSTALL_FAILED";
 NSString * const kErrorVersionRequired = @"VERSION_REQUIRED";
+NSString * const kErrorVersionNotRetained = @"VERSION_NOT_RETAINED";
 
 #pragma mark - Storage Keys
 
 NSString * const kInstalledVersion = @"hot_updates_installed_version";
 NSString * const kPendingVersion = @"hot_updates_pending_version";
+NSString * const kPendingWarmup = @"hot_updates_pending_warmup";
 NSString * const kHasPending = @"hot_updates_has_pending";
 NSString * const kPreviousVersion = @"hot_updates_previous_version";
 NSString * const kIgnoreList = @"hot_updates_ignore_list";
 NSString * const kCanaryVersion = @"hot_updates_canary_version";
+NSString * const kCanaryLatencies = @"hot_updates_canary_latencies";
 NSString * const kDownloadInProgress = @"hot_updates_download_in_progress";
 NSString * const kPendingUpdateURL = @"hot_updates_pending_update_url";
 NSString * const kPendingUpdateReady = @"hot_updates_pending_ready";
 NSString * const kVersionHistory = @"hot_updates_version_history";
+NSString * const kCurrentVersionDir = @"hot_updates_current_dir";
+NSString * const kPreviousVersionDir = @"hot_updates_previous_dir";
+NSString * const kRetainedVersions = @"hot_updates_retained_versions";
+NSString * const kResumeURL = @"hot_updates_resume_url";
+NSString * const kResumeVersion = @"hot_updates_resume_version";
+NSString * const kResumeValidator = @"hot_updates_resume_validator";
+NSString * const kResumeOffset = @"hot_updates_resume_offset";
+NSString * const kBackgroundDownloadURL = @"hot_updates_background_url";
+NSString * const kBackgroundDownloadVersion = @"hot_updates_background_version";
+NSString * const kBackgroundSessionId = @"hot_updates_background_session";
+NSString * const kBackgroundPacked = @"hot_updates_background_packed";
+NSString * const kCheckCache = @"hot_updates_check_cache";
+NSString * const kCacheVersionDir = @"hot_updates_cache_dir";
 
 #pragma mark - Directory Names
 
@@ -45,3 +66,92 @@ NSString * const kWWWDirName = @"www";
 NSString * const kPreviousWWWDirName = @"www_previous";
 NSString * const kBackupWWWDirName = @"www_backup";
 NSString * const kPendingUpdateDirName = @"pending_update";
+NSString * const kTempNewDownloadDirName = @"temp_new_download";
+NSString * const kTempDownloadedDirName = @"temp_downloaded_update";
+NSString * const kTempPatchDirName = @"temp_patch";
+NSString * const kSegmentedZipFileName = @"update_segmented.zip";
+NSString * const kPackedZipFileName = @"update_packed.zip";
+NSString * const kPackedBundleFileName = @"bundle.pack";
+NSString * const kOverlayMarkerFileName = @".hotupdates-overlay";
+NSString * const kCompressedAssetSuffix = @".gz";
+const unsigned long long kMaxInflatedAssetBytes = 256ULL * 1024 * 1024;
+NSString * const kVersionsDirName = @"versions";
+NSString * const kStoreDirName = @"store";
+NSString * const kStoreObjectsDirName = @"objects";
+NSString * const kStateFileName = @"hot_updates_state.plist";
+
+#pragma mark - Download
+
+const long long kResumeSaveIntervalBytes = 1024 * 1024;
+const NSInteger kMaxDownloadConnections = 8;
+const long long kSegmentedMinSizeBytes = 4 * 1024 * 1024;
+
+#pragma mark - Progress Events
+
+const NSTimeInterval kProgressInterval = 0.25;
+NSString * const kProgressPhaseDownloading = @"downloading";
+NSString * const kProgressPhaseVerifying = @"verifying";
+NSString * const kProgressPhaseExtracting = @"extracting";
+NSString * const kProgressPhaseStaging = @"staging";
+
+#pragma mark - Metrics
+
+const NSUInteger kMetricsCapacity = 256;
+
+#pragma mark - Canary
+
+const NSTimeInterval kCanaryTimeout = 20.0;
+const NSTimeInterval kCanaryMinTimeout = 10.0;
+const NSTimeInterval kCanaryMaxTimeout = 60.0;
+const NSInteger kCanaryTimeoutFactor = 3;
+const NSInteger kCanaryLatencyPercentile = 90;
+const NSUInteger kCanaryLatencySamples = 20;
+const NSUInteger kCanaryMinSamples = 3;
+const NSTimeInterval kCanaryMaxExtended = 300.0;
+
+#pragma mark - Warm-up
+
+const unsigned long long kWarmupMaxBytes = 32 * 1024 * 1024;
+
+#pragma mark - Background Download
+
+NSString * const kBackgroundSessionSuffix = @".hotupdates.background";
+NSString * const kBackgroundDiscretionarySuffix = @".discretionary";
+NSString * const kBackgroundZipFileName = @"update_temp.zip";
+NSString * const kBackgroundResumeDataFileName = @"update_resume.data";
+NSString * const kBackgroundVerifyManifestFileName = @"update_manifest.json";
+
+#pragma mark - Update Check
+
+NSString * const kCheckReasonUpToDate = @"upToDate";
+NSString * const kCheckReasonIgnored = @"ignored";
+NSString * const kCheckReasonIncompatible = @"incompatible";
+
+#pragma mark - Background Prefetch
+
+NSString * const kPrefetchURLPreference = @"HotUpdatesPrefetchUrl";
+NSString * const kPrefetchIntervalPreference = @"HotUpdatesPrefetchInterval";
+const NSInteger kDefaultPrefetchIntervalHours = 24;
+NSString * const kPrefetchTaskIdentifier = @"com.getmeback.hotupdates.prefetch";
+
+#pragma mark - Signed Manifest
+
+NSString * const kPublicKeyPreference = @"HotUpdatesPublicKey";
+NSString * const kSignatureSuffix = @".sig";
+
+#pragma mark - Startup
+
+NSString * const kAsyncStartupPreference = @"HotUpdatesAsyncStartup";
+NSString * const kSingleLoadPreference = @"HotUpdatesSingleLoad";
+
+#pragma mark - Version Retention
+
+NSString * const kKeepVersionsPreference = @"HotUpdatesKeepVersions";
+const NSInteger kDefaultKeepVersions = 2;
+const unsigned long long kLowStorageBytes = 50 * 1024 * 1024;
+const long long kStorageMarginBytes = 10 * 1024 * 1024;
+
+#pragma mark - WebView Cache
+
+NSString * const kCacheInvalidationPreference = @"HotUpdatesCacheInvalidation";
+NSString * const kCacheInvalidationFull = @"full";
@@ -0,0 +1,74 @@
+/*!
+ * @file HotUpdatesDownloadJob.h
+ * @brief One in-flight update download for Hot Updates Plugin
+ * @details All getUpdate calls for the same version share one job and are answered together
+ *          when its transfer finishes. A job is cancelled by cancelUpdate or by a getUpdate for
+ *          another version: its callbacks are answered right away, the tasks of its URL sessions
+ *          are cancelled and a late result of the aborted transfer is dropped.
+ *          Callbacks attached with progress also receive progress events until the job ends.
+ *
+ *          Thread-safe: callbacks attach on the main thread while the transfer ends on session queues.
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class HotUpdatesProgress;
+
+@interface HotUpdatesDownloadJob : NSObject
+
+/*!
+ * @param callbackId Callback of the getUpdate call that started the job,
+ *                   nil for a background download re-attached after relaunch
+ * @param progress Send progress events to this callback as well
+ */
+- (instancetype)initWithVersion:(NSString*)version callbackId:(NSString*)callbackId progress:(BOOL)progress;
+
+// Requested version
+@property (nonatomic, copy, readonly) NSString *version;
+
+/*!
+ * @brief Identifies the job in the download methods (passed on as their callbackId)
+ * @details callbackId of the first getUpdate, a generated UUID for a re-attached background download
+ */
+@property (nonatomic, copy, readonly) NSString *identifier;
+
+// Transfer to run once the previous job has stopped (nil after it started)
+@property (atomic, copy) void (^start)(void);
+
+@property (atomic, readonly, getter=isCancelled) BOOL cancelled;
+
+// Reporter of the running transfer (set by the plugin when the transfer starts)
+@property (atomic, strong) HotUpdatesProgress *progress;
+
+// Callback ids that asked for progress events, empty once the job ended
+@property (atomic, readonly) NSArray<NSString*> *progressCallbackIds;
+
+/*!
+ * @brief Wait for the result of this job
+ * @param progress Send progress events to this callback as well
+ * @return NO if the job already finished or was cancelled
+ */
+- (BOOL)attachCallbackId:(NSString*)callbackId progress:(BOOL)progress;
+
+/*!
+ * @brief Cancel the tasks of this session together with the job
+ * @details Tasks are cancelled at once if the job is already cancelled
+ */
+- (void)addSession:(NSURLSession*)session;
+
+/*!
+ * @brief Mark job cancelled and cancel the tasks of its sessions
+ * @return Callback ids to report the cancellation to, empty if the job already finished
+ */
+- (NSArray<NSString*>*)cancel;
+
+/*!
+ * @brief Mark transfer finished
+ * @return Callback ids to report the result to, nil if the job was cancelled or already finished
+ */
+- (NSArray<NSString*>*)finish;
+
+@end
@@ -0,0 +1,108 @@
+/*!
+ * @file HotUpdatesDownloadJob.m
+ * @brief Implementation of the in-flight download job
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import "HotUpdatesDownloadJob.h"
+
+@interface HotUpdatesDownloadJob ()
+@property (atomic, readwrite, getter=isCancelled) BOOL cancelled;
+@property (nonatomic, assign) BOOL finished;
+@property (nonatomic, strong) NSMutableArray<NSString*> *callbackIds;
+@property (nonatomic, strong) NSMutableArray<NSString*> *progressIds;
+@property (nonatomic, strong) NSMutableArray<NSURLSession*> *sessions;
+@end
+
+@implementation HotUpdatesDownloadJob
+
+- (instancetype)initWithVersion:(NSString*)version callbackId:(NSString*)callbackId progress:(BOOL)progress {
+    self = [super init];
+    if (self) {
+        _version = [version copy];
+        _identifier = [callbackId copy] ?: [[NSUUID UUID] UUIDString];
+        _callbackIds = callbackId ? [NSMutableArray arrayWithObject:callbackId] : [NSMutableArray array];
+        _progressIds = callbackId && progress ? [NSMutableArray arrayWithObject:callbackId] : [NSMutableArray array];
+        _sessions = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (BOOL)attachCallbackId:(NSString*)callbackId progress:(BOOL)progress {
+    @synchronized (self) {
+        if (self.cancelled || self.finished) {
+            return NO;
+        }
+        [self.callbackIds addObject:callbackId];
+        if (progress) {
+            [self.progressIds addObject:callbackId];
+        }
+        return YES;
+    }
+}
+
+- (NSArray<NSString*>*)progressCallbackIds {
+    @synchronized (self) {
+        if (self.cancelled || self.finished) {
+            return @[];
+        }
+        return [self.progressIds copy];
+    }
+}
+
+- (void)addSession:(NSURLSession*)session {
+    if (!session) {
+        return;
+    }
+    @synchronized (self) {
+        if (!self.cancelled) {
+            [self.sessions addObject:session];
+            return;
+        }
+    }
+    [HotUpdatesDownloadJob cancelTasksOfSession:session];
+}
+
+- (NSArray<NSString*>*)cancel {
+    NSArray<NSURLSession*> *sessions;
+    NSArray<NSString*> *callbackIds;
+    @synchronized (self) {
+        if (self.cancelled || self.finished) {
+            return @[];
+        }
+        self.cancelled = YES;
+        self.start = nil;
+        sessions = [self.sessions copy];
+        [self.sessions removeAllObjects];
+        callbackIds = [self.callbackIds copy];
+    }
+
+    // Только задачи: сессии с загрузками владельцев продолжают создавать задачи и инвалидируются сами
+    for (NSURLSession *session in sessions) {
+        [HotUpdatesDownloadJob cancelTasksOfSession:session];
+    }
+    return callbackIds;
+}
+
+- (NSArray<NSString*>*)finish {
+    @synchronized (self) {
+        if (self.cancelled || self.finished) {
+            return nil;
+        }
+        self.finished = YES;
+        [self.sessions removeAllObjects];
+        return [self.callbackIds copy];
+    }
+}
+
++ (void)cancelTasksOfSession:(NSURLSession*)session {
+    [session getAllTasksWithCompletionHandler:^(NSArray<__kindof NSURLSessionTask*> *tasks) {
+        for (NSURLSessionTask *task in tasks) {
+            [task cancel];
+        }
+    }];
+}
+
+@end
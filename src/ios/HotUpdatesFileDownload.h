@@ -0,0 +1,33 @@
+/*!
+ * @file HotUpdatesFileDownload.h
+ * @brief Single-connection download into a file for Hot Updates Plugin
+ * @details Session delegate instead of a completion handler task, so received bytes are reported
+ *          while the body arrives. Used for packed updates, which need the complete archive on disk.
+ *          Not resumable.
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class HotUpdatesProgress;
+
+@interface HotUpdatesFileDownload : NSObject
+
+/*!
+ * @brief Download URL into a file
+ * @param path Destination file (replaced when the server answers 200)
+ * @param configuration Session configuration (timeouts)
+ * @param reporter Receives the downloading phase with received bytes (nil to skip)
+ * @param completion Called on a background queue; error is set for network and file errors,
+ *                   otherwise statusCode tells whether the file was written (200)
+ * @return Session of the transfer (cancelling its tasks aborts the download)
+ */
++ (NSURLSession*)downloadURL:(NSURL*)url
+                      toFile:(NSString*)path
+               configuration:(NSURLSessionConfiguration*)configuration
+                    reporter:(HotUpdatesProgress*)reporter
+                  completion:(void (^)(NSInteger statusCode, NSError *error))completion;
+
+@end
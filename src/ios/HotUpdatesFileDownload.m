@@ -0,0 +1,85 @@
+/*!
+ * @file HotUpdatesFileDownload.m
+ * @brief Implementation of single-connection file download
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import "HotUpdatesFileDownload.h"
+#import "HotUpdatesProgress.h"
+#import "HotUpdatesMetrics.h"
+#import "HotUpdatesConstants.h"
+
+@interface HotUpdatesFileDownload () <NSURLSessionDownloadDelegate>
+@property (nonatomic, copy) NSString *path;
+@property (nonatomic, strong) HotUpdatesProgress *reporter;
+@property (nonatomic, strong) NSError *moveError;
+@property (nonatomic, copy) void (^completion)(NSInteger statusCode, NSError *error);
+@end
+
+@implementation HotUpdatesFileDownload
+
++ (NSURLSession*)downloadURL:(NSURL*)url
+                      toFile:(NSString*)path
+               configuration:(NSURLSessionConfiguration*)configuration
+                    reporter:(HotUpdatesProgress*)reporter
+                  completion:(void (^)(NSInteger statusCode, NSError *error))completion {
+    HotUpdatesFileDownload *download = [[HotUpdatesFileDownload alloc] init];
+    download.path = path;
+    download.reporter = reporter;
+    download.completion = completion;
+
+    NSOperationQueue *queue = [[NSOperationQueue alloc] init];
+    queue.maxConcurrentOperationCount = 1;
+    queue.qualityOfService = NSQualityOfServiceUtility;
+
+    [reporter startPhase:kProgressPhaseDownloading bytes:0 totalBytes:-1];
+
+    // Сессия держит delegate до завершения задачи
+    NSURLSession *session = [NSURLSession sessionWithConfiguration:configuration delegate:download delegateQueue:queue];
+    [[session downloadTaskWithURL:url] resume];
+    [session finishTasksAndInvalidate];
+    return session;
+}
+
+#pragma mark - Session Delegate
+
+- (void)URLSession:(NSURLSession*)session
+      downloadTask:(NSURLSessionDownloadTask*)downloadTask
+      didWriteData:(int64_t)bytesWritten
+ totalBytesWritten:(int64_t)totalBytesWritten
+totalBytesExpectedToWrite:(int64_t)totalBytesExpectedToWrite {
+    [self.reporter setBytes:totalBytesWritten
+                 totalBytes:totalBytesExpectedToWrite == NSURLSessionTransferSizeUnknown ? -1 : totalBytesExpectedToWrite];
+}
+
+- (void)URLSession:(NSURLSession*)session
+      downloadTask:(NSURLSessionDownloadTask*)downloadTask
+didFinishDownloadingToURL:(NSURL*)location {
+    // location удаляется после возврата из метода - переносим синхронно
+    if ([(NSHTTPURLResponse*)downloadTask.response statusCode] != 200) {
+        return;
+    }
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSError *error = nil;
+    [fileManager removeItemAtPath:self.path error:nil];
+    if (![fileManager moveItemAtURL:location toURL:[NSURL fileURLWithPath:self.path] error:&error]) {
+        self.moveError = error;
+    }
+}
+
+- (void)URLSession:(NSURLSession*)session task:(NSURLSessionTask*)task didFinishCollectingMetrics:(NSURLSessionTaskMetrics*)metrics {
+    [HotUpdatesMetrics recordTaskMetrics:metrics];
+}
+
+- (void)URLSession:(NSURLSession*)session task:(NSURLSessionTask*)task didCompleteWithError:(NSError*)error {
+    if (self.completion) {
+        self.completion([(NSHTTPURLResponse*)task.response statusCode], error ?: self.moveError);
+        self.completion = nil;
+    }
+    self.reporter = nil;
+}
+
+@end
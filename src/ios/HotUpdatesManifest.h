@@ -0,0 +1,74 @@
+/*!
+ * @file HotUpdatesManifest.h
+ * @brief Per-file content manifest for delta updates
+ * @details The server publishes one manifest per version describing every file of the
+ *          www folder by SHA-256 hash and size. The plugin compares it with the installed
+ *          www and downloads only the files that changed.
+ *
+ *          Format:
+ *          {
+ *            "version": "2.0.0",
+ *            "baseUrl": "https://cdn.example.com/app/2.0.0/www/",
+ *            "patches": { "1.9.0": "https://cdn.example.com/app/patch-1.9.0-2.0.0.zip" },
+ *            "warmup": ["js/app.js", "css/app.css"],
+ *            "files": { "index.html": { "sha256": "...", "size": 1234 } }
+ *          }
+ *          baseUrl defaults to www/ next to the manifest URL. warmup (optional) lists files
+ *          read ahead before the WebView reloads after install.
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+/*!
+ * @brief Single file record of the manifest
+ */
+@interface HotUpdatesManifestEntry : NSObject
+
+@property (nonatomic, copy, readonly) NSString *path;
+@property (nonatomic, copy, readonly) NSString *sha256;
+@property (nonatomic, assign, readonly) long long size;  // -1 if not declared
+
+@end
+
+@interface HotUpdatesManifest : NSObject
+
+@property (nonatomic, copy, readonly) NSString *version;
+@property (nonatomic, copy, readonly) NSArray<HotUpdatesManifestEntry*> *entries;
+@property (nonatomic, copy, readonly) NSArray<NSString*> *warmupPaths;  // Empty if not declared
+
+/*!
+ * @brief Parse manifest JSON
+ * @param data Manifest body
+ * @param manifestURL URL the manifest was loaded from (used to resolve relative URLs)
+ * @param error Set if manifest is malformed or contains unsafe paths
+ * @return Manifest or nil on error
+ */
++ (instancetype)manifestWithData:(NSData*)data manifestURL:(NSURL*)manifestURL error:(NSError**)error;
+
+/*!
+ * @brief Get patch archive URL for upgrading from the given version
+ * @return Patch ZIP URL or nil if the server has no patch for this version
+ */
+- (NSURL*)patchURLForVersion:(NSString*)version;
+
+/*!
+ * @brief Get download URL for a single file
+ */
+- (NSURL*)URLForEntry:(HotUpdatesManifestEntry*)entry;
+
+/*!
+ * @brief Check if local file has the content described by entry
+ * @details Compares size first so that changed files are usually rejected without hashing
+ */
++ (BOOL)fileAtPath:(NSString*)path matchesEntry:(HotUpdatesManifestEntry*)entry;
+
+/*!
+ * @brief Compute SHA-256 of a file
+ * @return Lowercase hex digest or nil if file cannot be read
+ */
++ (NSString*)sha256OfFileAtPath:(NSString*)path;
+
+@end
@@ -0,0 +1,177 @@
+/*!
+ * @file HotUpdatesManifest.m
+ * @brief Implementation of per-file content manifest for delta updates
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import "HotUpdatesManifest.h"
+#import <CommonCrypto/CommonDigest.h>
+
+static NSString * const kManifestErrorDomain = @"HotUpdatesManifest";
+static NSString * const kDefaultBaseURL = @"www/";
+
+@interface HotUpdatesManifestEntry ()
+@property (nonatomic, copy, readwrite) NSString *path;
+@property (nonatomic, copy, readwrite) NSString *sha256;
+@property (nonatomic, assign, readwrite) long long size;
+@end
+
+@implementation HotUpdatesManifestEntry
+@end
+
+@interface HotUpdatesManifest ()
+@property (nonatomic, copy, readwrite) NSString *version;
+@property (nonatomic, copy, readwrite) NSArray<HotUpdatesManifestEntry*> *entries;
+@property (nonatomic, copy, readwrite) NSArray<NSString*> *warmupPaths;
+@property (nonatomic, strong) NSURL *baseURL;
+@property (nonatomic, copy) NSDictionary<NSString*, NSURL*> *patches;
+@end
+
+@implementation HotUpdatesManifest
+
++ (instancetype)manifestWithData:(NSData*)data manifestURL:(NSURL*)manifestURL error:(NSError**)error {
+    id json = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:error] : nil;
+    if (![json isKindOfClass:[NSDictionary class]]) {
+        return [self failWithMessage:@"Manifest is not a JSON object" error:error];
+    }
+
+    NSDictionary *files = json[@"files"];
+    if (![files isKindOfClass:[NSDictionary class]]) {
+        return [self failWithMessage:@"Manifest has no files" error:error];
+    }
+
+    NSMutableArray *entries = [NSMutableArray arrayWithCapacity:files.count];
+    for (NSString *path in files) {
+        NSDictionary *file = files[path];
+        if (![self isSafeRelativePath:path] || ![file isKindOfClass:[NSDictionary class]]) {
+            return [self failWithMessage:[NSString stringWithFormat:@"Invalid path in manifest: %@", path] error:error];
+        }
+
+        NSString *sha256 = file[@"sha256"];
+        if (![sha256 isKindOfClass:[NSString class]]) {
+            return [self failWithMessage:[NSString stringWithFormat:@"Missing sha256 for %@", path] error:error];
+        }
+
+        HotUpdatesManifestEntry *entry = [[HotUpdatesManifestEntry alloc] init];
+        entry.path = path;
+        entry.sha256 = [sha256 lowercaseString];
+        entry.size = [file[@"size"] isKindOfClass:[NSNumber class]] ? [file[@"size"] longLongValue] : -1;
+        [entries addObject:entry];
+    }
+
+    NSMutableDictionary *patches = [NSMutableDictionary dictionary];
+    NSDictionary *patchesJson = json[@"patches"];
+    if ([patchesJson isKindOfClass:[NSDictionary class]]) {
+        for (NSString *fromVersion in patchesJson) {
+            NSURL *patchURL = [NSURL URLWithString:patchesJson[fromVersion] relativeToURL:manifestURL];
+            if (patchURL) {
+                patches[fromVersion] = patchURL.absoluteURL;
+            }
+        }
+    }
+
+    NSMutableArray<NSString*> *warmupPaths = [NSMutableArray array];
+    NSArray *warmupJson = json[@"warmup"];
+    if ([warmupJson isKindOfClass:[NSArray class]]) {
+        for (NSString *path in warmupJson) {
+            if (![path isKindOfClass:[NSString class]] || ![self isSafeRelativePath:path]) {
+                return [self failWithMessage:[NSString stringWithFormat:@"Invalid warmup path in manifest: %@", path] error:error];
+            }
+            [warmupPaths addObject:path];
+        }
+    }
+
+    NSString *baseURLString = [json[@"baseUrl"] isKindOfClass:[NSString class]] ? json[@"baseUrl"] : kDefaultBaseURL;
+    if (![baseURLString hasSuffix:@"/"]) {
+        baseURLString = [baseURLString stringByAppendingString:@"/"];
+    }
+    NSURL *baseURL = [NSURL URLWithString:baseURLString relativeToURL:manifestURL];
+    if (!baseURL) {
+        return [self failWithMessage:@"Invalid baseUrl in manifest" error:error];
+    }
+
+    HotUpdatesManifest *manifest = [[HotUpdatesManifest alloc] init];
+    manifest.version = [json[@"version"] isKindOfClass:[NSString class]] ? json[@"version"] : nil;
+    manifest.entries = entries;
+    manifest.warmupPaths = warmupPaths;
+    manifest.baseURL = baseURL.absoluteURL;
+    manifest.patches = patches;
+    return manifest;
+}
+
+- (NSURL*)patchURLForVersion:(NSString*)version {
+    return version ? self.patches[version] : nil;
+}
+
+- (NSURL*)URLForEntry:(HotUpdatesManifestEntry*)entry {
+    NSString *encodedPath = [entry.path stringByAddingPercentEncodingWithAllowedCharacters:[NSCharacterSet URLPathAllowedCharacterSet]];
+    return [NSURL URLWithString:encodedPath relativeToURL:self.baseURL].absoluteURL;
+}
+
++ (BOOL)fileAtPath:(NSString*)path matchesEntry:(HotUpdatesManifestEntry*)entry {
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil];
+    if (!attributes || ![attributes[NSFileType] isEqualToString:NSFileTypeRegular]) {
+        return NO;
+    }
+    if (entry.size >= 0 && [attributes fileSize] != (unsigned long long)entry.size) {
+        return NO;
+    }
+
+    NSString *hash = [self sha256OfFileAtPath:path];
+    return hash && [hash isEqualToString:entry.sha256];
+}
+
++ (NSString*)sha256OfFileAtPath:(NSString*)path {
+    NSInputStream *stream = [NSInputStream inputStreamWithFileAtPath:path];
+    if (!stream) return nil;
+
+    [stream open];
+
+    CC_SHA256_CTX context;
+    CC_SHA256_Init(&context);
+
+    uint8_t buffer[64 * 1024];
+    NSInteger bytesRead;
+    while ((bytesRead = [stream read:buffer maxLength:sizeof(buffer)]) > 0) {
+        CC_SHA256_Update(&context, buffer, (CC_LONG)bytesRead);
+    }
+    [stream close];
+
+    if (bytesRead < 0) return nil;
+
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_Final(digest, &context);
+
+    NSMutableString *hex = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+        [hex appendFormat:@"%02x", digest[i]];
+    }
+    return hex;
+}
+
+#pragma mark - Private
+
++ (BOOL)isSafeRelativePath:(NSString*)path {
+    if (path.length == 0 || [path hasPrefix:@"/"] || [path containsString:@"\\"]) {
+        return NO;
+    }
+    for (NSString *segment in [path componentsSeparatedByString:@"/"]) {
+        if (segment.length == 0 || [segment isEqualToString:@"."] || [segment isEqualToString:@".."]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
++ (id)failWithMessage:(NSString*)message error:(NSError**)error {
+    if (error) {
+        *error = [NSError errorWithDomain:kManifestErrorDomain
+                                     code:1
+                                 userInfo:@{NSLocalizedDescriptionKey: message}];
+    }
+    return nil;
+}
+
+@end
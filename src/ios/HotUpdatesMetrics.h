@@ -0,0 +1,82 @@
+/*!
+ * @file HotUpdatesMetrics.h
+ * @brief Update pipeline timings for Hot Updates Plugin
+ * @details Every stage of an update (connection, transfer, validation, extraction, install,
+ *          WebView reload, canary) records its duration into a fixed-size ring buffer.
+ *          Recording writes into preallocated C arrays under a lock, without allocations;
+ *          the dictionary for getMetrics is built only when JavaScript asks for it.
+ *          Samples live in memory and are lost when the process ends.
+ *
+ *          Each sample also keeps the free space of the app's volume at the stage end, and
+ *          getMetrics adds the process memory footprint, so benchmarks can derive peak disk and
+ *          memory of an update without sampling threads.
+ *
+ *          Thread-safe: stages finish on the main thread, session delegate queues and
+ *          extraction workers.
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+typedef NS_ENUM(NSInteger, HotUpdatesMetricsStage) {
+    HotUpdatesMetricsStageDNS = 0,      // Domain lookup
+    HotUpdatesMetricsStageConnect,      // TCP connect
+    HotUpdatesMetricsStageTLS,          // TLS handshake
+    HotUpdatesMetricsStageTTFB,         // Request sent until response headers
+    HotUpdatesMetricsStageDownload,     // Transfer (streaming: including inline extraction)
+    HotUpdatesMetricsStageValidate,     // ZIP header, pack CRC check, signed manifest check of remaining files
+    HotUpdatesMetricsStageExtract,      // Archive extraction
+    HotUpdatesMetricsStageCopy,         // Link / copy of files that could not be renamed or reused
+    HotUpdatesMetricsStageStage,        // Store ingest and move to temp_downloaded_update
+    HotUpdatesMetricsStageInstall,      // Move to versions/ and pointer switch
+    HotUpdatesMetricsStageCacheClear,   // clearWebViewCacheWithCompletion:
+    HotUpdatesMetricsStageReload,       // WebView load until page loaded
+    HotUpdatesMetricsStageCanary,       // Canary timer start until canary() call
+    HotUpdatesMetricsStageWarmup        // Read-ahead of the manifest warm-up list before reload
+};
+
+@interface HotUpdatesMetrics : NSObject
+
++ (instancetype)sharedMetrics;
+
+/*!
+ * @brief Start time for recordStage:since: (monotonic, seconds)
+ */
++ (NSTimeInterval)now;
+
+/*!
+ * @brief Record stage that started at startTime and ends now
+ * @return End time, start of a directly following stage
+ */
++ (NSTimeInterval)recordStage:(HotUpdatesMetricsStage)stage since:(NSTimeInterval)startTime;
+
+/*!
+ * @brief Same, with the byte count of the stage
+ * @param bytes Bytes transferred or extracted, -1 if not applicable
+ */
++ (NSTimeInterval)recordStage:(HotUpdatesMetricsStage)stage since:(NSTimeInterval)startTime bytes:(long long)bytes;
+
+/*!
+ * @brief Record stage with a duration measured elsewhere (task metrics of a background session)
+ */
++ (void)recordStage:(HotUpdatesMetricsStage)stage duration:(NSTimeInterval)duration bytes:(long long)bytes;
+
+/*!
+ * @brief Record DNS, connect, TLS and TTFB of every network transaction of a task
+ * @details Called from URLSession:task:didFinishCollectingMetrics:. Reused connections
+ *          only report TTFB.
+ */
++ (void)recordTaskMetrics:(NSURLSessionTaskMetrics*)metrics;
+
+/*!
+ * @brief Samples in recording order (oldest first)
+ * @param clear Drop returned samples, so the next call only reports new ones
+ * @return {capacity, dropped, freeBytes, memory: {currentBytes, peakBytes},
+ *         samples: [{stage, durationMs, timestamp, bytes?, freeBytes}]};
+ *         dropped counts samples overwritten since the last clear
+ */
+- (NSDictionary*)dictionaryClearing:(BOOL)clear;
+
+@end
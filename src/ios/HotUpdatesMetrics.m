@@ -0,0 +1,206 @@
+/*!
+ * @file HotUpdatesMetrics.m
+ * @brief Implementation of update pipeline timings
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import "HotUpdatesMetrics.h"
+#import "HotUpdatesConstants.h"
+#import <os/lock.h>
+#import <mach/mach.h>
+#import <sys/mount.h>
+
+// Имена этапов для JS, индекс - HotUpdatesMetricsStage
+static NSString * const kStageNames[] = {
+    @"dns", @"connect", @"tls", @"ttfb", @"download", @"validate", @"extract",
+    @"copy", @"stage", @"install", @"cacheClear", @"reload", @"canary", @"warmup"
+};
+
+@implementation HotUpdatesMetrics {
+    os_unfair_lock _lock;
+    // Кольцевой буфер, выделяется один раз
+    HotUpdatesMetricsStage *_stages;
+    double *_timestamps;      // Конец этапа, ms с 1970
+    double *_durations;       // Секунды
+    long long *_bytes;        // -1 - этап без данных
+    long long *_freeBytes;    // Свободно на томе приложения в конце этапа
+    char *_volumePath;        // Домашняя директория приложения (Documents на том же томе)
+    NSUInteger _capacity;
+    NSUInteger _next;
+    NSUInteger _count;
+    long long _dropped;       // Перезаписаны до чтения
+}
+
++ (instancetype)sharedMetrics {
+    static HotUpdatesMetrics *shared = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        shared = [[HotUpdatesMetrics alloc] initWithCapacity:kMetricsCapacity];
+    });
+    return shared;
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    self = [super init];
+    if (self) {
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _capacity = capacity;
+        _stages = calloc(capacity, sizeof(HotUpdatesMetricsStage));
+        _timestamps = calloc(capacity, sizeof(double));
+        _durations = calloc(capacity, sizeof(double));
+        _bytes = calloc(capacity, sizeof(long long));
+        _freeBytes = calloc(capacity, sizeof(long long));
+        _volumePath = strdup(NSHomeDirectory().fileSystemRepresentation);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_stages);
+    free(_timestamps);
+    free(_durations);
+    free(_bytes);
+    free(_freeBytes);
+    free(_volumePath);
+}
+
++ (NSTimeInterval)now {
+    return [NSProcessInfo processInfo].systemUptime;
+}
+
++ (NSTimeInterval)recordStage:(HotUpdatesMetricsStage)stage since:(NSTimeInterval)startTime {
+    return [self recordStage:stage since:startTime bytes:-1];
+}
+
++ (NSTimeInterval)recordStage:(HotUpdatesMetricsStage)stage since:(NSTimeInterval)startTime bytes:(long long)bytes {
+    NSTimeInterval end = [self now];
+    [[self sharedMetrics] addStage:stage duration:end - startTime bytes:bytes];
+    return end;
+}
+
++ (void)recordStage:(HotUpdatesMetricsStage)stage duration:(NSTimeInterval)duration bytes:(long long)bytes {
+    [[self sharedMetrics] addStage:stage duration:duration bytes:bytes];
+}
+
++ (void)recordTaskMetrics:(NSURLSessionTaskMetrics*)metrics {
+    HotUpdatesMetrics *shared = [self sharedMetrics];
+
+    for (NSURLSessionTaskTransactionMetrics *transaction in metrics.transactionMetrics) {
+        if (transaction.resourceFetchType != NSURLSessionTaskMetricsResourceFetchTypeNetworkLoad) {
+            continue;
+        }
+
+        if (!transaction.reusedConnection) {
+            if (transaction.domainLookupStartDate && transaction.domainLookupEndDate) {
+                [shared addStage:HotUpdatesMetricsStageDNS
+                        duration:[transaction.domainLookupEndDate timeIntervalSinceDate:transaction.domainLookupStartDate]
+                           bytes:-1];
+            }
+
+            // connectEnd включает TLS: делим по secureConnectionStart
+            NSDate *tcpEnd = transaction.secureConnectionStartDate ?: transaction.connectEndDate;
+            if (transaction.connectStartDate && tcpEnd) {
+                [shared addStage:HotUpdatesMetricsStageConnect
+                        duration:[tcpEnd timeIntervalSinceDate:transaction.connectStartDate]
+                           bytes:-1];
+            }
+            if (transaction.secureConnectionStartDate && transaction.secureConnectionEndDate) {
+                [shared addStage:HotUpdatesMetricsStageTLS
+                        duration:[transaction.secureConnectionEndDate timeIntervalSinceDate:transaction.secureConnectionStartDate]
+                           bytes:-1];
+            }
+        }
+
+        if (transaction.requestStartDate && transaction.responseStartDate) {
+            [shared addStage:HotUpdatesMetricsStageTTFB
+                    duration:[transaction.responseStartDate timeIntervalSinceDate:transaction.requestStartDate]
+                       bytes:-1];
+        }
+    }
+}
+
+- (NSDictionary*)dictionaryClearing:(BOOL)clear {
+    os_unfair_lock_lock(&_lock);
+
+    NSMutableArray *samples = [NSMutableArray arrayWithCapacity:_count];
+    for (NSUInteger i = 0; i < _count; i++) {
+        NSUInteger slot = (_next + _capacity - _count + i) % _capacity;
+        NSMutableDictionary *sample = [NSMutableDictionary dictionaryWithDictionary:@{
+            @"stage": kStageNames[_stages[slot]],
+            @"durationMs": @(_durations[slot] * 1000),
+            @"timestamp": @((long long)_timestamps[slot])
+        }];
+        if (_bytes[slot] >= 0) {
+            sample[@"bytes"] = @(_bytes[slot]);
+        }
+        sample[@"freeBytes"] = @(_freeBytes[slot]);
+        [samples addObject:sample];
+    }
+
+    NSDictionary *result = @{
+        @"capacity": @(_capacity),
+        @"dropped": @(_dropped),
+        @"freeBytes": @([self freeBytes]),
+        @"memory": [self memory],
+        @"samples": samples
+    };
+
+    if (clear) {
+        _count = 0;
+        _dropped = 0;
+    }
+
+    os_unfair_lock_unlock(&_lock);
+    return result;
+}
+
+#pragma mark - Private
+
+- (void)addStage:(HotUpdatesMetricsStage)stage duration:(NSTimeInterval)duration bytes:(long long)bytes {
+    double timestamp = (CFAbsoluteTimeGetCurrent() + kCFAbsoluteTimeIntervalSince1970) * 1000;
+    long long freeBytes = [self freeBytes];  // statfs вне блокировки
+
+    os_unfair_lock_lock(&_lock);
+    _stages[_next] = stage;
+    _timestamps[_next] = timestamp;
+    _durations[_next] = duration;
+    _bytes[_next] = bytes;
+    _freeBytes[_next] = freeBytes;
+    _next = (_next + 1) % _capacity;
+    if (_count < _capacity) {
+        _count++;
+    } else {
+        _dropped++;
+    }
+    os_unfair_lock_unlock(&_lock);
+}
+
+/*!
+ * @brief Free space of the app volume, -1 if unknown. No allocation (called on every sample)
+ */
+- (long long)freeBytes {
+    struct statfs stats;
+    if (statfs(_volumePath, &stats) != 0) {
+        return -1;
+    }
+    return (long long)stats.f_bavail * (long long)stats.f_bsize;
+}
+
+/*!
+ * @brief Memory footprint of the process (what jetsam limits) and its peak since process start
+ * @return {currentBytes, peakBytes}, -1 where the kernel does not report it
+ */
+- (NSDictionary*)memory {
+    task_vm_info_data_t info;
+    mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+    if (task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+        return @{@"currentBytes": @(-1), @"peakBytes": @(-1)};
+    }
+    // ledger_phys_footprint_peak появился в ревизии 1 структуры
+    long long peak = count >= TASK_VM_INFO_REV1_COUNT ? (long long)info.ledger_phys_footprint_peak : -1;
+    return @{@"currentBytes": @((long long)info.phys_footprint), @"peakBytes": @(peak)};
+}
+
+@end
@@ -0,0 +1,67 @@
+/*!
+ * @file HotUpdatesPack.h
+ * @brief Packed bundle (single-file www) for Hot Updates Plugin
+ * @details A pack is the update ZIP itself, kept as one file instead of being extracted.
+ *          All entries must be stored (no compression), so every file is a contiguous byte
+ *          range of the archive and is served straight from a memory mapping through the
+ *          Cordova scheme handler. Install is one file rename and the version occupies one inode.
+ *
+ *          Only entries below the www folder of the archive (root or one level nested, as for
+ *          extracted updates) are part of the pack. Zip64 and encrypted archives are not packs.
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class HotUpdatesVerifier;
+
+@interface HotUpdatesPack : NSObject
+
+/*!
+ * @brief Map pack into memory and read its table of contents (central directory)
+ * @param path Pack or candidate archive
+ * @param error Set if the file is not a valid pack (compressed entries, Zip64, no www folder)
+ * @return Opened pack or nil
+ */
++ (instancetype)packAtPath:(NSString*)path error:(NSError**)error;
+
+/*!
+ * @brief Check whether a downloaded archive can be installed as a pack
+ * @details Reads every entry once to verify its CRC. An archive that fails here is installed
+ *          by extraction instead, which reports the actual error.
+ * @param verifier Signed manifest, items are hashed in the same pass (nil to skip)
+ * @return YES if the archive is a valid pack containing index.html
+ */
++ (BOOL)isServableArchiveAtPath:(NSString*)path verifier:(HotUpdatesVerifier*)verifier;
+
+/*!
+ * @brief MIME type for a file name (lookup table, application/octet-stream for unknown types)
+ */
++ (NSString*)mimeTypeForPath:(NSString*)path;
+
+/*!
+ * @brief Inflate a gzip file (pre-compressed asset) chunk by chunk
+ * @details Memory use is one chunk whatever the file claims in its ISIZE trailer.
+ *          Output beyond maxBytes is treated as invalid data.
+ * @param data Complete .gz file
+ * @param maxBytes Limit of the inflated size
+ * @param handler Receives every inflated chunk in order; returns NO to stop
+ * @return YES if the whole stream was inflated and delivered, NO on invalid gzip or stop
+ */
++ (BOOL)inflateGzipData:(NSData*)data
+               maxBytes:(unsigned long long)maxBytes
+                handler:(BOOL (^)(NSData *chunk))handler;
+
+/*!
+ * @brief Bytes of a file inside the pack, without copy (keeps the mapping alive)
+ * @param path Path relative to www ("js/app.js")
+ * @return Data or nil if the pack has no such file
+ */
+- (NSData*)dataForPath:(NSString*)path;
+
+// Number of files in the pack
+@property (nonatomic, readonly) NSUInteger count;
+
+@end
@@ -0,0 +1,375 @@
+/*!
+ * @file HotUpdatesPack.m
+ * @brief Implementation of packed bundle
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import "HotUpdatesPack.h"
+#import "HotUpdatesConstants.h"
+#import "HotUpdatesVerifier.h"
+#import <CommonCrypto/CommonDigest.h>
+#import <zlib.h>
+
+static NSString * const kPackErrorDomain = @"HotUpdatesPack";
+
+static const uint32_t kLocalHeaderSignature = 0x04034b50;
+static const uint32_t kCentralHeaderSignature = 0x02014b50;
+static const uint32_t kEndOfCentralDirSignature = 0x06054b50;
+
+static const uint64_t kLocalHeaderSize = 30;
+static const uint64_t kCentralHeaderSize = 46;
+static const uint64_t kEndOfCentralDirSize = 22;
+static const NSUInteger kGzipMinSize = 18;  // 10 байт заголовка + 8 байт трейлера
+static const NSUInteger kInflateChunkSize = 256 * 1024;
+
+static const uint16_t kFlagEncrypted = 0x0001;
+static const uint16_t kMethodStored = 0;
+
+static inline uint16_t readUInt16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t readUInt32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*!
+ * @brief Byte range of one file in the archive
+ */
+@interface HotUpdatesPackItem : NSObject
+@property (nonatomic, assign) uint64_t offset;
+@property (nonatomic, assign) uint64_t size;
+@property (nonatomic, assign) uint32_t crc;
+@end
+
+@implementation HotUpdatesPackItem
+@end
+
+@interface HotUpdatesPack ()
+@property (nonatomic, strong) NSData *archive;  // NSDataReadingMappedAlways
+@property (nonatomic, strong) NSDictionary<NSString*, HotUpdatesPackItem*> *items;
+@end
+
+@implementation HotUpdatesPack
+
++ (instancetype)packAtPath:(NSString*)path error:(NSError**)error {
+    // Отображение остаётся валидным и после удаления файла (prune старых версий)
+    NSData *archive = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:error];
+    if (!archive) {
+        return nil;
+    }
+    const uint8_t *bytes = archive.bytes;
+    uint64_t length = archive.length;
+
+    if (length < kEndOfCentralDirSize || readUInt32(bytes) != kLocalHeaderSignature) {
+        return [self fail:error message:@"Invalid file format (not a ZIP archive)"];
+    }
+
+    // EOCD в конце файла, за ним может быть комментарий до 64 KB
+    uint64_t minPos = length > 0xFFFF + kEndOfCentralDirSize ? length - 0xFFFF - kEndOfCentralDirSize : 0;
+    int64_t eocd = -1;
+    for (int64_t i = (int64_t)(length - kEndOfCentralDirSize); i >= (int64_t)minPos; i--) {
+        if (readUInt32(bytes + i) == kEndOfCentralDirSignature) {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0) {
+        return [self fail:error message:@"Corrupted ZIP archive (central directory not found)"];
+    }
+
+    uint64_t entryCount = readUInt16(bytes + eocd + 10);
+    uint64_t cdSize = readUInt32(bytes + eocd + 12);
+    uint64_t cdOffset = readUInt32(bytes + eocd + 16);
+    if (entryCount == 0xFFFF || cdSize == 0xFFFFFFFF || cdOffset == 0xFFFFFFFF) {
+        return [self fail:error message:@"Zip64 archive cannot be used as pack"];
+    }
+    if (cdOffset + cdSize > (uint64_t)eocd) {
+        return [self fail:error message:@"Corrupted ZIP archive (invalid central directory)"];
+    }
+
+    NSMutableDictionary<NSString*, HotUpdatesPackItem*> *entries = [NSMutableDictionary dictionaryWithCapacity:(NSUInteger)entryCount];
+    uint64_t pos = cdOffset;
+    uint64_t cdEnd = cdOffset + cdSize;
+
+    for (uint64_t i = 0; i < entryCount; i++) {
+        if (pos + kCentralHeaderSize > cdEnd || readUInt32(bytes + pos) != kCentralHeaderSignature) {
+            return [self fail:error message:@"Corrupted ZIP archive (invalid central header)"];
+        }
+
+        const uint8_t *header = bytes + pos;
+        uint16_t flags = readUInt16(header + 8);
+        uint16_t method = readUInt16(header + 10);
+        uint32_t crc = readUInt32(header + 16);
+        uint64_t compressedSize = readUInt32(header + 20);
+        uint64_t size = readUInt32(header + 24);
+        uint16_t nameLength = readUInt16(header + 28);
+        uint16_t extraLength = readUInt16(header + 30);
+        uint16_t commentLength = readUInt16(header + 32);
+        uint64_t localOffset = readUInt32(header + 42);
+
+        if (pos + kCentralHeaderSize + nameLength + extraLength + commentLength > cdEnd) {
+            return [self fail:error message:@"Corrupted ZIP archive (invalid central header)"];
+        }
+
+        NSString *name = [[NSString alloc] initWithBytes:header + kCentralHeaderSize length:nameLength encoding:NSUTF8StringEncoding];
+        pos += kCentralHeaderSize + nameLength + extraLength + commentLength;
+
+        if (!name || [name hasSuffix:@"/"]) {
+            continue;
+        }
+        if (flags & kFlagEncrypted) {
+            return [self fail:error message:[NSString stringWithFormat:@"Encrypted entry cannot be served from pack: %@", name]];
+        }
+        if (method != kMethodStored || compressedSize != size) {
+            return [self fail:error message:[NSString stringWithFormat:@"Compressed entry cannot be served from pack: %@", name]];
+        }
+
+        // Данные идут после локального заголовка, его extra может отличаться от central
+        if (localOffset + kLocalHeaderSize > cdOffset || readUInt32(bytes + localOffset) != kLocalHeaderSignature) {
+            return [self fail:error message:[NSString stringWithFormat:@"Corrupted ZIP entry: %@", name]];
+        }
+        uint64_t dataOffset = localOffset + kLocalHeaderSize + readUInt16(bytes + localOffset + 26) + readUInt16(bytes + localOffset + 28);
+        if (dataOffset + size > cdOffset) {
+            return [self fail:error message:[NSString stringWithFormat:@"Corrupted ZIP entry: %@", name]];
+        }
+
+        HotUpdatesPackItem *item = [[HotUpdatesPackItem alloc] init];
+        item.offset = dataOffset;
+        item.size = size;
+        item.crc = crc;
+        entries[name] = item;
+    }
+
+    NSString *prefix = [self wwwPrefixForNames:entries.allKeys];
+    if (!prefix) {
+        return [self fail:error message:@"www folder not found in archive"];
+    }
+
+    NSMutableDictionary<NSString*, HotUpdatesPackItem*> *items = [NSMutableDictionary dictionaryWithCapacity:entries.count];
+    [entries enumerateKeysAndObjectsUsingBlock:^(NSString *name, HotUpdatesPackItem *item, BOOL *stop) {
+        if ([name hasPrefix:prefix] && name.length > prefix.length) {
+            items[[name substringFromIndex:prefix.length]] = item;
+        }
+    }];
+
+    HotUpdatesPack *pack = [[HotUpdatesPack alloc] init];
+    pack.archive = archive;
+    pack.items = items;
+    return pack;
+}
+
++ (BOOL)isServableArchiveAtPath:(NSString*)path verifier:(HotUpdatesVerifier*)verifier {
+    NSError *error = nil;
+    HotUpdatesPack *pack = [self packAtPath:path error:&error];
+
+    if (pack && !pack.items[@"index.html"]) {
+        error = [self errorWithMessage:@"index.html not found in archive"];
+        pack = nil;
+    }
+
+    const uint8_t *bytes = pack.archive.bytes;
+    NSString *wwwPrefix = [kWWWDirName stringByAppendingString:@"/"];
+    for (NSString *itemPath in pack.items) {
+        HotUpdatesPackItem *item = pack.items[itemPath];
+        uLong crc = crc32(0, Z_NULL, 0);
+        uint64_t remaining = item.size;
+        const uint8_t *source = bytes + item.offset;
+        // crc32 принимает uInt - считаем частями
+        while (remaining > 0) {
+            uInt chunk = (uInt)MIN(remaining, (uint64_t)UINT32_MAX);
+            crc = crc32(crc, source, chunk);
+            source += chunk;
+            remaining -= chunk;
+        }
+        if ((uint32_t)crc != item.crc) {
+            error = [self errorWithMessage:@"CRC mismatch"];
+            pack = nil;
+            break;
+        }
+
+        if (verifier) {
+            unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+            CC_SHA256_CTX sha256;
+            CC_SHA256_Init(&sha256);
+            const uint8_t *itemBytes = bytes + item.offset;
+            uint64_t itemRemaining = item.size;
+            while (itemRemaining > 0) {
+                CC_LONG chunk = (CC_LONG)MIN(itemRemaining, (uint64_t)UINT32_MAX);
+                CC_SHA256_Update(&sha256, itemBytes, chunk);
+                itemBytes += chunk;
+                itemRemaining -= chunk;
+            }
+            CC_SHA256_Final(digest, &sha256);
+
+            if (![verifier verifyEntryNamed:[wwwPrefix stringByAppendingString:itemPath] digest:digest error:&error]) {
+                pack = nil;
+                break;
+            }
+        }
+    }
+
+    if (!pack) {
+        NSLog(@"[HotUpdates] Archive cannot be used as pack (%@), extracting", error.localizedDescription);
+        return NO;
+    }
+    return YES;
+}
+
++ (NSString*)mimeTypeForPath:(NSString*)path {
+    static NSDictionary<NSString*, NSString*> *mimeTypes = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mimeTypes = @{
+            @"js": @"application/javascript",
+            @"mjs": @"application/javascript",
+            @"wasm": @"application/wasm",
+            @"html": @"text/html",
+            @"htm": @"text/html",
+            @"css": @"text/css",
+            @"json": @"application/json",
+            @"map": @"application/json",
+            @"svg": @"image/svg+xml",
+            @"png": @"image/png",
+            @"jpg": @"image/jpeg",
+            @"jpeg": @"image/jpeg",
+            @"gif": @"image/gif",
+            @"webp": @"image/webp",
+            @"ico": @"image/x-icon",
+            @"woff": @"font/woff",
+            @"woff2": @"font/woff2",
+            @"ttf": @"font/ttf",
+            @"otf": @"font/otf",
+            @"txt": @"text/plain",
+            @"xml": @"application/xml",
+            @"mp3": @"audio/mpeg",
+            @"mp4": @"video/mp4"
+        };
+    });
+
+    return mimeTypes[path.pathExtension.lowercaseString] ?: @"application/octet-stream";
+}
+
++ (BOOL)inflateGzipData:(NSData*)data
+               maxBytes:(unsigned long long)maxBytes
+                handler:(BOOL (^)(NSData *chunk))handler {
+    const uint8_t *bytes = data.bytes;
+    if (data.length < kGzipMinSize || bytes[0] != 0x1f || bytes[1] != 0x8b) {
+        return NO;
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        return NO;
+    }
+
+    // ISIZE из трейлера не используется: его значение ничем не проверено до конца потока.
+    // Размер и CRC zlib сверяет с трейлером сам
+    uint8_t *output = malloc(kInflateChunkSize);
+    const uint8_t *input = bytes;
+    unsigned long long inputRemaining = data.length;
+    unsigned long long produced = 0;
+    BOOL stopped = NO;
+    BOOL tooLarge = NO;
+    int status = Z_OK;
+
+    while (status == Z_OK) {
+        if (stream.avail_in == 0 && inputRemaining > 0) {
+            uInt chunk = (uInt)MIN(inputRemaining, (unsigned long long)UINT32_MAX);
+            stream.next_in = (Bytef *)input;
+            stream.avail_in = chunk;
+            input += chunk;
+            inputRemaining -= chunk;
+        }
+        stream.next_out = output;
+        stream.avail_out = (uInt)kInflateChunkSize;
+
+        // Без входа и без места на выходе Z_BUF_ERROR: поток обрезан
+        status = inflate(&stream, Z_NO_FLUSH);
+        NSUInteger length = kInflateChunkSize - stream.avail_out;
+        produced += length;
+        if (produced > maxBytes) {
+            tooLarge = YES;
+            break;
+        }
+        if (length > 0 && (status == Z_OK || status == Z_STREAM_END)
+            && !handler([NSData dataWithBytes:output length:length])) {
+            stopped = YES;
+            break;
+        }
+    }
+    free(output);
+    inflateEnd(&stream);
+
+    if (stopped) {
+        return NO;
+    }
+    if (tooLarge) {
+        NSLog(@"[HotUpdates] ERROR: Inflated gzip data exceeds %llu bytes", maxBytes);
+        return NO;
+    }
+    if (status != Z_STREAM_END) {
+        NSLog(@"[HotUpdates] ERROR: Invalid gzip data (status %d, %llu bytes inflated)", status, produced);
+        return NO;
+    }
+    return YES;
+}
+
+- (NSData*)dataForPath:(NSString*)path {
+    HotUpdatesPackItem *item = self.items[path];
+    if (!item) {
+        return nil;
+    }
+
+    // Без копирования: deallocator держит ссылку на отображение, пока WebKit использует данные
+    NSData *archive = self.archive;
+    return [[NSData alloc] initWithBytesNoCopy:(void*)((const uint8_t*)archive.bytes + item.offset)
+                                        length:(NSUInteger)item.size
+                                   deallocator:^(void *bytes, NSUInteger length) {
+        (void)archive;
+    }];
+}
+
+- (NSUInteger)count {
+    return self.items.count;
+}
+
+#pragma mark - Private
+
+/*!
+ * @brief Same rule as for extracted archives: www at the root, or nested one level
+ */
++ (NSString*)wwwPrefixForNames:(NSArray<NSString*>*)names {
+    NSString *rootPrefix = [kWWWDirName stringByAppendingString:@"/"];
+    NSString *nested = nil;
+
+    for (NSString *name in names) {
+        if ([name hasPrefix:rootPrefix]) {
+            return rootPrefix;
+        }
+        NSRange slash = [name rangeOfString:@"/"];
+        if (!nested && slash.location != NSNotFound && slash.location > 0
+            && [[name substringFromIndex:slash.location + 1] hasPrefix:rootPrefix]) {
+            nested = [[name substringToIndex:slash.location + 1] stringByAppendingString:rootPrefix];
+        }
+    }
+    return nested;
+}
+
++ (NSError*)errorWithMessage:(NSString*)message {
+    return [NSError errorWithDomain:kPackErrorDomain
+                               code:1
+                           userInfo:@{NSLocalizedDescriptionKey: message}];
+}
+
++ (id)fail:(NSError**)error message:(NSString*)message {
+    if (error) {
+        *error = [self errorWithMessage:message];
+    }
+    return nil;
+}
+
+@end
@@ -0,0 +1,42 @@
+/*!
+ * @file HotUpdatesParallelUnzip.h
+ * @brief Multi-core ZIP extraction for Hot Updates Plugin
+ * @details Maps the archive into memory, reads the central directory and spreads entries over
+ *          one worker per core. Bundles with thousands of small assets are CPU bound on inflate,
+ *          SSZipArchive extracts on one core only.
+ *
+ *          Supported: stored and deflated entries, Zip64.
+ *          Not supported: encrypted entries (rejected with an error).
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class HotUpdatesVerifier;
+@class HotUpdatesProgress;
+
+@interface HotUpdatesParallelUnzip : NSObject
+
+/*!
+ * @brief Extract ZIP archive using all cores, hashing every entry while it is inflated
+ *        and reporting written bytes as the extracting phase
+ * @param zipPath Complete archive on disk
+ * @param destination Destination directory (created if missing)
+ * @param verifier Signed manifest to check entries against (nil to skip)
+ * @param reporter Total is the uncompressed size of all entries (nil to skip)
+ * @param hashes Filled with entry name -> SHA-256 hex (see HotUpdatesStore ingestDirectoryAtPath:hashes:);
+ *               nil to hash only for the verifier
+ * @param error Set if the archive is invalid, an entry fails its CRC or a file cannot be written;
+ *              also if an entry does not match the manifest (verifier.failure is set too)
+ * @return YES if all entries were extracted
+ */
++ (BOOL)extractArchiveAtPath:(NSString*)zipPath
+                 toDirectory:(NSString*)destination
+                    verifier:(HotUpdatesVerifier*)verifier
+                    reporter:(HotUpdatesProgress*)reporter
+                      hashes:(NSMutableDictionary<NSString*, NSString*>*)hashes
+                       error:(NSError**)error;
+
+@end
@@ -0,0 +1,444 @@
+/*!
+ * @file HotUpdatesParallelUnzip.m
+ * @brief Implementation of multi-core ZIP extraction
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import "HotUpdatesParallelUnzip.h"
+#import "HotUpdatesVerifier.h"
+#import "HotUpdatesProgress.h"
+#import "HotUpdatesConstants.h"
+#import <CommonCrypto/CommonDigest.h>
+#import <zlib.h>
+#import <fcntl.h>
+#import <unistd.h>
+#import <stdatomic.h>
+
+static NSString * const kParallelUnzipErrorDomain = @"HotUpdatesParallelUnzip";
+
+static const uint32_t kLocalHeaderSignature = 0x04034b50;
+static const uint32_t kCentralHeaderSignature = 0x02014b50;
+static const uint32_t kEndOfCentralDirSignature = 0x06054b50;
+static const uint32_t kZip64EndOfCentralDirSignature = 0x06064b50;
+static const uint32_t kZip64LocatorSignature = 0x07064b50;
+
+static const uint64_t kLocalHeaderSize = 30;
+static const uint64_t kCentralHeaderSize = 46;
+static const uint64_t kEndOfCentralDirSize = 22;
+static const uint64_t kZip64EndOfCentralDirSize = 56;
+static const uint64_t kZip64LocatorSize = 20;
+
+static const size_t kOutputBufferSize = 256 * 1024;
+static const uint64_t kInputChunkSize = 1024 * 1024;
+
+static const uint16_t kFlagEncrypted = 0x0001;
+static const uint16_t kMethodStored = 0;
+static const uint16_t kMethodDeflated = 8;
+
+typedef struct {
+    uint64_t localHeaderOffset;
+    uint64_t compressedSize;
+    uint64_t uncompressedSize;
+    uint32_t crc;
+    uint16_t method;
+} HotUpdatesZipEntryInfo;
+
+static inline uint16_t readUInt16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t readUInt32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t readUInt64(const uint8_t *p) {
+    return (uint64_t)readUInt32(p) | ((uint64_t)readUInt32(p + 4) << 32);
+}
+
+static BOOL writeAll(int fd, const uint8_t *bytes, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, bytes, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return NO;
+        }
+        bytes += written;
+        length -= (size_t)written;
+    }
+    return YES;
+}
+
+@implementation HotUpdatesParallelUnzip
+
++ (BOOL)extractArchiveAtPath:(NSString*)zipPath
+                 toDirectory:(NSString*)destination
+                    verifier:(HotUpdatesVerifier*)verifier
+                    reporter:(HotUpdatesProgress*)reporter
+                      hashes:(NSMutableDictionary<NSString*, NSString*>*)hashes
+                       error:(NSError**)error {
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+
+    // Архив отображается в память: workers читают сжатые данные без копирования.
+    // precise_lifetime: bytes используются до конца метода, ARC не должен освободить NSData раньше
+    NSData *archive __attribute__((objc_precise_lifetime)) = [NSData dataWithContentsOfFile:zipPath options:NSDataReadingMappedAlways error:error];
+    if (!archive) {
+        return NO;
+    }
+    const uint8_t *bytes = archive.bytes;
+    uint64_t length = archive.length;
+
+    if (length < 4 || readUInt32(bytes) != kLocalHeaderSignature) {
+        return [self fail:error message:@"Invalid file format (not a ZIP archive)"];
+    }
+
+    uint64_t entryCount = 0, cdSize = 0, cdOffset = 0;
+    if (![self readEndOfCentralDir:bytes length:length entryCount:&entryCount cdSize:&cdSize cdOffset:&cdOffset]) {
+        return [self fail:error message:@"Corrupted ZIP archive (central directory not found)"];
+    }
+    if (entryCount > cdSize / kCentralHeaderSize) {
+        return [self fail:error message:@"Corrupted ZIP archive (invalid entry count)"];
+    }
+
+    NSMutableData *infoData __attribute__((objc_precise_lifetime)) = [NSMutableData dataWithLength:(NSUInteger)entryCount * sizeof(HotUpdatesZipEntryInfo)];
+    HotUpdatesZipEntryInfo *infos = infoData.mutableBytes;
+    NSMutableArray<NSString*> *paths = [NSMutableArray arrayWithCapacity:(NSUInteger)entryCount];
+    NSMutableArray<NSString*> *names = [NSMutableArray arrayWithCapacity:(NSUInteger)entryCount];
+    NSMutableSet<NSString*> *directories = [NSMutableSet set];
+
+    uint64_t pos = cdOffset;
+    uint64_t cdEnd = cdOffset + cdSize;
+    NSUInteger fileCount = 0;
+
+    for (uint64_t i = 0; i < entryCount; i++) {
+        if (pos + kCentralHeaderSize > cdEnd || readUInt32(bytes + pos) != kCentralHeaderSignature) {
+            return [self fail:error message:@"Corrupted ZIP archive (invalid central header)"];
+        }
+
+        const uint8_t *header = bytes + pos;
+        uint16_t flags = readUInt16(header + 8);
+        uint16_t method = readUInt16(header + 10);
+        uint32_t crc = readUInt32(header + 16);
+        uint64_t compressedSize = readUInt32(header + 20);
+        uint64_t uncompressedSize = readUInt32(header + 24);
+        uint16_t nameLength = readUInt16(header + 28);
+        uint16_t extraLength = readUInt16(header + 30);
+        uint16_t commentLength = readUInt16(header + 32);
+        uint64_t localOffset = readUInt32(header + 42);
+
+        if (pos + kCentralHeaderSize + nameLength + extraLength + commentLength > cdEnd) {
+            return [self fail:error message:@"Corrupted ZIP archive (invalid central header)"];
+        }
+
+        // Zip64: в extra поле 0x0001 лежат только значения, равные 0xFFFFFFFF в заголовке
+        const uint8_t *extra = header + kCentralHeaderSize + nameLength;
+        for (uint32_t e = 0; e + 4 <= extraLength; ) {
+            uint16_t fieldId = readUInt16(extra + e);
+            uint16_t fieldSize = readUInt16(extra + e + 2);
+            if (fieldId == 0x0001) {
+                const uint8_t *field = extra + e + 4;
+                uint32_t available = MIN((uint32_t)fieldSize, extraLength - e - 4);
+                uint32_t fieldPos = 0;
+                if (uncompressedSize == 0xFFFFFFFF && fieldPos + 8 <= available) {
+                    uncompressedSize = readUInt64(field + fieldPos);
+                    fieldPos += 8;
+                }
+                if (compressedSize == 0xFFFFFFFF && fieldPos + 8 <= available) {
+                    compressedSize = readUInt64(field + fieldPos);
+                    fieldPos += 8;
+                }
+                if (localOffset == 0xFFFFFFFF && fieldPos + 8 <= available) {
+                    localOffset = readUInt64(field + fieldPos);
+                }
+            }
+            e += 4 + fieldSize;
+        }
+
+        NSString *name = [[NSString alloc] initWithBytes:header + kCentralHeaderSize length:nameLength encoding:NSUTF8StringEncoding];
+        if (!name) {
+            name = [[NSString alloc] initWithBytes:header + kCentralHeaderSize length:nameLength encoding:NSWindowsCP1252StringEncoding];
+        }
+        pos += kCentralHeaderSize + nameLength + extraLength + commentLength;
+
+        if (!name || ![self isSafeEntryName:name]) {
+            return [self fail:error message:[NSString stringWithFormat:@"ZIP entry outside destination directory: %@", name]];
+        }
+        if (flags & kFlagEncrypted) {
+            return [self fail:error message:[NSString stringWithFormat:@"Encrypted ZIP entry not supported: %@", name]];
+        }
+
+        NSString *fullPath = [destination stringByAppendingPathComponent:name];
+        if ([name hasSuffix:@"/"]) {
+            [directories addObject:fullPath];
+            continue;
+        }
+        if (method != kMethodStored && method != kMethodDeflated) {
+            return [self fail:error message:[NSString stringWithFormat:@"Unsupported compression method %u: %@", method, name]];
+        }
+
+        [directories addObject:[fullPath stringByDeletingLastPathComponent]];
+        infos[fileCount] = (HotUpdatesZipEntryInfo){localOffset, compressedSize, uncompressedSize, crc, method};
+        [paths addObject:fullPath];
+        [names addObject:name];
+        fileCount++;
+    }
+
+    // Директории создаём один раз, до запуска workers
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    [directories addObject:destination];
+    for (NSString *directory in directories) {
+        if (![fileManager createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:error]) {
+            return NO;
+        }
+    }
+
+    // Крупные записи первыми, чтобы большой файл не распаковывался последним на одном ядре
+    NSMutableArray<NSNumber*> *order = [NSMutableArray arrayWithCapacity:fileCount];
+    for (NSUInteger i = 0; i < fileCount; i++) {
+        [order addObject:@(i)];
+    }
+    [order sortUsingComparator:^NSComparisonResult(NSNumber *a, NSNumber *b) {
+        uint64_t sizeA = infos[a.unsignedIntegerValue].compressedSize;
+        uint64_t sizeB = infos[b.unsignedIntegerValue].compressedSize;
+        return sizeA > sizeB ? NSOrderedAscending : (sizeA < sizeB ? NSOrderedDescending : NSOrderedSame);
+    }];
+
+    NSUInteger workers = MAX(1, MIN([NSProcessInfo processInfo].activeProcessorCount, fileCount));
+
+    long long uncompressedTotal = 0;
+    for (NSUInteger i = 0; i < fileCount; i++) {
+        uncompressedTotal += (long long)infos[i].uncompressedSize;
+    }
+    [reporter startPhase:kProgressPhaseExtracting bytes:0 totalBytes:uncompressedTotal];
+
+    atomic_uint_fast64_t nextIndex;
+    atomic_uint_fast64_t written;
+    atomic_bool failed;
+    atomic_init(&nextIndex, 0);
+    atomic_init(&written, 0);
+    atomic_init(&failed, false);
+    atomic_uint_fast64_t *nextIndexPtr = &nextIndex;
+    atomic_uint_fast64_t *writtenPtr = &written;
+    atomic_bool *failedPtr = &failed;
+
+    NSObject *errorLock = [[NSObject alloc] init];
+    __block NSString *firstError = nil;
+
+    // dispatch_apply синхронный: стековые переменные живут до конца всех workers
+    dispatch_apply(workers, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t worker) {
+        // Один буфер и один z_stream на worker для всех его записей
+        uint8_t *buffer = malloc(kOutputBufferSize);
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        inflateInit2(&stream, -MAX_WBITS);
+
+        uint_fast64_t index;
+        while (!atomic_load(failedPtr) && (index = atomic_fetch_add(nextIndexPtr, 1)) < fileCount) {
+            @autoreleasepool {
+                NSUInteger entryIndex = order[(NSUInteger)index].unsignedIntegerValue;
+                unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+                NSString *message = [self extractEntry:&infos[entryIndex]
+                                                 bytes:bytes
+                                                length:length
+                                                toPath:paths[entryIndex]
+                                                stream:&stream
+                                                buffer:buffer
+                                                digest:verifier || hashes ? digest : NULL];
+                NSError *verifyError = nil;
+                if (!message && verifier && ![verifier verifyEntryNamed:names[entryIndex] digest:digest error:&verifyError]) {
+                    message = verifyError.localizedDescription;
+                }
+                if (!message && hashes) {
+                    NSString *hex = [HotUpdatesVerifier hexStringForDigest:digest];
+                    @synchronized (hashes) {
+                        hashes[names[entryIndex]] = hex;
+                    }
+                }
+                if (message) {
+                    atomic_store(failedPtr, true);
+                    @synchronized (errorLock) {
+                        if (!firstError) firstError = message;
+                    }
+                } else {
+                    atomic_fetch_add(writtenPtr, infos[entryIndex].uncompressedSize);
+                    [reporter addBytes:(long long)infos[entryIndex].uncompressedSize];
+                }
+            }
+        }
+
+        inflateEnd(&stream);
+        free(buffer);
+    });
+
+    if (firstError) {
+        return [self fail:error message:firstError];
+    }
+
+    double seconds = CFAbsoluteTimeGetCurrent() - startTime;
+    uint64_t totalBytes = atomic_load(&written);
+    NSLog(@"[HotUpdates] Extracted %lu files (%llu KB) in %.0f ms on %lu threads, %.1f MB/s",
+          (unsigned long)fileCount, totalBytes / 1024, seconds * 1000, (unsigned long)workers,
+          seconds > 0 ? (totalBytes / (1024.0 * 1024.0)) / seconds : 0);
+    return YES;
+}
+
+#pragma mark - Private
+
++ (BOOL)readEndOfCentralDir:(const uint8_t*)bytes
+                     length:(uint64_t)length
+                 entryCount:(uint64_t*)entryCount
+                     cdSize:(uint64_t*)cdSize
+                   cdOffset:(uint64_t*)cdOffset {
+    if (length < kEndOfCentralDirSize) return NO;
+
+    // EOCD в конце файла, за ним может быть комментарий до 64 KB
+    uint64_t minPos = length > 0xFFFF + kEndOfCentralDirSize ? length - 0xFFFF - kEndOfCentralDirSize : 0;
+    int64_t eocd = -1;
+    for (int64_t i = (int64_t)(length - kEndOfCentralDirSize); i >= (int64_t)minPos; i--) {
+        if (readUInt32(bytes + i) == kEndOfCentralDirSignature) {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0) return NO;
+
+    *entryCount = readUInt16(bytes + eocd + 10);
+    *cdSize = readUInt32(bytes + eocd + 12);
+    *cdOffset = readUInt32(bytes + eocd + 16);
+
+    if (*entryCount == 0xFFFF || *cdSize == 0xFFFFFFFF || *cdOffset == 0xFFFFFFFF) {
+        // Zip64: locator стоит прямо перед EOCD
+        if (eocd >= (int64_t)kZip64LocatorSize && readUInt32(bytes + eocd - kZip64LocatorSize) == kZip64LocatorSignature) {
+            uint64_t zip64 = readUInt64(bytes + eocd - kZip64LocatorSize + 8);
+            if (zip64 + kZip64EndOfCentralDirSize <= length && readUInt32(bytes + zip64) == kZip64EndOfCentralDirSignature) {
+                *entryCount = readUInt64(bytes + zip64 + 32);
+                *cdSize = readUInt64(bytes + zip64 + 40);
+                *cdOffset = readUInt64(bytes + zip64 + 48);
+            }
+        }
+    }
+
+    return *cdOffset <= length && *cdSize <= length - *cdOffset;
+}
+
+/*!
+ * @brief Extract one entry
+ * @param digest Receives SHA-256 of the inflated content, NULL to skip hashing
+ * @return nil on success, error message otherwise
+ */
++ (NSString*)extractEntry:(const HotUpdatesZipEntryInfo*)info
+                    bytes:(const uint8_t*)bytes
+                   length:(uint64_t)length
+                   toPath:(NSString*)path
+                   stream:(z_stream*)stream
+                   buffer:(uint8_t*)buffer
+                   digest:(unsigned char*)digest {
+    NSString *name = path.lastPathComponent;
+    uint64_t offset = info->localHeaderOffset;
+    if (offset > length || length - offset < kLocalHeaderSize || readUInt32(bytes + offset) != kLocalHeaderSignature) {
+        return [NSString stringWithFormat:@"Corrupted ZIP entry: %@", name];
+    }
+
+    uint64_t dataStart = offset + kLocalHeaderSize + readUInt16(bytes + offset + 26) + readUInt16(bytes + offset + 28);
+    if (dataStart > length || info->compressedSize > length - dataStart) {
+        return [NSString stringWithFormat:@"Corrupted ZIP entry: %@", name];
+    }
+
+    int fd = open(path.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return [NSString stringWithFormat:@"Cannot write file: %@", name];
+    }
+
+    const uint8_t *source = bytes + dataStart;
+    uint64_t remaining = info->compressedSize;
+    uint64_t total = 0;
+    uLong crc = crc32(0, Z_NULL, 0);
+    NSString *message = nil;
+    CC_SHA256_CTX sha256;
+    if (digest) {
+        CC_SHA256_Init(&sha256);
+    }
+
+    if (info->method == kMethodStored) {
+        // Без сжатия: пишем прямо из отображённой памяти
+        while (remaining > 0 && !message) {
+            size_t chunk = (size_t)MIN(remaining, kInputChunkSize);
+            crc = crc32(crc, source, (uInt)chunk);
+            if (digest) {
+                CC_SHA256_Update(&sha256, source, (CC_LONG)chunk);
+            }
+            if (!writeAll(fd, source, chunk)) {
+                message = [NSString stringWithFormat:@"Cannot write file: %@", name];
+            }
+            source += chunk;
+            remaining -= chunk;
+            total += chunk;
+        }
+    } else {
+        inflateReset(stream);
+        stream->avail_in = 0;
+        int status = Z_OK;
+
+        while (status != Z_STREAM_END && !message) {
+            if (stream->avail_in == 0 && remaining > 0) {
+                uint64_t chunk = MIN(remaining, kInputChunkSize);
+                stream->next_in = (Bytef*)source;
+                stream->avail_in = (uInt)chunk;
+                source += chunk;
+                remaining -= chunk;
+            }
+
+            stream->next_out = buffer;
+            stream->avail_out = (uInt)kOutputBufferSize;
+            status = inflate(stream, Z_NO_FLUSH);
+            if (status != Z_OK && status != Z_STREAM_END) {
+                message = [NSString stringWithFormat:@"Corrupted ZIP entry: %@", name];
+                break;
+            }
+
+            size_t produced = kOutputBufferSize - stream->avail_out;
+            crc = crc32(crc, buffer, (uInt)produced);
+            if (digest) {
+                CC_SHA256_Update(&sha256, buffer, (CC_LONG)produced);
+            }
+            if (produced > 0 && !writeAll(fd, buffer, produced)) {
+                message = [NSString stringWithFormat:@"Cannot write file: %@", name];
+            }
+            total += produced;
+        }
+    }
+
+    close(fd);
+    if (digest) {
+        CC_SHA256_Final(digest, &sha256);
+    }
+
+    if (!message && ((uint32_t)crc != info->crc || total != info->uncompressedSize)) {
+        message = [NSString stringWithFormat:@"CRC mismatch: %@", name];
+    }
+    return message;
+}
+
++ (BOOL)isSafeEntryName:(NSString*)name {
+    if (name.length == 0 || [name hasPrefix:@"/"] || [name containsString:@"\\"]) {
+        return NO;
+    }
+    for (NSString *segment in [name componentsSeparatedByString:@"/"]) {
+        if ([segment isEqualToString:@".."]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
++ (BOOL)fail:(NSError**)error message:(NSString*)message {
+    if (error) {
+        *error = [NSError errorWithDomain:kParallelUnzipErrorDomain
+                                     code:1
+                                 userInfo:@{NSLocalizedDescriptionKey: message}];
+    }
+    return NO;
+}
+
+@end
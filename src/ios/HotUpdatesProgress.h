@@ -0,0 +1,47 @@
+/*!
+ * @file HotUpdatesProgress.h
+ * @brief Throttled progress reporting for Hot Updates Plugin
+ * @details Session delegates and extractors count bytes into a reporter; the reporter computes
+ *          rate and ETA and calls its handler at most once per kProgressInterval, so a fast
+ *          download does not flood the Cordova bridge. Phase changes are reported at once.
+ *
+ *          Thread-safe: segmented downloads and parallel extraction count from several queues.
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+/*!
+ * @param phase One of kProgressPhase*
+ * @param bytes Bytes processed in this phase (received, or written for extraction)
+ * @param totalBytes Expected bytes of the phase, -1 if unknown
+ * @param bytesPerSecond Average rate since the phase started
+ * @param etaSeconds Estimated time left, -1 if unknown
+ */
+typedef void (^HotUpdatesProgressHandler)(NSString *phase, long long bytes, long long totalBytes,
+                                          long long bytesPerSecond, long long etaSeconds);
+
+@interface HotUpdatesProgress : NSObject
+
+- (instancetype)initWithHandler:(HotUpdatesProgressHandler)handler;
+
+/*!
+ * @brief Enter a phase, reported regardless of the interval
+ * @param bytes Bytes already done (resume offset of a continued download)
+ * @param totalBytes Expected bytes, -1 if unknown
+ */
+- (void)startPhase:(NSString*)phase bytes:(long long)bytes totalBytes:(long long)totalBytes;
+
+/*!
+ * @brief Count processed bytes of the current phase
+ */
+- (void)addBytes:(long long)count;
+
+/*!
+ * @brief Set absolute counts of the current phase (download task delegate)
+ */
+- (void)setBytes:(long long)bytes totalBytes:(long long)totalBytes;
+
+@end
@@ -0,0 +1,78 @@
+/*!
+ * @file HotUpdatesProgress.m
+ * @brief Implementation of throttled progress reporting
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import "HotUpdatesProgress.h"
+#import "HotUpdatesConstants.h"
+
+@interface HotUpdatesProgress ()
+@property (nonatomic, copy) HotUpdatesProgressHandler handler;
+@property (nonatomic, copy) NSString *phase;
+@property (nonatomic, assign) long long bytes;
+@property (nonatomic, assign) long long totalBytes;
+@property (nonatomic, assign) long long phaseStartBytes;
+@property (nonatomic, assign) NSTimeInterval phaseStartTime;
+@property (nonatomic, assign) NSTimeInterval nextReportTime;
+@end
+
+@implementation HotUpdatesProgress
+
+- (instancetype)initWithHandler:(HotUpdatesProgressHandler)handler {
+    self = [super init];
+    if (self) {
+        _handler = [handler copy];
+        _totalBytes = -1;
+    }
+    return self;
+}
+
+- (void)startPhase:(NSString*)phase bytes:(long long)bytes totalBytes:(long long)totalBytes {
+    @synchronized (self) {
+        self.phase = phase;
+        self.bytes = bytes;
+        self.totalBytes = totalBytes;
+        self.phaseStartBytes = bytes;
+        self.phaseStartTime = [NSProcessInfo processInfo].systemUptime;
+        [self reportAt:self.phaseStartTime];
+    }
+}
+
+- (void)addBytes:(long long)count {
+    @synchronized (self) {
+        self.bytes += count;
+        [self reportIfDue];
+    }
+}
+
+- (void)setBytes:(long long)bytes totalBytes:(long long)totalBytes {
+    @synchronized (self) {
+        self.bytes = bytes;
+        self.totalBytes = totalBytes;
+        [self reportIfDue];
+    }
+}
+
+#pragma mark - Private
+
+- (void)reportIfDue {
+    NSTimeInterval now = [NSProcessInfo processInfo].systemUptime;
+    if (self.phase && now >= self.nextReportTime) {
+        [self reportAt:now];
+    }
+}
+
+// Вызывается под @synchronized (self)
+- (void)reportAt:(NSTimeInterval)now {
+    self.nextReportTime = now + kProgressInterval;
+
+    NSTimeInterval elapsed = now - self.phaseStartTime;
+    long long rate = elapsed > 0 ? (long long)((self.bytes - self.phaseStartBytes) / elapsed) : 0;
+    long long eta = self.totalBytes >= 0 && rate > 0 ? (MAX(0, self.totalBytes - self.bytes) + rate - 1) / rate : -1;
+    self.handler(self.phase, self.bytes, self.totalBytes, rate, eta);
+}
+
+@end
@@ -0,0 +1,42 @@
+/*!
+ * @file HotUpdatesSegmentedDownload.h
+ * @brief Parallel multi-connection download for Hot Updates Plugin
+ * @details Splits the archive into byte ranges fetched over several connections at once and
+ *          writes every range straight into a preallocated file at its offset. On high-latency
+ *          links one TCP stream leaves most of the bandwidth unused; a few concurrent streams fill it.
+ *
+ *          Every segment is checked: the server must answer 206 with exactly the requested range
+ *          while the validator of the probe still matches (If-Range), and deliver exactly the
+ *          requested number of bytes. Content itself is verified by ZIP CRCs during extraction.
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class HotUpdatesProgress;
+
+@interface HotUpdatesSegmentedDownload : NSObject
+
+/*!
+ * @brief Download archive over several parallel connections
+ * @details A one-byte range request probes the server first. If it cannot serve ranges, gives no
+ *          validator, or the archive is smaller than kSegmentedMinSizeBytes, completion is called
+ *          with supported = NO and nothing is downloaded (caller uses a single stream).
+ * @param url Archive URL
+ * @param path Destination file (replaced)
+ * @param connections Number of parallel connections (capped at kMaxDownloadConnections)
+ * @param configuration Session configuration (timeouts)
+ * @param reporter Receives the downloading phase with received bytes of all segments (nil to skip)
+ * @param completion Called on a background queue; statusCode is set for HTTP errors of the probe
+ * @return Session of the transfer (cancelling its tasks aborts the download)
+ */
++ (NSURLSession*)downloadURL:(NSURL*)url
+                      toFile:(NSString*)path
+                 connections:(NSInteger)connections
+               configuration:(NSURLSessionConfiguration*)configuration
+                    reporter:(HotUpdatesProgress*)reporter
+                  completion:(void (^)(BOOL supported, NSInteger statusCode, NSError *error))completion;
+
+@end
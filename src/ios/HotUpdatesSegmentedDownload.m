@@ -0,0 +1,281 @@
+/*!
+ * @file HotUpdatesSegmentedDownload.m
+ * @brief Implementation of parallel multi-connection download
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import "HotUpdatesSegmentedDownload.h"
+#import "HotUpdatesConstants.h"
+#import "HotUpdatesProgress.h"
+#import "HotUpdatesMetrics.h"
+
+static NSString * const kSegmentedErrorDomain = @"HotUpdatesSegmentedDownload";
+
+/*!
+ * @brief One byte range of the archive
+ */
+@interface HotUpdatesSegment : NSObject
+@property (nonatomic, assign) long long start;
+@property (nonatomic, assign) long long end;        // Включительно
+@property (nonatomic, assign) long long received;
+@property (nonatomic, strong) NSFileHandle *fileHandle;
+@end
+
+@implementation HotUpdatesSegment
+@end
+
+/*!
+ * @brief Writes segment bodies into the destination file
+ */
+@interface HotUpdatesSegmentedDownload () <NSURLSessionDataDelegate>
+@property (nonatomic, strong) NSURL *url;
+@property (nonatomic, copy) NSString *path;
+@property (nonatomic, assign) NSInteger connections;
+@property (nonatomic, strong) NSURLSession *session;
+@property (nonatomic, strong) NSURLSessionDataTask *probeTask;
+@property (nonatomic, strong) NSHTTPURLResponse *probeResponse;
+@property (nonatomic, copy) NSString *validator;
+@property (nonatomic, strong) NSMutableDictionary<NSNumber*, HotUpdatesSegment*> *segments;
+@property (nonatomic, assign) NSUInteger remaining;
+@property (nonatomic, strong) NSError *error;
+@property (nonatomic, strong) HotUpdatesProgress *reporter;
+@property (nonatomic, copy) void (^completion)(BOOL supported, NSInteger statusCode, NSError *error);
+@end
+
+@implementation HotUpdatesSegmentedDownload
+
++ (NSURLSession*)downloadURL:(NSURL*)url
+                      toFile:(NSString*)path
+                 connections:(NSInteger)connections
+               configuration:(NSURLSessionConfiguration*)configuration
+                    reporter:(HotUpdatesProgress*)reporter
+                  completion:(void (^)(BOOL supported, NSInteger statusCode, NSError *error))completion {
+    HotUpdatesSegmentedDownload *download = [[HotUpdatesSegmentedDownload alloc] init];
+    download.url = url;
+    download.path = path;
+    download.connections = MIN(MAX(connections, 1), kMaxDownloadConnections);
+    download.reporter = reporter;
+    download.completion = completion;
+
+    NSURLSessionConfiguration *config = [configuration copy];
+    config.HTTPMaximumConnectionsPerHost = download.connections;
+
+    // Последовательная очередь: записи в файл и учёт сегментов без блокировок
+    NSOperationQueue *queue = [[NSOperationQueue alloc] init];
+    queue.maxConcurrentOperationCount = 1;
+    queue.qualityOfService = NSQualityOfServiceUtility;
+
+    // Сессия держит delegate до invalidate
+    download.session = [NSURLSession sessionWithConfiguration:config delegate:download delegateQueue:queue];
+
+    // Probe: запрос одного байта. Нужны только заголовки, тело не читаем
+    NSMutableURLRequest *probe = [NSMutableURLRequest requestWithURL:url];
+    [probe setValue:@"identity" forHTTPHeaderField:@"Accept-Encoding"];
+    [probe setValue:@"bytes=0-0" forHTTPHeaderField:@"Range"];
+    download.probeTask = [download.session dataTaskWithRequest:probe];
+    [download.probeTask resume];
+    return download.session;
+}
+
+/*!
+ * @brief Decide on segmented download after the probe response
+ */
+- (void)probeCompletedWithError:(NSError*)error {
+    NSHTTPURLResponse *response = self.probeResponse;
+    self.probeTask = nil;
+
+    if (!response) {
+        [self.session invalidateAndCancel];
+        self.completion(YES, 0, error);
+        return;
+    }
+
+    if (response.statusCode != 206) {
+        // 200 - сервер не поддерживает Range
+        [self.session invalidateAndCancel];
+        self.completion(NO, response.statusCode == 200 ? 0 : response.statusCode, nil);
+        return;
+    }
+
+    NSString *contentRange = [response valueForHTTPHeaderField:@"Content-Range"];
+    NSRange slash = [contentRange rangeOfString:@"/" options:NSBackwardsSearch];
+    long long totalSize = slash.location != NSNotFound ? [[contentRange substringFromIndex:slash.location + 1] longLongValue] : 0;
+
+    NSString *etag = [response valueForHTTPHeaderField:@"ETag"];
+    self.validator = (etag && ![etag hasPrefix:@"W/"]) ? etag : [response valueForHTTPHeaderField:@"Last-Modified"];
+
+    // Без валидатора сегменты могут оказаться из разных версий архива
+    if (totalSize < kSegmentedMinSizeBytes || !self.validator) {
+        [self.session invalidateAndCancel];
+        self.completion(NO, 0, nil);
+        return;
+    }
+
+    [self startSegmentsWithTotalSize:totalSize];
+}
+
+- (void)startSegmentsWithTotalSize:(long long)totalSize {
+    NSLog(@"[HotUpdates] Segmented download: %lld bytes over %ld connections", totalSize, (long)self.connections);
+
+    // Выделяем файл полного размера, каждый сегмент пишет по своему смещению
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    [fileManager removeItemAtPath:self.path error:nil];
+    [fileManager createFileAtPath:self.path contents:nil attributes:nil];
+
+    NSFileHandle *sizeHandle = [NSFileHandle fileHandleForWritingAtPath:self.path];
+    if (!sizeHandle) {
+        [self.session invalidateAndCancel];
+        self.completion(YES, 0, [self errorWithMessage:@"Cannot create download file"]);
+        return;
+    }
+    [sizeHandle truncateFileAtOffset:totalSize];
+    [sizeHandle closeFile];
+
+    self.segments = [NSMutableDictionary dictionary];
+
+    long long segmentSize = (totalSize + self.connections - 1) / self.connections;
+    NSMutableArray<NSURLSessionDataTask*> *tasks = [NSMutableArray array];
+
+    for (long long start = 0; start < totalSize; start += segmentSize) {
+        HotUpdatesSegment *segment = [[HotUpdatesSegment alloc] init];
+        segment.start = start;
+        segment.end = MIN(start + segmentSize, totalSize) - 1;
+        segment.fileHandle = [NSFileHandle fileHandleForWritingAtPath:self.path];
+
+        NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:self.url];
+        [request setValue:@"identity" forHTTPHeaderField:@"Accept-Encoding"];
+        [request setValue:[NSString stringWithFormat:@"bytes=%lld-%lld", segment.start, segment.end] forHTTPHeaderField:@"Range"];
+        [request setValue:self.validator forHTTPHeaderField:@"If-Range"];
+
+        NSURLSessionDataTask *task = [self.session dataTaskWithRequest:request];
+        self.segments[@(task.taskIdentifier)] = segment;
+        [tasks addObject:task];
+    }
+
+    self.remaining = tasks.count;
+    [self.reporter startPhase:kProgressPhaseDownloading bytes:0 totalBytes:totalSize];
+    for (NSURLSessionDataTask *task in tasks) {
+        [task resume];
+    }
+
+    [self.session finishTasksAndInvalidate];
+}
+
+#pragma mark - Session Delegate
+
+- (void)URLSession:(NSURLSession*)session
+          dataTask:(NSURLSessionDataTask*)dataTask
+didReceiveResponse:(NSURLResponse*)response
+ completionHandler:(void (^)(NSURLSessionResponseDisposition))completionHandler {
+    NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse*)response;
+
+    if (dataTask == self.probeTask) {
+        self.probeResponse = httpResponse;
+        completionHandler(NSURLSessionResponseCancel);
+        return;
+    }
+
+    HotUpdatesSegment *segment = self.segments[@(dataTask.taskIdentifier)];
+    NSString *message = nil;
+    if (httpResponse.statusCode == 200) {
+        // If-Range не совпал: архив изменился на сервере после probe
+        message = @"Archive changed during download";
+    } else if (httpResponse.statusCode != 206) {
+        message = [NSString stringWithFormat:@"HTTP error: %ld", (long)httpResponse.statusCode];
+    } else if ([self contentRangeStart:[httpResponse valueForHTTPHeaderField:@"Content-Range"]] != segment.start) {
+        message = [NSString stringWithFormat:@"Unexpected range for segment at %lld", segment.start];
+    }
+
+    if (message) {
+        [self failWithError:[self errorWithMessage:message] session:session];
+        completionHandler(NSURLSessionResponseCancel);
+        return;
+    }
+
+    [segment.fileHandle seekToFileOffset:segment.start];
+    completionHandler(NSURLSessionResponseAllow);
+}
+
+- (void)URLSession:(NSURLSession*)session dataTask:(NSURLSessionDataTask*)dataTask didReceiveData:(NSData*)data {
+    if (self.error || dataTask == self.probeTask) return;
+
+    HotUpdatesSegment *segment = self.segments[@(dataTask.taskIdentifier)];
+    if (segment.start + segment.received + (long long)data.length > segment.end + 1) {
+        [self failWithError:[self errorWithMessage:[NSString stringWithFormat:@"Segment at %lld longer than requested", segment.start]]
+                    session:session];
+        return;
+    }
+
+    @try {
+        [segment.fileHandle writeData:data];
+    } @catch (NSException *exception) {
+        [self failWithError:[self errorWithMessage:exception.reason ?: @"Write failed"] session:session];
+        return;
+    }
+    segment.received += data.length;
+    [self.reporter addBytes:data.length];
+}
+
+- (void)URLSession:(NSURLSession*)session task:(NSURLSessionTask*)task didFinishCollectingMetrics:(NSURLSessionTaskMetrics*)metrics {
+    [HotUpdatesMetrics recordTaskMetrics:metrics];
+}
+
+- (void)URLSession:(NSURLSession*)session task:(NSURLSessionTask*)task didCompleteWithError:(NSError*)error {
+    if (task == self.probeTask) {
+        [self probeCompletedWithError:error];
+        return;
+    }
+
+    HotUpdatesSegment *segment = self.segments[@(task.taskIdentifier)];
+    [segment.fileHandle closeFile];
+    segment.fileHandle = nil;
+
+    if (!self.error) {
+        long long expected = segment.end - segment.start + 1;
+        if (error) {
+            [self failWithError:error session:session];
+        } else if (segment.received != expected) {
+            NSString *message = [NSString stringWithFormat:@"Segment at %lld incomplete: %lld of %lld bytes",
+                                 segment.start, segment.received, expected];
+            [self failWithError:[self errorWithMessage:message] session:session];
+        }
+    }
+
+    self.remaining--;
+    if (self.remaining == 0 && self.completion) {
+        if (self.error) {
+            [[NSFileManager defaultManager] removeItemAtPath:self.path error:nil];
+        }
+        self.completion(YES, 0, self.error);
+        self.completion = nil;
+        self.session = nil;
+    }
+}
+
+#pragma mark - Private
+
+- (void)failWithError:(NSError*)error session:(NSURLSession*)session {
+    if (self.error) return;
+    self.error = error;
+    // Остальные сегменты бесполезны - отменяем
+    [session invalidateAndCancel];
+}
+
+- (long long)contentRangeStart:(NSString*)contentRange {
+    // Content-Range: bytes 1000-4999/5000
+    if (![contentRange hasPrefix:@"bytes "]) return -1;
+
+    NSScanner *scanner = [NSScanner scannerWithString:[contentRange substringFromIndex:6]];
+    long long start = -1;
+    return [scanner scanLongLong:&start] ? start : -1;
+}
+
+- (NSError*)errorWithMessage:(NSString*)message {
+    return [NSError errorWithDomain:kSegmentedErrorDomain
+                               code:1
+                           userInfo:@{NSLocalizedDescriptionKey: message}];
+}
+
+@end
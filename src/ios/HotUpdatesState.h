@@ -0,0 +1,53 @@
+/*!
+ * @file HotUpdatesState.h
+ * @brief Persistent plugin state for Hot Updates Plugin
+ * @details All state (version pointers, pending update, ignore list, history, resume data) is
+ *          one dictionary kept in memory and saved as one property list file. Each state
+ *          transition changes several keys inside one block and is written once with an
+ *          atomic write (temporary file + rename): after a crash the file holds either the old
+ *          or the new key set, never a mix, and a transition costs one write instead of one
+ *          NSUserDefaults synchronize per save.
+ *
+ *          Keys are the former NSUserDefaults keys (kInstalledVersion, ...); values stored
+ *          there by older plugin versions are moved into the file on first launch.
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+@interface HotUpdatesState : NSObject
+
+/*!
+ * @brief Load state file from the given directory (Documents)
+ * @details Migrates NSUserDefaults values if the file does not exist yet
+ */
+- (instancetype)initWithRootPath:(NSString*)rootPath;
+
+- (id)objectForKey:(NSString*)key;
+- (NSString*)stringForKey:(NSString*)key;
+- (NSArray*)arrayForKey:(NSString*)key;
+- (BOOL)boolForKey:(NSString*)key;
+- (long long)longLongForKey:(NSString*)key;
+
+/*!
+ * @brief Copy of all values, consistent with one transition
+ */
+- (NSDictionary*)snapshot;
+
+/*!
+ * @brief Apply one state transition and write it to disk
+ * @details The block runs under the state lock on the calling thread and must only change
+ *          values (thread-safe). Changes made with stageChanges: are written together with it.
+ * @return NO if the file could not be written (memory keeps the new values)
+ */
+- (BOOL)commitChanges:(void (^)(NSMutableDictionary *values))changes;
+
+/*!
+ * @brief Apply changes in memory only; written with the next commit
+ * @details For frequent progress values (resume offset) whose loss only costs repeated work
+ */
+- (void)stageChanges:(void (^)(NSMutableDictionary *values))changes;
+
+@end
@@ -0,0 +1,142 @@
+/*!
+ * @file HotUpdatesState.m
+ * @brief Implementation of persistent plugin state
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import "HotUpdatesState.h"
+#import "HotUpdatesConstants.h"
+
+@interface HotUpdatesState ()
+@property (nonatomic, copy) NSString *path;
+@property (nonatomic, strong) NSMutableDictionary *values;
+@end
+
+@implementation HotUpdatesState
+
+- (instancetype)initWithRootPath:(NSString*)rootPath {
+    self = [super init];
+    if (self) {
+        _path = [rootPath stringByAppendingPathComponent:kStateFileName];
+        _values = [NSMutableDictionary dictionary];
+
+        NSData *data = [NSData dataWithContentsOfFile:_path];
+        if (data) {
+            NSError *error = nil;
+            NSDictionary *saved = [NSPropertyListSerialization propertyListWithData:data
+                                                                            options:NSPropertyListImmutable
+                                                                             format:NULL
+                                                                              error:&error];
+            if ([saved isKindOfClass:[NSDictionary class]]) {
+                [_values addEntriesFromDictionary:saved];
+            } else {
+                NSLog(@"[HotUpdates] ERROR: State file unreadable, starting clean: %@", error.localizedDescription);
+            }
+        } else {
+            [self migrateUserDefaults];
+        }
+    }
+    return self;
+}
+
+- (id)objectForKey:(NSString*)key {
+    @synchronized (self) {
+        return self.values[key];
+    }
+}
+
+- (NSString*)stringForKey:(NSString*)key {
+    id value = [self objectForKey:key];
+    return [value isKindOfClass:[NSString class]] ? value : nil;
+}
+
+- (NSArray*)arrayForKey:(NSString*)key {
+    id value = [self objectForKey:key];
+    return [value isKindOfClass:[NSArray class]] ? value : nil;
+}
+
+- (BOOL)boolForKey:(NSString*)key {
+    id value = [self objectForKey:key];
+    return [value isKindOfClass:[NSNumber class]] && [value boolValue];
+}
+
+- (long long)longLongForKey:(NSString*)key {
+    id value = [self objectForKey:key];
+    return [value isKindOfClass:[NSNumber class]] ? [value longLongValue] : 0;
+}
+
+- (NSDictionary*)snapshot {
+    @synchronized (self) {
+        return [self.values copy];
+    }
+}
+
+- (BOOL)commitChanges:(void (^)(NSMutableDictionary *values))changes {
+    @synchronized (self) {
+        if (changes) {
+            changes(self.values);
+        }
+        return [self writeValues];
+    }
+}
+
+- (void)stageChanges:(void (^)(NSMutableDictionary *values))changes {
+    @synchronized (self) {
+        changes(self.values);
+    }
+}
+
+#pragma mark - Private
+
+/*!
+ * @brief Write snapshot (called under the lock, so files are written in transition order)
+ */
+- (BOOL)writeValues {
+    NSError *error = nil;
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:self.values
+                                                              format:NSPropertyListBinaryFormat_v1_0
+                                                             options:0
+                                                               error:&error];
+    if (!data || ![data writeToFile:self.path options:NSDataWritingAtomic error:&error]) {
+        NSLog(@"[HotUpdates] ERROR: Failed to save state: %@", error.localizedDescription);
+        return NO;
+    }
+    return YES;
+}
+
+/*!
+ * @brief Move state of older plugin versions out of NSUserDefaults
+ * @details Defaults are removed only after the file was written, so an interrupted migration
+ *          is simply repeated on the next launch
+ */
+- (void)migrateUserDefaults {
+    NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+    NSArray<NSString*> *keys = @[
+        kInstalledVersion, kPendingVersion, kHasPending, kPreviousVersion, kIgnoreList,
+        kCanaryVersion, kDownloadInProgress, kPendingUpdateURL, kPendingUpdateReady,
+        kVersionHistory, kCurrentVersionDir, kPreviousVersionDir, kResumeURL, kResumeVersion,
+        kResumeValidator, kResumeOffset, kBackgroundDownloadURL, kBackgroundDownloadVersion,
+        kBackgroundSessionId, kBackgroundPacked
+    ];
+
+    for (NSString *key in keys) {
+        id value = [defaults objectForKey:key];
+        if (value) {
+            self.values[key] = value;
+        }
+    }
+    if (self.values.count == 0) {
+        return;
+    }
+
+    if ([self writeValues]) {
+        for (NSString *key in keys) {
+            [defaults removeObjectForKey:key];
+        }
+        NSLog(@"[HotUpdates] Migrated %lu state values from NSUserDefaults", (unsigned long)self.values.count);
+    }
+}
+
+@end
@@ -0,0 +1,60 @@
+/*!
+ * @file HotUpdatesStore.h
+ * @brief Content-addressed file store for Hot Updates Plugin
+ * @details Every file of a downloaded update is stored once under its SHA-256 hash.
+ *          Version directories (versions/<dir>/www, temp_downloaded_update, ...) are built from
+ *          hard links into the store, so identical assets shared between versions take
+ *          disk space only once and install/backup/rollback cost one link per file.
+ *
+ *          Layout: store/objects/<first 2 hex chars>/<sha256>
+ *
+ *          Ingest and garbage collection of all instances are serialized on one lock:
+ *          an object must not be deleted between the check that it exists and the link to it.
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+@interface HotUpdatesStore : NSObject
+
+/*!
+ * @brief Create store inside the given directory
+ * @param rootPath Parent directory (Documents)
+ */
+- (instancetype)initWithRootPath:(NSString*)rootPath;
+
+/*!
+ * @brief Move every file of the directory into the store
+ * @details Files whose content is already stored are replaced by a link to the existing
+ *          object (deduplication); new content becomes a new object.
+ * @param path Freshly extracted update directory
+ * @param hashes Path relative to the directory -> SHA-256 hex, computed during extraction.
+ *               Files without an entry (or all, if nil) are hashed from disk.
+ */
+- (void)ingestDirectoryAtPath:(NSString*)path hashes:(NSDictionary<NSString*, NSString*>*)hashes;
+
+/*!
+ * @brief Mirror file or directory tree with hard links
+ * @details Falls back to cloneItemAtPath:toPath:error: if linking is not possible
+ * @return YES on success
+ */
+- (BOOL)linkItemAtPath:(NSString*)srcPath toPath:(NSString*)dstPath error:(NSError**)error;
+
+/*!
+ * @brief Copy file or directory tree as an APFS clone
+ * @details Clones share blocks with the source until either is written, so the copy
+ *          costs no data I/O. Where cloning is not possible (other volume, not APFS)
+ *          the data is copied in the kernel by copyfile. Fails if dstPath exists.
+ * @return YES on success
+ */
++ (BOOL)cloneItemAtPath:(NSString*)srcPath toPath:(NSString*)dstPath error:(NSError**)error;
+
+/*!
+ * @brief Delete objects that are no longer referenced by any version directory
+ * @return Number of deleted objects
+ */
+- (NSUInteger)collectGarbage;
+
+@end
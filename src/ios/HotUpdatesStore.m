@@ -0,0 +1,171 @@
+/*!
+ * @file HotUpdatesStore.m
+ * @brief Implementation of content-addressed file store
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import "HotUpdatesStore.h"
+#import "HotUpdatesConstants.h"
+#import "HotUpdatesManifest.h"
+
+#import <copyfile.h>
+#import <sys/clonefile.h>
+
+@interface HotUpdatesStore ()
+@property (nonatomic, copy) NSString *objectsPath;
+@end
+
+@implementation HotUpdatesStore
+
+- (instancetype)initWithRootPath:(NSString*)rootPath {
+    self = [super init];
+    if (self) {
+        _objectsPath = [[rootPath stringByAppendingPathComponent:kStoreDirName]
+                        stringByAppendingPathComponent:kStoreObjectsDirName];
+    }
+    return self;
+}
+
+- (void)ingestDirectoryAtPath:(NSString*)path hashes:(NSDictionary<NSString*, NSString*>*)hashes {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSDirectoryEnumerator *enumerator = [fileManager enumeratorAtPath:path];
+    NSUInteger hashedFromDisk = 0;
+
+    @synchronized ([HotUpdatesStore class]) {
+        NSString *relativePath;
+        while ((relativePath = [enumerator nextObject])) {
+            if (![enumerator.fileAttributes[NSFileType] isEqualToString:NSFileTypeRegular]) {
+                continue;
+            }
+            NSString *filePath = [path stringByAppendingPathComponent:relativePath];
+
+            // Дайджест из распаковки; с диска - только для файлов без него (докачка)
+            NSString *hash = hashes[relativePath];
+            if (!hash) {
+                hash = [HotUpdatesManifest sha256OfFileAtPath:filePath];
+                hashedFromDisk++;
+            }
+            if (hash) {
+                [self ingestFileAtPath:filePath hash:hash];
+            }
+        }
+    }
+
+    if (hashedFromDisk > 0) {
+        NSLog(@"[HotUpdates] Store: %lu files hashed from disk", (unsigned long)hashedFromDisk);
+    }
+}
+
+- (BOOL)linkItemAtPath:(NSString*)srcPath toPath:(NSString*)dstPath error:(NSError**)error {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+
+    // Для директорий NSFileManager создаёт структуру и hard link на каждый файл
+    if ([fileManager linkItemAtPath:srcPath toPath:dstPath error:nil]) {
+        return YES;
+    }
+
+    [fileManager removeItemAtPath:dstPath error:nil];
+    return [HotUpdatesStore cloneItemAtPath:srcPath toPath:dstPath error:error];
+}
+
++ (BOOL)cloneItemAtPath:(NSString*)srcPath toPath:(NSString*)dstPath error:(NSError**)error {
+    const char *src = srcPath.fileSystemRepresentation;
+    const char *dst = dstPath.fileSystemRepresentation;
+
+    // clonefile клонирует и дерево директорий целиком, одним вызовом
+    if (clonefile(src, dst, CLONE_NOFOLLOW) == 0) {
+        return YES;
+    }
+    int cloneErrno = errno;
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    BOOL isDirectory = NO;
+    if (cloneErrno != EEXIST && [fileManager fileExistsAtPath:srcPath isDirectory:&isDirectory] && isDirectory) {
+        // Не APFS: NSFileManager копирует каждый файл через copyfile
+        [fileManager removeItemAtPath:dstPath error:nil];
+        return [fileManager copyItemAtPath:srcPath toPath:dstPath error:error];
+    }
+
+    // COPYFILE_CLONE: клон, если возможен, иначе копия данных в ядре
+    if (cloneErrno != EEXIST && copyfile(src, dst, NULL, COPYFILE_CLONE) == 0) {
+        return YES;
+    }
+
+    int copyErrno = cloneErrno == EEXIST ? EEXIST : errno;
+    if (copyErrno != EEXIST) {
+        // Недописанная копия
+        unlink(dst);
+    }
+    if (error) {
+        *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:copyErrno
+                                 userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Copy of %@ failed: %s",
+                                                                        srcPath.lastPathComponent, strerror(copyErrno)]}];
+    }
+    return NO;
+}
+
+- (NSUInteger)collectGarbage {
+    @synchronized ([HotUpdatesStore class]) {
+        return [self collectUnreferenced];
+    }
+}
+
+#pragma mark - Private
+
+- (NSUInteger)collectUnreferenced {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSUInteger deleted = 0;
+
+    for (NSString *bucket in [fileManager contentsOfDirectoryAtPath:self.objectsPath error:nil]) {
+        NSString *bucketPath = [self.objectsPath stringByAppendingPathComponent:bucket];
+
+        for (NSString *object in [fileManager contentsOfDirectoryAtPath:bucketPath error:nil]) {
+            NSString *objectPath = [bucketPath stringByAppendingPathComponent:object];
+            NSDictionary *attributes = [fileManager attributesOfItemAtPath:objectPath error:nil];
+
+            if (attributes && [attributes[NSFileReferenceCount] unsignedIntegerValue] <= 1 &&
+                [fileManager removeItemAtPath:objectPath error:nil]) {
+                deleted++;
+            }
+        }
+
+        if ([fileManager contentsOfDirectoryAtPath:bucketPath error:nil].count == 0) {
+            [fileManager removeItemAtPath:bucketPath error:nil];
+        }
+    }
+
+    if (deleted > 0) {
+        NSLog(@"[HotUpdates] Store GC: removed %lu unreferenced objects", (unsigned long)deleted);
+    }
+    return deleted;
+}
+
+- (void)ingestFileAtPath:(NSString*)filePath hash:(NSString*)hash {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSString *bucketPath = [self.objectsPath stringByAppendingPathComponent:[hash substringToIndex:2]];
+    NSString *objectPath = [bucketPath stringByAppendingPathComponent:hash];
+
+    if ([fileManager fileExistsAtPath:objectPath]) {
+        // Такой контент уже есть в хранилище - используем его
+        NSString *tempPath = [filePath stringByAppendingString:@".hu_tmp"];
+        [fileManager removeItemAtPath:tempPath error:nil];
+        if (![fileManager linkItemAtPath:objectPath toPath:tempPath error:nil]) {
+            return;
+        }
+        // rename() заменяет файл атомарно: путь ни в какой момент не пропадает
+        if (rename(tempPath.fileSystemRepresentation, filePath.fileSystemRepresentation) != 0) {
+            NSLog(@"[HotUpdates] Store: cannot replace %@: %s", filePath.lastPathComponent, strerror(errno));
+            [fileManager removeItemAtPath:tempPath error:nil];
+        }
+    } else {
+        [fileManager createDirectoryAtPath:bucketPath withIntermediateDirectories:YES attributes:nil error:nil];
+        NSError *error = nil;
+        if (![fileManager linkItemAtPath:filePath toPath:objectPath error:&error]) {
+            NSLog(@"[HotUpdates] Store: cannot link %@: %@", filePath.lastPathComponent, error.localizedDescription);
+        }
+    }
+}
+
+@end
@@ -0,0 +1,99 @@
+/*!
+ * @file HotUpdatesVerifier.h
+ * @brief Signed manifest verification of ZIP updates for Hot Updates Plugin
+ * @details The server signs the manifest of a version (same format as for delta updates) with
+ *          an ECDSA P-256 key; the app ships the public key in config.xml (HotUpdatesPublicKey).
+ *          Extractors hash every entry while it is inflated and hand the digest to the verifier,
+ *          so checking the update costs no second read of the extracted tree. The update is
+ *          rejected before it is staged.
+ *
+ *          The detached signature is loaded from "<manifestUrl>.sig": base64 of the DER encoded
+ *          ECDSA signature over the manifest bytes. Every file below the www folder of the
+ *          archive must be listed with a matching hash, and every listed file must be present.
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+extern NSString * const HotUpdatesVerifierErrorDomain;
+
+typedef NS_ENUM(NSInteger, HotUpdatesVerifierError) {
+    HotUpdatesVerifierErrorDownload = 1,   // Manifest or signature could not be downloaded
+    HotUpdatesVerifierErrorSignature,      // No key configured or signature does not match
+    HotUpdatesVerifierErrorManifest,       // Manifest is malformed
+    HotUpdatesVerifierErrorHashMismatch    // File missing, not listed or modified
+};
+
+@interface HotUpdatesVerifier : NSObject
+
+/*!
+ * @brief First verification failure (thread-safe), nil while all files matched
+ * @details Lets callers that only get a BOOL from an extractor report HASH_MISMATCH
+ */
+@property (atomic, strong, readonly) NSError *failure;
+
+/*!
+ * @brief Warm-up list of the signed manifest
+ */
+@property (nonatomic, copy, readonly) NSArray<NSString*> *warmupPaths;
+
+/*!
+ * @brief Extracted size of the update declared by the manifest, -1 if a file has no declared size
+ */
+@property (nonatomic, assign, readonly) long long totalSize;
+
+/*!
+ * @brief Download manifest and its signature and check the signature
+ * @param publicKey Base64 public key from config.xml
+ * @param completion Called on a background queue with the verifier or an error
+ */
++ (void)loadManifestAtURL:(NSURL*)url
+                publicKey:(NSString*)publicKey
+                  session:(NSURLSession*)session
+               completion:(void (^)(HotUpdatesVerifier *verifier, NSError *error))completion;
+
+/*!
+ * @brief Check already downloaded document (delta manifest) against its detached signature
+ * @param completion Called on a background queue, error is nil if the signature is valid
+ */
++ (void)verifyData:(NSData*)data
+       signedAtURL:(NSURL*)url
+         publicKey:(NSString*)publicKey
+           session:(NSURLSession*)session
+        completion:(void (^)(NSError *error))completion;
+
+/*!
+ * @brief Restore verifier saved with writeToFile: (background download after relaunch)
+ * @details The signature is checked again, the file is not trusted by itself
+ */
++ (instancetype)verifierWithContentsOfFile:(NSString*)path publicKey:(NSString*)publicKey error:(NSError**)error;
+
+/*!
+ * @brief Save manifest and signature (path and path.sig)
+ */
+- (BOOL)writeToFile:(NSString*)path error:(NSError**)error;
+
+/*!
+ * @brief Check digest of one extracted entry
+ * @param entryName Entry name in the archive ("www/js/app.js"); entries outside www are ignored
+ * @param digest SHA-256 of the inflated content (CC_SHA256_DIGEST_LENGTH bytes)
+ * @return NO if the file is not in the manifest or differs
+ */
+- (BOOL)verifyEntryNamed:(NSString*)entryName digest:(const unsigned char*)digest error:(NSError**)error;
+
+/*!
+ * @brief Check manifest files that were not verified during extraction
+ * @details Normally none: only entries extracted before a resumed download (or by the
+ *          SSZipArchive fallback) are hashed here from disk
+ * @param wwwPath Extracted www folder
+ */
+- (BOOL)verifyRemainingInDirectory:(NSString*)wwwPath error:(NSError**)error;
+
+/*!
+ * @brief Lowercase hex of a SHA-256 digest (CC_SHA256_DIGEST_LENGTH bytes)
+ */
++ (NSString*)hexStringForDigest:(const unsigned char*)digest;
+
+@end
@@ -0,0 +1,288 @@
+/*!
+ * @file HotUpdatesVerifier.m
+ * @brief Implementation of signed manifest verification
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import "HotUpdatesVerifier.h"
+#import "HotUpdatesManifest.h"
+#import "HotUpdatesConstants.h"
+#import <CommonCrypto/CommonDigest.h>
+#import <Security/Security.h>
+
+NSString * const HotUpdatesVerifierErrorDomain = @"HotUpdatesVerifier";
+
+// SubjectPublicKeyInfo ключа P-256 = 26 байт заголовка + точка X9.63 (65 байт)
+static const NSUInteger kP256PointLength = 65;
+static const NSUInteger kP256SPKILength = 91;
+
+@interface HotUpdatesVerifier ()
+@property (atomic, strong, readwrite) NSError *failure;
+@property (nonatomic, strong) NSData *manifestData;
+@property (nonatomic, strong) NSData *signatureData;  // base64, как на сервере
+@property (nonatomic, copy) NSDictionary<NSString*, HotUpdatesManifestEntry*> *entries;
+@property (nonatomic, copy, readwrite) NSArray<NSString*> *warmupPaths;
+@property (nonatomic, assign, readwrite) long long totalSize;
+@property (nonatomic, strong) NSMutableSet<NSString*> *verified;
+@end
+
+@implementation HotUpdatesVerifier
+
++ (void)loadManifestAtURL:(NSURL*)url
+                publicKey:(NSString*)publicKey
+                  session:(NSURLSession*)session
+               completion:(void (^)(HotUpdatesVerifier *verifier, NSError *error))completion {
+    [self downloadURL:url session:session completion:^(NSData *manifestData, NSError *error) {
+        if (error) {
+            completion(nil, error);
+            return;
+        }
+
+        NSURL *signatureURL = [NSURL URLWithString:[url.absoluteString stringByAppendingString:kSignatureSuffix]];
+        [self downloadURL:signatureURL session:session completion:^(NSData *signatureData, NSError *signatureError) {
+            if (signatureError) {
+                completion(nil, signatureError);
+                return;
+            }
+
+            NSError *verifyError = nil;
+            HotUpdatesVerifier *verifier = [self verifierWithManifestData:manifestData
+                                                            signatureData:signatureData
+                                                              manifestURL:url
+                                                                publicKey:publicKey
+                                                                    error:&verifyError];
+            completion(verifier, verifyError);
+        }];
+    }];
+}
+
++ (void)verifyData:(NSData*)data
+       signedAtURL:(NSURL*)url
+         publicKey:(NSString*)publicKey
+           session:(NSURLSession*)session
+        completion:(void (^)(NSError *error))completion {
+    NSURL *signatureURL = [NSURL URLWithString:[url.absoluteString stringByAppendingString:kSignatureSuffix]];
+    [self downloadURL:signatureURL session:session completion:^(NSData *signatureData, NSError *error) {
+        if (!error) {
+            [self isSignatureValid:signatureData forData:data publicKey:publicKey error:&error];
+        }
+        completion(error);
+    }];
+}
+
++ (instancetype)verifierWithContentsOfFile:(NSString*)path publicKey:(NSString*)publicKey error:(NSError**)error {
+    NSData *manifestData = [NSData dataWithContentsOfFile:path];
+    NSData *signatureData = [NSData dataWithContentsOfFile:[path stringByAppendingString:kSignatureSuffix]];
+    if (!manifestData || !signatureData) {
+        if (error) *error = [self errorWithCode:HotUpdatesVerifierErrorManifest message:@"Saved manifest not found"];
+        return nil;
+    }
+    return [self verifierWithManifestData:manifestData signatureData:signatureData manifestURL:nil publicKey:publicKey error:error];
+}
+
+- (BOOL)writeToFile:(NSString*)path error:(NSError**)error {
+    return [self.manifestData writeToFile:path options:NSDataWritingAtomic error:error]
+        && [self.signatureData writeToFile:[path stringByAppendingString:kSignatureSuffix] options:NSDataWritingAtomic error:error];
+}
+
+- (BOOL)verifyEntryNamed:(NSString*)entryName digest:(const unsigned char*)digest error:(NSError**)error {
+    NSString *path = [HotUpdatesVerifier wwwPathForEntryName:entryName];
+    if (!path) {
+        return YES;
+    }
+
+    HotUpdatesManifestEntry *entry = self.entries[path];
+    NSString *message = nil;
+    if (!entry) {
+        message = [NSString stringWithFormat:@"Hash mismatch: %@ is not in manifest", path];
+    } else if (![[HotUpdatesVerifier hexStringForDigest:digest] isEqualToString:entry.sha256]) {
+        message = [NSString stringWithFormat:@"Hash mismatch: %@", path];
+    }
+
+    if (message) {
+        return [self failWithMessage:message error:error];
+    }
+
+    @synchronized (self.verified) {
+        [self.verified addObject:path];
+    }
+    return YES;
+}
+
+- (BOOL)verifyRemainingInDirectory:(NSString*)wwwPath error:(NSError**)error {
+    NSUInteger fromDisk = 0;
+    NSUInteger inlineCount = 0;
+
+    for (HotUpdatesManifestEntry *entry in self.entries.allValues) {
+        BOOL done;
+        @synchronized (self.verified) {
+            done = [self.verified containsObject:entry.path];
+        }
+        if (done) {
+            inlineCount++;
+            continue;
+        }
+
+        NSString *filePath = [wwwPath stringByAppendingPathComponent:entry.path];
+        if (![HotUpdatesManifest fileAtPath:filePath matchesEntry:entry]) {
+            return [self failWithMessage:[NSString stringWithFormat:@"Hash mismatch: %@ missing or modified", entry.path]
+                                   error:error];
+        }
+        fromDisk++;
+    }
+
+    NSLog(@"[HotUpdates] Update verified: %lu files during extraction, %lu from disk",
+          (unsigned long)inlineCount, (unsigned long)fromDisk);
+    return YES;
+}
+
+#pragma mark - Private
+
++ (instancetype)verifierWithManifestData:(NSData*)manifestData
+                           signatureData:(NSData*)signatureData
+                             manifestURL:(NSURL*)manifestURL
+                               publicKey:(NSString*)publicKey
+                                   error:(NSError**)error {
+    if (![self isSignatureValid:signatureData forData:manifestData publicKey:publicKey error:error]) {
+        return nil;
+    }
+
+    NSError *parseError = nil;
+    HotUpdatesManifest *manifest = [HotUpdatesManifest manifestWithData:manifestData
+                                                            manifestURL:manifestURL ?: [NSURL URLWithString:@"file:///"]
+                                                                  error:&parseError];
+    if (!manifest) {
+        if (error) {
+            *error = [self errorWithCode:HotUpdatesVerifierErrorManifest
+                                 message:[NSString stringWithFormat:@"Invalid manifest: %@", parseError.localizedDescription]];
+        }
+        return nil;
+    }
+
+    NSMutableDictionary *entries = [NSMutableDictionary dictionaryWithCapacity:manifest.entries.count];
+    long long totalSize = 0;
+    for (HotUpdatesManifestEntry *entry in manifest.entries) {
+        entries[entry.path] = entry;
+        totalSize = totalSize >= 0 && entry.size >= 0 ? totalSize + entry.size : -1;
+    }
+
+    HotUpdatesVerifier *verifier = [[HotUpdatesVerifier alloc] init];
+    verifier.manifestData = manifestData;
+    verifier.signatureData = signatureData;
+    verifier.entries = entries;
+    verifier.warmupPaths = manifest.warmupPaths;
+    verifier.totalSize = totalSize;
+    verifier.verified = [NSMutableSet setWithCapacity:entries.count];
+    return verifier;
+}
+
++ (BOOL)isSignatureValid:(NSData*)signatureData forData:(NSData*)data publicKey:(NSString*)publicKey error:(NSError**)error {
+    NSString *trimmedKey = [publicKey stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+    if (trimmedKey.length == 0) {
+        if (error) *error = [self errorWithCode:HotUpdatesVerifierErrorSignature
+                                        message:[NSString stringWithFormat:@"Signature invalid: %@ preference not set", kPublicKeyPreference]];
+        return NO;
+    }
+
+    NSData *keyData = [[NSData alloc] initWithBase64EncodedString:trimmedKey options:NSDataBase64DecodingIgnoreUnknownCharacters];
+    NSString *encodedSignature = [[NSString alloc] initWithData:signatureData encoding:NSASCIIStringEncoding];
+    NSData *signature = encodedSignature
+        ? [[NSData alloc] initWithBase64EncodedString:encodedSignature options:NSDataBase64DecodingIgnoreUnknownCharacters]
+        : nil;
+
+    // SecKeyCreateWithData принимает только точку X9.63 - отрезаем заголовок SPKI
+    if (keyData.length == kP256SPKILength) {
+        keyData = [keyData subdataWithRange:NSMakeRange(kP256SPKILength - kP256PointLength, kP256PointLength)];
+    }
+
+    BOOL valid = NO;
+    if (keyData.length == kP256PointLength && signature.length > 0) {
+        NSDictionary *attributes = @{
+            (__bridge id)kSecAttrKeyType: (__bridge id)kSecAttrKeyTypeECSECPrimeRandom,
+            (__bridge id)kSecAttrKeyClass: (__bridge id)kSecAttrKeyClassPublic,
+            (__bridge id)kSecAttrKeySizeInBits: @256
+        };
+        SecKeyRef key = SecKeyCreateWithData((__bridge CFDataRef)keyData, (__bridge CFDictionaryRef)attributes, NULL);
+        if (key) {
+            valid = SecKeyVerifySignature(key, kSecKeyAlgorithmECDSASignatureMessageX962SHA256,
+                                          (__bridge CFDataRef)data, (__bridge CFDataRef)signature, NULL);
+            CFRelease(key);
+        }
+    }
+
+    if (!valid) {
+        if (error) *error = [self errorWithCode:HotUpdatesVerifierErrorSignature message:@"Signature invalid: manifest"];
+        return NO;
+    }
+
+    NSLog(@"[HotUpdates] Manifest signature verified");
+    return YES;
+}
+
++ (void)downloadURL:(NSURL*)url session:(NSURLSession*)session completion:(void (^)(NSData *data, NSError *error))completion {
+    if (!url) {
+        completion(nil, [self errorWithCode:HotUpdatesVerifierErrorDownload message:@"Invalid URL format"]);
+        return;
+    }
+
+    [[session dataTaskWithURL:url completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+        NSInteger statusCode = [(NSHTTPURLResponse*)response statusCode];
+        if (error) {
+            completion(nil, [self errorWithCode:HotUpdatesVerifierErrorDownload
+                                        message:[NSString stringWithFormat:@"Manifest download failed: %@", error.localizedDescription]]);
+        } else if (statusCode != 200) {
+            completion(nil, [self errorWithCode:HotUpdatesVerifierErrorDownload
+                                        message:[NSString stringWithFormat:@"HTTP error: %ld", (long)statusCode]]);
+        } else {
+            completion(data, nil);
+        }
+    }] resume];
+}
+
+/*!
+ * @brief Same rule as moveExtractedWWWFrom: www at the archive root, or nested one level
+ */
++ (NSString*)wwwPathForEntryName:(NSString*)entryName {
+    NSString *prefix = [kWWWDirName stringByAppendingString:@"/"];
+    if ([entryName hasPrefix:prefix]) {
+        return [entryName substringFromIndex:prefix.length];
+    }
+
+    NSRange slash = [entryName rangeOfString:@"/"];
+    if (slash.location != NSNotFound && slash.location > 0) {
+        NSString *rest = [entryName substringFromIndex:slash.location + 1];
+        if ([rest hasPrefix:prefix]) {
+            return [rest substringFromIndex:prefix.length];
+        }
+    }
+    return nil;
+}
+
++ (NSString*)hexStringForDigest:(const unsigned char*)digest {
+    NSMutableString *hex = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+    for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+        [hex appendFormat:@"%02x", digest[i]];
+    }
+    return hex;
+}
+
+- (BOOL)failWithMessage:(NSString*)message error:(NSError**)error {
+    NSError *failure = [HotUpdatesVerifier errorWithCode:HotUpdatesVerifierErrorHashMismatch message:message];
+    @synchronized (self) {
+        if (!self.failure) {
+            self.failure = failure;
+        }
+    }
+    if (error) *error = failure;
+    return NO;
+}
+
++ (NSError*)errorWithCode:(HotUpdatesVerifierError)code message:(NSString*)message {
+    return [NSError errorWithDomain:HotUpdatesVerifierErrorDomain
+                               code:code
+                           userInfo:@{NSLocalizedDescriptionKey: message}];
+}
+
+@end
@@ -0,0 +1,102 @@
+/*!
+ * @file HotUpdatesZipStream.h
+ * @brief Streaming ZIP extraction for Hot Updates Plugin
+ * @details Parses ZIP local file headers and inflates entries as bytes arrive, so an update
+ *          archive can be extracted directly from the HTTP body. Network and decompression
+ *          overlap, and the archive itself is never written to disk.
+ *
+ *          Supported: stored and deflated entries, data descriptors, Zip64 sizes.
+ *          Not supported: encrypted entries, stored entries with unknown size
+ *          (both are rejected with an error).
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class HotUpdatesVerifier;
+@class HotUpdatesProgress;
+
+/*!
+ * @brief Outcome of a streaming download
+ */
+@interface HotUpdatesZipStreamResult : NSObject
+
+@property (nonatomic, assign) NSInteger statusCode;       // 200 or 206 on success
+@property (nonatomic, copy) NSString *validator;          // Strong ETag or Last-Modified (for If-Range)
+@property (nonatomic, assign) long long committedOffset;  // Offset to resume from after a failure
+@property (nonatomic, strong) NSError *networkError;
+@property (nonatomic, strong) NSError *extractError;
+@property (nonatomic, copy) NSDictionary<NSString*, NSString*> *hashes;  // Entry name -> SHA-256 hex of this transfer
+
+@end
+
+@interface HotUpdatesZipStream : NSObject
+
+/*!
+ * @brief Archive offset of the first entry not yet fully extracted
+ * @details An interrupted extraction can continue from here with entries extracted so far kept
+ */
+@property (nonatomic, assign, readonly) long long committedOffset;
+
+/*!
+ * @brief Create extractor writing into the given directory
+ * @param destination Existing directory for extracted entries
+ * @param startOffset Archive offset of the first appended byte, must be an entry boundary
+ */
+- (instancetype)initWithDestination:(NSString*)destination startOffset:(long long)startOffset;
+
+/*!
+ * @brief Signed manifest: every entry is hashed while it is inflated and checked against it
+ */
+@property (nonatomic, strong) HotUpdatesVerifier *verifier;
+
+/*!
+ * @brief Entry name -> SHA-256 hex of the files extracted by this instance
+ * @details Computed while entries are inflated, so staging does not read them again.
+ *          Entries of an earlier, resumed transfer are not included.
+ */
+@property (nonatomic, copy, readonly) NSDictionary<NSString*, NSString*> *hashes;
+
+/*!
+ * @brief Feed next chunk of the archive
+ * @param error Set if data is not a valid ZIP stream or a file cannot be written
+ * @return NO on error (extraction cannot continue)
+ */
+- (BOOL)appendData:(NSData*)data error:(NSError**)error;
+
+/*!
+ * @brief Check that the archive was complete
+ * @param error Set if stream ended before the central directory
+ * @return YES if all entries were extracted
+ */
+- (BOOL)finishWithError:(NSError**)error;
+
+/*!
+ * @brief Download ZIP and extract it while the body streams in
+ * @details With resumeOffset > 0 sends Range / If-Range: the server answers 206 while the
+ *          validator still matches, otherwise the full body is downloaded and destination
+ *          is emptied first.
+ * @param url Archive URL
+ * @param destination Existing directory for extracted entries
+ * @param resumeOffset Committed offset of a previous attempt (0 for full download)
+ * @param validator Validator of the previous attempt (nil for full download)
+ * @param configuration Session configuration (timeouts)
+ * @param verifier Signed manifest to check entries against (nil to skip)
+ * @param progress Called after every extracted entry with the new committed offset
+ * @param reporter Receives the downloading phase with received bytes (nil to skip)
+ * @param completion Called on a background queue when the transfer ends
+ * @return Session of the transfer (cancelling its tasks aborts the download)
+ */
++ (NSURLSession*)extractArchiveAtURL:(NSURL*)url
+                         toDirectory:(NSString*)destination
+                        resumeOffset:(long long)resumeOffset
+                           validator:(NSString*)validator
+                       configuration:(NSURLSessionConfiguration*)configuration
+                            verifier:(HotUpdatesVerifier*)verifier
+                            progress:(void (^)(long long committedOffset))progress
+                            reporter:(HotUpdatesProgress*)reporter
+                          completion:(void (^)(HotUpdatesZipStreamResult *result))completion;
+
+@end
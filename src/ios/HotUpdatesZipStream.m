@@ -0,0 +1,586 @@
+/*!
+ * @file HotUpdatesZipStream.m
+ * @brief Implementation of streaming ZIP extraction
+ * @version 2.3.1
+ * @author Mustafin Vladimir
+ * @copyright Copyright (c) 2025. All rights reserved.
+ */
+
+#import "HotUpdatesZipStream.h"
+#import "HotUpdatesVerifier.h"
+#import "HotUpdatesProgress.h"
+#import "HotUpdatesMetrics.h"
+#import "HotUpdatesConstants.h"
+#import <CommonCrypto/CommonDigest.h>
+#import <zlib.h>
+
+static NSString * const kZipStreamErrorDomain = @"HotUpdatesZipStream";
+
+static const uint32_t kLocalHeaderSignature = 0x04034b50;
+static const uint32_t kCentralHeaderSignature = 0x02014b50;
+static const uint32_t kEndOfCentralDirSignature = 0x06054b50;
+static const uint32_t kDataDescriptorSignature = 0x08074b50;
+
+static const NSUInteger kLocalHeaderSize = 30;
+static const NSUInteger kOutputBufferSize = 64 * 1024;
+
+static const uint16_t kFlagEncrypted = 0x0001;
+static const uint16_t kFlagDataDescriptor = 0x0008;
+static const uint16_t kFlagUTF8 = 0x0800;
+
+static const uint16_t kMethodStored = 0;
+static const uint16_t kMethodDeflated = 8;
+
+typedef NS_ENUM(NSInteger, HotUpdatesZipState) {
+    HotUpdatesZipStateHeader,
+    HotUpdatesZipStateData,
+    HotUpdatesZipStateDescriptor,
+    HotUpdatesZipStateDone
+};
+
+static inline uint16_t readUInt16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t readUInt32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t readUInt64(const uint8_t *p) {
+    return (uint64_t)readUInt32(p) | ((uint64_t)readUInt32(p + 4) << 32);
+}
+
+/*!
+ * @brief Feeds data task body into the extractor
+ */
+@interface HotUpdatesZipStreamDelegate : NSObject <NSURLSessionDataDelegate>
+@property (nonatomic, strong) HotUpdatesZipStream *extractor;
+@property (nonatomic, copy) NSString *destination;
+@property (nonatomic, assign) long long resumeOffset;
+@property (nonatomic, strong) HotUpdatesVerifier *verifier;
+@property (nonatomic, copy) void (^progress)(long long committedOffset);
+@property (nonatomic, strong) HotUpdatesProgress *reporter;
+@property (nonatomic, copy) void (^completion)(HotUpdatesZipStreamResult *result);
+@property (nonatomic, strong) HotUpdatesZipStreamResult *result;
+@end
+
+@implementation HotUpdatesZipStreamResult
+@end
+
+@interface HotUpdatesZipStream ()
+@property (nonatomic, assign, readwrite) long long committedOffset;
+@property (nonatomic, copy) void (^entryHandler)(long long committedOffset);
+@end
+
+#pragma mark - Extractor
+
+@implementation HotUpdatesZipStream {
+    NSString *_destination;
+    NSMutableData *_buffer;      // Ещё не разобранные байты (обычно только заголовок)
+    NSUInteger _offset;
+    long long _bufferStart;      // Смещение _buffer[0] в архиве
+    HotUpdatesZipState _state;
+
+    // Текущая запись
+    NSString *_entryName;
+    uint16_t _flags;
+    uint16_t _method;
+    uint32_t _expectedCRC;
+    uint32_t _crc;
+    CC_SHA256_CTX _sha256;
+    uint64_t _remaining;         // Для stored записей
+    BOOL _zip64;
+    FILE *_file;
+    NSMutableDictionary<NSString*, NSString*> *_hashes;
+    z_stream _zstream;
+    BOOL _inflating;
+    uint8_t *_output;
+}
+
+- (instancetype)initWithDestination:(NSString*)destination startOffset:(long long)startOffset {
+    self = [super init];
+    if (self) {
+        _destination = [destination copy];
+        _bufferStart = startOffset;
+        _committedOffset = startOffset;
+        _buffer = [NSMutableData data];
+        _state = HotUpdatesZipStateHeader;
+        _hashes = [NSMutableDictionary dictionary];
+        _output = malloc(kOutputBufferSize);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self closeEntry];
+    free(_output);
+}
+
+- (NSDictionary<NSString*, NSString*>*)hashes {
+    return [_hashes copy];
+}
+
+- (BOOL)appendData:(NSData*)data error:(NSError**)error {
+    if (_state == HotUpdatesZipStateDone) {
+        return YES;
+    }
+
+    [_buffer appendData:data];
+
+    BOOL progress = YES;
+    while (progress && _state != HotUpdatesZipStateDone) {
+        NSError *stepError = nil;
+        switch (_state) {
+            case HotUpdatesZipStateHeader:
+                progress = [self readHeader:&stepError];
+                break;
+            case HotUpdatesZipStateData:
+                progress = [self readData:&stepError];
+                break;
+            case HotUpdatesZipStateDescriptor:
+                progress = [self readDescriptor:&stepError];
+                break;
+            case HotUpdatesZipStateDone:
+                progress = NO;
+                break;
+        }
+
+        if (stepError) {
+            [self closeEntry];
+            if (error) *error = stepError;
+            return NO;
+        }
+    }
+
+    // Убираем разобранные байты, в буфере остаётся только неполный заголовок
+    [_buffer replaceBytesInRange:NSMakeRange(0, _offset) withBytes:NULL length:0];
+    _bufferStart += _offset;
+    _offset = 0;
+    return YES;
+}
+
+- (BOOL)finishWithError:(NSError**)error {
+    if (_state != HotUpdatesZipStateDone) {
+        [self closeEntry];
+        if (error) *error = [self errorWithMessage:@"Unexpected end of ZIP stream"];
+        return NO;
+    }
+    return YES;
+}
+
+#pragma mark - Download
+
++ (NSURLSession*)extractArchiveAtURL:(NSURL*)url
+                         toDirectory:(NSString*)destination
+                        resumeOffset:(long long)resumeOffset
+                           validator:(NSString*)validator
+                       configuration:(NSURLSessionConfiguration*)configuration
+                            verifier:(HotUpdatesVerifier*)verifier
+                            progress:(void (^)(long long committedOffset))progress
+                            reporter:(HotUpdatesProgress*)reporter
+                          completion:(void (^)(HotUpdatesZipStreamResult *result))completion {
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:url];
+    // Смещения должны указывать в сам архив, а не в сжатую передачу
+    [request setValue:@"identity" forHTTPHeaderField:@"Accept-Encoding"];
+
+    if (resumeOffset > 0 && validator) {
+        [request setValue:[NSString stringWithFormat:@"bytes=%lld-", resumeOffset] forHTTPHeaderField:@"Range"];
+        [request setValue:validator forHTTPHeaderField:@"If-Range"];
+    } else {
+        resumeOffset = 0;
+    }
+
+    HotUpdatesZipStreamDelegate *delegate = [[HotUpdatesZipStreamDelegate alloc] init];
+    delegate.destination = destination;
+    delegate.resumeOffset = resumeOffset;
+    delegate.verifier = verifier;
+    delegate.progress = progress;
+    delegate.reporter = reporter;
+    delegate.completion = completion;
+    delegate.result = [[HotUpdatesZipStreamResult alloc] init];
+    delegate.result.committedOffset = resumeOffset;
+
+    // Последовательная очередь: куски архива разбираются строго по порядку, вне main thread
+    NSOperationQueue *queue = [[NSOperationQueue alloc] init];
+    queue.maxConcurrentOperationCount = 1;
+    queue.qualityOfService = NSQualityOfServiceUtility;
+
+    NSURLSession *session = [NSURLSession sessionWithConfiguration:configuration delegate:delegate delegateQueue:queue];
+    [[session dataTaskWithRequest:request] resume];
+
+    // Сессия держит delegate до завершения задачи
+    [session finishTasksAndInvalidate];
+    return session;
+}
+
+#pragma mark - Parsing
+
+- (NSUInteger)available {
+    return _buffer.length - _offset;
+}
+
+- (const uint8_t*)cursor {
+    return (const uint8_t*)_buffer.bytes + _offset;
+}
+
+- (BOOL)readHeader:(NSError**)error {
+    if ([self available] < 4) return NO;
+
+    const uint8_t *p = [self cursor];
+    uint32_t signature = readUInt32(p);
+
+    if (signature == kCentralHeaderSignature || signature == kEndOfCentralDirSignature) {
+        // Все записи извлечены, central directory не нужен
+        _state = HotUpdatesZipStateDone;
+        return NO;
+    }
+    if (signature != kLocalHeaderSignature) {
+        *error = [self errorWithMessage:@"Invalid file format (not a ZIP archive)"];
+        return NO;
+    }
+
+    if ([self available] < kLocalHeaderSize) return NO;
+
+    uint16_t nameLength = readUInt16(p + 26);
+    uint16_t extraLength = readUInt16(p + 28);
+    if ([self available] < kLocalHeaderSize + nameLength + extraLength) return NO;
+
+    _flags = readUInt16(p + 6);
+    _method = readUInt16(p + 8);
+    _expectedCRC = readUInt32(p + 14);
+    uint64_t compressedSize = readUInt32(p + 18);
+    _zip64 = NO;
+
+    // Zip64: реальные размеры лежат в extra поле 0x0001
+    const uint8_t *extra = p + kLocalHeaderSize + nameLength;
+    for (NSUInteger i = 0; i + 4 <= extraLength; ) {
+        uint16_t fieldId = readUInt16(extra + i);
+        uint16_t fieldSize = readUInt16(extra + i + 2);
+        if (fieldId == 0x0001) {
+            _zip64 = YES;
+            // Порядок: uncompressed size, compressed size
+            if (fieldSize >= 16 && i + 4 + 16 <= extraLength) {
+                compressedSize = readUInt64(extra + i + 4 + 8);
+            }
+        }
+        i += 4 + fieldSize;
+    }
+
+    NSData *nameData = [NSData dataWithBytes:p + kLocalHeaderSize length:nameLength];
+    NSStringEncoding encoding = (_flags & kFlagUTF8) ? NSUTF8StringEncoding : NSISOLatin1StringEncoding;
+    NSString *name = [[NSString alloc] initWithData:nameData encoding:NSUTF8StringEncoding]
+                     ?: [[NSString alloc] initWithData:nameData encoding:encoding];
+
+    _offset += kLocalHeaderSize + nameLength + extraLength;
+
+    if (![self isSafeEntryName:name]) {
+        *error = [self errorWithMessage:[NSString stringWithFormat:@"ZIP entry outside destination directory: %@", name]];
+        return NO;
+    }
+    if (_flags & kFlagEncrypted) {
+        *error = [self errorWithMessage:[NSString stringWithFormat:@"Encrypted ZIP entry not supported: %@", name]];
+        return NO;
+    }
+    if (_method != kMethodStored && _method != kMethodDeflated) {
+        *error = [self errorWithMessage:[NSString stringWithFormat:@"Unsupported compression method %u: %@", _method, name]];
+        return NO;
+    }
+    BOOL isDirectory = [name hasSuffix:@"/"];
+    if (_method == kMethodStored && (_flags & kFlagDataDescriptor) && compressedSize == 0 && !isDirectory) {
+        *error = [self errorWithMessage:[NSString stringWithFormat:@"Stored ZIP entry without size: %@", name]];
+        return NO;
+    }
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSString *outputPath = [_destination stringByAppendingPathComponent:name];
+
+    if (isDirectory) {
+        // Данные директории (пустой deflate поток) разбираются как у файла, но не пишутся
+        [fileManager createDirectoryAtPath:outputPath withIntermediateDirectories:YES attributes:nil error:nil];
+    } else {
+        [fileManager createDirectoryAtPath:[outputPath stringByDeletingLastPathComponent]
+               withIntermediateDirectories:YES attributes:nil error:nil];
+
+        _file = fopen(outputPath.fileSystemRepresentation, "wb");
+        if (!_file) {
+            *error = [self errorWithMessage:[NSString stringWithFormat:@"Cannot create file: %@", name] posixCode:errno];
+            return NO;
+        }
+    }
+
+    _entryName = name;
+    _crc = (uint32_t)crc32(0L, Z_NULL, 0);
+    CC_SHA256_Init(&_sha256);
+
+    if (_method == kMethodDeflated) {
+        memset(&_zstream, 0, sizeof(_zstream));
+        if (inflateInit2(&_zstream, -MAX_WBITS) != Z_OK) {
+            *error = [self errorWithMessage:@"Cannot initialize inflater"];
+            return NO;
+        }
+        _inflating = YES;
+    } else {
+        _remaining = compressedSize;
+    }
+
+    _state = HotUpdatesZipStateData;
+    return YES;
+}
+
+- (BOOL)readData:(NSError**)error {
+    NSUInteger available = [self available];
+
+    if (_method == kMethodStored) {
+        NSUInteger count = (NSUInteger)MIN((uint64_t)available, _remaining);
+        if (count > 0) {
+            if (![self writeBytes:[self cursor] length:count error:error]) return NO;
+            _offset += count;
+            _remaining -= count;
+        }
+        if (_remaining > 0) return NO;
+        return [self finishEntryData:error];
+    }
+
+    if (available == 0) return NO;
+
+    _zstream.next_in = (Bytef*)[self cursor];
+    _zstream.avail_in = (uInt)MIN(available, (NSUInteger)UINT32_MAX);
+
+    int status;
+    do {
+        _zstream.next_out = _output;
+        _zstream.avail_out = (uInt)kOutputBufferSize;
+
+        status = inflate(&_zstream, Z_NO_FLUSH);
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+            *error = [self errorWithMessage:[NSString stringWithFormat:@"Corrupted ZIP entry: %@", _entryName]];
+            return NO;
+        }
+
+        NSUInteger produced = kOutputBufferSize - _zstream.avail_out;
+        if (produced > 0 && ![self writeBytes:_output length:produced error:error]) {
+            return NO;
+        }
+    } while (status != Z_STREAM_END && _zstream.avail_out == 0);
+
+    _offset += available - _zstream.avail_in;
+
+    if (status != Z_STREAM_END) return NO;
+
+    inflateEnd(&_zstream);
+    _inflating = NO;
+    return [self finishEntryData:error];
+}
+
+- (BOOL)readDescriptor:(NSError**)error {
+    NSUInteger sizesLength = _zip64 ? 16 : 8;
+    if ([self available] < 4) return NO;
+
+    const uint8_t *p = [self cursor];
+    NSUInteger signatureLength = readUInt32(p) == kDataDescriptorSignature ? 4 : 0;
+    if ([self available] < signatureLength + 4 + sizesLength) return NO;
+
+    _expectedCRC = readUInt32(p + signatureLength);
+    _offset += signatureLength + 4 + sizesLength;
+
+    return [self verifyEntry:error];
+}
+
+- (BOOL)finishEntryData:(NSError**)error {
+    if (_flags & kFlagDataDescriptor) {
+        _state = HotUpdatesZipStateDescriptor;
+        return YES;
+    }
+    return [self verifyEntry:error];
+}
+
+- (BOOL)verifyEntry:(NSError**)error {
+    NSString *name = _entryName;
+    BOOL isFile = _file != NULL;
+    [self closeEntry];
+
+    if (isFile && _crc != _expectedCRC) {
+        *error = [self errorWithMessage:[NSString stringWithFormat:@"CRC mismatch: %@", name]];
+        return NO;
+    }
+    if (isFile) {
+        unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+        CC_SHA256_Final(digest, &_sha256);
+        if (self.verifier && ![self.verifier verifyEntryNamed:name digest:digest error:error]) {
+            return NO;
+        }
+        _hashes[name] = [HotUpdatesVerifier hexStringForDigest:digest];
+    }
+
+    _state = HotUpdatesZipStateHeader;
+    self.committedOffset = _bufferStart + _offset;
+    if (self.entryHandler) {
+        self.entryHandler(self.committedOffset);
+    }
+    return YES;
+}
+
+#pragma mark - Private
+
+- (BOOL)writeBytes:(const uint8_t*)bytes length:(NSUInteger)length error:(NSError**)error {
+    if (!_file) return YES;  // Директория
+
+    _crc = (uint32_t)crc32(_crc, bytes, (uInt)length);
+    CC_SHA256_Update(&_sha256, bytes, (CC_LONG)length);
+    if (fwrite(bytes, 1, length, _file) != length) {
+        *error = [self errorWithMessage:[NSString stringWithFormat:@"Cannot write file: %@", _entryName] posixCode:errno];
+        return NO;
+    }
+    return YES;
+}
+
+- (void)closeEntry {
+    if (_file) {
+        fclose(_file);
+        _file = NULL;
+    }
+    if (_inflating) {
+        inflateEnd(&_zstream);
+        _inflating = NO;
+    }
+    _entryName = nil;
+}
+
+- (BOOL)isSafeEntryName:(NSString*)name {
+    if (name.length == 0 || [name hasPrefix:@"/"] || [name containsString:@"\\"]) {
+        return NO;
+    }
+    for (NSString *segment in [name componentsSeparatedByString:@"/"]) {
+        if ([segment isEqualToString:@".."]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (NSError*)errorWithMessage:(NSString*)message {
+    return [NSError errorWithDomain:kZipStreamErrorDomain
+                               code:1
+                           userInfo:@{NSLocalizedDescriptionKey: message}];
+}
+
+/*!
+ * @brief File system error, errno as underlying error (ENOSPC - disk full)
+ */
+- (NSError*)errorWithMessage:(NSString*)message posixCode:(int)code {
+    return [NSError errorWithDomain:kZipStreamErrorDomain
+                               code:1
+                           userInfo:@{NSLocalizedDescriptionKey: message,
+                                      NSUnderlyingErrorKey: [NSError errorWithDomain:NSPOSIXErrorDomain code:code userInfo:nil]}];
+}
+
+@end
+
+#pragma mark - Download Delegate
+
+@implementation HotUpdatesZipStreamDelegate
+
+- (void)URLSession:(NSURLSession*)session
+          dataTask:(NSURLSessionDataTask*)dataTask
+didReceiveResponse:(NSURLResponse*)response
+ completionHandler:(void (^)(NSURLSessionResponseDisposition))completionHandler {
+    NSHTTPURLResponse *httpResponse = [response isKindOfClass:[NSHTTPURLResponse class]] ? (NSHTTPURLResponse*)response : nil;
+    NSInteger statusCode = httpResponse.statusCode;
+    self.result.statusCode = statusCode;
+
+    long long startOffset = 0;
+    if (statusCode == 206) {
+        startOffset = [self contentRangeStart:[httpResponse valueForHTTPHeaderField:@"Content-Range"]];
+        if (self.resumeOffset == 0 || startOffset != self.resumeOffset) {
+            // Неожиданный диапазон - считаем ответ ошибкой, следующая попытка начнёт с нуля
+            self.result.committedOffset = 0;
+            self.result.statusCode = 416;
+            completionHandler(NSURLSessionResponseCancel);
+            return;
+        }
+    } else if (statusCode == 200) {
+        // Валидатор изменился или первая попытка - начинаем с пустой директории
+        NSFileManager *fileManager = [NSFileManager defaultManager];
+        if (self.resumeOffset > 0) {
+            [fileManager removeItemAtPath:self.destination error:nil];
+            [fileManager createDirectoryAtPath:self.destination withIntermediateDirectories:YES attributes:nil error:nil];
+        }
+    } else {
+        completionHandler(NSURLSessionResponseCancel);
+        return;
+    }
+
+    NSString *etag = [httpResponse valueForHTTPHeaderField:@"ETag"];
+    self.result.validator = (etag && ![etag hasPrefix:@"W/"]) ? etag : [httpResponse valueForHTTPHeaderField:@"Last-Modified"];
+    self.result.committedOffset = startOffset;
+
+    // Записи распаковываются по мере поступления: загрузка и распаковка - одна фаза
+    long long expected = response.expectedContentLength;
+    [self.reporter startPhase:kProgressPhaseDownloading
+                        bytes:startOffset
+                   totalBytes:expected >= 0 ? startOffset + expected : -1];
+
+    self.extractor = [[HotUpdatesZipStream alloc] initWithDestination:self.destination startOffset:startOffset];
+    self.extractor.verifier = self.verifier;
+    __weak HotUpdatesZipStreamDelegate *weakSelf = self;
+    self.extractor.entryHandler = ^(long long committedOffset) {
+        weakSelf.result.committedOffset = committedOffset;
+        if (weakSelf.progress) {
+            weakSelf.progress(committedOffset);
+        }
+    };
+
+    completionHandler(NSURLSessionResponseAllow);
+}
+
+- (void)URLSession:(NSURLSession*)session dataTask:(NSURLSessionDataTask*)dataTask didReceiveData:(NSData*)data {
+    if (self.result.extractError || !self.extractor) return;
+    [self.reporter addBytes:data.length];
+
+    NSError *error = nil;
+    if (![self.extractor appendData:data error:&error]) {
+        self.result.extractError = error;
+        [dataTask cancel];
+    }
+}
+
+- (void)URLSession:(NSURLSession*)session task:(NSURLSessionTask*)task didFinishCollectingMetrics:(NSURLSessionTaskMetrics*)metrics {
+    [HotUpdatesMetrics recordTaskMetrics:metrics];
+}
+
+- (void)URLSession:(NSURLSession*)session task:(NSURLSessionTask*)task didCompleteWithError:(NSError*)error {
+    HotUpdatesZipStreamResult *result = self.result;
+    BOOL httpOK = result.statusCode == 200 || result.statusCode == 206;
+
+    if (!result.extractError && httpOK && !error) {
+        NSError *extractError = nil;
+        if (![self.extractor finishWithError:&extractError]) {
+            result.extractError = extractError;
+        }
+    }
+
+    // Ошибка cancel после неверного HTTP статуса или извлечения не является сетевой
+    if (!result.extractError && httpOK) {
+        result.networkError = error;
+    }
+
+    result.hashes = self.extractor.hashes;
+    if (self.completion) {
+        self.completion(result);
+        self.completion = nil;
+    }
+    self.extractor = nil;
+    self.progress = nil;
+    self.reporter = nil;
+}
+
+- (long long)contentRangeStart:(NSString*)contentRange {
+    // Content-Range: bytes 1000-4999/5000
+    if (![contentRange hasPrefix:@"bytes "]) return -1;
+
+    NSScanner *scanner = [NSScanner scannerWithString:[contentRange substringFromIndex:6]];
+    long long start = -1;
+    return [scanner scanLongLong:&start] ? start : -1;
+}
+
+@end
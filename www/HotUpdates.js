@@ -17,18 +17,24 @@ var ErrorCodes = {
     // getUpdate errors
     UPDATE_DATA_REQUIRED: 'UPDATE_DATA_REQUIRED',
     URL_REQUIRED: 'URL_REQUIRED',
-    DOWNLOAD_IN_PROGRESS: 'DOWNLOAD_IN_PROGRESS',
+    DOWNLOAD_IN_PROGRESS: 'DOWNLOAD_IN_PROGRESS', // no longer returned, kept for compatibility
+    CANCELLED: 'CANCELLED',
     DOWNLOAD_FAILED: 'DOWNLOAD_FAILED',
     HTTP_ERROR: 'HTTP_ERROR',
     TEMP_DIR_ERROR: 'TEMP_DIR_ERROR',
     EXTRACTION_FAILED: 'EXTRACTION_FAILED',
     WWW_NOT_FOUND: 'WWW_NOT_FOUND',
+    MANIFEST_INVALID: 'MANIFEST_INVALID',
+    HASH_MISMATCH: 'HASH_MISMATCH',
+    INSUFFICIENT_STORAGE: 'INSUFFICIENT_STORAGE',
     // forceUpdate errors
     NO_UPDATE_READY: 'NO_UPDATE_READY',
     UPDATE_FILES_NOT_FOUND: 'UPDATE_FILES_NOT_FOUND',
     INSTALL_FAILED: 'INSTALL_FAILED',
     // canary errors
-    VERSION_REQUIRED: 'VERSION_REQUIRED'
+    VERSION_REQUIRED: 'VERSION_REQUIRED',
+    // rollbackTo errors
+    VERSION_NOT_RETAINED: 'VERSION_NOT_RETAINED'
 };
 
 var HotUpdates = {
@@ -39,21 +45,131 @@ var HotUpdates = {
      */
     ErrorCodes: ErrorCodes,
 
+    /**
+     * Ask the check API (or a release-channel manifest) which version to install
+     *
+     * The request is conditional (If-None-Match / If-Modified-Since with the validators of the
+     * last answer), so an unchanged answer is a 304 without body. The response is filtered
+     * against the ignore list and the app version (minAppVersion).
+     *
+     * @param {Object} [options] - Check options
+     * @param {string} [options.url] - Check URL; defaults to the HotUpdatesPrefetchUrl preference.
+     *   "version" and "platform" are appended as query parameters
+     * @param {boolean|Object} [options.download] - Download a found update right away; an object is
+     *   passed to getUpdate as options (background, connections, onProgress, ...)
+     * @param {Function} callback - Callback(error, update)
+     *   - update: {hasUpdate, version, url, manifestUrl, verifyManifestUrl, packed, minAppVersion,
+     *     ready (already downloaded), notModified (answered with 304),
+     *     reason ('upToDate' | 'ignored' | 'incompatible', when hasUpdate is false)}
+     *   - with download, callback fires when the download ends (error is the getUpdate error)
+     *
+     * @example
+     * hotUpdate.checkForUpdate({download: {background: true}}, function(error, update) {
+     *     if (!error && update.hasUpdate) console.log('Update ' + update.version + ' ready');
+     * });
+     */
+    checkForUpdate: function(options, callback) {
+        if (typeof options === 'function') {
+            callback = options;
+            options = null;
+        }
+        options = options || {};
+        var download = options.download;
+
+        exec(
+            function(update) {
+                if (!download || !update.hasUpdate) {
+                    if (callback) callback(null, update);
+                    return;
+                }
+
+                var updateOptions = {};
+                if (typeof download === 'object') {
+                    for (var key in download) {
+                        if (Object.prototype.hasOwnProperty.call(download, key)) {
+                            updateOptions[key] = download[key];
+                        }
+                    }
+                }
+                updateOptions.url = update.url;
+                updateOptions.manifestUrl = update.manifestUrl;
+                updateOptions.version = update.version;
+                updateOptions.verifyManifestUrl = update.verifyManifestUrl;
+                updateOptions.packed = updateOptions.packed || update.packed;
+
+                HotUpdates.getUpdate(updateOptions, function(error) {
+                    if (callback) callback(error, update);
+                });
+            },
+            function(error) {
+                if (callback) callback({error: error});
+            },
+            'HotUpdates',
+            'checkForUpdate',
+            [{url: options.url}]
+        );
+    },
+
     /**
      * Download update from server
      *
      * @param {Object} options - Update options
-     * @param {string} options.url - URL to download ZIP archive (required)
+     * @param {string} [options.url] - URL to download ZIP archive (required unless manifestUrl is set)
+     * @param {string} [options.manifestUrl] - URL of per-file hash manifest (delta update, only changed files are downloaded)
      * @param {string} [options.version] - Version string (optional)
+     * @param {number} [options.connections=1] - Parallel connections for ZIP download (max 8). Used when the server
+     *   supports Range requests and the archive is at least 4 MB; otherwise one streaming connection
+     * @param {boolean} [options.background=false] - Download ZIP in the background (URLSession / WorkManager),
+     *   survives app suspension; callback fires when done if the app is still running (ignored with manifestUrl)
+     * @param {boolean} [options.wifiOnly=false] - Background download: do not use cellular network
+     * @param {boolean} [options.requiresCharging=false] - Background download: wait until the device is charging
+     *   (Android); discretionary transfer scheduled by the system (iOS)
+     * @param {boolean} [options.packed=false] - Keep the ZIP as one file and serve assets from it without extraction.
+     *   Requires an archive with stored (uncompressed) entries; otherwise it is extracted as usual
+     * @param {string} [options.verifyManifestUrl] - Signed manifest (signature at <url>.sig, key in the
+     *   HotUpdatesPublicKey preference); every file is hash-checked during extraction before the update becomes pending
+     * @param {boolean} [options.lowStorage=false] - Low-storage mode for ZIP downloads: drop a staged update and
+     *   retained versions (except the rollback target) first, then stream over one connection. Used automatically
+     *   when the update does not fit otherwise; INSUFFICIENT_STORAGE if it still does not fit
+     * @param {Function} [options.onProgress] - Called with progress events until the download ends (at most 4 per second,
+     *   and on every phase change): {type: 'progress', version, phase, bytesReceived, totalBytes, bytesPerSecond, etaSeconds}.
+     *   phase is 'downloading', 'verifying', 'extracting' or 'staging'; totalBytes and etaSeconds are -1 when unknown
      * @param {Function} callback - Callback(error)
      *   - null on success
      *   - {error: {code: string, message: string}} on error
      *
+     * A call for the version that is already downloading waits for that download instead of
+     * starting another one. A call for a different version cancels the running download, whose
+     * callbacks get CANCELLED.
+     *
      * @example
      * hotUpdate.getUpdate({url: 'https://server.com/update.zip', version: '2.0.0'}, function(err) {
      *     if (err) console.error(err.error.code, err.error.message);
      *     else console.log('Downloaded');
      * });
+     *
+     * @example
+     * // Delta update: only files whose hash changed are downloaded
+     * hotUpdate.getUpdate({manifestUrl: 'https://server.com/2.0.0/manifest.json', version: '2.0.0'}, callback);
+     *
+     * @example
+     * // Background download over Wi-Fi, installed on next launch if the app is killed meanwhile
+     * hotUpdate.getUpdate({url: 'https://server.com/update.zip', version: '2.0.0', background: true, wifiOnly: true}, callback);
+     *
+     * @example
+     * // Packed install: archive built with `zip -0 -r update.zip www`, served straight from the file
+     * hotUpdate.getUpdate({url: 'https://server.com/update.zip', version: '2.0.0', packed: true}, callback);
+     *
+     * @example
+     * // Reject the archive unless every file matches the signed manifest
+     * hotUpdate.getUpdate({url: 'https://server.com/update.zip', version: '2.0.0',
+     *     verifyManifestUrl: 'https://server.com/2.0.0/manifest.json'}, callback);
+     *
+     * @example
+     * // Progress bar
+     * hotUpdate.getUpdate({url: 'https://server.com/update.zip', version: '2.0.0', onProgress: function(p) {
+     *     if (p.totalBytes > 0) bar.style.width = (100 * p.bytesReceived / p.totalBytes) + '%';
+     * }}, callback);
      */
     getUpdate: function(options, callback) {
         if (!options) {
@@ -63,15 +179,30 @@ var HotUpdates = {
             return;
         }
 
-        if (!options.url) {
+        if (!options.url && !options.manifestUrl) {
             if (callback) {
                 callback({error: {code: ErrorCodes.URL_REQUIRED, message: 'URL is required'}});
             }
             return;
         }
 
+        // Functions cannot cross the bridge; native only sends events when asked to
+        var onProgress = typeof options.onProgress === 'function' ? options.onProgress : null;
+        var nativeOptions = {};
+        for (var key in options) {
+            if (Object.prototype.hasOwnProperty.call(options, key) && key !== 'onProgress') {
+                nativeOptions[key] = options[key];
+            }
+        }
+        nativeOptions.progress = onProgress !== null;
+
         exec(
-            function() {
+            function(event) {
+                // Progress events arrive on the same (kept) callback before the final result
+                if (event && event.type === 'progress') {
+                    if (onProgress) onProgress(event);
+                    return;
+                }
                 if (callback) callback(null);
             },
             function(error) {
@@ -79,7 +210,35 @@ var HotUpdates = {
             },
             'HotUpdates',
             'getUpdate',
-            [options]
+            [nativeOptions]
+        );
+    },
+
+    /**
+     * Abort the running download and delete its partial files
+     *
+     * Waiting getUpdate callbacks get CANCELLED. An update that is already downloaded
+     * (ready for forceUpdate) is kept.
+     *
+     * @param {Function} callback - Callback(error)
+     *   - null once the download has stopped (also when nothing was downloading)
+     *
+     * @example
+     * hotUpdate.cancelUpdate(function() {
+     *     console.log('Download cancelled');
+     * });
+     */
+    cancelUpdate: function(callback) {
+        exec(
+            function() {
+                if (callback) callback(null);
+            },
+            function(error) {
+                if (callback) callback({error: error});
+            },
+            'HotUpdates',
+            'cancelUpdate',
+            []
         );
     },
 
@@ -111,7 +270,8 @@ var HotUpdates = {
     },
 
     /**
-     * Confirm successful bundle load (MUST call within 20 sec after forceUpdate)
+     * Confirm successful bundle load (MUST call within the canary timeout after forceUpdate:
+     * 20 sec until load times are measured, then adapted to the device, see getVersionInfo().canaryTimeoutMs)
      *
      * @param {string} version - Current version
      * @param {Function} [callback] - Optional callback
@@ -142,6 +302,67 @@ var HotUpdates = {
         );
     },
 
+    /**
+     * Push the canary deadline of a slow load that still makes progress.
+     * Each call moves the deadline by the current canary timeout, at most to 5 minutes after the reload.
+     *
+     * @param {Function} [callback] - Optional callback(error|null)
+     *
+     * @example
+     * migration.onProgress = function() {
+     *     hotUpdate.extendCanary();
+     * };
+     */
+    extendCanary: function(callback) {
+        exec(
+            function() {
+                if (callback) callback(null);
+            },
+            function(error) {
+                if (callback) callback({error: error});
+            },
+            'HotUpdates',
+            'extendCanary',
+            []
+        );
+    },
+
+    /**
+     * Switch to an installed version kept on the device (see getVersionInfo().retainedVersions)
+     * and reload the WebView. No download is made. The version left becomes the rollback
+     * target, so canary() must be called for the restored version as after forceUpdate.
+     *
+     * @param {string} version - Retained version to restore (appBundleVersion restores the bundle)
+     * @param {Function} [callback] - Optional callback(error|null)
+     *
+     * @example
+     * hotUpdate.rollbackTo('2.0.0', function(error) {
+     *     if (error && error.error.code === hotUpdate.ErrorCodes.VERSION_NOT_RETAINED) {
+     *         console.log('Version is no longer on the device');
+     *     }
+     * });
+     */
+    rollbackTo: function(version, callback) {
+        if (!version) {
+            if (callback) {
+                callback({error: {code: ErrorCodes.VERSION_REQUIRED, message: 'Version is required'}});
+            }
+            return;
+        }
+
+        exec(
+            function() {
+                if (callback) callback(null);
+            },
+            function(error) {
+                if (callback) callback({error: error});
+            },
+            'HotUpdates',
+            'rollbackTo',
+            [version]
+        );
+    },
+
     /**
      * Get list of problematic versions
      *
@@ -179,7 +400,9 @@ var HotUpdates = {
      *     canaryVersion: string|null,
      *     pendingVersion: string|null,
      *     hasPendingUpdate: boolean,
-     *     ignoreList: string[]
+     *     ignoreList: string[],
+     *     retainedVersions: string[],  // rollbackTo targets, newest first
+     *     canaryTimeoutMs: number      // canary timeout of the next load
      *   }
      *
      * @example
@@ -199,6 +422,57 @@ var HotUpdates = {
             'getVersionInfo',
             []
         );
+    },
+
+    /**
+     * Get timings of the update pipeline (in-memory ring buffer, oldest sample first)
+     *
+     * @param {Object} [options] - Options
+     * @param {boolean} [options.clear=false] - Drop the returned samples, so the next call only returns new ones
+     * @param {Function} callback - Callback with metrics
+     *   {
+     *     capacity: number,      // samples kept, older ones are overwritten
+     *     dropped: number,       // samples overwritten since the last clear
+     *     freeBytes: number,     // free space of the app's data volume now
+     *     memory: {              // process memory (Android resident set, iOS footprint), -1 if unknown
+     *       currentBytes: number,
+     *       peakBytes: number    // high-water mark since the process started
+     *     },
+     *     samples: [{
+     *       stage: string,       // 'dns' | 'connect' | 'tls' | 'ttfb' | 'download' | 'validate' | 'extract' |
+     *                            // 'copy' | 'stage' | 'install' | 'cacheClear' | 'reload' | 'canary' |
+     *                            // 'warmup'
+     *       durationMs: number,
+     *       timestamp: number,   // end of the stage, ms since epoch
+     *       bytes: number,       // download and extract only
+     *       freeBytes: number    // free space at the end of the stage
+     *     }]
+     *   }
+     *
+     * @example
+     * hotUpdate.getMetrics({clear: true}, function(metrics) {
+     *     metrics.samples.forEach(function(s) {
+     *         analytics.timing('hot_update_' + s.stage, s.durationMs);
+     *     });
+     * });
+     */
+    getMetrics: function(options, callback) {
+        if (typeof options === 'function') {
+            callback = options;
+            options = {};
+        }
+
+        exec(
+            function(metrics) {
+                if (callback) callback(metrics);
+            },
+            function(error) {
+                if (callback) callback({error: error});
+            },
+            'HotUpdates',
+            'getMetrics',
+            [options || {}]
+        );
     }
 };
 